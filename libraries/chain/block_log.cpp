@@ -49,7 +49,11 @@ namespace hive { namespace chain {
         // only accessed when appending a block, doesn't need locking
         ssize_t block_log_size;
 
+        // block log is appended by another process (see block_log::open)
+        bool read_only = false;
+
         signed_block read_block_from_offset_and_size(uint64_t offset, uint64_t size);
+        void refresh_head();
     };
 
     void block_log_impl::write_with_retry(int fd, const void* buf, size_t nbyte)
@@ -145,12 +149,45 @@ namespace hive { namespace chain {
     }
   }
 
-  void block_log::open( const fc::path& file )
+  /// Follows the block log appended by other process. Head is the last block which successor is already indexed,
+  /// since only then the size of the block is known for sure.
+  void detail::block_log_impl::refresh_head()
+  {
+    const uint32_t indexed_blocks = get_file_size(block_index_fd) / sizeof(uint64_t);
+    if (indexed_blocks < 2)
+      return;
+
+    const uint32_t head_block_num = indexed_blocks - 1;
+    boost::shared_ptr<signed_block> head_block = head.load();
+    if (head_block && head_block->block_num() >= head_block_num)
+      return;
+
+    uint64_t offsets[2] = {0, 0};
+    auto bytes_read = pread_with_retry(block_index_fd, &offsets, sizeof(offsets), sizeof(uint64_t) * (head_block_num - 1));
+    FC_ASSERT(bytes_read == sizeof(offsets));
+    head.exchange(boost::make_shared<signed_block>(read_block_from_offset_and_size(offsets[0], offsets[1] - offsets[0] - sizeof(uint64_t))));
+  }
+
+  void block_log::open( const fc::path& file, bool read_only )
   {
     close();
 
     my->block_file = file;
     my->index_file = fc::path( file.generic_string() + ".index" );
+    my->read_only = read_only;
+
+    if( read_only )
+    {
+      my->block_log_fd = ::open(my->block_file.generic_string().c_str(), O_RDONLY | O_CLOEXEC);
+      if (my->block_log_fd == -1)
+        FC_THROW("Error opening block log file ${filename}: ${error}", ("filename", my->block_file)("error", strerror(errno)));
+      my->block_index_fd = ::open(my->index_file.generic_string().c_str(), O_RDONLY | O_CLOEXEC);
+      if (my->block_index_fd == -1)
+        FC_THROW("Error opening block index file ${filename}: ${error}", ("filename", my->index_file)("error", strerror(errno)));
+      my->block_log_size = get_file_size(my->block_log_fd);
+      my->refresh_head();
+      return;
+    }
 
     my->block_log_fd = ::open(my->block_file.generic_string().c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
     if (my->block_log_fd == -1)
@@ -296,6 +333,8 @@ namespace hive { namespace chain {
   {
     try
     {
+      FC_ASSERT( !my->read_only, "Cannot append to block log opened in read only mode" );
+
       uint64_t block_start_pos = my->block_log_size;
       std::vector<char> serialized_block = fc::raw::pack_to_vector(b);
 
@@ -334,6 +373,8 @@ namespace hive { namespace chain {
       // first, check if it's the current head block; if so, we can just return it.  If the
       // block number is less than than the current head, it's guaranteed to have been fully
       // written to the log+index
+      if (my->read_only && my->block_log_fd != -1)
+        my->refresh_head();
       boost::shared_ptr<signed_block> head_block = my->head.load();
       /// \warning ignore block 0 which is invalid, but old API also returned empty result for it (instead of assert).
       if (block_num == 0 || !head_block || block_num > head_block->block_num())
@@ -363,6 +404,8 @@ namespace hive { namespace chain {
 
       // first, check if the last block we want is the current head block; if so, we can 
       // will use it and then load the previous blocks from the block log
+      if (my->read_only && my->block_log_fd != -1)
+        my->refresh_head();
       boost::shared_ptr<signed_block> head_block = my->head.load();
       if (!head_block || first_block_num > head_block->block_num())
         return result; // the caller is asking for blocks after the head block, we don't have them
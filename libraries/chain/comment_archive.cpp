@@ -0,0 +1,451 @@
+#include <hive/chain/comment_archive.hpp>
+
+#include <fc/bloom_filter.hpp>
+#include <fc/io/raw.hpp>
+
+#include <rocksdb/db.h>
+#include <rocksdb/options.h>
+#include <rocksdb/slice.h>
+#include <rocksdb/write_batch.h>
+
+#include <boost/endian/conversion.hpp>
+
+#include <mutex>
+#include <unordered_map>
+
+#define COMMENT_ARCHIVE_BY_HASH 1
+#define COMMENT_ARCHIVE_BY_ID   2
+
+#define COMMENT_ARCHIVE_LIB_KEY        "lib"
+#define COMMENT_ARCHIVE_COUNT_KEY      "count"
+#define COMMENT_ARCHIVE_MIN_PROJECTION 16*1024*1024
+#define COMMENT_ARCHIVE_FALSE_POSITIVE 0.001
+
+#define checkStatus(s) FC_ASSERT((s).ok(), "Comment archive data access failed: ${m}", ("m", (s).ToString()))
+
+namespace hive { namespace chain {
+
+namespace detail {
+
+using ::rocksdb::ColumnFamilyDescriptor;
+using ::rocksdb::ColumnFamilyHandle;
+using ::rocksdb::ColumnFamilyOptions;
+using ::rocksdb::DB;
+using ::rocksdb::Options;
+using ::rocksdb::PinnableSlice;
+using ::rocksdb::ReadOptions;
+using ::rocksdb::Slice;
+using ::rocksdb::WriteBatch;
+
+class comment_archive_impl
+{
+  public:
+    ~comment_archive_impl() { close(); }
+
+    void open( const fc::path& dir, uint64_t projected_comment_count );
+    void close();
+
+    void store( const comment_object& comment );
+    void flush( uint32_t last_irreversible_block );
+
+    const comment_object* find( const comment_object::author_and_permlink_hash_type& hash );
+    const comment_object* find( const comment_id_type& id );
+    std::shared_ptr< const comment_object > load( const comment_object::author_and_permlink_hash_type& hash );
+
+    typedef std::vector< ColumnFamilyDescriptor > column_definitions;
+    column_definitions prepare_column_definitions( bool add_default_column )const;
+
+    void build_bloom_filter( uint64_t projected_comment_count );
+
+    uint64_t read_meta_value( const char* key )const;
+    void write_meta_value( const char* key, uint64_t value );
+
+    static Slice to_slice( const comment_object::author_and_permlink_hash_type& hash )
+    {
+      return Slice( hash.data(), hash.data_size() );
+    }
+
+    bool read( const comment_object::author_and_permlink_hash_type& hash, PinnableSlice& data );
+    static std::unique_ptr< comment_object > unpack( const PinnableSlice& data );
+    const comment_object* materialize( const PinnableSlice& data );
+    const comment_object* find_materialized( const comment_id_type& id )const;
+    void release_materialized();
+
+    std::unique_ptr< DB >                 _storage;
+    std::vector< ColumnFamilyHandle* >    _column_handles;
+    WriteBatch                            _write_batch;
+
+    fc::bloom_filter                      _bloom;
+    uint64_t                              _last_irreversible_block = 0;
+    uint64_t                              _comment_count = 0;
+    uint64_t                              _pending_count = 0;
+
+    mutable std::atomic< uint64_t >       _lookups = { 0 };
+    mutable std::atomic< uint64_t >       _bloom_rejections = { 0 };
+    mutable std::atomic< uint64_t >       _hits = { 0 };
+    uint64_t                              _stored = 0;
+
+    /// comments already returned by find() (by comment id), lookups run concurrently under read lock
+    mutable std::mutex                    _materialized_mutex;
+    std::unordered_map< uint32_t, std::unique_ptr< comment_object > > _materialized;
+};
+
+namespace
+{
+  class id_slice_t : public Slice
+  {
+    public:
+      explicit id_slice_t( uint32_t id ) : _value( boost::endian::native_to_big( id ) )
+      {
+        data_ = reinterpret_cast< const char* >( &_value );
+        size_ = sizeof( _value );
+      }
+
+    private:
+      uint32_t _value;
+  };
+}
+
+comment_archive_impl::column_definitions comment_archive_impl::prepare_column_definitions( bool add_default_column )const
+{
+  column_definitions column_defs;
+  if( add_default_column )
+    column_defs.emplace_back( ::rocksdb::kDefaultColumnFamilyName, ColumnFamilyOptions() );
+
+  column_defs.emplace_back( "comment_by_hash", ColumnFamilyOptions() );
+  column_defs.emplace_back( "comment_hash_by_id", ColumnFamilyOptions() );
+
+  return column_defs;
+}
+
+void comment_archive_impl::open( const fc::path& dir, uint64_t projected_comment_count )
+{
+  FC_ASSERT( !_storage, "Comment archive is already open" );
+
+  fc::create_directories( dir );
+
+  Options options;
+  /// Optimize RocksDB. This is the easiest way to get RocksDB to perform well
+  options.IncreaseParallelism();
+  options.OptimizeLevelStyleCompaction();
+  /// Lookups by hash are point lookups only
+  options.OptimizeForPointLookup( 64 );
+
+  DB* db = nullptr;
+  auto column_defs = prepare_column_definitions( true );
+  auto s = DB::Open( options, dir.string(), column_defs, &_column_handles, &db );
+
+  if( !s.ok() )
+  {
+    /// Storage does not exist yet (or misses column families) - create it
+    options.create_if_missing = true;
+    s = DB::Open( options, dir.string(), &db );
+    checkStatus( s );
+
+    column_defs = prepare_column_definitions( false );
+    s = db->CreateColumnFamilies( column_defs, &_column_handles );
+    checkStatus( s );
+
+    _column_handles.insert( _column_handles.begin(), db->DefaultColumnFamily() );
+    ilog( "Created comment archive storage at: `${p}'", ("p", dir.string()) );
+  }
+
+  _storage.reset( db );
+
+  _last_irreversible_block = read_meta_value( COMMENT_ARCHIVE_LIB_KEY );
+  _comment_count = read_meta_value( COMMENT_ARCHIVE_COUNT_KEY );
+
+  build_bloom_filter( projected_comment_count );
+
+  ilog( "Opened comment archive holding ${c} comments, written up to irreversible block ${b}",
+    ("c", _comment_count)("b", _last_irreversible_block) );
+}
+
+void comment_archive_impl::close()
+{
+  if( !_storage )
+    return;
+
+  if( _pending_count )
+    wlog( "Closing comment archive with ${n} comments not flushed - they will be archived again", ("n", _pending_count) );
+  _write_batch.Clear();
+  _pending_count = 0;
+  release_materialized();
+
+  ::rocksdb::FlushOptions flush_options;
+  for( auto* handle : _column_handles )
+  {
+    auto s = _storage->Flush( flush_options, handle );
+    if( !s.ok() )
+      elog( "Cannot flush comment archive column family. Error: `${e}'", ("e", s.ToString()) );
+  }
+
+  for( auto* handle : _column_handles )
+  {
+    if( handle == _storage->DefaultColumnFamily() )
+      continue;
+    auto s = _storage->DestroyColumnFamilyHandle( handle );
+    if( !s.ok() )
+      elog( "Cannot destroy comment archive column family handle. Error: `${e}'", ("e", s.ToString()) );
+  }
+  _column_handles.clear();
+  _storage.reset();
+}
+
+uint64_t comment_archive_impl::read_meta_value( const char* key )const
+{
+  std::string data;
+  auto s = _storage->Get( ReadOptions(), _column_handles[ 0 ], key, &data );
+  if( s.IsNotFound() )
+    return 0;
+  checkStatus( s );
+
+  uint64_t value = 0;
+  FC_ASSERT( data.size() == sizeof( value ), "Corrupted comment archive meta value ${k}", ("k", key) );
+  memcpy( &value, data.data(), sizeof( value ) );
+  return value;
+}
+
+void comment_archive_impl::write_meta_value( const char* key, uint64_t value )
+{
+  auto s = _write_batch.Put( _column_handles[ 0 ], key, Slice( reinterpret_cast< const char* >( &value ), sizeof( value ) ) );
+  checkStatus( s );
+}
+
+void comment_archive_impl::build_bloom_filter( uint64_t projected_comment_count )
+{
+  fc::bloom_parameters parameters;
+  parameters.projected_element_count = std::max< uint64_t >( { projected_comment_count, 2 * _comment_count, COMMENT_ARCHIVE_MIN_PROJECTION } );
+  parameters.false_positive_probability = COMMENT_ARCHIVE_FALSE_POSITIVE;
+  parameters.compute_optimal_parameters();
+
+  _bloom = fc::bloom_filter( parameters );
+
+  if( _comment_count == 0 )
+    return;
+
+  ilog( "Building comment archive bloom filter for ${c} comments...", ("c", _comment_count) );
+
+  /// hash_by_id holds only hashes as values, so it is much cheaper to scan than comment_by_hash
+  std::unique_ptr< ::rocksdb::Iterator > it( _storage->NewIterator( ReadOptions(), _column_handles[ COMMENT_ARCHIVE_BY_ID ] ) );
+  for( it->SeekToFirst(); it->Valid(); it->Next() )
+  {
+    auto hash = it->value();
+    _bloom.insert( hash.data(), hash.size() );
+  }
+  checkStatus( it->status() );
+}
+
+void comment_archive_impl::store( const comment_object& comment )
+{
+  const auto& hash = comment.get_author_and_permlink_hash();
+  auto packed = fc::raw::pack_to_vector( comment );
+
+  auto s = _write_batch.Put( _column_handles[ COMMENT_ARCHIVE_BY_HASH ], to_slice( hash ), Slice( packed.data(), packed.size() ) );
+  checkStatus( s );
+  s = _write_batch.Put( _column_handles[ COMMENT_ARCHIVE_BY_ID ], id_slice_t( comment.get_id().get_value() ), to_slice( hash ) );
+  checkStatus( s );
+
+  _bloom.insert( hash.data(), hash.data_size() );
+  ++_pending_count;
+}
+
+void comment_archive_impl::flush( uint32_t last_irreversible_block )
+{
+  FC_ASSERT( last_irreversible_block >= _last_irreversible_block,
+    "Comment archive cannot go back from irreversible block ${o} to ${n}", ("o", _last_irreversible_block)("n", last_irreversible_block) );
+
+  /// nothing to write - there is no need to track irreversible block as long as no comment depends on it
+  if( _pending_count == 0 )
+    return;
+
+  uint64_t new_count = _comment_count + _pending_count;
+  write_meta_value( COMMENT_ARCHIVE_LIB_KEY, last_irreversible_block );
+  write_meta_value( COMMENT_ARCHIVE_COUNT_KEY, new_count );
+
+  auto s = _storage->Write( ::rocksdb::WriteOptions(), &_write_batch );
+  checkStatus( s );
+  _write_batch.Clear();
+
+  _stored += _pending_count;
+  _comment_count = new_count;
+  _pending_count = 0;
+  _last_irreversible_block = last_irreversible_block;
+}
+
+std::unique_ptr< comment_object > comment_archive_impl::unpack( const PinnableSlice& data )
+{
+  fc::datastream< const char* > ds( data.data(), data.size() );
+  return std::unique_ptr< comment_object >( new comment_object( nullptr, 0, [&]( comment_object& c )
+  {
+    fc::raw::unpack( ds, c );
+  } ) );
+}
+
+const comment_object* comment_archive_impl::materialize( const PinnableSlice& data )
+{
+  std::unique_ptr< comment_object > comment = unpack( data );
+
+  /// other thread might have materialized the same comment in the meantime - its object has to be returned then
+  std::lock_guard< std::mutex > guard( _materialized_mutex );
+  auto& slot = _materialized[ comment->get_id().get_value() ];
+  if( !slot )
+    slot = std::move( comment );
+  return slot.get();
+}
+
+const comment_object* comment_archive_impl::find_materialized( const comment_id_type& id )const
+{
+  std::lock_guard< std::mutex > guard( _materialized_mutex );
+  auto found = _materialized.find( id.get_value() );
+  return found == _materialized.end() ? nullptr : found->second.get();
+}
+
+void comment_archive_impl::release_materialized()
+{
+  std::lock_guard< std::mutex > guard( _materialized_mutex );
+  _materialized.clear();
+}
+
+bool comment_archive_impl::read( const comment_object::author_and_permlink_hash_type& hash, PinnableSlice& data )
+{
+  ++_lookups;
+
+  if( !_bloom.contains( hash.data(), hash.data_size() ) )
+  {
+    ++_bloom_rejections;
+    return false;
+  }
+
+  auto s = _storage->Get( ReadOptions(), _column_handles[ COMMENT_ARCHIVE_BY_HASH ], to_slice( hash ), &data );
+  if( s.IsNotFound() )
+    return false;
+  checkStatus( s );
+
+  ++_hits;
+  return true;
+}
+
+const comment_object* comment_archive_impl::find( const comment_object::author_and_permlink_hash_type& hash )
+{
+  PinnableSlice data;
+  if( !read( hash, data ) )
+    return nullptr;
+  return materialize( data );
+}
+
+std::shared_ptr< const comment_object > comment_archive_impl::load( const comment_object::author_and_permlink_hash_type& hash )
+{
+  PinnableSlice data;
+  if( !read( hash, data ) )
+    return std::shared_ptr< const comment_object >();
+  return std::shared_ptr< const comment_object >( unpack( data ) );
+}
+
+const comment_object* comment_archive_impl::find( const comment_id_type& id )
+{
+  ++_lookups;
+
+  const comment_object* materialized = find_materialized( id );
+  if( materialized != nullptr )
+  {
+    ++_hits;
+    return materialized;
+  }
+
+  PinnableSlice hash_data;
+  auto s = _storage->Get( ReadOptions(), _column_handles[ COMMENT_ARCHIVE_BY_ID ], id_slice_t( id.get_value() ), &hash_data );
+  if( s.IsNotFound() )
+    return nullptr;
+  checkStatus( s );
+
+  PinnableSlice data;
+  s = _storage->Get( ReadOptions(), _column_handles[ COMMENT_ARCHIVE_BY_HASH ], Slice( hash_data.data(), hash_data.size() ), &data );
+  checkStatus( s );
+
+  ++_hits;
+  return materialize( data );
+}
+
+} // detail
+
+comment_archive::comment_archive() : my( new detail::comment_archive_impl() ) {}
+comment_archive::~comment_archive() {}
+
+void comment_archive::open( const fc::path& dir, uint64_t projected_comment_count )
+{
+  my->open( dir, projected_comment_count );
+}
+
+void comment_archive::close()
+{
+  my->close();
+}
+
+void comment_archive::wipe( const fc::path& dir )
+{
+  if( !fc::exists( dir ) )
+    return;
+
+  auto s = ::rocksdb::DestroyDB( dir.string(), ::rocksdb::Options() );
+  if( !s.ok() )
+    wlog( "Cannot destroy comment archive storage. Error: `${e}'", ("e", s.ToString()) );
+  fc::remove_all( dir );
+}
+
+bool comment_archive::is_open()const
+{
+  return my->_storage != nullptr;
+}
+
+void comment_archive::store( const comment_object& comment )
+{
+  my->store( comment );
+}
+
+void comment_archive::flush( uint32_t last_irreversible_block )
+{
+  my->flush( last_irreversible_block );
+}
+
+uint32_t comment_archive::get_last_irreversible_block()const
+{
+  return my->_last_irreversible_block;
+}
+
+uint64_t comment_archive::get_comment_count()const
+{
+  return my->_comment_count;
+}
+
+const comment_object* comment_archive::find( const comment_object::author_and_permlink_hash_type& hash )const
+{
+  return my->find( hash );
+}
+
+const comment_object* comment_archive::find( const comment_id_type& id )const
+{
+  return my->find( id );
+}
+
+std::shared_ptr< const comment_object > comment_archive::load( const comment_object::author_and_permlink_hash_type& hash )const
+{
+  return my->load( hash );
+}
+
+void comment_archive::release_found_comments()
+{
+  my->release_materialized();
+}
+
+comment_archive::stats comment_archive::get_stats()const
+{
+  stats result;
+  result.lookups = my->_lookups.load();
+  result.bloom_rejections = my->_bloom_rejections.load();
+  result.hits = my->_hits.load();
+  result.stored = my->_stored;
+  return result;
+}
+
+} } // hive::chain
@@ -6,6 +6,7 @@
 #include <hive/protocol/get_config.hpp>
 
 #include <hive/chain/block_summary_object.hpp>
+#include <hive/chain/comment_archive.hpp>
 #include <hive/chain/compound.hpp>
 #include <hive/chain/custom_operation_interpreter.hpp>
 #include <hive/chain/database.hpp>
@@ -124,8 +125,17 @@ class database_impl
 database_impl::database_impl( database& self )
   : _self(self), _evaluator_registry(self), _req_action_evaluator_registry(self), _opt_action_evaluator_registry(self) {}
 
+// names under which handling of undo state is recorded by advanced benchmark
+static const std::string undo_start_session_name = "undo--->start_session";
+static const std::string undo_push_session_name = "undo--->push_session";
+static const std::string undo_squash_name = "undo--->squash";
+static const std::string undo_commit_name = "undo--->commit";
+
 database::database()
-  : _my( new database_impl(*this) ) {}
+  : _my( new database_impl(*this) )
+{
+  init_notification_benchmark();
+}
 
 database::~database()
 {
@@ -143,10 +153,25 @@ void database::open( const open_args& args )
                                                 appbase::app().get_plugins_names(),
                                                 []( const std::string& message ){ wlog( message.c_str() ); }
                                               );
+    set_address_space_reserve( args.shared_file_max_size );
+    set_mapping_options( args.shared_file_mapping );
+    if( args.shared_file_mapping.prefault_threads )
+      ilog( "Prefaulting shared memory file with ${n} threads...", ("n", args.shared_file_mapping.prefault_threads) );
     chainbase::database::open( args.shared_mem_dir, args.chainbase_flags, args.shared_file_size, args.database_cfg, &environment_extension, args.force_replay );
 
+    if( !get_open_durability_marker().clean )
+      wlog( "Shared memory file was modified after it was last flushed at revision ${r} (node was not closed properly). State might be inconsistent, replay is needed if the node fails.",
+        ("r", get_open_durability_marker().flushed_revision) );
+
     initialize_indexes();
     initialize_evaluators();
+
+    if( is_replica() )
+    {
+      open_replica( args );
+      return;
+    }
+
     initialize_irreversible_storage();
 
     if( !find< dynamic_global_property_object >() )
@@ -195,6 +220,8 @@ void database::open( const open_args& args )
       }
     });
 
+    open_comment_archive( args );
+
     if( head_block_num() )
     {
       optional<signed_block> head_block = _block_log.read_block_by_num( head_block_num() );
@@ -232,6 +259,7 @@ void database::open( const open_args& args )
 
     _shared_file_full_threshold = args.shared_file_full_threshold;
     _shared_file_scale_rate = args.shared_file_scale_rate;
+    _shared_file_max_size = args.shared_file_max_size;
 
     auto account = find< account_object, by_name >( "nijeah" );
     if( account != nullptr && account->to_withdraw < 0 )
@@ -248,6 +276,33 @@ void database::open( const open_args& args )
   FC_CAPTURE_LOG_AND_RETHROW( (args.data_dir)(args.shared_mem_dir)(args.shared_file_size) )
 }
 
+void database::open_replica( const open_args& args )
+{
+  // comments moved to archive by the writer would not be visible, since archive storage can't follow writes of other process
+  FC_ASSERT( !args.comment_archive && !fc::exists( args.shared_mem_dir / HIVE_COMMENT_ARCHIVE_DIR ),
+    "Read only replica can't serve state of node that uses comment archive" );
+
+  // state is owned by the writer process - only local data is initialized, nothing can be written to shared memory
+  irreversible_object = get_segment_manager()->find_no_lock< irreversible_object_type >( "irreversible" ).first;
+  FC_ASSERT( irreversible_object != nullptr, "Shared memory file was not initialized by the writer yet" );
+
+  _block_log.open( args.data_dir / "block_log", true /*read_only*/ );
+
+  with_read_lock( [&]()
+  {
+    init_hardforks();
+
+#ifndef IS_TEST_NET
+    const auto& hardforks = get_hardfork_property_object();
+    if( hardforks.last_hardfork >= HIVE_HARDFORK_1_24 )
+      set_chain_id( HIVE_CHAIN_ID );
+#endif /// IS_TEST_NET
+
+    ilog( "Opened read only replica of blockchain database at head block: ${hb}, last irreversible block: ${lb}, generation: ${g}",
+      ("hb", head_block_num())("lb", get_last_irreversible_block_num())("g", get_replica_generation()) );
+  });
+}
+
 uint32_t database::reindex_internal( const open_args& args, signed_block& block )
 {
   uint64_t skip_flags =
@@ -420,6 +475,7 @@ void database::wipe( const fc::path& data_dir, const fc::path& shared_mem_dir, b
   if( get_is_open() )
     close();
   chainbase::database::wipe( shared_mem_dir );
+  comment_archive::wipe( shared_mem_dir / HIVE_COMMENT_ARCHIVE_DIR );
   if( include_blocks )
   {
     fc::remove_all( data_dir / "block_log" );
@@ -439,14 +495,23 @@ void database::close(bool rewind)
     // Since pop_block() will move tx's in the popped blocks into pending,
     // we have to clear_pending() after we're done popping to get a clean
     // DB state (issue #336).
-    clear_pending();
-
-    chainbase::database::flush();
+    if( !is_replica() )
+    {
+      end_irreversible_fast_apply();
+      clear_pending();
+      chainbase::database::flush();
+    }
 
     auto lib = this->get_last_irreversible_block_num();
 
     ilog("Database flushed at last irreversible block: ${b}", ("b", lib));
 
+    if( _comment_archive )
+    {
+      _comment_archive->close();
+      _comment_archive.reset();
+    }
+
     chainbase::database::close();
 
     _block_log.close();
@@ -756,18 +821,34 @@ const account_object* database::find_account( const account_name_type& name )con
 
 const comment_object& database::get_comment( comment_id_type comment_id )const try
 {
-  return get< comment_object, by_id >( comment_id );
+  const comment_object* comment = find< comment_object, by_id >( comment_id );
+  if( comment == nullptr && _comment_archive )
+    comment = _comment_archive->find( comment_id );
+  if( comment == nullptr )
+    CHAINBASE_THROW_EXCEPTION( std::out_of_range( "key not found" ) );
+  return *comment;
 }
 FC_CAPTURE_AND_RETHROW( (comment_id) )
 
+const comment_object* database::find_comment( const fc::ripemd160& author_and_permlink_hash )const
+{
+  const comment_object* comment = find< comment_object, by_permlink >( author_and_permlink_hash );
+  if( comment == nullptr && _comment_archive )
+    comment = _comment_archive->find( author_and_permlink_hash );
+  return comment;
+}
+
 const comment_object& database::get_comment( const account_id_type& author, const shared_string& permlink )const
 { try {
-  return get< comment_object, by_permlink >( comment_object::compute_author_and_permlink_hash( author, to_string( permlink ) ) );
+  const comment_object* comment = find_comment( author, permlink );
+  if( comment == nullptr )
+    CHAINBASE_THROW_EXCEPTION( std::out_of_range( "key not found" ) );
+  return *comment;
 } FC_CAPTURE_AND_RETHROW( (author)(permlink) ) }
 
 const comment_object* database::find_comment( const account_id_type& author, const shared_string& permlink )const
 {
-  return find< comment_object, by_permlink >( comment_object::compute_author_and_permlink_hash( author, to_string( permlink ) ) );
+  return find_comment( comment_object::compute_author_and_permlink_hash( author, to_string( permlink ) ) );
 }
 
 const comment_object& database::get_comment( const account_name_type& author, const shared_string& permlink )const
@@ -786,12 +867,15 @@ const comment_object* database::find_comment( const account_name_type& author, c
 
 const comment_object& database::get_comment( const account_id_type& author, const string& permlink )const
 { try {
-  return get< comment_object, by_permlink >( comment_object::compute_author_and_permlink_hash( author, permlink ) );
+  const comment_object* comment = find_comment( author, permlink );
+  if( comment == nullptr )
+    CHAINBASE_THROW_EXCEPTION( std::out_of_range( "key not found" ) );
+  return *comment;
 } FC_CAPTURE_AND_RETHROW( (author)(permlink) ) }
 
 const comment_object* database::find_comment( const account_id_type& author, const string& permlink )const
 {
-  return find< comment_object, by_permlink >( comment_object::compute_author_and_permlink_hash( author, permlink ) );
+  return find_comment( comment_object::compute_author_and_permlink_hash( author, permlink ) );
 }
 
 const comment_object& database::get_comment( const account_name_type& author, const string& permlink )const
@@ -808,6 +892,19 @@ const comment_object* database::find_comment( const account_name_type& author, c
 
 #endif
 
+std::shared_ptr< const comment_object > database::find_comment_for_api( const account_name_type& author, const string& permlink )const
+{
+  const account_object* acc = find_account( author );
+  if( acc == nullptr )
+    return std::shared_ptr< const comment_object >();
+
+  auto hash = comment_object::compute_author_and_permlink_hash( acc->get_id(), permlink );
+  const comment_object* comment = find< comment_object, by_permlink >( hash );
+  if( comment != nullptr )
+    return std::shared_ptr< const comment_object >( std::shared_ptr< const comment_object >(), comment ); // not owning
+  return _comment_archive ? _comment_archive->load( hash ) : std::shared_ptr< const comment_object >();
+}
+
 const escrow_object& database::get_escrow( const account_name_type& name, uint32_t escrow_id )const
 { try {
   return get< escrow_object, by_from_id >( boost::make_tuple( name, escrow_id ) );
@@ -874,7 +971,7 @@ const comment_object& database::get_comment_for_payout_time( const comment_objec
   if( has_hardfork( HIVE_HARDFORK_0_17__769 ) || comment.is_root() )
     return comment;
   else
-    return get< comment_object >( comment.get_root_id() );
+    return get_comment( comment.get_root_id() );
 }
 
 const time_point_sec database::calculate_discussion_payout_time( const comment_object& comment )const
@@ -948,10 +1045,23 @@ void database::remove_old_comments()
   {
     const auto& current = *itr;
     ++itr;
+    mark_comment_paid_out( current.get_comment_id() );
     remove( current );
   }
 }
 
+void database::mark_comment_paid_out( comment_id_type comment_id )
+{
+  if( !_comment_archive )
+    return;
+
+  create< volatile_comment_object >( [&]( volatile_comment_object& vc )
+  {
+    vc.comment = comment_id;
+    vc.block = head_block_num();
+  } );
+}
+
 asset database::get_effective_vesting_shares( const account_object& account, asset_symbol_type vested_symbol )const
 {
   if( vested_symbol == VESTS_SYMBOL )
@@ -1000,6 +1110,8 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
 {
   //fc::time_point begin_time = fc::time_point::now();
 
+  end_irreversible_fast_apply();
+
   auto block_num = new_block.block_num();
   if( _checkpoints.size() && _checkpoints.rbegin()->second != block_id_type() )
   {
@@ -1045,6 +1157,112 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
   return result;
 }
 
+bool database::is_known_irreversible( uint32_t block_num )const
+{
+  return _checkpoints.size() && _checkpoints.rbegin()->second != block_id_type() &&
+    _checkpoints.rbegin()->first >= block_num;
+}
+
+void database::push_irreversible_block( const signed_block& new_block, uint32_t skip )
+{
+  auto block_num = new_block.block_num();
+  FC_ASSERT( is_known_irreversible( block_num ), "Block is not covered by checkpoint", ("block_num", block_num) );
+
+  auto itr = _checkpoints.find( block_num );
+  if( itr != _checkpoints.end() )
+    FC_ASSERT( new_block.id() == itr->second, "Block did not match checkpoint", ("checkpoint",*itr)("block_id",new_block.id()) );
+  FC_ASSERT( new_block.previous == head_block_id(), "Irreversible block does not link to head block",
+    ("block_num", block_num)("previous", new_block.previous)("head", head_block_id()) );
+
+  // Block can't be undone, and only block at checkpoint height is compared with checkpoint id, so it must be
+  // signed by witness scheduled for its slot - otherwise any peer could feed forged blocks linking to head.
+  // Checked before anything is changed, since there is no undo session to revert failed block.
+  validate_block_header( skip & ~( skip_witness_signature | skip_witness_schedule_check ), new_block );
+
+  begin_irreversible_fast_apply();
+
+  // same checks as with checkpointed block in push_block, but also without fork database and undo session;
+  // merkle check stays, so transactions are still tied to checkpointed block ids (witness signature and
+  // schedule were verified above)
+  skip |= skip_witness_signature
+       | skip_transaction_signatures
+       | skip_transaction_dupe_check
+       | skip_fork_db
+       | skip_block_size_check
+       | skip_tapos_check
+       | skip_authority_check
+       | skip_undo_history_check
+       | skip_witness_schedule_check
+       | skip_validate
+       | skip_validate_invariants
+       | skip_block_log
+       ;
+
+  try
+  {
+    // undo session lives only until the block is applied and is committed right away, so no undo history
+    // is kept, but block that fails to apply is reverted and rejected like any other invalid block
+    auto session = start_undo_session();
+    apply_block( new_block, skip );
+    session.push();
+    commit( revision() );
+  }
+  catch( const fc::exception& e )
+  {
+    elog( "Rejected irreversible block ${b} that failed to apply:\n${e}", ("b", block_num)("e", e.to_detail_string()) );
+    throw;
+  }
+
+  _block_log.append( new_block );
+  check_free_memory( false, block_num );
+}
+
+void database::begin_irreversible_fast_apply()
+{
+  if( _irreversible_fast_apply )
+    return;
+
+  // pending transactions were built on undo session that is about to be dropped
+  clear_pending();
+  _popped_tx.clear();
+
+  // blocks still kept only in fork database are written out to block log, since from now on
+  // block log is what links next blocks to the chain
+  const auto& log_head = _block_log.head();
+  uint32_t log_head_num = log_head ? log_head->block_num() : 0;
+  vector< item_ptr > blocks_to_write;
+  for( uint32_t num = log_head_num + 1; num <= head_block_num(); ++num )
+  {
+    item_ptr block_ptr = _fork_db.fetch_block_on_main_branch_by_number( num );
+    FC_ASSERT( block_ptr, "Fork database does not contain head block branch", ("block_num", num) );
+    blocks_to_write.push_back( block_ptr );
+  }
+  for( const auto& block_ptr : blocks_to_write )
+    _block_log.append( block_ptr->data );
+
+  commit( revision() );
+  // each block gets its own revision, same as in push_block, even though its undo state is committed at once
+  set_revision( head_block_num() );
+  _fork_db.reset();
+  _irreversible_fast_apply = true;
+
+  ilog( "Applying irreversible blocks without undo state from block ${b}", ("b", head_block_num() + 1) );
+}
+
+void database::end_irreversible_fast_apply()
+{
+  if( !_irreversible_fast_apply )
+    return;
+
+  _irreversible_fast_apply = false;
+  set_revision( head_block_num() );
+  const auto& head = _block_log.head();
+  if( head )
+    _fork_db.start_block( *head );
+
+  ilog( "Finished applying irreversible blocks without undo state at block ${b}", ("b", head_block_num()) );
+}
+
 void database::_maybe_warn_multiple_production( uint32_t height )const
 {
   auto blocks = _fork_db.fetch_block_by_number( height );
@@ -1137,9 +1355,17 @@ bool database::_push_block(const signed_block& new_block)
 
   try
   {
+    if( _benchmark_dumper.is_enabled() )
+      _benchmark_dumper.begin();
     auto session = start_undo_session();
+    if( _benchmark_dumper.is_enabled() )
+      _benchmark_dumper.end( undo_start_session_name );
     apply_block(new_block, skip);
+    if( _benchmark_dumper.is_enabled() )
+      _benchmark_dumper.begin();
     session.push();
+    if( _benchmark_dumper.is_enabled() )
+      _benchmark_dumper.end( undo_push_session_name );
   }
   catch( const fc::exception& e )
   {
@@ -1164,6 +1390,7 @@ void database::push_transaction( const signed_transaction& trx, uint32_t skip )
 {
   try
   {
+    end_irreversible_fast_apply();
     try
     {
       FC_ASSERT( fc::raw::pack_size(trx) <= (get_dynamic_global_properties().maximum_block_size - 256) );
@@ -1205,7 +1432,11 @@ void database::_push_transaction( const signed_transaction& trx )
 
   notify_changed_objects();
   // The transaction applied successfully. Merge its changes into the pending block session.
+  if( _benchmark_dumper.is_enabled() )
+    _benchmark_dumper.begin();
   temp_session.squash();
+  if( _benchmark_dumper.is_enabled() )
+    _benchmark_dumper.end( undo_squash_name );
 }
 
 /**
@@ -1260,6 +1491,12 @@ void database::pre_push_virtual_operation( const operation& op )
   ++_current_virtual_op;
   note.virtual_op = _current_virtual_op;
   notify_pre_apply_operation( note );
+
+  // post notification of the same operation reuses impacted accounts computed by pre handlers;
+  // pre/post pairs of virtual operations can nest (f.e. hardfork that consolidates treasury), so they are kept on stack
+  _pending_virtual_ops.emplace_back();
+  auto& pending = _pending_virtual_ops.back();
+  pending.computed = note.take_impacted_accounts( pending.impacted );
 }
 
 void database::post_push_virtual_operation( const operation& op )
@@ -1267,6 +1504,11 @@ void database::post_push_virtual_operation( const operation& op )
   FC_ASSERT( is_virtual_operation( op ) );
   operation_notification note = create_operation_notification( op );
   note.virtual_op = _current_virtual_op;
+  FC_ASSERT( !_pending_virtual_ops.empty(), "post_push_virtual_operation without matching pre_push_virtual_operation" );
+  auto& pending = _pending_virtual_ops.back();
+  if( pending.computed )
+    note.set_impacted_accounts( std::move( pending.impacted ) );
+  _pending_virtual_ops.pop_back();
   notify_post_apply_operation( note );
 }
 
@@ -3061,7 +3303,10 @@ void database::process_comment_cashout()
     if( has_hardfork( HIVE_HARDFORK_0_19__876 ) )
     {
       if( current->cashout_time == fc::time_point_sec::maximum() )
+      {
+        mark_comment_paid_out( current->get_comment_id() );
         remove( *current );
+      }
     }
 
     current = cidx.begin();
@@ -4020,6 +4265,9 @@ void database::check_free_memory( bool force_print, uint32_t current_block_num )
   if( BOOST_UNLIKELY( _shared_file_full_threshold != 0 && _shared_file_scale_rate != 0 && free_mem < ( ( uint128_t( HIVE_100_PERCENT - _shared_file_full_threshold ) * max_mem ) / HIVE_100_PERCENT ).to_uint64() ) )
   {
     uint64_t new_max = ( uint128_t( max_mem * _shared_file_scale_rate ) / HIVE_100_PERCENT ).to_uint64() + max_mem;
+    // stay within reserved address range as long as possible, so the file can grow in place
+    if( max_mem < _shared_file_max_size && new_max > _shared_file_max_size )
+      new_max = _shared_file_max_size;
 
     wlog( "Memory is almost full, increasing to ${mem}M", ("mem", new_max / (1024*1024)) );
 
@@ -4051,12 +4299,26 @@ void database::check_free_memory( bool force_print, uint32_t current_block_num )
   }
 }
 
+// records statement as span of block application phase when block is being traced
+#define TRACE_APPLY_PHASE( name, statement ) \
+  { util::apply_trace_span _phase_span( _apply_tracer, name ); statement; }
+
 void database::_apply_block( const signed_block& next_block )
 {
   block_notification note( next_block );
 
+  _apply_tracer.begin_block( note.block_num );
+  BOOST_SCOPE_EXIT( this_ )
+  {
+    this_->_apply_tracer.end_block();
+  } BOOST_SCOPE_EXIT_END
+
+  // block is applied under write lock, so no reference to comment found in archive can be held anymore
+  if( _comment_archive )
+    _comment_archive->release_found_comments();
+
   try {
-  notify_pre_apply_block( note );
+  TRACE_APPLY_PHASE( "notify_pre_apply_block", notify_pre_apply_block( note ) );
 
   const uint32_t next_block_num = note.block_num;
 
@@ -4071,6 +4333,8 @@ void database::_apply_block( const signed_block& next_block )
   _current_block_num    = next_block_num;
   _current_trx_in_block = 0;
   _current_virtual_op   = 0;
+  // pairs left open by previously failed block
+  _pending_virtual_ops.clear();
 
   if( BOOST_UNLIKELY( next_block_num == 1 ) )
   {
@@ -4109,9 +4373,12 @@ void database::_apply_block( const signed_block& next_block )
     }
   }
 
+  // ids of all transactions are computed at once (batch hashing), together with merkle root when it is checked
+  vector< transaction_id_type > trx_ids;
+  util::apply_trace_span merkle_span( _apply_tracer, "transaction_ids_and_merkle_root" );
   if( !( skip & skip_merkle_check ) )
   {
-    auto merkle_root = next_block.calculate_merkle_root();
+    auto merkle_root = next_block.calculate_merkle_root( trx_ids );
 
     try
     {
@@ -4126,7 +4393,13 @@ void database::_apply_block( const signed_block& next_block )
         throw e;
     }
   }
+  else
+  {
+    trx_ids = next_block.calculate_transaction_ids();
+  }
+  merkle_span.finish();
 
+  util::apply_trace_span header_span( _apply_tracer, "validate_block_header" );
   const witness_object& signing_witness = validate_block_header(skip, next_block);
 
   const auto& gprops = get_dynamic_global_properties();
@@ -4163,79 +4436,92 @@ void database::_apply_block( const signed_block& next_block )
       ("witness",witness)("next_block.witness",next_block.witness)("hardfork_state", hardfork_state)
     );
   }
+  header_span.finish();
 
-  for( const auto& trx : next_block.transactions )
+  util::apply_trace_span transactions_span( _apply_tracer, "transactions" );
+  // impacted accounts of all operations of the block are computed in one pass when first handler needs them
+  _block_impacted.set_block( &next_block );
+  BOOST_SCOPE_EXIT( this_ )
+  {
+    this_->_block_impacted.set_block( nullptr );
+  } BOOST_SCOPE_EXIT_END
+  for( size_t i = 0; i < next_block.transactions.size(); ++i )
   {
+    util::apply_trace_span trx_span( _apply_tracer, "transaction", util::apply_tracer::transaction, int32_t( i ) );
     /* We do not need to push the undo state for each transaction
       * because they either all apply and are valid or the
       * entire block fails to apply.  We only need an "undo" state
       * for transactions when validating broadcast transactions or
       * when building a block.
       */
-    apply_transaction( trx, skip );
+    _apply_transaction( next_block.transactions[i], trx_ids[i] );
     ++_current_trx_in_block;
   }
+  transactions_span.finish();
 
   _current_trx_in_block = -1;
   _current_op_in_trx = 0;
   _current_virtual_op = 0;
 
-  update_global_dynamic_data(next_block);
-  update_signing_witness(signing_witness, next_block);
+  TRACE_APPLY_PHASE( "update_global_dynamic_data", update_global_dynamic_data(next_block) );
+  TRACE_APPLY_PHASE( "update_signing_witness", update_signing_witness(signing_witness, next_block) );
 
-  uint32_t old_last_irreversible = update_last_irreversible_block();
+  uint32_t old_last_irreversible = 0;
+  TRACE_APPLY_PHASE( "update_last_irreversible_block", old_last_irreversible = update_last_irreversible_block() );
 
-  create_block_summary(next_block);
-  clear_expired_transactions();
-  clear_expired_orders();
-  clear_expired_delegations();
+  TRACE_APPLY_PHASE( "create_block_summary", create_block_summary(next_block) );
+  TRACE_APPLY_PHASE( "clear_expired_transactions", clear_expired_transactions() );
+  TRACE_APPLY_PHASE( "clear_expired_orders", clear_expired_orders() );
+  TRACE_APPLY_PHASE( "clear_expired_delegations", clear_expired_delegations() );
 
-  update_witness_schedule(*this);
+  TRACE_APPLY_PHASE( "update_witness_schedule", update_witness_schedule(*this) );
 
-  update_median_feed();
-  update_virtual_supply(); //accommodate potentially new price
+  TRACE_APPLY_PHASE( "update_median_feed", update_median_feed() );
+  TRACE_APPLY_PHASE( "update_virtual_supply", update_virtual_supply() ); //accommodate potentially new price
 
-  clear_null_account_balance();
-  consolidate_treasury_balance();
-  process_funds();
-  process_conversions();
-  process_comment_cashout();
-  process_vesting_withdrawals();
-  process_savings_withdraws();
-  process_subsidized_accounts();
-  pay_liquidity_reward();
-  update_virtual_supply(); //cover changes in HBD supply from above processes
+  TRACE_APPLY_PHASE( "clear_null_account_balance", clear_null_account_balance() );
+  TRACE_APPLY_PHASE( "consolidate_treasury_balance", consolidate_treasury_balance() );
+  TRACE_APPLY_PHASE( "process_funds", process_funds() );
+  TRACE_APPLY_PHASE( "process_conversions", process_conversions() );
+  TRACE_APPLY_PHASE( "process_comment_cashout", process_comment_cashout() );
+  TRACE_APPLY_PHASE( "process_vesting_withdrawals", process_vesting_withdrawals() );
+  TRACE_APPLY_PHASE( "process_savings_withdraws", process_savings_withdraws() );
+  TRACE_APPLY_PHASE( "process_subsidized_accounts", process_subsidized_accounts() );
+  TRACE_APPLY_PHASE( "pay_liquidity_reward", pay_liquidity_reward() );
+  TRACE_APPLY_PHASE( "update_virtual_supply", update_virtual_supply() ); //cover changes in HBD supply from above processes
 
-  account_recovery_processing();
-  expire_escrow_ratification();
-  process_decline_voting_rights();
-  process_proposals( note ); //new HBD converted here does not count towards limit
-  process_delayed_voting( note );
-  remove_expired_governance_votes();
+  TRACE_APPLY_PHASE( "account_recovery_processing", account_recovery_processing() );
+  TRACE_APPLY_PHASE( "expire_escrow_ratification", expire_escrow_ratification() );
+  TRACE_APPLY_PHASE( "process_decline_voting_rights", process_decline_voting_rights() );
+  TRACE_APPLY_PHASE( "process_proposals", process_proposals( note ) ); //new HBD converted here does not count towards limit
+  TRACE_APPLY_PHASE( "process_delayed_voting", process_delayed_voting( note ) );
+  TRACE_APPLY_PHASE( "remove_expired_governance_votes", remove_expired_governance_votes() );
 
-  process_recurrent_transfers();
+  TRACE_APPLY_PHASE( "process_recurrent_transfers", process_recurrent_transfers() );
 
-  generate_required_actions();
-  generate_optional_actions();
+  TRACE_APPLY_PHASE( "generate_required_actions", generate_required_actions() );
+  TRACE_APPLY_PHASE( "generate_optional_actions", generate_optional_actions() );
 
-  process_required_actions( req_actions );
-  process_optional_actions( opt_actions );
+  TRACE_APPLY_PHASE( "process_required_actions", process_required_actions( req_actions ) );
+  TRACE_APPLY_PHASE( "process_optional_actions", process_optional_actions( opt_actions ) );
 
-  process_hardforks();
+  TRACE_APPLY_PHASE( "process_hardforks", process_hardforks() );
 
   // notify observers that the block has been applied
-  notify_post_apply_block( note );
+  TRACE_APPLY_PHASE( "notify_post_apply_block", notify_post_apply_block( note ) );
 
-  notify_changed_objects();
+  TRACE_APPLY_PHASE( "notify_changed_objects", notify_changed_objects() );
 
   // This moves newly irreversible blocks from the fork db to the block log
   // and commits irreversible state to the database. This should always be the
   // last call of applying a block because it is the only thing that is not
   // reversible.
-  migrate_irreversible_state(old_last_irreversible);
+  TRACE_APPLY_PHASE( "migrate_irreversible_state", migrate_irreversible_state(old_last_irreversible) );
 
 } FC_CAPTURE_CALL_LOG_AND_RETHROW( std::bind( &database::notify_fail_apply_block, this, note ), (next_block.block_num()) ) }
 
+#undef TRACE_APPLY_PHASE
+
 struct process_header_visitor
 {
   process_header_visitor( const std::string& witness, required_automated_actions& req_actions, optional_automated_actions& opt_actions, database& db ) :
@@ -4406,10 +4692,14 @@ void database::apply_transaction(const signed_transaction& trx, uint32_t skip)
 }
 
 void database::_apply_transaction(const signed_transaction& trx)
+{
+  _apply_transaction( trx, trx.id() );
+}
+
+void database::_apply_transaction(const signed_transaction& trx, const transaction_id_type& trx_id)
 { try {
-  transaction_notification note(trx);
-  _current_trx_id = note.transaction_id;
-  const transaction_id_type& trx_id = note.transaction_id;
+  transaction_notification note( trx, trx_id );
+  _current_trx_id = trx_id;
   _current_virtual_op = 0;
 
   uint32_t skip = get_node_properties().skip_flags;
@@ -4426,9 +4716,10 @@ void database::_apply_transaction(const signed_transaction& trx)
 
   if( !(skip & (skip_transaction_signatures | skip_authority_check) ) )
   {
-    auto get_active  = [&]( const string& name ) { return authority( get< account_authority_object, by_account >( name ).active ); };
-    auto get_owner   = [&]( const string& name ) { return authority( get< account_authority_object, by_account >( name ).owner );  };
-    auto get_posting = [&]( const string& name ) { return authority( get< account_authority_object, by_account >( name ).posting );  };
+    // authorities are checked directly in shared memory, without copying them into heap allocated authority
+    auto get_active  = [&]( const string& name ) { return authority_view( get< account_authority_object, by_account >( name ).active ); };
+    auto get_owner   = [&]( const string& name ) { return authority_view( get< account_authority_object, by_account >( name ).owner );  };
+    auto get_posting = [&]( const string& name ) { return authority_view( get< account_authority_object, by_account >( name ).posting );  };
 
     try
     {
@@ -4496,6 +4787,8 @@ void database::_apply_transaction(const signed_transaction& trx)
 void database::apply_operation(const operation& op)
 {
   operation_notification note = create_operation_notification( op );
+  if( _block_impacted.has_block() )
+    note.use_block_impacted_accounts( _block_impacted );
   notify_pre_apply_operation( note );
 
   if( _benchmark_dumper.is_enabled() )
@@ -4632,191 +4925,182 @@ void database::apply_optional_action( const optional_automated_action& a )
   notify_post_apply_optional_action( note );
 }
 
-template <typename TFunction> struct fcall {};
-
-template <typename TResult, typename... TArgs>
-struct fcall<TResult(TArgs...)>
-{
-  using TNotification = std::function<TResult(TArgs...)>;
-
-  fcall() = default;
-  fcall(const TNotification& func, util::advanced_benchmark_dumper& dumper,
-      const abstract_plugin& plugin, const std::string& item_name)
-      : _func(func), _benchmark_dumper(dumper)
-    {
-      _name = plugin.get_name() + item_name;
-    }
-
-  void operator () (TArgs&&... args)
-  {
-    if (_benchmark_dumper.is_enabled())
-      _benchmark_dumper.begin();
-
-    _func(std::forward<TArgs>(args)...);
-
-    if (_benchmark_dumper.is_enabled())
-      _benchmark_dumper.end(_name);
-  }
-
-private:
-  TNotification                    _func;
-  util::advanced_benchmark_dumper& _benchmark_dumper;
-  std::string                      _name;
-};
-
-template <typename TResult, typename... TArgs>
-struct fcall<std::function<TResult(TArgs...)>>
-  : public fcall<TResult(TArgs...)>
-{
-  typedef fcall<TResult(TArgs...)> TBase;
-  using TBase::TBase;
-};
-
 template <typename TSignal, typename TNotification>
-boost::signals2::connection database::connect_impl( TSignal& signal, const TNotification& func,
+util::notification_connection database::connect_impl( TSignal& signal, const TNotification& func,
   const abstract_plugin& plugin, int32_t group, const std::string& item_name )
 {
-  fcall<TNotification> fcall_wrapper(func,_benchmark_dumper,plugin,item_name);
-
-  return signal.connect(group, fcall_wrapper);
-}
-
-template< bool IS_PRE_OPERATION >
-boost::signals2::connection database::any_apply_operation_handler_impl( const apply_operation_handler_t& func,
-  const abstract_plugin& plugin, int32_t group )
-{
-  auto complex_func = [this, func, &plugin]( const operation_notification& o )
-  {
-    std::string name;
-
-    if (_benchmark_dumper.is_enabled())
-    {
-      if( _my->_evaluator_registry.is_evaluator( o.op ) )
-        name = _benchmark_dumper.generate_desc< IS_PRE_OPERATION >( plugin.get_name(), _my->_evaluator_registry.get_evaluator( o.op ).get_name( o.op ) );
-      else
-        name = util::advanced_benchmark_dumper::get_virtual_operation_name();
-
-      _benchmark_dumper.begin();
-    }
-
-    func( o );
-
-    if (_benchmark_dumper.is_enabled())
-      _benchmark_dumper.end( name );
+  return signal.connect( group, func, plugin.get_name() + item_name );
+}
+
+void database::init_notification_benchmark()
+{
+  _pre_apply_required_action_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _post_apply_required_action_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _pre_apply_optional_action_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _post_apply_optional_action_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _pre_apply_block_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _on_irreversible_block.set_benchmark_dumper( &_benchmark_dumper );
+  _post_apply_block_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _fail_apply_block_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _pre_apply_transaction_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _post_apply_transaction_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _pre_reindex_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _post_reindex_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _generate_optional_actions_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _prepare_snapshot_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _prepare_snapshot_supplement_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _load_snapshot_supplement_signal.set_benchmark_dumper( &_benchmark_dumper );
+  _comment_reward_signal.set_benchmark_dumper( &_benchmark_dumper );
+
+  // operation handlers are subscribed under plugin name only, actual name depends on operation
+  auto operation_benchmark_name = [this]( bool is_pre_operation, const std::string& plugin_name, const operation_notification& o ) -> std::string
+  {
+    if( !_my->_evaluator_registry.is_evaluator( o.op ) )
+      return util::advanced_benchmark_dumper::get_virtual_operation_name();
+
+    const std::string& op_name = _my->_evaluator_registry.get_evaluator( o.op ).get_name( o.op );
+    return is_pre_operation ? _benchmark_dumper.generate_desc< true >( plugin_name, op_name ) :
+                              _benchmark_dumper.generate_desc< false >( plugin_name, op_name );
   };
-
-  if( IS_PRE_OPERATION )
-    return _pre_apply_operation_signal.connect(group, complex_func);
-  else
-    return _post_apply_operation_signal.connect(group, complex_func);
-}
-
-boost::signals2::connection database::add_pre_apply_required_action_handler( const apply_required_action_handler_t& func,
+  _pre_apply_operation_signal.set_benchmark_dumper( &_benchmark_dumper,
+    [operation_benchmark_name]( const std::string& plugin_name, const operation_notification& o ){ return operation_benchmark_name( true, plugin_name, o ); } );
+  _post_apply_operation_signal.set_benchmark_dumper( &_benchmark_dumper,
+    [operation_benchmark_name]( const std::string& plugin_name, const operation_notification& o ){ return operation_benchmark_name( false, plugin_name, o ); } );
+
+  // handlers of notifications emitted during application of block are recorded by block tracer
+  _pre_apply_required_action_signal.set_tracer( &_apply_tracer );
+  _post_apply_required_action_signal.set_tracer( &_apply_tracer );
+  _pre_apply_optional_action_signal.set_tracer( &_apply_tracer );
+  _post_apply_optional_action_signal.set_tracer( &_apply_tracer );
+  _pre_apply_block_signal.set_tracer( &_apply_tracer );
+  _on_irreversible_block.set_tracer( &_apply_tracer );
+  _post_apply_block_signal.set_tracer( &_apply_tracer );
+  _pre_apply_transaction_signal.set_tracer( &_apply_tracer );
+  _post_apply_transaction_signal.set_tracer( &_apply_tracer );
+  _pre_apply_operation_signal.set_tracer( &_apply_tracer );
+  _post_apply_operation_signal.set_tracer( &_apply_tracer );
+  _generate_optional_actions_signal.set_tracer( &_apply_tracer );
+  _comment_reward_signal.set_tracer( &_apply_tracer );
+}
+
+util::notification_connection database::add_pre_apply_required_action_handler( const apply_required_action_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_pre_apply_required_action_signal, func, plugin, group, "->required_action");
 }
 
-boost::signals2::connection database::add_post_apply_required_action_handler( const apply_required_action_handler_t& func,
+util::notification_connection database::add_post_apply_required_action_handler( const apply_required_action_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_post_apply_required_action_signal, func, plugin, group, "<-required_action");
 }
 
-boost::signals2::connection database::add_pre_apply_optional_action_handler( const apply_optional_action_handler_t& func,
+util::notification_connection database::add_pre_apply_optional_action_handler( const apply_optional_action_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_pre_apply_optional_action_signal, func, plugin, group, "->optional_action");
 }
 
-boost::signals2::connection database::add_post_apply_optional_action_handler( const apply_optional_action_handler_t& func,
+util::notification_connection database::add_post_apply_optional_action_handler( const apply_optional_action_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_post_apply_optional_action_signal, func, plugin, group, "<-optional_action");
 }
 
-boost::signals2::connection database::add_pre_apply_operation_handler( const apply_operation_handler_t& func,
+util::notification_connection database::add_pre_apply_operation_handler( const apply_operation_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
-  return any_apply_operation_handler_impl< true/*IS_PRE_OPERATION*/ >( func, plugin, group );
+  return _pre_apply_operation_signal.connect( group, func, plugin.get_name() );
 }
 
-boost::signals2::connection database::add_post_apply_operation_handler( const apply_operation_handler_t& func,
+util::notification_connection database::add_post_apply_operation_handler( const apply_operation_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
-  return any_apply_operation_handler_impl< false/*IS_PRE_OPERATION*/ >( func, plugin, group );
+  return _post_apply_operation_signal.connect( group, func, plugin.get_name() );
 }
 
-boost::signals2::connection database::add_pre_apply_transaction_handler( const apply_transaction_handler_t& func,
+util::notification_connection database::add_pre_apply_operation_handler( const apply_operation_handler_t& func,
+  const abstract_plugin& plugin, int32_t group, const std::vector< int64_t >& op_tags )
+{
+  return _pre_apply_operation_signal.connect( group, func, plugin.get_name(), op_tags );
+}
+
+util::notification_connection database::add_post_apply_operation_handler( const apply_operation_handler_t& func,
+  const abstract_plugin& plugin, int32_t group, const std::vector< int64_t >& op_tags )
+{
+  return _post_apply_operation_signal.connect( group, func, plugin.get_name(), op_tags );
+}
+
+util::notification_connection database::add_pre_apply_transaction_handler( const apply_transaction_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_pre_apply_transaction_signal, func, plugin, group, "->transaction");
 }
 
-boost::signals2::connection database::add_post_apply_transaction_handler( const apply_transaction_handler_t& func,
+util::notification_connection database::add_post_apply_transaction_handler( const apply_transaction_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_post_apply_transaction_signal, func, plugin, group, "<-transaction");
 }
 
-boost::signals2::connection database::add_pre_apply_block_handler( const apply_block_handler_t& func,
+util::notification_connection database::add_pre_apply_block_handler( const apply_block_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_pre_apply_block_signal, func, plugin, group, "->block");
 }
 
-boost::signals2::connection database::add_post_apply_block_handler( const apply_block_handler_t& func,
+util::notification_connection database::add_post_apply_block_handler( const apply_block_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_post_apply_block_signal, func, plugin, group, "<-block");
 }
 
-boost::signals2::connection database::add_fail_apply_block_handler( const apply_block_handler_t& func,
+util::notification_connection database::add_fail_apply_block_handler( const apply_block_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_fail_apply_block_signal, func, plugin, group, "<-block");
 }
 
-boost::signals2::connection database::add_irreversible_block_handler( const irreversible_block_handler_t& func,
+util::notification_connection database::add_irreversible_block_handler( const irreversible_block_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_on_irreversible_block, func, plugin, group, "<-irreversible");
 }
 
-boost::signals2::connection database::add_pre_reindex_handler(const reindex_handler_t& func,
+util::notification_connection database::add_pre_reindex_handler(const reindex_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_pre_reindex_signal, func, plugin, group, "->reindex");
 }
 
-boost::signals2::connection database::add_post_reindex_handler(const reindex_handler_t& func,
+util::notification_connection database::add_post_reindex_handler(const reindex_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_post_reindex_signal, func, plugin, group, "<-reindex");
 }
 
-boost::signals2::connection database::add_generate_optional_actions_handler(const generate_optional_actions_handler_t& func,
+util::notification_connection database::add_generate_optional_actions_handler(const generate_optional_actions_handler_t& func,
   const abstract_plugin& plugin, int32_t group )
 {
   return connect_impl(_generate_optional_actions_signal, func, plugin, group, "->generate_optional_actions");
 }
 
-boost::signals2::connection database::add_prepare_snapshot_handler(const prepare_snapshot_handler_t& func, const abstract_plugin& plugin, int32_t group)
+util::notification_connection database::add_prepare_snapshot_handler(const prepare_snapshot_handler_t& func, const abstract_plugin& plugin, int32_t group)
 {
   return connect_impl(_prepare_snapshot_signal, func, plugin, group, "->prepare_snapshot");
 }
 
-boost::signals2::connection database::add_snapshot_supplement_handler(const prepare_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group)
+util::notification_connection database::add_snapshot_supplement_handler(const prepare_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group)
 {
   return connect_impl(_prepare_snapshot_supplement_signal, func, plugin, group, "->prepare_snapshot_data_supplement");
 }
 
-boost::signals2::connection database::add_snapshot_supplement_handler(const load_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group)
+util::notification_connection database::add_snapshot_supplement_handler(const load_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group)
 {
   return connect_impl(_load_snapshot_supplement_signal, func, plugin, group, "->load_snapshot_data_supplement");
 }
 
-boost::signals2::connection database::add_comment_reward_handler(const comment_reward_notification_handler_t& func, const abstract_plugin& plugin, int32_t group)
+util::notification_connection database::add_comment_reward_handler(const comment_reward_notification_handler_t& func, const abstract_plugin& plugin, int32_t group)
 {
   return connect_impl(_comment_reward_signal, func, plugin, group, "->comment_reward");
 }
@@ -5077,13 +5361,20 @@ void database::migrate_irreversible_state(uint32_t old_last_irreversible)
     _fork_db.set_max_size( dpo.head_block_number - get_last_irreversible_block_num() + 1 );
 
     // This deletes undo state
+    if( _benchmark_dumper.is_enabled() )
+      _benchmark_dumper.begin();
     commit( get_last_irreversible_block_num() );
+    if( _benchmark_dumper.is_enabled() )
+      _benchmark_dumper.end( undo_commit_name );
 
     if(old_last_irreversible < get_last_irreversible_block_num() )
     {
       //ilog("Updating last irreversible block to: ${b}. Old last irreversible was: ${ob}.",
       //  ("b", get_last_irreversible_block_num())("ob", old_last_irreversible));
 
+      if( _comment_archive )
+        archive_paid_out_comments( get_last_irreversible_block_num() );
+
       for( uint32_t i = old_last_irreversible + 1; i <= get_last_irreversible_block_num(); ++i )
       {
         notify_irreversible_block( i );
@@ -5094,6 +5385,105 @@ void database::migrate_irreversible_state(uint32_t old_last_irreversible)
   FC_CAPTURE_AND_RETHROW()
 }
 
+void database::open_comment_archive( const open_args& args )
+{
+  fc::path archive_dir = args.shared_mem_dir / HIVE_COMMENT_ARCHIVE_DIR;
+  bool enabled = args.comment_archive;
+
+  if( fc::exists( archive_dir ) )
+  {
+    if( head_block_num() == 0 )
+    {
+      ilog( "Wiping comment archive left after previous state" );
+      comment_archive::wipe( archive_dir );
+    }
+    else if( !enabled )
+    {
+      wlog( "Comment archive found in `${p}' - it is required by current state and will stay enabled", ("p", archive_dir.string()) );
+      enabled = true;
+    }
+  }
+
+  if( !enabled )
+    return;
+
+  _comment_archive.reset( new comment_archive() );
+
+  with_write_lock( [&]()
+  {
+    const auto& comment_idx = get_index< comment_index, by_id >();
+    _comment_archive->open( archive_dir, comment_idx.size() );
+
+    uint32_t lib = get_last_irreversible_block_num();
+    FC_ASSERT( _comment_archive->get_last_irreversible_block() <= lib,
+      "Comment archive was written up to block ${a} but state is at irreversible block ${b}. Replay is required.",
+      ("a", _comment_archive->get_last_irreversible_block())("b", lib) );
+
+    // State is at LIB now, so all paid out comments still in shared memory can be moved to the archive.
+    // It covers comments marked as volatile before last shutdown as well as existing state on which the
+    // archive was just enabled.
+    std::vector< comment_id_type > paid_out;
+    for( const auto& comment : comment_idx )
+    {
+      if( find_comment_cashout( comment ) == nullptr )
+        paid_out.push_back( comment.get_id() );
+    }
+
+    if( !paid_out.empty() )
+      ilog( "Moving ${n} paid out comments to comment archive", ("n", paid_out.size()) );
+
+    move_comments_to_archive( paid_out, lib );
+
+    auto& volatile_idx = get_mutable_index< volatile_comment_index >();
+    const auto& volatile_by_block = volatile_idx.indices().get< by_payout_block >();
+    volatile_idx.move_to_external_storage< by_payout_block >( volatile_by_block.begin(), volatile_by_block.end(),
+      []( const volatile_comment_object& ) {} );
+  });
+}
+
+void database::archive_paid_out_comments( uint32_t last_irreversible_block )
+{
+  auto& volatile_idx = get_mutable_index< volatile_comment_index >();
+  const auto& volatile_by_block = volatile_idx.indices().get< by_payout_block >();
+  auto volatile_end = volatile_by_block.upper_bound( last_irreversible_block );
+
+  if( volatile_end == volatile_by_block.begin() )
+    return;
+
+  std::vector< comment_id_type > paid_out;
+  for( auto itr = volatile_by_block.begin(); itr != volatile_end; ++itr )
+    paid_out.push_back( itr->comment );
+
+  move_comments_to_archive( paid_out, last_irreversible_block );
+
+  volatile_idx.move_to_external_storage< by_payout_block >( volatile_by_block.begin(), volatile_end,
+    []( const volatile_comment_object& ) {} );
+}
+
+void database::move_comments_to_archive( const std::vector< comment_id_type >& paid_out, uint32_t last_irreversible_block )
+{
+  auto& comment_idx = get_mutable_index< comment_index >();
+  const auto& comment_by_id = comment_idx.indices().get< by_id >();
+
+  for( const auto& id : paid_out )
+  {
+    auto found = comment_by_id.find( id );
+    if( found != comment_by_id.end() )
+      _comment_archive->store( *found );
+  }
+
+  // comments have to be safely stored in the archive before they disappear from shared memory
+  _comment_archive->flush( last_irreversible_block );
+
+  // paid out comments can't be modified or removed, so there is no undo state that could refer to them
+  for( const auto& id : paid_out )
+  {
+    auto found = comment_by_id.find( id );
+    if( found != comment_by_id.end() )
+      comment_idx.move_to_external_storage< by_id >( found, std::next( found ), []( const comment_object& ) {} );
+  }
+}
+
 
 bool database::apply_order( const limit_order_object& new_order_object )
 {
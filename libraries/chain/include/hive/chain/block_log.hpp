@@ -40,7 +40,8 @@ namespace hive { namespace chain {
       block_log();
       ~block_log();
 
-      void open( const fc::path& file );
+      /// In read only mode block log written by another process is followed (used by read only replicas).
+      void open( const fc::path& file, bool read_only = false );
 
       void rewrite(const fc::path& inputFile, const fc::path& outputFile, uint32_t maxBlockNo);
 
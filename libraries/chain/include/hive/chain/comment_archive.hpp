@@ -0,0 +1,75 @@
+#pragma once
+
+#include <hive/chain/comment_object.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <memory>
+
+#define HIVE_COMMENT_ARCHIVE_DIR "comments-rocksdb-storage"
+
+namespace hive { namespace chain {
+
+  namespace detail { class comment_archive_impl; }
+
+  /* The comment archive is an external (RocksDB backed) store of comments that were paid out
+    * in irreversible blocks. Such comments are only needed by consensus to resolve parent/root
+    * of replies and to check if permlink is already in use, so there is no reason to keep them
+    * in shared memory. Comments are stored in two column families:
+    *
+    * by_hash: author_and_permlink_hash -> packed comment_object
+    * by_id:   comment_id               -> author_and_permlink_hash
+    *
+    * A bloom filter over all stored hashes is kept in memory (rebuilt on open) so the
+    * most common lookup - checking that a permlink of new comment is not used yet - does not
+    * need to reach RocksDB at all.
+    *
+    * Objects returned by find() are materialized once per comment and stay valid (at the same
+    * address) until release_found_comments() is called. Database does it when it holds write lock
+    * before applying next block, so references are valid under the same conditions as references
+    * to objects in shared memory. API calls, which can look up any number of comments between blocks,
+    * use load() instead - it returns copy owned by the caller, so the materialized set only grows with
+    * comments needed by block application.
+    */
+  class comment_archive
+  {
+    public:
+      struct stats
+      {
+        uint64_t lookups = 0;         ///< number of lookups that reached the archive (missed shared memory)
+        uint64_t bloom_rejections = 0;///< number of lookups answered negatively by bloom filter alone
+        uint64_t hits = 0;            ///< number of lookups that found a comment in the archive
+        uint64_t stored = 0;          ///< number of comments moved to archive since open
+      };
+
+      comment_archive();
+      ~comment_archive();
+
+      void open( const fc::path& dir, uint64_t projected_comment_count );
+      void close();
+      static void wipe( const fc::path& dir );
+      bool is_open()const;
+
+      /// Puts comment into write batch. Nothing is written to storage until flush().
+      void store( const comment_object& comment );
+      /// Writes all stored comments atomically together with given last irreversible block number (no-op when nothing was stored).
+      void flush( uint32_t last_irreversible_block );
+
+      /// Last irreversible block which state was written to the archive (0 for empty archive).
+      uint32_t get_last_irreversible_block()const;
+      uint64_t get_comment_count()const;
+
+      const comment_object* find( const comment_object::author_and_permlink_hash_type& hash )const;
+      const comment_object* find( const comment_id_type& id )const;
+      /// Same lookup as find( hash ), but returned comment is owned by the caller and not kept by the archive.
+      std::shared_ptr< const comment_object > load( const comment_object::author_and_permlink_hash_type& hash )const;
+      /// Destroys all objects returned by find(). Must not be called while any of them can still be used.
+      void release_found_comments();
+
+      stats get_stats()const;
+
+    private:
+      std::unique_ptr< detail::comment_archive_impl > my;
+  };
+
+} }
@@ -21,6 +21,8 @@ namespace hive { namespace chain {
   using protocol::votable_asset_info;
 #endif
 
+  namespace detail { class comment_archive_impl; }
+
   class comment_object : public object< comment_object_type, comment_object >
   {
     CHAINBASE_OBJECT( comment_object );
@@ -57,6 +59,7 @@ namespace hive { namespace chain {
       uint16_t        depth = 0; //looks like a candidate for removal (see https://github.com/steemit/steem/issues/767 )
 
       CHAINBASE_UNPACK_CONSTRUCTOR(comment_object);
+      friend class detail::comment_archive_impl; //materializes archived comments outside of shared memory
   };
 
   template< typename Allocator >
@@ -240,6 +243,39 @@ namespace hive { namespace chain {
     allocator< comment_object >
   > comment_index;
 
+  /*
+    Marks comment that was paid out (lost its `comment_cashout_object`) in given block.
+    Once the block becomes irreversible the comment is moved from shared memory to
+    comment archive (see comment_archive.hpp). Objects are only created when archive is enabled.
+  */
+  class volatile_comment_object : public object< volatile_comment_object_type, volatile_comment_object >
+  {
+    CHAINBASE_OBJECT( volatile_comment_object );
+    public:
+      CHAINBASE_DEFAULT_CONSTRUCTOR( volatile_comment_object )
+
+      comment_id_type   comment;
+      uint32_t          block = 0; ///< block in which comment was paid out
+
+    CHAINBASE_UNPACK_CONSTRUCTOR(volatile_comment_object);
+  };
+
+  struct by_payout_block;
+  typedef multi_index_container<
+    volatile_comment_object,
+    indexed_by<
+      ordered_unique< tag< by_id >,
+        const_mem_fun< volatile_comment_object, volatile_comment_object::id_type, &volatile_comment_object::get_id > >,
+      ordered_unique< tag< by_payout_block >,
+        composite_key< volatile_comment_object,
+          member< volatile_comment_object, uint32_t, &volatile_comment_object::block >,
+          const_mem_fun< volatile_comment_object, volatile_comment_object::id_type, &volatile_comment_object::get_id >
+        >
+      >
+    >,
+    allocator< volatile_comment_object >
+  > volatile_comment_index;
+
   struct by_cashout_time; /// cashout_time
 
   typedef multi_index_container<
@@ -287,6 +323,11 @@ FC_REFLECT( hive::chain::comment_vote_object,
         )
 CHAINBASE_SET_INDEX_TYPE( hive::chain::comment_vote_object, hive::chain::comment_vote_index )
 
+FC_REFLECT( hive::chain::volatile_comment_object,
+          (id)(comment)(block)
+        )
+CHAINBASE_SET_INDEX_TYPE( hive::chain::volatile_comment_object, hive::chain::volatile_comment_index )
+
 namespace helpers
 {
   using hive::chain::shared_string;
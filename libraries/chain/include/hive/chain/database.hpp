@@ -10,6 +10,8 @@
 #include <hive/chain/notifications.hpp>
 
 #include <hive/chain/util/advanced_benchmark_dumper.hpp>
+#include <hive/chain/util/apply_trace.hpp>
+#include <hive/chain/util/notification_bus.hpp>
 #include <hive/chain/util/signal.hpp>
 
 #include <hive/protocol/protocol.hpp>
@@ -57,6 +59,7 @@ namespace chain {
 
   class database_impl;
   class custom_operation_interpreter;
+  class comment_archive;
 
   namespace util {
     struct comment_reward_context;
@@ -80,6 +83,8 @@ namespace chain {
     uint64_t initial_supply = HIVE_INIT_SUPPLY;
     uint64_t hbd_initial_supply = HIVE_HBD_INIT_SUPPLY;
     uint64_t shared_file_size = 0;
+    uint64_t shared_file_max_size = 0;
+    chainbase::mapping_options shared_file_mapping;
     uint16_t shared_file_full_threshold = 0;
     uint16_t shared_file_scale_rate = 0;
     uint32_t chainbase_flags = 0;
@@ -88,6 +93,7 @@ namespace chain {
     fc::variant database_cfg;
     bool replay_in_memory = false;
     std::vector< std::string > replay_memory_indices{};
+    bool comment_archive = false; // move comments paid out in irreversible blocks to external storage
 
     // The following fields are only used on reindexing
     uint32_t stop_replay_at = 0;
@@ -261,6 +267,13 @@ namespace chain {
       const comment_object*  find_comment( const account_name_type& author, const string& permlink )const;
 #endif
 
+      /**
+        * Comment lookup for API calls. Unlike find_comment(), comment found in the archive is a copy owned by
+        * the result and is not kept by the archive until next block, so API lookups don't accumulate memory.
+        * Comment from shared memory is only referenced - it is valid under the same conditions as with find_comment().
+        */
+      std::shared_ptr< const comment_object > find_comment_for_api( const account_name_type& author, const string& permlink )const;
+
       const escrow_object&   get_escrow(  const account_name_type& name, uint32_t escrow_id )const;
       const escrow_object*   find_escrow( const account_name_type& name, uint32_t escrow_id )const;
 
@@ -291,6 +304,9 @@ namespace chain {
       const comment_object& get_comment( const comment_cashout_object& comment_cashout ) const;
       void remove_old_comments();
 
+      /// Returns comment archive or nullptr when it is disabled.
+      const comment_archive* get_comment_archive() const { return _comment_archive.get(); }
+
       asset get_effective_vesting_shares( const account_object& account, asset_symbol_type vested_symbol )const;
 
       void max_bandwidth_per_share()const;
@@ -307,6 +323,17 @@ namespace chain {
 
       bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
       void push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
+
+      /// true when block with given number is covered by the last checkpoint with known block id
+      bool is_known_irreversible( uint32_t block_num )const;
+      /**
+        * Applies block that is known to be irreversible (see is_known_irreversible) without fork database
+        * and undo history, appending it straight to block log. Consecutive calls form a fast apply run,
+        * which ends with first push_block, push_transaction or close.
+        * Block must link to head block and be signed by scheduled witness. Block that fails to apply is
+        * reverted and exception is thrown, state stays at previous block.
+        */
+      void push_irreversible_block( const signed_block& b, uint32_t skip = skip_nothing );
       void _maybe_warn_multiple_production( uint32_t height )const;
       bool _push_block( const signed_block& b );
       void _push_transaction( const signed_transaction& trx );
@@ -367,33 +394,37 @@ namespace chain {
 
     private:
       template <typename TSignal,
-              typename TNotification = std::function<typename TSignal::signature_type>>
-      boost::signals2::connection connect_impl( TSignal& signal, const TNotification& func,
+              typename TNotification = typename TSignal::handler_t>
+      util::notification_connection connect_impl( TSignal& signal, const TNotification& func,
         const abstract_plugin& plugin, int32_t group, const std::string& item_name = "" );
 
-      template< bool IS_PRE_OPERATION >
-      boost::signals2::connection any_apply_operation_handler_impl( const apply_operation_handler_t& func,
-        const abstract_plugin& plugin, int32_t group );
+      void init_notification_benchmark();
 
     public:
 
-      boost::signals2::connection add_pre_apply_required_action_handler ( const apply_required_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_post_apply_required_action_handler( const apply_required_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_pre_apply_optional_action_handler ( const apply_optional_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_post_apply_optional_action_handler( const apply_optional_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_pre_apply_operation_handler       ( const apply_operation_handler_t&           func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_post_apply_operation_handler      ( const apply_operation_handler_t&           func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_pre_apply_transaction_handler     ( const apply_transaction_handler_t&         func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_post_apply_transaction_handler    ( const apply_transaction_handler_t&         func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_pre_apply_block_handler           ( const apply_block_handler_t&               func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_post_apply_block_handler          ( const apply_block_handler_t&               func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_fail_apply_block_handler          ( const apply_block_handler_t&               func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_irreversible_block_handler        ( const irreversible_block_handler_t&        func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_pre_reindex_handler               ( const reindex_handler_t&                   func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_post_reindex_handler              ( const reindex_handler_t&                   func, const abstract_plugin& plugin, int32_t group = -1 );
-      boost::signals2::connection add_generate_optional_actions_handler ( const generate_optional_actions_handler_t& func, const abstract_plugin& plugin, int32_t group = -1 );
-
-      boost::signals2::connection add_prepare_snapshot_handler          (const prepare_snapshot_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
+      util::notification_connection add_pre_apply_required_action_handler ( const apply_required_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_post_apply_required_action_handler( const apply_required_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_pre_apply_optional_action_handler ( const apply_optional_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_post_apply_optional_action_handler( const apply_optional_action_handler_t&     func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_pre_apply_operation_handler       ( const apply_operation_handler_t&           func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_post_apply_operation_handler      ( const apply_operation_handler_t&           func, const abstract_plugin& plugin, int32_t group = -1 );
+      /// Subscribes handler to notifications about operations with given tags only (see operation_tags)
+      util::notification_connection add_pre_apply_operation_handler       ( const apply_operation_handler_t&           func, const abstract_plugin& plugin, int32_t group, const std::vector< int64_t >& op_tags );
+      util::notification_connection add_post_apply_operation_handler      ( const apply_operation_handler_t&           func, const abstract_plugin& plugin, int32_t group, const std::vector< int64_t >& op_tags );
+
+      template< typename... OperationTypes >
+      static std::vector< int64_t > operation_tags() { return { operation::tag< OperationTypes >::value... }; }
+      util::notification_connection add_pre_apply_transaction_handler     ( const apply_transaction_handler_t&         func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_post_apply_transaction_handler    ( const apply_transaction_handler_t&         func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_pre_apply_block_handler           ( const apply_block_handler_t&               func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_post_apply_block_handler          ( const apply_block_handler_t&               func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_fail_apply_block_handler          ( const apply_block_handler_t&               func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_irreversible_block_handler        ( const irreversible_block_handler_t&        func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_pre_reindex_handler               ( const reindex_handler_t&                   func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_post_reindex_handler              ( const reindex_handler_t&                   func, const abstract_plugin& plugin, int32_t group = -1 );
+      util::notification_connection add_generate_optional_actions_handler ( const generate_optional_actions_handler_t& func, const abstract_plugin& plugin, int32_t group = -1 );
+
+      util::notification_connection add_prepare_snapshot_handler          (const prepare_snapshot_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
       /// <summary>
       ///  All plugins storing data in different way than chainbase::generic_index (wrapping
       ///  a multi_index) should register to this handler to add its own data to the prepared snapshot.
@@ -402,7 +433,7 @@ namespace chain {
       /// <param name="plugin">the plugin be registering its handler</param>
       /// <param name="group"></param>
       /// <returns></returns>
-      boost::signals2::connection add_snapshot_supplement_handler       (const prepare_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
+      util::notification_connection add_snapshot_supplement_handler       (const prepare_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
       /// <summary>
       ///  All plugins storing data in different way than chainbase::generic_index (wrapping
       ///  a multi_index) should register to this handler to load its own data from the loaded snapshot.
@@ -411,9 +442,9 @@ namespace chain {
       /// <param name="plugin"></param>
       /// <param name="group"></param>
       /// <returns></returns>
-      boost::signals2::connection add_snapshot_supplement_handler       (const load_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
+      util::notification_connection add_snapshot_supplement_handler       (const load_snapshot_data_supplement_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
 
-      boost::signals2::connection add_comment_reward_handler            (const comment_reward_notification_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
+      util::notification_connection add_comment_reward_handler            (const comment_reward_notification_handler_t& func, const abstract_plugin& plugin, int32_t group = -1);
 
       //////////////////// db_witness_schedule.cpp ////////////////////
 
@@ -565,6 +596,9 @@ namespace chain {
       // Reset irreversible state (unaffected by undo)
       void initialize_irreversible_storage();
 
+      /// Finishes opening of read only replica of shared memory file maintained by another process
+      void open_replica( const open_args& args );
+
       void resetState(const open_args& args);
 
       void init_schema();
@@ -652,7 +686,10 @@ namespace chain {
 
       void apply_block( const signed_block& next_block, uint32_t skip = skip_nothing );
       void _apply_block( const signed_block& next_block );
+      void begin_irreversible_fast_apply();
+      void end_irreversible_fast_apply();
       void _apply_transaction( const signed_transaction& trx );
+      void _apply_transaction( const signed_transaction& trx, const transaction_id_type& trx_id );
       void apply_operation( const operation& op );
 
       void process_required_actions( const required_automated_actions& actions );
@@ -685,6 +722,11 @@ namespace chain {
       void update_signing_witness(const witness_object& signing_witness, const signed_block& new_block);
       uint32_t update_last_irreversible_block();
       void migrate_irreversible_state(uint32_t old_last_irreversible);
+      void open_comment_archive( const open_args& args );
+      void mark_comment_paid_out( comment_id_type comment_id );
+      void archive_paid_out_comments( uint32_t last_irreversible_block );
+      void move_comments_to_archive( const std::vector< comment_id_type >& paid_out, uint32_t last_irreversible_block );
+      const comment_object* find_comment( const fc::ripemd160& author_and_permlink_hash )const;
       void clear_expired_transactions();
       void clear_expired_orders();
       void clear_expired_delegations();
@@ -754,6 +796,11 @@ namespace chain {
         return _benchmark_dumper;
       }
 
+      util::apply_tracer& get_apply_tracer()
+      {
+        return _apply_tracer;
+      }
+
       const hardfork_versions& get_hardfork_versions()
       {
         return _hardfork_versions;
@@ -768,9 +815,13 @@ namespace chain {
 
       block_log                     _block_log;
 
-      // this function needs access to _plugin_index_signal
+      std::unique_ptr< comment_archive > _comment_archive;
+
+      // these functions need access to _plugin_index_signal
       template< typename MultiIndexType >
       friend void add_plugin_index( database& db );
+      template< typename MultiIndexType >
+      friend void add_plugin_index( database& db, const std::string& lock_domain );
 
       transaction_id_type           _current_trx_id;
       uint32_t                      _current_block_num    = 0;
@@ -778,9 +829,21 @@ namespace chain {
       uint16_t                      _current_op_in_trx    = 0;
       uint16_t                      _current_virtual_op   = 0;
 
+      /// virtual operations between pre_push_virtual_operation and post_push_virtual_operation (innermost last),
+      /// with impacted accounts computed by pre handlers, if any
+      struct pending_virtual_op
+      {
+        hive::app::impacted_accounts impacted;
+        bool                         computed = false;
+      };
+      std::vector< pending_virtual_op > _pending_virtual_ops;
+      /// impacted accounts of operations of block being applied, computed on first use
+      hive::app::block_impacted_accounts _block_impacted;
+
       optional< block_id_type >     _currently_processing_block_id;
 
       flat_map<uint32_t,block_id_type>  _checkpoints;
+      bool                              _irreversible_fast_apply = false; ///< inside run of push_irreversible_block calls
 
       node_property_object              _node_property_object;
 
@@ -791,6 +854,7 @@ namespace chain {
 
       uint16_t                      _shared_file_full_threshold = 0;
       uint16_t                      _shared_file_scale_rate = 0;
+      uint64_t                      _shared_file_max_size = 0;
 
       bool                          snapshot_loaded = false;
 
@@ -798,18 +862,19 @@ namespace chain {
       std::string                   _json_schema;
 
       util::advanced_benchmark_dumper  _benchmark_dumper;
+      util::apply_tracer               _apply_tracer;
 
-      fc::signal<void(const required_action_notification&)> _pre_apply_required_action_signal;
-      fc::signal<void(const required_action_notification&)> _post_apply_required_action_signal;
+      util::notification_channel< const required_action_notification& > _pre_apply_required_action_signal;
+      util::notification_channel< const required_action_notification& > _post_apply_required_action_signal;
 
-      fc::signal<void(const optional_action_notification&)> _pre_apply_optional_action_signal;
-      fc::signal<void(const optional_action_notification&)> _post_apply_optional_action_signal;
+      util::notification_channel< const optional_action_notification& > _pre_apply_optional_action_signal;
+      util::notification_channel< const optional_action_notification& > _post_apply_optional_action_signal;
 
-      fc::signal<void(const operation_notification&)>       _pre_apply_operation_signal;
+      util::operation_notification_channel< operation_notification, operation > _pre_apply_operation_signal;
       /**
         *  This signal is emitted for plugins to process every operation after it has been fully applied.
         */
-      fc::signal<void(const operation_notification&)>       _post_apply_operation_signal;
+      util::operation_notification_channel< operation_notification, operation > _post_apply_operation_signal;
 
       /**
         *  This signal is emitted when we start processing a block.
@@ -818,9 +883,9 @@ namespace chain {
         *  the write lock and may be in an "inconstant state" until after it is
         *  released.
         */
-      fc::signal<void(const block_notification&)>           _pre_apply_block_signal;
+      util::notification_channel< const block_notification& >      _pre_apply_block_signal;
 
-      fc::signal<void(uint32_t)>                            _on_irreversible_block;
+      util::notification_channel< uint32_t >                       _on_irreversible_block;
 
       /**
         *  This signal is emitted after all operations and virtual operation for a
@@ -830,47 +895,47 @@ namespace chain {
         *  the write lock and may be in an "inconstant state" until after it is
         *  released.
         */
-      fc::signal<void(const block_notification&)>           _post_apply_block_signal;
+      util::notification_channel< const block_notification& >      _post_apply_block_signal;
 
       /**
         *  This signal is emitted when any problems occured during block processing
         */
-      fc::signal<void(const block_notification&)>           _fail_apply_block_signal;
+      util::notification_channel< const block_notification& >      _fail_apply_block_signal;
 
       /**
         * This signal is emitted any time a new transaction is about to be applied
         * to the chain state.
         */
-      fc::signal<void(const transaction_notification&)>     _pre_apply_transaction_signal;
+      util::notification_channel< const transaction_notification& > _pre_apply_transaction_signal;
 
       /**
         * This signal is emitted any time a new transaction has been applied to the
         * chain state.
         */
-      fc::signal<void(const transaction_notification&)>     _post_apply_transaction_signal;
+      util::notification_channel< const transaction_notification& > _post_apply_transaction_signal;
 
       /**
         * Emitted when reindexing starts
         */
-      fc::signal<void(const reindex_notification&)>         _pre_reindex_signal;
+      util::notification_channel< const reindex_notification& >    _pre_reindex_signal;
 
       /**
         * Emitted when reindexing finishes
         */
-      fc::signal<void(const reindex_notification&)>         _post_reindex_signal;
+      util::notification_channel< const reindex_notification& >    _post_reindex_signal;
 
-      fc::signal<void(const generate_optional_actions_notification& )> _generate_optional_actions_signal;
+      util::notification_channel< const generate_optional_actions_notification& > _generate_optional_actions_signal;
 
-      fc::signal<void(const database&, const database::abstract_index_cntr_t&)> _prepare_snapshot_signal;
+      util::notification_channel< const database&, const database::abstract_index_cntr_t& > _prepare_snapshot_signal;
 
       /// <summary>
       ///  Emitted by snapshot plugin implementation to allow all registered plugins to include theirs custom-stored data in the snapshot
       /// </summary>
-      fc::signal<void(const prepare_snapshot_supplement_notification&)> _prepare_snapshot_supplement_signal;
+      util::notification_channel< const prepare_snapshot_supplement_notification& > _prepare_snapshot_supplement_signal;
       /// <summary>
       /// Emitted by snapshot plugin implementation to allow all registered plugins to load theirs custom-stored data from the snapshot
       /// </summary>
-      fc::signal<void(const load_snapshot_supplement_notification&)> _load_snapshot_supplement_signal;
+      util::notification_channel< const load_snapshot_supplement_notification& > _load_snapshot_supplement_signal;
 
       /**
         *  Emitted After a block has been applied and committed.  The callback
@@ -891,7 +956,7 @@ namespace chain {
       /// <summary>
       ///  Emitted when rewards for author and curators are paid out.
       /// </summary>
-      fc::signal<void(const comment_reward_notification&)>          _comment_reward_signal;
+      util::notification_channel< const comment_reward_notification& > _comment_reward_signal;
   };
 
   struct reindex_notification
@@ -81,6 +81,7 @@ enum object_type
   proposal_vote_object_type,
   comment_cashout_object_type,
   recurrent_transfer_object_type,
+  volatile_comment_object_type,
 #ifdef HIVE_ENABLE_SMT
   // SMT objects
   smt_token_object_type,
@@ -127,6 +128,7 @@ class pending_required_action_object;
 class pending_optional_action_object;
 class comment_cashout_object;
 class recurrent_transfer_object;
+class volatile_comment_object;
 
 #ifdef HIVE_ENABLE_SMT
 class smt_token_object;
@@ -175,6 +177,7 @@ typedef oid_ref< pending_required_action_object         > pending_required_actio
 typedef oid_ref< pending_optional_action_object         > pending_optional_action_id_type;
 typedef oid_ref< comment_cashout_object                 > comment_cashout_id_type;
 typedef oid_ref< recurrent_transfer_object              > recurrent_transfer_id_type;
+typedef oid_ref< volatile_comment_object                > volatile_comment_id_type;
 
 #ifdef HIVE_ENABLE_SMT
 typedef oid_ref< smt_token_object                       > smt_token_id_type;
@@ -342,6 +345,7 @@ FC_REFLECT_ENUM( hive::chain::object_type,
             (proposal_vote_object_type)
             (comment_cashout_object_type)
             (recurrent_transfer_object_type)
+            (volatile_comment_object_type)
 
 #ifdef HIVE_ENABLE_SMT
             (smt_token_object_type)
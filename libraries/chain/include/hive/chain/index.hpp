@@ -55,6 +55,18 @@ void add_plugin_index( database& db )
   db._plugin_index_signal.connect( [&db](){ _add_index_impl< MultiIndexType >(db); } );
 }
 
+/// Adds plugin index that belongs to given lock domain instead of consensus domain (see chainbase::database::register_lock_domain)
+template< typename MultiIndexType >
+void add_plugin_index( database& db, const std::string& lock_domain )
+{
+  uint32_t domain = db.register_lock_domain( lock_domain );
+  db._plugin_index_signal.connect( [&db, domain]()
+  {
+    _add_index_impl< MultiIndexType >(db);
+    db.set_index_lock_domain< MultiIndexType >( domain );
+  } );
+}
+
 } }
 
 #define HIVE_ADD_CORE_INDEX(db, index_name) \
@@ -62,3 +74,6 @@ void add_plugin_index( database& db )
 
 #define HIVE_ADD_PLUGIN_INDEX(db, index_name) \
   hive::chain::add_plugin_index< index_name >( db )
+
+#define HIVE_ADD_PLUGIN_INDEX_IN_LOCK_DOMAIN(db, index_name, lock_domain) \
+  hive::chain::add_plugin_index< index_name >( db, lock_domain )
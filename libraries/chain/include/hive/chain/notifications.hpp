@@ -2,6 +2,8 @@
 
 #include <hive/protocol/block.hpp>
 
+#include <hive/chain/util/impacted.hpp>
+
 namespace hive { namespace chain {
 
 struct block_notification
@@ -24,6 +26,9 @@ struct transaction_notification
     transaction_id = tx.id();
   }
 
+  transaction_notification( const hive::protocol::signed_transaction& tx, const hive::protocol::transaction_id_type& id )
+    : transaction_id(id), transaction(tx) {}
+
   hive::protocol::transaction_id_type          transaction_id;
   const hive::protocol::signed_transaction&    transaction;
 };
@@ -38,6 +43,53 @@ struct operation_notification
   uint32_t            op_in_trx = 0;
   uint32_t            virtual_op = 0;
   const hive::protocol::operation&    op;
+
+  /// Accounts impacted by the operation; computed on first use and shared by all handlers of pre and post notification
+  const hive::app::impacted_accounts& get_impacted_accounts()const
+  {
+    if( !_impacted_computed )
+    {
+      if( _block_impacted != nullptr )
+      {
+        auto accounts = _block_impacted->get( trx_in_block, op_in_trx );
+        _impacted.insert( accounts.begin(), accounts.end() );
+      }
+      else
+      {
+        hive::app::operation_get_impacted_accounts( op, _impacted );
+      }
+      _impacted_computed = true;
+    }
+    return _impacted;
+  }
+
+  /// Makes impacted accounts taken from set computed for whole block (the operation has to be its op_in_trx of trx_in_block)
+  void use_block_impacted_accounts( const hive::app::block_impacted_accounts& block_impacted )
+  {
+    _block_impacted = &block_impacted;
+  }
+
+  /// Moves out impacted accounts if some handler already computed them
+  bool take_impacted_accounts( hive::app::impacted_accounts& impacted )
+  {
+    if( !_impacted_computed )
+      return false;
+    impacted = std::move( _impacted );
+    _impacted_computed = false;
+    return true;
+  }
+
+  /// Sets impacted accounts computed for earlier notification of the same operation
+  void set_impacted_accounts( hive::app::impacted_accounts&& impacted )
+  {
+    _impacted = std::move( impacted );
+    _impacted_computed = true;
+  }
+
+private:
+  const hive::app::block_impacted_accounts* _block_impacted = nullptr;
+  mutable hive::app::impacted_accounts      _impacted;
+  mutable bool                              _impacted_computed = false;
 };
 
 struct required_action_notification
@@ -23,6 +23,7 @@ class advanced_benchmark_dumper
 {                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                           
   public:
 
+    /// Time of items is measured in microseconds; files are dumped in milliseconds
     struct item
     {
       std::string op_name;
@@ -105,6 +106,10 @@ class advanced_benchmark_dumper
     void end( const std::string& str );
 
     void dump();
+
+    /// Accumulated times (in microseconds) of all measured items
+    const std::set< item >& get_items()const { return info.items; }
+    uint64_t get_total_time()const { return info.total_time; }
 };
 
 } } } // hive::chain::util
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <fc/filesystem.hpp>
+#include <fc/reflect/variant.hpp>
+#include <fc/variant_object.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hive { namespace chain { namespace util {
+
+/// Single span of block application as exported in Chrome trace (Perfetto) format (complete event, ph = "X")
+struct trace_event
+{
+  std::string name;
+  std::string cat;
+  std::string ph = "X";
+  int64_t     ts = 0;  ///< start in microseconds
+  int64_t     dur = 0; ///< duration in microseconds
+  uint32_t    pid = 1;
+  uint32_t    tid = 1;
+  fc::mutable_variant_object args;
+};
+
+/// Content of Chrome trace JSON file, can be opened directly in chrome://tracing or ui.perfetto.dev
+struct chrome_trace
+{
+  std::vector< trace_event > traceEvents;
+  std::string                displayTimeUnit = "ms";
+};
+
+/* Low overhead tracing of block application. Spans of block, its phases, transactions and plugin
+  * handlers are recorded into fixed size ring buffer, so the buffer always contains last few blocks.
+  * Only block writer thread records events (application of block happens under write lock); readers
+  * (API) take snapshot of the buffer without locking - every slot carries sequence number that
+  * is odd while the slot is being written, and events that changed during copying are dropped.
+  *
+  * When tracing is disabled (buffer size 0) or no block is being applied, each span costs a single
+  * branch. Block that takes longer than threshold is dumped to file in dump directory - its events
+  * are copied and the file is written by background thread, so slow disk does not delay next block.
+  */
+class apply_tracer
+{
+  public:
+    enum category : uint8_t { block, phase, transaction, plugin };
+
+    apply_tracer() = default;
+    ~apply_tracer();
+
+    /// Sets size of ring buffer (in events, 0 disables tracing) and automatic dump of slow blocks
+    /// (0 threshold disables). Must not be called while block is being applied.
+    void configure( size_t capacity, uint32_t threshold_ms, const fc::path& dump_dir );
+
+    bool is_enabled() const { return _capacity != 0; }
+    /// true while block is being applied with tracing enabled (only meaningful on writer thread)
+    bool is_active() const { return _active; }
+
+    static int64_t now()
+    {
+      return std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+    }
+
+    void begin_block( uint32_t block_num );
+    /// records span of whole block and dumps it when it was slower than threshold
+    void end_block();
+
+    void record( const char* name, category cat, int64_t start, int64_t duration, int32_t trx_in_block = -1 );
+
+    /// events of last given number of blocks (fewer if buffer does not hold that many)
+    chrome_trace get_trace( uint32_t blocks ) const;
+
+    /// blocks until all traces of slow blocks scheduled so far are written
+    void wait_for_dumps();
+
+  private:
+    struct event
+    {
+      char     name[ 48 ];
+      category cat;
+      int32_t  trx_in_block;
+      uint32_t block_num;
+      int64_t  start;
+      int64_t  duration;
+    };
+
+    struct slot
+    {
+      std::atomic< uint64_t > sequence{ 0 };
+      event                   data;
+    };
+
+    struct pending_dump
+    {
+      uint32_t             block_num = 0;
+      std::vector< event > events;
+      fc::path             dump_dir;
+    };
+
+    std::vector< event > snapshot() const;
+    /// events of block that was just applied (only on writer thread)
+    std::vector< event > last_block_events() const;
+    static chrome_trace to_trace( const std::vector< event >& events, uint32_t blocks );
+
+    void schedule_dump( pending_dump&& dump );
+    void dump_main();
+    static void dump( const pending_dump& dump );
+
+    std::unique_ptr< slot[] >  _slots;
+    size_t                     _capacity = 0;
+    std::atomic< uint64_t >    _head{ 0 };
+
+    bool                       _active = false;
+    uint32_t                   _block_num = 0;
+    int64_t                    _block_start = 0;
+    uint32_t                   _threshold_ms = 0;
+    fc::path                   _dump_dir;
+
+    std::thread                _dump_thread;
+    std::mutex                 _dump_mutex;
+    std::condition_variable    _dump_cv;
+    std::condition_variable    _dump_idle_cv;
+    std::deque< pending_dump > _dumps;
+    bool                       _dump_in_progress = false;
+    bool                       _dump_stop = false;
+};
+
+/// Records span of its own lifetime when block is being traced
+class apply_trace_span
+{
+  public:
+    apply_trace_span( apply_tracer& tracer, const char* name, apply_tracer::category cat = apply_tracer::phase, int32_t trx_in_block = -1 )
+      : _tracer( tracer ), _name( name ), _cat( cat ), _trx_in_block( trx_in_block )
+    {
+      if( _tracer.is_active() )
+        _start = apply_tracer::now();
+    }
+
+    ~apply_trace_span() { finish(); }
+
+    /// ends span before the end of scope
+    void finish()
+    {
+      if( _start != 0 )
+        _tracer.record( _name, _cat, _start, apply_tracer::now() - _start, _trx_in_block );
+      _start = 0;
+    }
+
+  private:
+    apply_tracer&          _tracer;
+    const char*            _name;
+    apply_tracer::category _cat;
+    int32_t                _trx_in_block;
+    int64_t                _start = 0;
+};
+
+} } } // hive::chain::util
+
+FC_REFLECT( hive::chain::util::trace_event, (name)(cat)(ph)(ts)(dur)(pid)(tid)(args) )
+FC_REFLECT( hive::chain::util::chrome_trace, (traceEvents)(displayTimeUnit) )
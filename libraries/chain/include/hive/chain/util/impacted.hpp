@@ -1,22 +1,129 @@
 #pragma once
 
 #include <fc/container/flat.hpp>
+#include <hive/protocol/block.hpp>
 #include <hive/protocol/operations.hpp>
 #include <hive/protocol/transaction.hpp>
 
 #include <fc/string.hpp>
 
+#include <boost/container/small_vector.hpp>
+
+#include <algorithm>
+#include <vector>
+
 namespace hive { namespace app {
 
 using namespace fc;
 
+/** Sorted set of accounts impacted by operation. Behaves like flat_set, but keeps first few names
+  * inline, so typical operation (impacting 1-3 accounts) is handled without heap allocation.
+  */
+class impacted_accounts
+{
+  public:
+    typedef boost::container::small_vector< protocol::account_name_type, 4 > storage_type;
+    typedef storage_type::const_iterator                                     const_iterator;
+
+    void insert( const protocol::account_name_type& name )
+    {
+      auto it = std::lower_bound( _accounts.begin(), _accounts.end(), name );
+      if( it == _accounts.end() || *it != name )
+        _accounts.insert( it, name );
+    }
+
+    template< typename Iterator >
+    void insert( Iterator first, Iterator last )
+    {
+      for( ; first != last; ++first )
+        insert( *first );
+    }
+
+    bool count( const protocol::account_name_type& name ) const
+    {
+      return std::binary_search( _accounts.begin(), _accounts.end(), name );
+    }
+
+    const_iterator begin() const { return _accounts.begin(); }
+    const_iterator end() const { return _accounts.end(); }
+    size_t size() const { return _accounts.size(); }
+    bool empty() const { return _accounts.empty(); }
+    void clear() { _accounts.clear(); }
+
+  private:
+    storage_type _accounts;
+};
+
+/** Impacted accounts of all operations of a block (in order of transactions and their operations),
+  * stored in single buffer. They are computed in one pass on first access after block is set.
+  * Buffers are reused when the same object is filled with subsequent blocks.
+  */
+class block_impacted_accounts
+{
+  public:
+    struct range
+    {
+      const protocol::account_name_type* first;
+      const protocol::account_name_type* last;
+
+      const protocol::account_name_type* begin() const { return first; }
+      const protocol::account_name_type* end() const { return last; }
+      size_t size() const { return last - first; }
+      bool empty() const { return first == last; }
+    };
+
+    /// sets block to describe (nullptr when there is none); block has to outlive its use here
+    void set_block( const protocol::signed_block* block )
+    {
+      _block = block;
+      _computed = false;
+    }
+    bool has_block() const { return _block != nullptr; }
+
+    /// number of operations in the block
+    size_t size() const { compute(); return _offsets.size() - 1; }
+    /// accounts impacted by given operation (index counted across all transactions of the block)
+    range operator[]( size_t op_index ) const
+    {
+      compute();
+      const protocol::account_name_type* base = _accounts.data();
+      return { base + _offsets[ op_index ], base + _offsets[ op_index + 1 ] };
+    }
+    /// accounts impacted by given operation of given transaction
+    range get( size_t trx_in_block, size_t op_in_trx ) const
+    {
+      compute();
+      return (*this)[ _trx_offsets[ trx_in_block ] + op_in_trx ];
+    }
+
+  private:
+    void compute() const;
+
+    const protocol::signed_block*                        _block = nullptr;
+    mutable bool                                         _computed = false;
+    mutable std::vector< protocol::account_name_type >   _accounts;
+    /// per operation: index of its first account in _accounts (extra entry closes the last one)
+    mutable std::vector< uint32_t >                      _offsets;
+    /// per transaction: index of its first operation
+    mutable std::vector< uint32_t >                      _trx_offsets;
+};
+
 void operation_get_impacted_accounts(
   const hive::protocol::operation& op,
   fc::flat_set<protocol::account_name_type>& result );
 
+void operation_get_impacted_accounts(
+  const hive::protocol::operation& op,
+  impacted_accounts& result );
+
 void transaction_get_impacted_accounts(
   const hive::protocol::transaction& tx,
   fc::flat_set<protocol::account_name_type>& result
   );
 
+void transaction_get_impacted_accounts(
+  const hive::protocol::transaction& tx,
+  impacted_accounts& result
+  );
+
 } } // hive::app
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <hive/chain/util/advanced_benchmark_dumper.hpp>
+#include <hive/chain/util/apply_trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hive { namespace chain { namespace util {
+
+/// Handle of a handler subscribed to notification_channel (counterpart of boost::signals2::connection)
+class notification_connection
+{
+  public:
+    notification_connection() {}
+    explicit notification_connection( const std::shared_ptr< std::atomic_bool >& state ) : _state( state ) {}
+
+    bool connected()const
+    {
+      auto state = _state.lock();
+      return state && state->load();
+    }
+
+    void disconnect()
+    {
+      auto state = _state.lock();
+      if( state )
+        state->store( false );
+    }
+
+  private:
+    std::weak_ptr< std::atomic_bool > _state;
+};
+
+/* Purpose-built replacement of boost::signals2 for database notifications. Handlers are kept in
+  * a plain vector ordered by group (and by order of subscription within the group), so emission is
+  * just a loop over delegates - no mutexes, no slot tracking, no per-call allocations.
+  *
+  * Subscribing is not synchronized with emission, which is fine since plugins subscribe during
+  * initialization, before any notification is emitted. Disconnected handlers are skipped and
+  * removed from the vector on next subscription.
+  *
+  * When benchmark dumper is attached and enabled, execution time of each handler is recorded under
+  * the name given during subscription; otherwise the cost of benchmarking is a single branch per
+  * emission, not per handler. The same applies to tracer of block application - while block is
+  * traced, each handler is recorded as a span named after the handler.
+  */
+template< typename... Args >
+class notification_channel
+{
+  public:
+    typedef std::function< void( Args... ) > handler_t;
+    /// Provides name under which execution of handler (subscribed with given name) is recorded in benchmark
+    typedef std::function< std::string( const std::string&, Args... ) > benchmark_name_t;
+
+    notification_connection connect( int32_t group, const handler_t& func, const std::string& name )
+    {
+      handler_entry entry{ group, func, name, std::make_shared< std::atomic_bool >( true ) };
+      notification_connection result( entry.state );
+      insert( _handlers, std::move( entry ) );
+      return result;
+    }
+
+    void set_benchmark_dumper( advanced_benchmark_dumper* dumper, const benchmark_name_t& benchmark_name = benchmark_name_t() )
+    {
+      _dumper = dumper;
+      _benchmark_name = benchmark_name;
+    }
+
+    void set_tracer( apply_tracer* tracer )
+    {
+      _tracer = tracer;
+    }
+
+    void operator()( Args... args )const
+    {
+      dispatch( _handlers, args... );
+    }
+
+  protected:
+    struct handler_entry
+    {
+      int32_t                             group;
+      handler_t                           func;
+      std::string                         name;
+      std::shared_ptr< std::atomic_bool > state;
+    };
+
+    typedef std::vector< handler_entry > handler_list;
+
+    static void insert( handler_list& handlers, handler_entry entry )
+    {
+      handlers.erase( std::remove_if( handlers.begin(), handlers.end(),
+        []( const handler_entry& h ){ return !h.state->load(); } ), handlers.end() );
+
+      auto pos = std::upper_bound( handlers.begin(), handlers.end(), entry.group,
+        []( int32_t group, const handler_entry& h ){ return group < h.group; } );
+      handlers.insert( pos, std::move( entry ) );
+    }
+
+    void dispatch( const handler_list& handlers, Args... args )const
+    {
+      const bool benchmark = _dumper != nullptr && _dumper->is_enabled();
+      const bool trace = _tracer != nullptr && _tracer->is_active();
+      if( !benchmark && !trace )
+      {
+        for( const auto& h : handlers )
+        {
+          if( h.state->load( std::memory_order_relaxed ) )
+            h.func( args... );
+        }
+      }
+      else
+      {
+        for( const auto& h : handlers )
+        {
+          if( !h.state->load( std::memory_order_relaxed ) )
+            continue;
+
+          const int64_t trace_start = trace ? apply_tracer::now() : 0;
+          if( benchmark )
+          {
+            std::string name = _benchmark_name ? _benchmark_name( h.name, args... ) : h.name;
+            _dumper->begin();
+            h.func( args... );
+            _dumper->end( name );
+          }
+          else
+          {
+            h.func( args... );
+          }
+          if( trace )
+            _tracer->record( h.name.c_str(), apply_tracer::plugin, trace_start, apply_tracer::now() - trace_start );
+        }
+      }
+    }
+
+    handler_list               _handlers;
+    advanced_benchmark_dumper* _dumper = nullptr;
+    benchmark_name_t           _benchmark_name;
+    apply_tracer*              _tracer = nullptr;
+};
+
+/* Channel of operation notifications that allows subscribing to selected operation types only.
+  * Handlers are kept in separate list for each type of operation (handlers subscribed to all
+  * operations are present in every list), so emission only walks handlers that are interested in
+  * the operation, while relative order of handlers (by group) is the same as for the plain channel.
+  */
+template< typename Notification, typename OperationType >
+class operation_notification_channel : public notification_channel< const Notification& >
+{
+  typedef notification_channel< const Notification& > base_type;
+
+  public:
+    typedef typename base_type::handler_t handler_t;
+
+    operation_notification_channel() : _by_type( OperationType::count() ) {}
+
+    /// Subscribes handler to all operations
+    notification_connection connect( int32_t group, const handler_t& func, const std::string& name )
+    {
+      typename base_type::handler_entry entry{ group, func, name, std::make_shared< std::atomic_bool >( true ) };
+      notification_connection result( entry.state );
+      for( auto& handlers : _by_type )
+        base_type::insert( handlers, entry );
+      return result;
+    }
+
+    /// Subscribes handler to operations with given tags (positions in OperationType variant) only
+    notification_connection connect( int32_t group, const handler_t& func, const std::string& name, const std::vector< int64_t >& tags )
+    {
+      typename base_type::handler_entry entry{ group, func, name, std::make_shared< std::atomic_bool >( true ) };
+      notification_connection result( entry.state );
+      for( int64_t tag : tags )
+      {
+        FC_ASSERT( tag >= 0 && tag < static_cast< int64_t >( _by_type.size() ), "Invalid operation tag ${t}", ("t", tag) );
+        base_type::insert( _by_type[ tag ], entry );
+      }
+      return result;
+    }
+
+    void operator()( const Notification& note )const
+    {
+      base_type::dispatch( _by_type[ note.op.which() ], note );
+    }
+
+  private:
+    std::vector< typename base_type::handler_list > _by_type;
+};
+
+} } } // hive::chain::util
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <hive/chain/util/notification_bus.hpp>
+
 #include <fc/signals.hpp>
 
 namespace hive { namespace chain { namespace util {
@@ -11,4 +13,11 @@ inline void disconnect_signal( boost::signals2::connection& signal )
   FC_ASSERT( !signal.connected() );
 }
 
+inline void disconnect_signal( notification_connection& connection )
+{
+  if( connection.connected() )
+    connection.disconnect();
+  FC_ASSERT( !connection.connected() );
+}
+
 } } }
@@ -25,14 +25,14 @@ namespace hive { namespace chain { namespace util {
 
   void advanced_benchmark_dumper::begin()
   {
-    time_begin = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::system_clock::now().time_since_epoch() ).count();
+    time_begin = std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
   }
 
   template< bool APPLY_CONTEXT >
   void advanced_benchmark_dumper::end( const std::string& str )
   {
-    uint64_t time = std::chrono::duration_cast<std::chrono::milliseconds>(
-      std::chrono::system_clock::now().time_since_epoch() ).count() - time_begin;
+    uint64_t time = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch() ).count() - time_begin;
     auto res = info.emplace( APPLY_CONTEXT ? (apply_context_name + str) : str, time );
 
     if( !res.second )
@@ -68,14 +68,16 @@ namespace hive { namespace chain { namespace util {
 
   void advanced_benchmark_dumper::dump()
   {
-    total_info< std::multiset< ritem > > rinfo( info.total_time );
-    std::for_each(info.items.begin(), info.items.end(), [&rinfo]( const item& obj )
+    // times are accumulated in microseconds (so short items are not rounded to zero), but files keep milliseconds
+    total_info< std::set< item > > ms_info( info.total_time / 1000 );
+    total_info< std::multiset< ritem > > rinfo( info.total_time / 1000 );
+    std::for_each(info.items.begin(), info.items.end(), [&ms_info, &rinfo]( const item& obj )
     {
-      //rinfo.items.emplace( obj.op_name, obj.time );
-      rinfo.emplace( obj.op_name, obj.time );
+      ms_info.emplace( obj.op_name, obj.time / 1000 );
+      rinfo.emplace( obj.op_name, obj.time / 1000 );
     });
 
-    dump_impl( info, file_name );
+    dump_impl( ms_info, file_name );
     dump_impl( rinfo, "r_" + file_name );
   }
 
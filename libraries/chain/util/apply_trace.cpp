@@ -0,0 +1,227 @@
+#include <hive/chain/util/apply_trace.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/variant_object.hpp>
+
+#include <algorithm>
+
+namespace hive { namespace chain { namespace util {
+
+/// slow blocks that wait for their trace to be written; traces of further slow blocks are skipped
+#define HIVE_APPLY_TRACE_MAX_PENDING_DUMPS 16
+
+apply_tracer::~apply_tracer()
+{
+  {
+    std::lock_guard< std::mutex > guard( _dump_mutex );
+    _dump_stop = true;
+  }
+  _dump_cv.notify_all();
+  if( _dump_thread.joinable() )
+    _dump_thread.join();
+}
+
+void apply_tracer::configure( size_t capacity, uint32_t threshold_ms, const fc::path& dump_dir )
+{
+  _slots.reset( capacity ? new slot[ capacity ] : nullptr );
+  _capacity = capacity;
+  _head.store( 0 );
+  _active = false;
+  _threshold_ms = threshold_ms;
+  _dump_dir = dump_dir;
+}
+
+void apply_tracer::begin_block( uint32_t block_num )
+{
+  if( !is_enabled() )
+    return;
+  _active = true;
+  _block_num = block_num;
+  _block_start = now();
+}
+
+void apply_tracer::end_block()
+{
+  if( !_active )
+    return;
+  int64_t duration = now() - _block_start;
+  record( "block", block, _block_start, duration );
+  _active = false;
+
+  if( _threshold_ms != 0 && duration > int64_t( _threshold_ms ) * 1000 )
+  {
+    pending_dump dump;
+    dump.block_num = _block_num;
+    dump.events = last_block_events();
+    dump.dump_dir = _dump_dir;
+    schedule_dump( std::move( dump ) );
+  }
+}
+
+void apply_tracer::record( const char* name, category cat, int64_t start, int64_t duration, int32_t trx_in_block )
+{
+  uint64_t position = _head.load( std::memory_order_relaxed );
+  slot& s = _slots[ position % _capacity ];
+
+  s.sequence.store( 2 * position + 1, std::memory_order_relaxed );
+  std::atomic_thread_fence( std::memory_order_release );
+  strncpy( s.data.name, name, sizeof( s.data.name ) - 1 );
+  s.data.name[ sizeof( s.data.name ) - 1 ] = '\0';
+  s.data.cat = cat;
+  s.data.trx_in_block = trx_in_block;
+  s.data.block_num = _block_num;
+  s.data.start = start;
+  s.data.duration = duration;
+  s.sequence.store( 2 * position + 2, std::memory_order_release );
+
+  _head.store( position + 1, std::memory_order_release );
+}
+
+std::vector< apply_tracer::event > apply_tracer::snapshot() const
+{
+  std::vector< event > result;
+  if( !is_enabled() )
+    return result;
+
+  uint64_t head = _head.load( std::memory_order_acquire );
+  uint64_t first = head > _capacity ? head - _capacity : 0;
+  result.reserve( head - first );
+  for( uint64_t position = first; position < head; ++position )
+  {
+    const slot& s = _slots[ position % _capacity ];
+    uint64_t sequence = s.sequence.load( std::memory_order_acquire );
+    if( sequence != 2 * position + 2 )
+      continue; // already overwritten by newer event
+    event copy = s.data;
+    std::atomic_thread_fence( std::memory_order_acquire );
+    if( s.sequence.load( std::memory_order_relaxed ) != sequence )
+      continue; // overwritten while copying
+    result.push_back( copy );
+  }
+  return result;
+}
+
+std::vector< apply_tracer::event > apply_tracer::last_block_events() const
+{
+  // only writer thread modifies the buffer, so it can be read directly
+  std::vector< event > result;
+  uint64_t head = _head.load( std::memory_order_relaxed );
+  uint64_t first = head > _capacity ? head - _capacity : 0;
+  for( uint64_t position = head; position > first; --position )
+  {
+    const event& e = _slots[ ( position - 1 ) % _capacity ].data;
+    if( e.block_num != _block_num )
+      break;
+    result.push_back( e );
+  }
+  std::reverse( result.begin(), result.end() );
+  return result;
+}
+
+chrome_trace apply_tracer::get_trace( uint32_t blocks ) const
+{
+  return to_trace( snapshot(), blocks );
+}
+
+chrome_trace apply_tracer::to_trace( const std::vector< event >& events, uint32_t blocks )
+{
+  static const char* category_names[] = { "block", "phase", "transaction", "plugin" };
+
+  // block span is recorded last, so events after the (blocks + 1)-th block span from the end belong
+  // to requested blocks
+  size_t begin = events.size();
+  uint32_t found = 0;
+  for( ; begin > 0; --begin )
+  {
+    if( events[ begin - 1 ].cat == block && found++ == blocks )
+      break;
+  }
+
+  chrome_trace result;
+  for( size_t i = begin; i < events.size(); ++i )
+  {
+    const auto& e = events[i];
+    trace_event te;
+    te.name = e.name;
+    te.cat = category_names[ e.cat ];
+    te.ts = e.start;
+    te.dur = e.duration;
+    te.args( "block", e.block_num );
+    if( e.trx_in_block >= 0 )
+      te.args( "trx_in_block", e.trx_in_block );
+    result.traceEvents.push_back( std::move( te ) );
+  }
+  return result;
+}
+
+void apply_tracer::schedule_dump( pending_dump&& dump )
+{
+  {
+    std::lock_guard< std::mutex > guard( _dump_mutex );
+    if( _dumps.size() >= HIVE_APPLY_TRACE_MAX_PENDING_DUMPS )
+    {
+      wlog( "Block ${b} was slow, but ${n} traces are still waiting to be written - its trace is skipped",
+        ( "b", dump.block_num )( "n", _dumps.size() ) );
+      return;
+    }
+    _dumps.push_back( std::move( dump ) );
+    if( !_dump_thread.joinable() )
+      _dump_thread = std::thread( [this]() { dump_main(); } );
+  }
+  _dump_cv.notify_one();
+}
+
+void apply_tracer::wait_for_dumps()
+{
+  std::unique_lock< std::mutex > lock( _dump_mutex );
+  _dump_idle_cv.wait( lock, [this]() { return _dumps.empty() && !_dump_in_progress; } );
+}
+
+void apply_tracer::dump_main()
+{
+  std::unique_lock< std::mutex > lock( _dump_mutex );
+  while( true )
+  {
+    // pending traces are still written on stop
+    _dump_cv.wait( lock, [this]() { return !_dumps.empty() || _dump_stop; } );
+    if( _dumps.empty() )
+      break;
+
+    pending_dump next = std::move( _dumps.front() );
+    _dumps.pop_front();
+    _dump_in_progress = true;
+    lock.unlock();
+
+    try
+    {
+      dump( next );
+    }
+    catch( const fc::exception& e )
+    {
+      wlog( "Cannot write trace of block ${b}: ${e}", ( "b", next.block_num )( "e", e.to_string() ) );
+    }
+    catch( const std::exception& e )
+    {
+      wlog( "Cannot write trace of block ${b}: ${e}", ( "b", next.block_num )( "e", e.what() ) );
+    }
+
+    lock.lock();
+    _dump_in_progress = false;
+    if( _dumps.empty() )
+      _dump_idle_cv.notify_all();
+  }
+}
+
+void apply_tracer::dump( const pending_dump& dump )
+{
+  auto trace = to_trace( dump.events, 1 );
+  fc::create_directories( dump.dump_dir );
+  fc::path file = dump.dump_dir / ( "block_" + std::to_string( dump.block_num ) + ".trace.json" );
+  fc::json::save_to_file( trace, file, false );
+  wlog( "Block ${b} took ${t} ms, trace written to ${f}",
+    ( "b", dump.block_num )( "t", trace.traceEvents.empty() ? 0 : trace.traceEvents.back().dur / 1000 )( "f", file.string() ) );
+}
+
+} } } // hive::chain::util
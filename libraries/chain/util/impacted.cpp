@@ -10,19 +10,40 @@ namespace hive { namespace app {
 using namespace fc;
 using namespace hive::protocol;
 
+namespace {
+
+template< typename T >
+void get_required_accounts( const T& op, flat_set<account_name_type>& result )
+{
+  op.get_required_posting_authorities( result );
+  op.get_required_active_authorities( result );
+  op.get_required_owner_authorities( result );
+}
+
+template< typename T >
+void get_required_accounts( const T& op, impacted_accounts& result )
+{
+  // operations report required authorities through flat_set, so collect them in buffer that keeps its capacity
+  static thread_local flat_set<account_name_type> required;
+  required.clear();
+  get_required_accounts( op, required );
+  result.insert( required.begin(), required.end() );
+}
+
+}
+
 // TODO:  Review all of these, especially no-ops
+template< typename Collection >
 struct get_impacted_account_visitor
 {
-  flat_set<account_name_type>& _impacted;
-  get_impacted_account_visitor( flat_set<account_name_type>& impact ):_impacted( impact ) {}
+  Collection& _impacted;
+  get_impacted_account_visitor( Collection& impact ):_impacted( impact ) {}
   typedef void result_type;
 
   template<typename T>
   void operator()( const T& op )
   {
-    op.get_required_posting_authorities( _impacted );
-    op.get_required_active_authorities( _impacted );
-    op.get_required_owner_authorities( _impacted );
+    get_required_accounts( op, _impacted );
   }
 
   // ops
@@ -282,13 +303,13 @@ struct get_impacted_account_visitor
 
   void operator()(const effective_comment_vote_operation& op)
   {
-    _impacted.emplace(op.author);
-    _impacted.emplace(op.voter);
+    _impacted.insert(op.author);
+    _impacted.insert(op.voter);
   }
 
   void operator()(const ineffective_delete_comment_operation& op)
   {
-    _impacted.emplace(op.author);
+    _impacted.insert(op.author);
   }
 
   void operator()(const comment_payout_update_operation& op)
@@ -412,7 +433,13 @@ struct get_impacted_account_visitor
 
 void operation_get_impacted_accounts( const operation& op, flat_set<account_name_type>& result )
 {
-  get_impacted_account_visitor vtor = get_impacted_account_visitor( result );
+  get_impacted_account_visitor< flat_set<account_name_type> > vtor( result );
+  op.visit( vtor );
+}
+
+void operation_get_impacted_accounts( const operation& op, impacted_accounts& result )
+{
+  get_impacted_account_visitor< impacted_accounts > vtor( result );
   op.visit( vtor );
 }
 
@@ -422,4 +449,36 @@ void transaction_get_impacted_accounts( const transaction& tx, flat_set<account_
     operation_get_impacted_accounts( op, result );
 }
 
+void transaction_get_impacted_accounts( const transaction& tx, impacted_accounts& result )
+{
+  for( const auto& op : tx.operations )
+    operation_get_impacted_accounts( op, result );
+}
+
+void block_impacted_accounts::compute() const
+{
+  if( _computed )
+    return;
+
+  _accounts.clear();
+  _offsets.clear();
+  _trx_offsets.clear();
+  _offsets.push_back( 0 );
+
+  FC_ASSERT( _block != nullptr );
+  impacted_accounts impacted;
+  for( const auto& tx : _block->transactions )
+  {
+    _trx_offsets.push_back( _offsets.size() - 1 );
+    for( const auto& op : tx.operations )
+    {
+      impacted.clear();
+      operation_get_impacted_accounts( op, impacted );
+      _accounts.insert( _accounts.end(), impacted.begin(), impacted.end() );
+      _offsets.push_back( _accounts.size() );
+    }
+  }
+  _computed = true;
+}
+
 } }
@@ -0,0 +1,230 @@
+/*
+  * Measures cost of opening shared memory file and of random index lookups with default mapping
+  * and with mapping options given on command line (huge pages, access hint, prefaulting), e.g.
+  *
+  *   chainbase_lookup_benchmark --dir /dev/shm/bench --objects 20000000 --huge-pages --prefault 8
+  *
+  * Run it with state bigger than TLB reach (a few GB) to see the effect of huge pages; to measure
+  * cold start drop page cache (echo 3 > /proc/sys/vm/drop_caches) before the run.
+  */
+#include <chainbase/chainbase.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace chainbase;
+using namespace boost::multi_index;
+
+class record : public chainbase::object< 0, record >
+{
+  CHAINBASE_OBJECT( record );
+
+public:
+  CHAINBASE_DEFAULT_CONSTRUCTOR( record )
+
+  uint64_t key = 0;
+  uint64_t payload[6] = {};
+};
+
+struct by_key;
+
+typedef multi_index_container<
+  record,
+  indexed_by<
+    ordered_unique< tag< by_id >, const_mem_fun< record, record::id_type, &record::get_id > >,
+    ordered_unique< tag< by_key >, member< record, uint64_t, &record::key > >
+  >,
+  chainbase::allocator< record >
+> record_index;
+
+CHAINBASE_SET_INDEX_TYPE( record, record_index )
+
+FC_REFLECT( record, (id)(key) )
+
+namespace fc { namespace raw {
+template< typename Stream >
+inline void pack( Stream& s, const record& ) {}
+template< typename Stream >
+inline void unpack( Stream& s, record&, uint32_t depth = 0 ) {}
+} }
+
+namespace
+{
+  typedef std::chrono::steady_clock clock_type;
+
+  struct bench_config
+  {
+    bfs::path       dir = bfs::temp_directory_path() / "chainbase_lookup_benchmark";
+    uint64_t        objects = 5000000;
+    uint64_t        lookups = 5000000;
+    mapping_options options;
+  };
+
+  uint64_t key_of( uint64_t i )
+  {
+    // spreads consecutive objects over key space, so by_key lookups walk different tree nodes than by_id
+    return i * 0x9E3779B97F4A7C15ull;
+  }
+
+  double elapsed_ms( clock_type::time_point start )
+  {
+    return std::chrono::duration< double, std::milli >( clock_type::now() - start ).count();
+  }
+
+  void fill( const bench_config& cfg )
+  {
+    chainbase::database db;
+    // two index nodes and the object itself per record, plus slack; previous shared memory file is wiped
+    db.open( cfg.dir, 0, cfg.objects * 256 + 64 * 1024 * 1024, nullptr, nullptr, true );
+    db.add_index< record_index >();
+
+    auto start = clock_type::now();
+    db.with_write_lock( [&]()
+    {
+      for( uint64_t i = 0; i < cfg.objects; ++i )
+        db.create< record >( [&]( record& r ) { r.key = key_of( i ); } );
+    } );
+    std::cout << "filled " << cfg.objects << " objects in " << elapsed_ms( start ) << " ms" << std::endl;
+    db.close();
+  }
+
+  void run( const bench_config& cfg, const mapping_options& options, const char* label )
+  {
+    chainbase::database db;
+    db.set_mapping_options( options );
+
+    auto start = clock_type::now();
+    db.open( cfg.dir );
+    db.add_index< record_index >();
+    double open_ms = elapsed_ms( start );
+
+    const auto& by_id_idx = db.get_index< record_index, by_id >();
+    const auto& by_key_idx = db.get_index< record_index, by_key >();
+
+    std::mt19937_64 rng( 42 );
+    std::uniform_int_distribution< uint64_t > pick( 0, cfg.objects - 1 );
+
+    // lookups are timed in batches, so the cost of reading clock does not dominate
+    const uint64_t batch = 64;
+    std::vector< double > batch_ns;
+    batch_ns.reserve( cfg.lookups / batch + 1 );
+    uint64_t checksum = 0;
+
+    auto lookups_start = clock_type::now();
+    for( uint64_t done = 0; done < cfg.lookups; done += batch )
+    {
+      auto batch_start = clock_type::now();
+      for( uint64_t i = 0; i < batch; ++i )
+      {
+        uint64_t n = pick( rng );
+        auto by_id_itr = by_id_idx.find( record::id_type( n ) );
+        auto by_key_itr = by_key_idx.find( key_of( pick( rng ) ) );
+        checksum += by_id_itr->key + by_key_itr->get_id().get_value();
+      }
+      batch_ns.push_back( std::chrono::duration< double, std::nano >( clock_type::now() - batch_start ).count() / ( 2 * batch ) );
+    }
+    double lookups_ms = elapsed_ms( lookups_start );
+
+    std::sort( batch_ns.begin(), batch_ns.end() );
+    auto percentile = [&]( double p ) { return batch_ns[ std::min< size_t >( batch_ns.size() - 1, size_t( p * batch_ns.size() ) ) ]; };
+
+    std::cout << std::fixed << std::setprecision( 1 )
+              << std::left << std::setw( 10 ) << label
+              << " open+prefault: " << std::setw( 10 ) << open_ms << " ms"
+              << "  lookups: " << std::setw( 10 ) << lookups_ms << " ms"
+              << "  avg: " << std::setw( 7 ) << lookups_ms * 1e6 / ( 2 * cfg.lookups ) << " ns"
+              << "  p50: " << std::setw( 7 ) << percentile( 0.5 ) << " ns"
+              << "  p99: " << std::setw( 7 ) << percentile( 0.99 ) << " ns"
+              << "  (checksum " << checksum % 1000 << ")" << std::endl;
+
+    db.close();
+  }
+
+  void usage()
+  {
+    std::cout << "Usage: chainbase_lookup_benchmark [--dir PATH] [--objects N] [--lookups N] [--keep]\n"
+                 "         [--huge-pages] [--access normal|random|sequential|willneed] [--prefault THREADS]\n"
+                 "Fills index with N objects (unless --keep reuses existing file) and compares random lookups\n"
+                 "with default mapping (baseline) and with given mapping options (tuned).\n";
+  }
+}
+
+int main( int argc, char** argv )
+{
+  try
+  {
+    bench_config cfg;
+    bool keep = false;
+
+    for( int i = 1; i < argc; ++i )
+    {
+      std::string arg = argv[i];
+      auto value = [&]() -> std::string
+      {
+        if( i + 1 >= argc )
+          throw std::invalid_argument( "missing value of " + arg );
+        return argv[ ++i ];
+      };
+
+      if( arg == "--dir" )
+        cfg.dir = bfs::absolute( value() );
+      else if( arg == "--objects" )
+        cfg.objects = std::stoull( value() );
+      else if( arg == "--lookups" )
+        cfg.lookups = std::stoull( value() );
+      else if( arg == "--keep" )
+        keep = true;
+      else if( arg == "--huge-pages" )
+        cfg.options.huge_pages = true;
+      else if( arg == "--prefault" )
+        cfg.options.prefault_threads = std::stoul( value() );
+      else if( arg == "--access" )
+      {
+        std::string access = value();
+        if( access == "normal" )
+          cfg.options.access = mapping_access::normal;
+        else if( access == "random" )
+          cfg.options.access = mapping_access::random;
+        else if( access == "sequential" )
+          cfg.options.access = mapping_access::sequential;
+        else if( access == "willneed" )
+          cfg.options.access = mapping_access::willneed;
+        else
+          throw std::invalid_argument( "unknown access " + access );
+      }
+      else
+      {
+        usage();
+        return arg == "--help" ? 0 : 1;
+      }
+    }
+
+    if( cfg.objects == 0 )
+      throw std::invalid_argument( "at least one object is needed" );
+
+    if( !keep || !bfs::exists( cfg.dir / "shared_memory.bin" ) )
+      fill( cfg );
+
+    run( cfg, mapping_options(), "baseline" );
+    run( cfg, cfg.options, "tuned" );
+    return 0;
+  }
+  catch( const std::exception& e )
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -27,9 +27,12 @@
 
 #include <array>
 #include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <typeindex>
 #include <typeinfo>
 
@@ -37,6 +40,14 @@
   #define CHAINBASE_NUM_RW_LOCKS 10
 #endif
 
+#ifndef CHAINBASE_MAX_LOCK_DOMAINS
+  #define CHAINBASE_MAX_LOCK_DOMAINS 32
+#endif
+
+#ifndef CHAINBASE_MAX_REPLICAS
+  #define CHAINBASE_MAX_REPLICAS 64
+#endif
+
 #ifdef CHAINBASE_CHECK_LOCKING
   #define CHAINBASE_REQUIRE_READ_LOCK(m, t) require_read_lock(m, typeid(t).name())
   #define CHAINBASE_REQUIRE_WRITE_LOCK(m, t) require_write_lock(m, typeid(t).name())
@@ -119,9 +130,44 @@ namespace chainbase {
   enum open_flags
   {
     skip_nothing               = 0,
-    skip_env_check             = 1 << 0 // Skip environment check on db open
+    skip_env_check             = 1 << 0, // Skip environment check on db open
+    read_only_replica          = 1 << 1  // Map shared memory file of another (writer) process in read only mode
+  };
+
+  /// Hint for the kernel on how shared memory file mapping is going to be accessed (see madvise)
+  enum class mapping_access
+  {
+    normal,
+    random,       ///< no readahead, useful when state does not fit in memory
+    sequential,
+    willneed      ///< read whole file into page cache in background
+  };
+
+  struct mapping_options
+  {
+    /**
+      * Back the mapping with transparent huge pages (MADV_HUGEPAGE - kernel supports it for files on tmpfs).
+      * When shared memory file is placed on hugetlbfs it always uses huge pages and file size is rounded
+      * to the huge page size regardless of this option.
+      */
+    bool            huge_pages = false;
+    mapping_access  access = mapping_access::normal;
+    /// Number of threads that fault in all pages of the mapping during open (0 - pages are faulted on first access)
+    uint32_t        prefault_threads = 0;
+  };
+
+  /// Information about last flush of shared memory file, kept in shared_memory.meta
+  struct durability_marker
+  {
+    /// revision of the state at last flush (-1 when the file was never flushed)
+    int64_t flushed_revision = -1;
+    /// false when the file was modified after last flush (process was killed or crashed), so it might be inconsistent
+    bool    clean = true;
   };
 
+  struct replica_state;
+  struct durability_state;
+
   struct strcmp_less
   {
     bool operator()( const shared_string& a, const shared_string& b )const
@@ -414,6 +460,8 @@ namespace chainbase {
           /** combines this session with the prior session */
           void squash() { if( _apply ) _index.squash(); _apply = false; }
           void undo()   { if( _apply ) _index.undo();  _apply = false; }
+          /** true when undo of the session would modify objects of the index */
+          bool has_changes()const { return _apply && _index.has_undo_changes(); }
 
           session& operator = ( session&& mv ) {
             if( this == &mv ) return *this;
@@ -623,6 +671,23 @@ namespace chainbase {
           undo();
       }
 
+      /** true when undo() would modify objects of the index, not just its undo buffer */
+      bool has_undo_changes()const
+      {
+        return enabled() && has_changes( _stack.back() );
+      }
+
+      /** true when undo_all() would modify objects of the index */
+      bool has_any_undo_changes()const
+      {
+        for( const auto& state : _stack )
+        {
+          if( has_changes( state ) )
+            return true;
+        }
+        return false;
+      }
+
       void set_revision( int64_t revision )
       {
         if( _stack.size() != 0 ) CHAINBASE_THROW_EXCEPTION( std::logic_error("cannot set revision while there is an existing undo stack") );
@@ -632,6 +697,11 @@ namespace chainbase {
     private:
       bool enabled()const { return _stack.size(); }
 
+      static bool has_changes( const undo_state_type& state )
+      {
+        return !( state.old_values.empty() && state.new_ids.empty() && state.removed_values.empty() );
+      }
+
       void on_modify( const value_type& v ) {
         if( !enabled() ) return;
 
@@ -697,6 +767,7 @@ namespace chainbase {
       virtual void push()             = 0;
       virtual void squash()           = 0;
       virtual void undo()             = 0;
+      virtual bool has_changes()const = 0;
       virtual int64_t revision()const  = 0;
   };
 
@@ -709,6 +780,7 @@ namespace chainbase {
       virtual void push() override  { _session.push();  }
       virtual void squash() override{ _session.squash(); }
       virtual void undo() override  { _session.undo();  }
+      virtual bool has_changes()const override { return _session.has_changes(); }
       virtual int64_t revision()const override  { return _session.revision();  }
     private:
       SessionType _session;
@@ -738,6 +810,8 @@ namespace chainbase {
       virtual void    squash()const = 0;
       virtual void    commit( int64_t revision )const = 0;
       virtual void    undo_all()const = 0;
+      virtual bool    has_undo_changes()const = 0;
+      virtual bool    has_any_undo_changes()const = 0;
       virtual uint32_t type_id()const  = 0;
 
       virtual statistic_info get_statistics(bool onlyStaticInfo) const = 0;
@@ -750,10 +824,15 @@ namespace chainbase {
       void add_index_extension( std::shared_ptr< index_extension > ext )  { _extensions.push_back( ext ); }
       const index_extensions& get_index_extensions()const  { return _extensions; }
       void* get()const { return _idx_ptr; }
+
+      /// Lock domain the index belongs to (see database::register_lock_domain)
+      uint32_t get_lock_domain()const { return _lock_domain; }
+      void set_lock_domain( uint32_t domain ) { _lock_domain = domain; }
     protected:
       void*              _idx_ptr;
     private:
       index_extensions   _extensions;
+      uint32_t           _lock_domain = 0;
   };
 
   template<typename BaseIndex>
@@ -773,6 +852,8 @@ namespace chainbase {
       virtual void     squash()const  override { _base.squash(); }
       virtual void     commit( int64_t revision )const  override { _base.commit(revision); }
       virtual void     undo_all() const override {_base.undo_all(); }
+      virtual bool     has_undo_changes()const override { return _base.has_undo_changes(); }
+      virtual bool     has_any_undo_changes()const override { return _base.has_any_undo_changes(); }
       virtual uint32_t type_id()const override { return BaseIndex::value_type::type_id; }
 
       virtual statistic_info get_statistics(bool onlyStaticInfo) const override final
@@ -849,13 +930,88 @@ namespace chainbase {
 
       void wipe_indexes();
 
+#ifndef ENABLE_STD_ALLOCATOR
+      /// Registers read of replica, so the writer does not modify state until the read is finished
+      struct replica_read_guard
+      {
+        replica_read_guard( const database& db, uint64_t wait_micro ) : _db( db ) { _db.enter_replica_read( wait_micro ); }
+        ~replica_read_guard() { _db.leave_replica_read(); }
+
+        const database& _db;
+      };
+
+      /// Publishes state modified under write lock to replicas
+      struct replica_write_guard
+      {
+        replica_write_guard( database& db ) : _db( db ) { _db.begin_replica_write(); }
+        ~replica_write_guard() { _db.end_replica_write(); }
+
+        database& _db;
+      };
+
+      uint64_t enter_replica_read( uint64_t wait_micro )const;
+      void leave_replica_read()const;
+      void extend_replica_mapping( size_t new_size )const;
+      void begin_replica_write();
+      void end_replica_write();
+      void open_replica( const bfs::path& dir, uint32_t flags );
+      void open_replica_state( const bfs::path& dir );
+      void close_replica_state();
+
+      /// Reserves virtual address range for shared memory file mapping, returns address to map the file at (or nullptr)
+      void* reserve_address_space( size_t shared_file_size );
+      /// Reserves again the part of address range that had to be left free when the file was mapped
+      void restore_address_space_gap();
+      void release_address_space();
+      /// Extends file and its mapping within reserved address range, false when reserved range is too small
+      bool grow_in_place( size_t new_shared_file_size );
+
+      void apply_mapping_advice( char* base, size_t size )const;
+      void prefault( const char* base, size_t size )const;
+
+      void start_background_flush();
+      void stop_background_flush();
+#endif
+
     public:
+      ~database();
+
       void open( const bfs::path& dir, uint32_t flags = 0, size_t shared_file_size = 0, const boost::any& database_cfg = nullptr, const helpers::environment_extension_resources* environment_extension = nullptr, const bool wipe_shared_file = false );
       void close();
       void flush();
       void wipe( const bfs::path& dir );
+      /**
+        * Grows shared memory file. When the new size fits in address range reserved at open (see
+        * set_address_space_reserve) the file and its mapping are extended in place, otherwise the file
+        * is closed and reopened, which invalidates all pointers to objects and is not possible while
+        * undo sessions are active.
+        */
       void resize( size_t new_shared_file_size );
       void set_require_locking( bool enable_require_locking );
+      /**
+        * Size of virtual address range reserved for shared memory file mapping on next open (0 - no reservation).
+        * Reservation does not consume memory nor disk space, it just makes sure the file can grow up to that size
+        * without moving its mapping.
+        */
+      void set_address_space_reserve( size_t reserve ) { _address_space_reserve = reserve; }
+      /// Options of shared memory file mapping used on next open
+      void set_mapping_options( const mapping_options& options ) { _mapping_options = options; }
+      /**
+        * Enables background thread (started on next open) that continuously initiates writeback of dirty pages
+        * of shared memory file, so each pass over the whole file takes given number of seconds (0 - disabled).
+        * Writeback does not block the writer and keeps the amount of work left for flush() small.
+        */
+      void set_background_flush_interval( uint32_t seconds ) { _background_flush_interval = seconds; }
+      /// Durability marker as it was found when shared memory file was opened
+      const durability_marker& get_open_durability_marker()const { return _open_durability; }
+
+      /// True when shared memory file of another process was opened with read_only_replica flag
+      bool is_replica()const { return _is_replica; }
+      /**
+        * Generation of the state published by the writer, incremented each time the writer releases write lock
+        * (0 when writer is not running or state is not published yet).
+        */
+      uint64_t get_replica_generation()const;
 
 #ifdef CHAINBASE_CHECK_LOCKING
       void require_lock_fail( const char* method, const char* lock_type, const char* tname )const;
@@ -876,13 +1032,15 @@ namespace chainbase {
       struct session {
         public:
           session( session&& s )
-            : _index_sessions( std::move(s._index_sessions) ),
+            : _db( s._db ),
+              _index_sessions( std::move(s._index_sessions) ),
+              _lock_domains( std::move(s._lock_domains) ),
               _revision( s._revision ),
               _session_incrementer( s._session_incrementer )
           {}
 
-          session( vector<std::unique_ptr<abstract_session>>&& s, int32_t& session_count )
-            : _index_sessions( std::move(s) ), _session_incrementer( session_count )
+          session( database& db, vector<std::unique_ptr<abstract_session>>&& s, vector<uint32_t>&& lock_domains, int32_t& session_count )
+            : _db( &db ), _index_sessions( std::move(s) ), _lock_domains( std::move(lock_domains) ), _session_incrementer( session_count )
           {
             if( _index_sessions.size() )
               _revision = _index_sessions[0]->revision();
@@ -906,7 +1064,12 @@ namespace chainbase {
 
           void undo()
           {
-            for( auto& i : _index_sessions ) i->undo();
+            for( size_t i = 0; i < _index_sessions.size(); ++i )
+            {
+              if( _lock_domains[i] && _index_sessions[i]->has_changes() )
+                _db->lock_domain_for_write( _lock_domains[i] );
+              _index_sessions[i]->undo();
+            }
             _index_sessions.clear();
           }
 
@@ -915,7 +1078,9 @@ namespace chainbase {
         private:
           friend class database;
 
+          database* _db = nullptr;
           vector< std::unique_ptr<abstract_session> > _index_sessions;
+          vector< uint32_t > _lock_domains; ///< lock domain of index of each session
           int64_t _revision = -1;
           int_incrementer _session_incrementer;
       };
@@ -1038,7 +1203,11 @@ namespace chainbase {
           CHAINBASE_THROW_EXCEPTION( std::runtime_error( "unable to find index for " + type_name + " in database" ) );
         }
 
-        return *index_type_ptr( _index_map[index_type::value_type::type_id]->get() );
+        const auto& idx = _index_map[index_type::value_type::type_id];
+        if( BOOST_UNLIKELY( idx->get_lock_domain() != consensus_lock_domain ) )
+          lock_domain_for_write( idx->get_lock_domain() );
+
+        return *index_type_ptr( idx->get() );
       }
 
       template< typename ObjectType, typename IndexedByType, typename CompatibleKey >
@@ -1119,6 +1288,13 @@ namespace chainbase {
       auto with_read_lock( Lambda&& callback, uint64_t wait_micro = 1000000 ) -> decltype( (*(Lambda*)nullptr)() )
       {
 #ifndef ENABLE_STD_ALLOCATOR
+        // replicas never touch the lock - consistency with the writer (other process) is provided by replica_state
+        if( _is_replica )
+        {
+          replica_read_guard guard( *this, wait_micro );
+          return callback();
+        }
+
         read_lock lock( _rw_lock, bip::defer_lock_type() );
 #else
         read_lock lock( _rw_lock, boost::defer_lock_t() );
@@ -1142,6 +1318,54 @@ namespace chainbase {
         return callback();
       }
 
+      /**
+        * Read lock limited to given lock domains (mask built with lock_domain_mask). Reader waits only
+        * for the writer to finish with indices of those domains, not for the whole write section.
+        * Callback must not touch indices outside of given domains.
+        */
+      template< typename Lambda >
+      auto with_read_lock_in_domains( uint32_t domains, Lambda&& callback, uint64_t wait_micro = 1000000 ) -> decltype( (*(Lambda*)nullptr)() )
+      {
+#ifndef ENABLE_STD_ALLOCATOR
+        if( _is_replica )
+        {
+          replica_read_guard guard( *this, wait_micro );
+          return callback();
+        }
+#endif
+
+        // writer takes domains other than consensus in order of first use, not in order of ids; readers
+        // that need more than one domain therefore have to go through consensus domain first (the writer
+        // holds it for the whole write section), otherwise they could deadlock with the writer
+        if( domains & ( domains - 1 ) )
+          domains |= lock_domain_mask( consensus_lock_domain );
+
+#ifdef CHAINBASE_CHECK_LOCKING
+        BOOST_ATTRIBUTE_UNUSED
+        int_incrementer ii( _read_lock_count );
+#endif
+
+        read_lock locks[ CHAINBASE_MAX_LOCK_DOMAINS ];
+        auto deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::microseconds( wait_micro );
+        for( uint32_t d = 0; d < CHAINBASE_MAX_LOCK_DOMAINS; ++d )
+        {
+          if( !( domains & lock_domain_mask( d ) ) )
+            continue;
+
+#ifndef ENABLE_STD_ALLOCATOR
+          locks[d] = read_lock( get_domain_lock( d ), bip::defer_lock_type() );
+#else
+          locks[d] = read_lock( get_domain_lock( d ), boost::defer_lock_t() );
+#endif
+          if( !wait_micro )
+            locks[d].lock();
+          else if( !locks[d].timed_lock( deadline ) )
+            CHAINBASE_THROW_EXCEPTION( lock_exception() );
+        }
+
+        return callback();
+      }
+
       template< typename Lambda >
       auto with_write_lock( Lambda&& callback ) -> decltype( (*(Lambda*)nullptr)() )
       {
@@ -1153,6 +1377,17 @@ namespace chainbase {
 
         lock.lock();
 
+        BOOST_ATTRIBUTE_UNUSED
+        domain_write_guard domain_guard( *this );
+
+#ifndef ENABLE_STD_ALLOCATOR
+        if( _is_replica )
+          CHAINBASE_THROW_EXCEPTION( std::logic_error( "cannot modify state of read only replica" ) );
+
+        BOOST_ATTRIBUTE_UNUSED
+        replica_write_guard replica_guard( *this );
+#endif
+
         return callback();
       }
 
@@ -1171,6 +1406,39 @@ namespace chainbase {
         }
       }
 
+      /**
+        * Lock domains split the database lock, so readers that only need indices that are rarely written
+        * (plugin indices) do not wait for the writer to finish whole write section. Every index belongs to
+        * consensus domain unless assigned to other domain with set_index_lock_domain. with_write_lock
+        * locks consensus domain, other domains are locked on first modification (or undo) of their index
+        * within the write section and stay locked until the end of the section. with_read_lock locks
+        * consensus domain and therefore waits for the whole write section, with_read_lock_in_domains
+        * locks only selected domains.
+        *
+        * Registering the same name again returns the same domain.
+        */
+      uint32_t register_lock_domain( const std::string& name );
+
+      static uint32_t lock_domain_mask( uint32_t domain ) { return 1u << domain; }
+
+      template<typename MultiIndexType>
+      void set_index_lock_domain( uint32_t domain )
+      {
+        typedef generic_index<MultiIndexType> index_type;
+
+        if( !has_index< MultiIndexType >() )
+        {
+          std::string type_name = boost::core::demangle( typeid( typename index_type::value_type ).name() );
+          CHAINBASE_THROW_EXCEPTION( std::runtime_error( "unable to find index for " + type_name + " in database" ) );
+        }
+        if( domain >= _lock_domain_names.size() )
+          CHAINBASE_THROW_EXCEPTION( std::logic_error( "unknown lock domain" ) );
+
+        _index_map[index_type::value_type::type_id]->set_lock_domain( domain );
+      }
+
+      static const uint32_t consensus_lock_domain = 0;
+
       typedef vector<abstract_index*> abstract_index_cntr_t;
 
       const abstract_index_cntr_t& get_abstract_index_cntr() const
@@ -1181,6 +1449,38 @@ namespace chainbase {
         { return _is_open; }
 
     private:
+      read_write_mutex& get_domain_lock( uint32_t domain )
+      {
+        return domain == consensus_lock_domain ? _rw_lock : _domain_locks[ domain - 1 ];
+      }
+
+      /// Locks given domain for the rest of current write section (no-op outside of write section)
+      void lock_domain_for_write( uint32_t domain )
+      {
+        if( !_in_domain_write_section || ( _write_domains_held & lock_domain_mask( domain ) ) )
+          return;
+        get_domain_lock( domain ).lock();
+        _write_domains_held |= lock_domain_mask( domain );
+      }
+
+      /// Releases domains locked during write section
+      struct domain_write_guard
+      {
+        domain_write_guard( database& db ) : _db( db ) { _db._in_domain_write_section = true; }
+        ~domain_write_guard()
+        {
+          for( uint32_t d = CHAINBASE_MAX_LOCK_DOMAINS; d-- > 1; )
+          {
+            if( _db._write_domains_held & lock_domain_mask( d ) )
+              _db.get_domain_lock( d ).unlock();
+          }
+          _db._write_domains_held = 0;
+          _db._in_domain_write_section = false;
+        }
+
+        database& _db;
+      };
+
       template<typename MultiIndexType>
       void add_index_helper() {
         const uint16_t type_id = generic_index<MultiIndexType>::value_type::type_id;
@@ -1196,7 +1496,17 @@ namespace chainbase {
 #ifdef ENABLE_STD_ALLOCATOR
         idx_ptr = new index_type( index_alloc() );
 #else
-        idx_ptr = _segment->find_or_construct< index_type >( type_name.c_str() )( index_alloc( _segment->get_segment_manager() ) );
+        if( _is_replica )
+        {
+          // read only mapping - index has to be already constructed by the writer (and segment can't be locked)
+          idx_ptr = _segment->find_no_lock< index_type >( type_name.c_str() ).first;
+          if( idx_ptr == nullptr )
+            CHAINBASE_THROW_EXCEPTION( std::runtime_error( "unable to find index for " + type_name + " in shared memory of the writer" ) );
+        }
+        else
+        {
+          idx_ptr = _segment->find_or_construct< index_type >( type_name.c_str() )( index_alloc( _segment->get_segment_manager() ) );
+        }
 #endif
 
 
@@ -1211,7 +1521,11 @@ namespace chainbase {
         _index_list.push_back( new_index );
       }
 
-      read_write_mutex                                            _rw_lock;
+      read_write_mutex                                            _rw_lock; ///< lock of consensus domain
+      read_write_mutex                                            _domain_locks[ CHAINBASE_MAX_LOCK_DOMAINS - 1 ];
+      vector< std::string >                                       _lock_domain_names = { "consensus" };
+      uint32_t                                                    _write_domains_held = 0;
+      bool                                                        _in_domain_write_section = false;
 
       unique_ptr<bip::managed_mapped_file>                        _segment;
       unique_ptr<bip::managed_mapped_file>                        _meta;
@@ -1237,8 +1551,34 @@ namespace chainbase {
 
       bool                                                        _is_open = false;
 
+      bool                                                        _is_replica = false;
+      replica_state*                                              _replica_state = nullptr;
+      int32_t                                                     _replica_slot = -1;
+      /// size of shared memory file that replica has mapped so far (it grows with the writer's file)
+      mutable std::atomic< size_t >                               _replica_mapped_size{ 0 };
+      mutable std::mutex                                          _replica_mapping_mutex;
+
       int32_t                                                     _undo_session_count = 0;
       size_t                                                      _file_size = 0;
+
+      mapping_options                                             _mapping_options;
+      /// size of pages backing shared memory file (bigger than system page when file is on hugetlbfs)
+      size_t                                                      _page_size = 0;
+      size_t                                                      _address_space_reserve = 0;
+      char*                                                       _reserved_base = nullptr;
+      size_t                                                      _reserved_size = 0;
+      /// part of reserved range right after the file that is temporarily free while the file is being mapped
+      size_t                                                      _reserved_gap = 0;
+
+      durability_state*                                           _durability = nullptr;
+      durability_marker                                           _open_durability;
+      bool                                                        _in_write_section = false;
+
+      uint32_t                                                    _background_flush_interval = 0;
+      std::thread                                                 _flush_thread;
+      std::mutex                                                  _flush_mutex;
+      std::condition_variable                                     _flush_cv;
+      bool                                                        _flush_stop = false;
       boost::any                                                  _database_cfg = nullptr;
   };
 
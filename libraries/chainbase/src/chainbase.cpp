@@ -1,7 +1,24 @@
 #include <chainbase/chainbase.hpp>
 #include <boost/array.hpp>
 #include <boost/any.hpp>
+#include <algorithm>
 #include <iostream>
+#include <thread>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#ifndef HUGETLBFS_MAGIC
+  #define HUGETLBFS_MAGIC 0x958458f6
+#endif
+#ifndef MAP_FIXED_NOREPLACE
+  // older kernels ignore the flag and treat address as a hint, which is handled the same as conflict
+  #define MAP_FIXED_NOREPLACE 0x100000
+#endif
 
 namespace chainbase {
 
@@ -140,18 +157,96 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
       bool                    created_storage = true;
   };
 
+#ifndef ENABLE_STD_ALLOCATOR
+  /* State shared by the writer with processes that map shared_memory.bin in read only mode (replicas). It is kept
+    * in separate shared_memory.meta file, which replicas map with write access, since they have to announce their
+    * reads in progress.
+    *
+    * Consistency is provided by a seqlock: the writer makes `sequence` odd before it starts to modify the state
+    * (when it acquires write lock) and even again once it is done (when it releases write lock), so `sequence / 2` is
+    * a generation of published state. Replica reads only start on even sequence and are registered in the slot of
+    * their process, and the writer waits for all registered reads to finish before it modifies the state, so a read
+    * never observes partially modified state (multi_index nodes are not safe to traverse while being modified).
+    * Only slots of replica processes that died are released without waiting. Long API calls of replicas therefore
+    * delay block processing of the writer just like local API calls holding read lock do.
+    */
+  struct replica_state
+  {
+    struct reader_slot
+    {
+      std::atomic< int32_t >  pid{ 0 };
+      std::atomic< uint32_t > active_reads{ 0 };
+    };
+
+    std::atomic< uint64_t >                              sequence{ 1 }; // nothing published yet
+    /// Replicas extend their mapping when the writer grows shared memory file
+    std::atomic< uint64_t >                              file_size{ 0 };
+    std::array< reader_slot, CHAINBASE_MAX_REPLICAS >    readers;
+  };
+#endif
+
+#ifndef ENABLE_STD_ALLOCATOR
+  namespace
+  {
+    /// transparent huge page (PMD) size that kernel may add to hinted file mapping to align it
+    const size_t huge_page_alignment_padding = 2 * 1024 * 1024;
+
+    size_t round_to_pages( size_t size, size_t page_size )
+    {
+      return ( size + page_size - 1 ) / page_size * page_size;
+    }
+
+    size_t detect_page_size( const bfs::path& dir )
+    {
+      struct statfs fs;
+      if( statfs( dir.generic_string().c_str(), &fs ) == 0 && fs.f_type == HUGETLBFS_MAGIC )
+        return fs.f_bsize;
+      return sysconf( _SC_PAGE_SIZE );
+    }
+  }
+#endif
+
+#ifndef ENABLE_STD_ALLOCATOR
+  /* Durability marker kept by the writer in shared_memory.meta. The state is marked as modified (and the marker
+    * is synced to disk) before the first modification that follows a flush, and revision of the state is recorded
+    * on each flush. Only flush done outside of write lock (on close) marks the file as clean again, so after
+    * a crash the marker tells that shared memory file might contain partially written state.
+    */
+  struct durability_state
+  {
+    std::atomic< int64_t > flushed_revision{ -1 };
+    std::atomic< bool >    modified{ false };
+  };
+#endif
+
+  database::~database()
+  {
+#ifndef ENABLE_STD_ALLOCATOR
+    stop_background_flush();
+#endif
+  }
+
   void database::open( const bfs::path& dir, uint32_t flags, size_t shared_file_size, const boost::any& database_cfg, const helpers::environment_extension_resources* environment_extension, const bool wipe_shared_file )
   {
     assert( dir.is_absolute() );
     bfs::create_directories( dir );
     if( _data_dir != dir ) close();
-    if( wipe_shared_file ) wipe( dir );
+    if( wipe_shared_file && !( flags & read_only_replica ) ) wipe( dir );
 
     _data_dir = dir;
     _database_cfg = database_cfg;
 #ifndef ENABLE_STD_ALLOCATOR
+    if( flags & read_only_replica )
+    {
+      open_replica( dir, flags );
+      return;
+    }
+
     auto abs_path = bfs::absolute( dir / "shared_memory.bin" );
-    
+    // files on hugetlbfs can only have sizes that are multiples of huge page
+    _page_size = detect_page_size( dir );
+    shared_file_size = round_to_pages( shared_file_size, _page_size );
+
     if( bfs::exists( abs_path ) )
     {
       _file_size = bfs::file_size( abs_path );
@@ -164,8 +259,10 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
       }
 
       _segment.reset( new bip::managed_mapped_file( bip::open_only,
-                                      abs_path.generic_string().c_str()
+                                      abs_path.generic_string().c_str(),
+                                      reserve_address_space( _file_size )
                                       ) );
+      restore_address_space_gap();
 
       auto env = _segment->find< environment_check >( "environment" );
 
@@ -197,8 +294,10 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
     } else {
       _file_size = shared_file_size;
       _segment.reset( new bip::managed_mapped_file( bip::create_only,
-                                      abs_path.generic_string().c_str(), shared_file_size
+                                      abs_path.generic_string().c_str(), shared_file_size,
+                                      reserve_address_space( shared_file_size )
                                       ) );
+      restore_address_space_gap();
       _segment->find_or_construct< environment_check >( "environment" )( allocator< environment_check >( _segment->get_segment_manager() ) );
     }
 
@@ -206,17 +305,281 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
     if( environment_extension )
       env.first->test_set_plugins( *environment_extension );
 
+    apply_mapping_advice( static_cast< char* >( _segment->get_address() ), _file_size );
+    prefault( static_cast< const char* >( _segment->get_address() ), _file_size );
+
     _flock = bip::file_lock( abs_path.generic_string().c_str() );
     if( !_flock.try_lock() )
       BOOST_THROW_EXCEPTION( std::runtime_error( "could not gain write access to the shared memory file" ) );
+
+    open_replica_state( dir );
+    start_background_flush();
 #endif
 
     _is_open = true;
   }
 
+#ifndef ENABLE_STD_ALLOCATOR
+  void database::open_replica( const bfs::path& dir, uint32_t flags )
+  {
+    auto abs_path = bfs::absolute( dir / "shared_memory.bin" );
+    auto meta_path = bfs::absolute( dir / "shared_memory.meta" );
+
+    if( !bfs::exists( abs_path ) || !bfs::exists( meta_path ) )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "read only replica requires shared memory file created by the writer in " + dir.generic_string() ) );
+
+    _page_size = detect_page_size( dir );
+    _file_size = bfs::file_size( abs_path );
+    // address range for growth of the file is reserved even when not configured, so the mapping can follow the writer
+    if( _address_space_reserve < 2 * _file_size )
+      _address_space_reserve = 2 * _file_size;
+    _segment.reset( new bip::managed_mapped_file( bip::open_read_only, abs_path.generic_string().c_str(),
+                                    reserve_address_space( _file_size ) ) );
+    restore_address_space_gap();
+    _replica_mapped_size.store( _file_size );
+    apply_mapping_advice( static_cast< char* >( _segment->get_address() ), _file_size );
+    prefault( static_cast< const char* >( _segment->get_address() ), _file_size );
+
+    // segment can't be locked by read only mapping, hence find_no_lock
+    auto env = _segment->find_no_lock< environment_check >( "environment" );
+    if( !env.first )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "Unable to find environment data saved in persistent storage. Probably database created by a different compiler, build, or operating system" ) );
+
+    _meta.reset( new bip::managed_mapped_file( bip::open_only, meta_path.generic_string().c_str() ) );
+
+    if( !( flags & skip_env_check ) )
+    {
+      // runtime environment has to be constructed in writable segment (its empty strings don't allocate anything)
+      environment_check eCheck( allocator< environment_check >( _meta->get_segment_manager() ) );
+      if( !( *env.first == eCheck ) )
+      {
+        std::string dp = env.first->dump();
+        std::string dr = eCheck.dump();
+        BOOST_THROW_EXCEPTION(std::runtime_error("Different persistent & runtime environments. Persistent: `" + dp + "'. Runtime: `"+ dr + "'.Probably database created by a different compiler, build, or operating system"));
+      }
+    }
+
+    _replica_state = _meta->find< replica_state >( "replica_state" ).first;
+    if( _replica_state == nullptr )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "shared memory file was not published for replicas by the writer" ) );
+    if( _replica_state->file_size.load() != _file_size )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "shared memory file is being resized by the writer" ) );
+
+    int32_t pid = getpid();
+    for( int32_t i = 0; i < CHAINBASE_MAX_REPLICAS && _replica_slot < 0; ++i )
+    {
+      auto& slot = _replica_state->readers[i];
+      int32_t owner = slot.pid.load();
+      // slots of processes that did not close replica properly can be reused
+      if( owner != 0 && ( kill( owner, 0 ) == 0 || errno != ESRCH ) )
+        continue;
+      if( slot.pid.compare_exchange_strong( owner, pid ) )
+      {
+        slot.active_reads.store( 0 );
+        _replica_slot = i;
+      }
+    }
+
+    if( _replica_slot < 0 )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "too many replicas of shared memory file" ) );
+
+    _is_replica = true;
+    _is_open = true;
+  }
+
+  void database::open_replica_state( const bfs::path& dir )
+  {
+    auto meta_path = bfs::absolute( dir / "shared_memory.meta" );
+    _meta.reset( new bip::managed_mapped_file( bip::open_or_create, meta_path.generic_string().c_str(), 64 * 1024 ) );
+    _replica_state = _meta->find_or_construct< replica_state >( "replica_state" )();
+    _durability = _meta->find_or_construct< durability_state >( "durability_state" )();
+    _open_durability.flushed_revision = _durability->flushed_revision.load();
+    _open_durability.clean = !_durability->modified.load();
+
+    // state is not consistent until writer releases its first write lock
+    uint64_t sequence = _replica_state->sequence.load();
+    if( ( sequence & 1 ) == 0 )
+      _replica_state->sequence.store( sequence + 1 );
+    _replica_state->file_size.store( _file_size );
+  }
+
+  void database::close_replica_state()
+  {
+    if( _replica_state == nullptr )
+      return;
+
+    if( _is_replica )
+    {
+      _replica_state->readers[ _replica_slot ].active_reads.store( 0 );
+      _replica_state->readers[ _replica_slot ].pid.store( 0 );
+      _replica_slot = -1;
+    }
+    _replica_state = nullptr;
+    _durability = nullptr;
+  }
+
+  uint64_t database::enter_replica_read( uint64_t wait_micro )const
+  {
+    auto& slot = _replica_state->readers[ _replica_slot ];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds( wait_micro );
+
+    while( true )
+    {
+      uint64_t sequence = _replica_state->sequence.load();
+      if( ( sequence & 1 ) == 0 )
+      {
+        // writer changes sequence before it checks active reads, so either it sees our read or we see its change
+        slot.active_reads.fetch_add( 1 );
+        if( _replica_state->sequence.load() == sequence )
+        {
+          // file size only changes in write section, so it is stable until the read is left
+          uint64_t published_size = _replica_state->file_size.load();
+          if( published_size != _replica_mapped_size.load() )
+          {
+            try
+            {
+              extend_replica_mapping( published_size );
+            }
+            catch( ... )
+            {
+              slot.active_reads.fetch_sub( 1 );
+              throw;
+            }
+          }
+          return sequence;
+        }
+        slot.active_reads.fetch_sub( 1 );
+      }
+
+      if( wait_micro && std::chrono::steady_clock::now() > deadline )
+        CHAINBASE_THROW_EXCEPTION( lock_exception() );
+
+      std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+    }
+  }
+
+  void database::leave_replica_read()const
+  {
+    _replica_state->readers[ _replica_slot ].active_reads.fetch_sub( 1 );
+  }
+
+  void database::extend_replica_mapping( size_t new_size )const
+  {
+    std::lock_guard< std::mutex > guard( _replica_mapping_mutex );
+    size_t mapped_size = _replica_mapped_size.load();
+    if( new_size <= mapped_size )
+      return; // already extended by other thread (the writer never shrinks the file in place)
+
+    size_t new_mapped_size = round_to_pages( new_size, _page_size );
+    if( _reserved_base == nullptr || new_mapped_size > _reserved_size )
+      CHAINBASE_THROW_EXCEPTION( std::runtime_error( "shared memory file grew beyond address range reserved by replica, replica has to be reopened" ) );
+
+    auto abs_path = bfs::absolute( _data_dir / "shared_memory.bin" );
+    int fd = ::open( abs_path.generic_string().c_str(), O_RDONLY );
+    if( fd < 0 )
+      CHAINBASE_THROW_EXCEPTION( std::runtime_error( "could not open shared memory file to extend replica mapping" ) );
+
+    // grown part replaces reserved pages right after current mapping, so existing pointers stay valid
+    size_t old_mapped_size = round_to_pages( mapped_size, _page_size );
+    if( new_mapped_size > old_mapped_size )
+    {
+      void* tail = mmap( _reserved_base + old_mapped_size, new_mapped_size - old_mapped_size, PROT_READ,
+        MAP_SHARED | MAP_FIXED, fd, old_mapped_size );
+      if( tail == MAP_FAILED )
+      {
+        ::close( fd );
+        CHAINBASE_THROW_EXCEPTION( std::runtime_error( "could not map grown part of shared memory file in replica" ) );
+      }
+      apply_mapping_advice( _reserved_base + old_mapped_size, new_mapped_size - old_mapped_size );
+    }
+    ::close( fd );
+
+    _replica_mapped_size.store( new_size );
+  }
+
+  void database::begin_replica_write()
+  {
+    _in_write_section = true;
+    if( _replica_state == nullptr )
+      return;
+
+    if( !_durability->modified.load( std::memory_order_relaxed ) )
+    {
+      // marker has to reach the disk before any modification of the state does
+      _durability->modified.store( true );
+      _meta->flush();
+    }
+
+    uint64_t sequence = _replica_state->sequence.load();
+    if( ( sequence & 1 ) == 0 )
+      _replica_state->sequence.store( sequence + 1 );
+
+    // no new replica read can start now; reads in progress must finish before the state is modified
+    for( auto& slot : _replica_state->readers )
+    {
+      int32_t pid = slot.pid.load();
+      if( pid == 0 )
+        continue;
+
+      auto next_liveness_check = std::chrono::steady_clock::now() + std::chrono::milliseconds( 100 );
+      while( slot.active_reads.load() != 0 )
+      {
+        if( std::chrono::steady_clock::now() > next_liveness_check )
+        {
+          // slot of crashed replica is released, its reads will never finish
+          if( kill( pid, 0 ) != 0 && errno == ESRCH && slot.pid.compare_exchange_strong( pid, 0 ) )
+          {
+            slot.active_reads.store( 0 );
+            break;
+          }
+          next_liveness_check = std::chrono::steady_clock::now() + std::chrono::milliseconds( 100 );
+        }
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void database::end_replica_write()
+  {
+    _in_write_section = false;
+    if( _replica_state == nullptr )
+      return;
+
+    uint64_t sequence = _replica_state->sequence.load();
+    if( sequence & 1 )
+      _replica_state->sequence.store( sequence + 1 );
+  }
+#endif
+
+  uint64_t database::get_replica_generation()const
+  {
+#ifndef ENABLE_STD_ALLOCATOR
+    if( _replica_state != nullptr )
+      return _replica_state->sequence.load() / 2;
+#endif
+    return 0;
+  }
+
   void database::flush() {
+    if( _is_replica )
+      return;
+#ifndef ENABLE_STD_ALLOCATOR
+    // part of the file added by in place growth is not known to _segment
+    if( _reserved_base != nullptr )
+      msync( _reserved_base, _file_size, MS_SYNC );
+    else
+#endif
     if( _segment )
       _segment->flush();
+#ifndef ENABLE_STD_ALLOCATOR
+    if( _durability != nullptr )
+    {
+      _durability->flushed_revision.store( revision() );
+      // state can still be modified in the rest of write lock section
+      if( !_in_write_section )
+        _durability->modified.store( false );
+    }
+#endif
     if( _meta )
       _meta->flush();
   }
@@ -225,8 +588,16 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
   {
     if( _is_open )
     {
+#ifndef ENABLE_STD_ALLOCATOR
+      stop_background_flush();
+      close_replica_state();
+#endif
+      _is_replica = false;
       _segment.reset();
       _meta.reset();
+#ifndef ENABLE_STD_ALLOCATOR
+      release_address_space();
+#endif
       _data_dir = bfs::path();
 
       wipe_indexes();
@@ -246,6 +617,9 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
     assert( !_is_open );
     _segment.reset();
     _meta.reset();
+#ifndef ENABLE_STD_ALLOCATOR
+    release_address_space();
+#endif
     bfs::remove_all( dir / "shared_memory.bin" );
     bfs::remove_all( dir / "shared_memory.meta" );
     _data_dir = bfs::path();
@@ -256,9 +630,18 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
 
   void database::resize( size_t new_shared_file_size )
   {
+#ifndef ENABLE_STD_ALLOCATOR
+    if( grow_in_place( new_shared_file_size ) )
+      return;
+#endif
+
     if( _undo_session_count )
       BOOST_THROW_EXCEPTION( std::runtime_error( "Cannot resize shared memory file while undo session is active" ) );
 
+#ifndef ENABLE_STD_ALLOCATOR
+    stop_background_flush();
+    close_replica_state();
+#endif
     _segment.reset();
     _meta.reset();
 
@@ -272,6 +655,221 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
     }
   }
 
+#ifndef ENABLE_STD_ALLOCATOR
+  void* database::reserve_address_space( size_t shared_file_size )
+  {
+    release_address_space();
+
+    size_t reserve = round_to_pages( _address_space_reserve, _page_size );
+    size_t mapped_size = round_to_pages( shared_file_size, _page_size );
+    if( reserve <= mapped_size )
+      return nullptr;
+
+    // reserve one page more, so the range can be aligned to (possibly huge) page size
+    size_t system_page_size = sysconf( _SC_PAGE_SIZE );
+    size_t slack = _page_size > system_page_size ? _page_size : 0;
+    void* range = mmap( nullptr, reserve + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+    if( range == MAP_FAILED )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "could not reserve address space for shared memory file" ) );
+
+    char* base = reinterpret_cast< char* >( round_to_pages( reinterpret_cast< size_t >( range ), _page_size ) );
+    if( base != range )
+      munmap( range, base - static_cast< char* >( range ) );
+    if( static_cast< char* >( range ) + slack != base )
+      munmap( base + reserve, static_cast< char* >( range ) + slack - base );
+
+    // the file is mapped at the beginning of reserved range, the rest stays reserved for growth; kernel pads hinted
+    // file mapping by huge page size to align it, so the hole has to fit padded request, otherwise the hint is ignored
+    size_t gap = std::min( reserve - mapped_size, huge_page_alignment_padding );
+    munmap( base, mapped_size + gap );
+    _reserved_base = base;
+    _reserved_size = reserve;
+    _reserved_gap = gap;
+    return base;
+  }
+
+  void database::restore_address_space_gap()
+  {
+    if( _reserved_base == nullptr || _reserved_gap == 0 )
+      return;
+
+    size_t mapped_size = round_to_pages( _file_size, _page_size );
+    char* gap_begin = _reserved_base + mapped_size;
+    void* gap = mmap( gap_begin, _reserved_gap, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0 );
+    if( gap != gap_begin )
+    {
+      // something else was mapped in the gap in the meantime (or kernel treated the address as a hint) - the file
+      // can't be extended in place, so the rest of reserved range is released and growth falls back to remapping
+      if( gap != MAP_FAILED )
+        munmap( gap, _reserved_gap );
+      munmap( gap_begin + _reserved_gap, _reserved_size - mapped_size - _reserved_gap );
+      _reserved_size = mapped_size;
+    }
+    _reserved_gap = 0;
+  }
+
+  void database::release_address_space()
+  {
+    if( _reserved_base == nullptr )
+      return;
+
+    munmap( _reserved_base, _reserved_size );
+    _reserved_base = nullptr;
+    _reserved_size = 0;
+    _reserved_gap = 0;
+  }
+
+  bool database::grow_in_place( size_t new_shared_file_size )
+  {
+    if( _reserved_base == nullptr || _is_replica )
+      return false;
+
+    size_t new_size = round_to_pages( new_shared_file_size, _page_size );
+    if( new_size > _reserved_size )
+      return false;
+    if( new_size <= _file_size )
+      return true;
+
+    auto abs_path = bfs::absolute( _data_dir / "shared_memory.bin" );
+    int fd = ::open( abs_path.generic_string().c_str(), O_RDWR );
+    if( fd < 0 )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "could not open shared memory file to grow it" ) );
+
+    if( ftruncate( fd, new_size ) != 0 )
+    {
+      ::close( fd );
+      BOOST_THROW_EXCEPTION( std::runtime_error( "could not grow database file to requested size." ) );
+    }
+
+    // new part of the file replaces reserved pages right after current mapping (MAP_FIXED is atomic)
+    size_t mapped_size = round_to_pages( _file_size, _page_size );
+    if( new_size > mapped_size )
+    {
+      void* tail = mmap( _reserved_base + mapped_size, new_size - mapped_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_FIXED, fd, mapped_size );
+      if( tail == MAP_FAILED )
+      {
+        ::close( fd );
+        BOOST_THROW_EXCEPTION( std::runtime_error( "could not map grown part of shared memory file" ) );
+      }
+      apply_mapping_advice( _reserved_base + mapped_size, new_size - mapped_size );
+    }
+    ::close( fd );
+
+    _segment->get_segment_manager()->grow( new_size - _file_size );
+    _file_size = new_size;
+    if( _replica_state != nullptr )
+      _replica_state->file_size.store( _file_size );
+    return true;
+  }
+
+  void database::apply_mapping_advice( char* base, size_t size )const
+  {
+    // advice is just a hint, mapping works (just slower) when kernel does not support it
+#ifdef MADV_HUGEPAGE
+    if( _mapping_options.huge_pages )
+      madvise( base, size, MADV_HUGEPAGE );
+#endif
+
+    switch( _mapping_options.access )
+    {
+      case mapping_access::normal:
+        break;
+      case mapping_access::random:
+        madvise( base, size, MADV_RANDOM );
+        break;
+      case mapping_access::sequential:
+        madvise( base, size, MADV_SEQUENTIAL );
+        break;
+      case mapping_access::willneed:
+        madvise( base, size, MADV_WILLNEED );
+        break;
+    }
+  }
+
+  void database::start_background_flush()
+  {
+    if( _background_flush_interval == 0 || _flush_thread.joinable() )
+      return;
+
+    auto abs_path = bfs::absolute( _data_dir / "shared_memory.bin" );
+    int fd = ::open( abs_path.generic_string().c_str(), O_RDONLY );
+    if( fd < 0 )
+      BOOST_THROW_EXCEPTION( std::runtime_error( "could not open shared memory file for background flush" ) );
+
+    _flush_stop = false;
+    _flush_thread = std::thread( [this, fd]()
+    {
+      const size_t chunk_size = 64 * 1024 * 1024;
+
+      std::unique_lock< std::mutex > lock( _flush_mutex );
+      while( !_flush_stop )
+      {
+        // file size is taken from the file itself, since it can grow in the meantime
+        struct stat st;
+        size_t file_size = fstat( fd, &st ) == 0 ? st.st_size : 0;
+        size_t chunks = std::max< size_t >( 1, ( file_size + chunk_size - 1 ) / chunk_size );
+        auto pause = std::chrono::microseconds( uint64_t( _background_flush_interval ) * 1000000 / chunks );
+
+        for( size_t offset = 0; offset < file_size && !_flush_stop; offset += chunk_size )
+        {
+          lock.unlock();
+#ifdef __linux__
+          // only initiates writeback of dirty pages, does not wait for it (nor for pages modified meanwhile)
+          sync_file_range( fd, offset, std::min( chunk_size, file_size - offset ), SYNC_FILE_RANGE_WRITE );
+#else
+          fdatasync( fd );
+#endif
+          lock.lock();
+          _flush_cv.wait_for( lock, pause, [this]() { return _flush_stop; } );
+        }
+
+        if( file_size == 0 )
+          _flush_cv.wait_for( lock, pause, [this]() { return _flush_stop; } );
+      }
+
+      ::close( fd );
+    } );
+  }
+
+  void database::stop_background_flush()
+  {
+    if( !_flush_thread.joinable() )
+      return;
+
+    {
+      std::lock_guard< std::mutex > guard( _flush_mutex );
+      _flush_stop = true;
+    }
+    _flush_cv.notify_all();
+    _flush_thread.join();
+  }
+
+  void database::prefault( const char* base, size_t size )const
+  {
+    if( _mapping_options.prefault_threads == 0 || size == 0 )
+      return;
+
+    size_t system_page_size = sysconf( _SC_PAGE_SIZE );
+    size_t pages = ( size + system_page_size - 1 ) / system_page_size;
+    size_t pages_per_thread = ( pages + _mapping_options.prefault_threads - 1 ) / _mapping_options.prefault_threads;
+
+    // reading single byte of every page maps it (reading does not make pages dirty, so there is nothing extra to flush)
+    auto touch = [=]( size_t first_page, size_t last_page )
+    {
+      volatile char sink = 0;
+      for( size_t page = first_page; page < last_page; ++page )
+        sink = sink + base[ page * system_page_size ];
+    };
+
+    std::vector< std::thread > threads;
+    for( size_t first_page = 0; first_page < pages; first_page += pages_per_thread )
+      threads.emplace_back( touch, first_page, std::min( first_page + pages_per_thread, pages ) );
+    for( auto& thread : threads )
+      thread.join();
+  }
+#endif
+
   void database::set_require_locking( bool enable_require_locking )
   {
 #ifdef CHAINBASE_CHECK_LOCKING
@@ -292,6 +890,8 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
   {
     for( auto& item : _index_list )
     {
+      if( item->get_lock_domain() != consensus_lock_domain && item->has_undo_changes() )
+        lock_domain_for_write( item->get_lock_domain() );
       item->undo();
     }
   }
@@ -316,6 +916,8 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
   {
     for( auto& item : _index_list )
     {
+      if( item->get_lock_domain() != consensus_lock_domain && item->has_any_undo_changes() )
+        lock_domain_for_write( item->get_lock_domain() );
       item->undo_all();
     }
   }
@@ -323,11 +925,27 @@ size_t snapshot_base_serializer::worker_common_base::get_serialized_object_cache
   database::session database::start_undo_session()
   {
     vector< std::unique_ptr<abstract_session> > _sub_sessions;
+    vector< uint32_t > _lock_domains;
     _sub_sessions.reserve( _index_list.size() );
+    _lock_domains.reserve( _index_list.size() );
     for( auto& item : _index_list ) {
       _sub_sessions.push_back( item->start_undo_session() );
+      _lock_domains.push_back( item->get_lock_domain() );
     }
-    return session( std::move( _sub_sessions ), _undo_session_count );
+    return session( *this, std::move( _sub_sessions ), std::move( _lock_domains ), _undo_session_count );
+  }
+
+  uint32_t database::register_lock_domain( const std::string& name )
+  {
+    auto itr = std::find( _lock_domain_names.begin(), _lock_domain_names.end(), name );
+    if( itr != _lock_domain_names.end() )
+      return uint32_t( itr - _lock_domain_names.begin() );
+
+    if( _lock_domain_names.size() >= CHAINBASE_MAX_LOCK_DOMAINS )
+      CHAINBASE_THROW_EXCEPTION( std::logic_error( "too many lock domains, cannot register " + name ) );
+
+    _lock_domain_names.push_back( name );
+    return uint32_t( _lock_domain_names.size() - 1 );
   }
 
 }  // namespace chainbase
@@ -10,7 +10,9 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <future>
 #include <iostream>
+#include <thread>
 
 using namespace chainbase;
 using namespace boost::multi_index;
@@ -43,6 +45,28 @@ CHAINBASE_SET_INDEX_TYPE( book, book_index )
 
 FC_REFLECT(book, (id)(a)(b))
 
+class note : public chainbase::object<1, note>
+{
+  CHAINBASE_OBJECT( note );
+
+public:
+  CHAINBASE_DEFAULT_CONSTRUCTOR( note )
+
+  int a = 0;
+};
+
+typedef multi_index_container<
+  note,
+  indexed_by<
+    ordered_unique< tag< by_id >, const_mem_fun<note,note::id_type,&note::get_id> >
+  >,
+  chainbase::allocator<note>
+> note_index;
+
+CHAINBASE_SET_INDEX_TYPE( note, note_index )
+
+FC_REFLECT(note, (id)(a))
+
 namespace fc {namespace raw {
 template<typename Stream>
 inline void pack(Stream& s, const book&)
@@ -53,6 +77,16 @@ template<typename Stream>
 inline void unpack(Stream& s, book& id, uint32_t depth = 0)
   {
   }
+
+template<typename Stream>
+inline void pack(Stream& s, const note&)
+  {
+  }
+
+template<typename Stream>
+inline void unpack(Stream& s, note& id, uint32_t depth = 0)
+  {
+  }
 }}
 
 
@@ -153,4 +187,287 @@ BOOST_AUTO_TEST_CASE( open_and_create ) {
   }
 }
 
+BOOST_AUTO_TEST_CASE( replica_reads ) {
+  boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  try {
+    chainbase::database replica;
+    BOOST_CHECK_THROW( replica.open( temp, chainbase::read_only_replica ), std::runtime_error ); /// writer did not create the file yet
+
+    chainbase::database db;
+    db.open( temp, 0, 1024*1024*8 );
+    db.add_index< book_index >();
+    BOOST_REQUIRE_EQUAL( db.get_replica_generation(), 0 );
+
+    db.with_write_lock( [&]()
+    {
+      db.create<book>( []( book& b ) {
+          b.a = 3;
+          b.b = 4;
+      } );
+    });
+    BOOST_REQUIRE_EQUAL( db.get_replica_generation(), 1 );
+
+    replica.open( temp, chainbase::read_only_replica );
+    BOOST_REQUIRE( replica.is_replica() );
+    replica.add_index< book_index >();
+
+    int a = replica.with_read_lock( [&]() { return replica.get( book::id_type(0) ).a; } );
+    BOOST_REQUIRE_EQUAL( a, 3 );
+    BOOST_REQUIRE_EQUAL( replica.get_replica_generation(), 1 );
+
+    db.with_write_lock( [&]()
+    {
+      db.modify( db.get( book::id_type(0) ), []( book& b ) {
+          b.a = 5;
+      } );
+    });
+
+    a = replica.with_read_lock( [&]() { return replica.get( book::id_type(0) ).a; } );
+    BOOST_REQUIRE_EQUAL( a, 5 );
+    BOOST_REQUIRE_EQUAL( replica.get_replica_generation(), 2 );
+
+    /// writer does not modify the state while read of replica is in progress
+    std::atomic< bool > written( false );
+    bool written_during_read = false;
+    std::thread writer;
+    a = replica.with_read_lock( [&]()
+    {
+      writer = std::thread( [&]()
+      {
+        db.with_write_lock( [&]()
+        {
+          db.modify( db.get( book::id_type(0) ), []( book& b ) {
+              b.a = 7;
+          } );
+        });
+        written = true;
+      } );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 200 ) );
+      written_during_read = written;
+      return replica.get( book::id_type(0) ).a;
+    } );
+    writer.join();
+    BOOST_REQUIRE( !written_during_read );
+    BOOST_REQUIRE_EQUAL( a, 5 );
+    BOOST_REQUIRE( written );
+    a = replica.with_read_lock( [&]() { return replica.get( book::id_type(0) ).a; } );
+    BOOST_REQUIRE_EQUAL( a, 7 );
+
+    BOOST_CHECK_THROW( replica.with_write_lock( [](){} ), std::logic_error );
+
+    replica.close();
+    db.close();
+    bfs::remove_all( temp );
+  } catch ( ... ) {
+    bfs::remove_all( temp );
+    throw;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( replica_follows_growth ) {
+  boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  try {
+    chainbase::database db;
+    db.set_address_space_reserve( 1024*1024*64 );
+    db.open( temp, 0, 1024*1024*8 );
+    db.add_index< book_index >();
+    db.with_write_lock( [&]() { db.create<book>( []( book& b ) { b.a = 1; } ); } );
+
+    chainbase::database replica;
+    replica.open( temp, chainbase::read_only_replica );
+    replica.add_index< book_index >();
+    BOOST_REQUIRE_EQUAL( replica.with_read_lock( [&]() { return replica.count< book >(); } ), 1u );
+
+    /// objects allocated in grown part of the file are visible to replica without reopening it
+    db.with_write_lock( [&]()
+    {
+      db.resize( 1024*1024*16 );
+      for( int i = 0; db.get_free_memory() > 1024*1024*4; ++i )
+        db.create<book>( [i]( book& b ) { b.a = i; } );
+    });
+    size_t count = db.count< book >();
+    int last = db.get( book::id_type( count - 1 ) ).a;
+
+    BOOST_REQUIRE_EQUAL( replica.with_read_lock( [&]() { return replica.count< book >(); } ), count );
+    BOOST_REQUIRE_EQUAL( replica.with_read_lock( [&]() { return replica.get( book::id_type( count - 1 ) ).a; } ), last );
+
+    replica.close();
+    db.close();
+    bfs::remove_all( temp );
+  } catch ( ... ) {
+    bfs::remove_all( temp );
+    throw;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( grow_in_place ) {
+  boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  try {
+    chainbase::database db;
+    db.set_address_space_reserve( 1024*1024*64 );
+    db.open( temp, 0, 1024*1024*8 );
+    db.add_index< book_index >();
+
+    db.with_write_lock( [&]()
+    {
+      auto session = db.start_undo_session();
+      const book& first = db.create<book>( []( book& b ) {
+          b.a = 3;
+          b.b = 4;
+      } );
+
+      size_t free_memory = db.get_free_memory();
+      /// file grows without reopening, so it is possible with undo session active and objects stay in place
+      db.resize( 1024*1024*16 );
+      BOOST_REQUIRE_EQUAL( db.get_max_memory(), 1024*1024*16 );
+      BOOST_REQUIRE_EQUAL( db.get_free_memory(), free_memory + 1024*1024*8 );
+      BOOST_REQUIRE( &db.get( book::id_type(0) ) == &first );
+      BOOST_REQUIRE_EQUAL( first.a, 3 );
+
+      /// new memory is usable (more than was free before growth gets allocated)
+      for( int i = 0; db.get_free_memory() > 1024*1024*4; ++i )
+      {
+        db.create<book>( [i]( book& b ) {
+            b.a = i;
+            b.b = i;
+        } );
+      }
+      BOOST_REQUIRE( db.get_free_memory() < free_memory );
+
+      /// growing above reserved size requires reopening
+      BOOST_CHECK_THROW( db.resize( 1024*1024*128 ), std::runtime_error );
+      session.undo();
+    });
+
+    db.close();
+    BOOST_REQUIRE_EQUAL( bfs::file_size( temp / "shared_memory.bin" ), 1024*1024*16 );
+    bfs::remove_all( temp );
+  } catch ( ... ) {
+    bfs::remove_all( temp );
+    throw;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( unclean_close_detection ) {
+  boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  try {
+    {
+      chainbase::database db;
+      db.set_background_flush_interval( 1 );
+      db.open( temp, 0, 1024*1024*8 );
+      db.add_index< book_index >();
+      BOOST_REQUIRE( db.get_open_durability_marker().clean );
+      BOOST_REQUIRE_EQUAL( db.get_open_durability_marker().flushed_revision, -1 );
+
+      db.with_write_lock( [&]()
+      {
+        db.set_revision( 5 );
+        db.create<book>( []( book& b ) { b.a = 3; } );
+        /// flush in write lock section does not make the file clean, since modifications can follow
+        db.flush();
+      });
+      /// file is closed without flush, like after crash
+      db.close();
+    }
+
+    {
+      chainbase::database db;
+      db.open( temp );
+      db.add_index< book_index >();
+      BOOST_REQUIRE( !db.get_open_durability_marker().clean );
+      BOOST_REQUIRE_EQUAL( db.get_open_durability_marker().flushed_revision, 5 );
+
+      db.with_write_lock( [&]()
+      {
+        db.set_revision( 6 );
+      });
+      db.flush();
+      db.close();
+    }
+
+    {
+      chainbase::database db;
+      db.open( temp );
+      BOOST_REQUIRE( db.get_open_durability_marker().clean );
+      BOOST_REQUIRE_EQUAL( db.get_open_durability_marker().flushed_revision, 6 );
+      db.close();
+    }
+    bfs::remove_all( temp );
+  } catch ( ... ) {
+    bfs::remove_all( temp );
+    throw;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( lock_domains ) {
+  boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  try {
+    chainbase::database db;
+    db.open( temp, 0, 1024*1024*8 );
+    db.add_index< book_index >();
+    db.add_index< note_index >();
+
+    uint32_t notes = db.register_lock_domain( "notes" );
+    BOOST_REQUIRE_EQUAL( db.register_lock_domain( "notes" ), notes );
+    uint32_t others = db.register_lock_domain( "others" );
+    BOOST_REQUIRE( notes != chainbase::database::consensus_lock_domain && others != notes );
+    db.set_index_lock_domain< note_index >( notes );
+
+    db.with_write_lock( [&]()
+    {
+      db.create<book>( []( book& b ) { b.a = 1; } );
+      db.create<note>( []( note& n ) { n.a = 1; } );
+    });
+
+    auto read_book = [&]() { return db.with_read_lock( [&]() { return db.get( book::id_type(0) ).a; }, 10000 ); };
+    auto read_note = [&]() { return db.with_read_lock_in_domains( chainbase::database::lock_domain_mask( notes ),
+      [&]() { return db.get( note::id_type(0) ).a; }, 10000 ); };
+    auto read_both = [&]() { return db.with_read_lock_in_domains(
+      chainbase::database::lock_domain_mask( notes ) | chainbase::database::lock_domain_mask( others ),
+      [&]() { return db.get( note::id_type(0) ).a; }, 10000 ); };
+
+    db.with_write_lock( [&]()
+    {
+      auto session = db.start_undo_session();
+      db.modify( db.get( book::id_type(0) ), []( book& b ) { b.a = 2; } );
+
+      /// writer did not touch notes yet - reader of notes domain does not wait for it, reader of consensus does
+      BOOST_REQUIRE_EQUAL( std::async( std::launch::async, read_note ).get(), 1 );
+      BOOST_CHECK_THROW( std::async( std::launch::async, read_book ).get(), chainbase::lock_exception );
+      /// reader of more than one domain always waits for the writer
+      BOOST_CHECK_THROW( std::async( std::launch::async, read_both ).get(), chainbase::lock_exception );
+
+      db.modify( db.get( note::id_type(0) ), []( note& n ) { n.a = 2; } );
+      BOOST_CHECK_THROW( std::async( std::launch::async, read_note ).get(), chainbase::lock_exception );
+      session.push();
+    });
+    BOOST_REQUIRE_EQUAL( read_note(), 2 );
+    BOOST_REQUIRE_EQUAL( read_book(), 2 );
+
+    /// undo that restores notes locks their domain as well
+    db.with_write_lock( [&]()
+    {
+      db.undo();
+      BOOST_CHECK_THROW( std::async( std::launch::async, read_note ).get(), chainbase::lock_exception );
+    });
+    BOOST_REQUIRE_EQUAL( read_note(), 1 );
+    BOOST_REQUIRE_EQUAL( read_book(), 1 );
+
+    /// undo without changes of notes leaves their domain unlocked
+    db.with_write_lock( [&]()
+    {
+      auto session = db.start_undo_session();
+      db.modify( db.get( book::id_type(0) ), []( book& b ) { b.a = 3; } );
+      session.undo();
+      BOOST_REQUIRE_EQUAL( std::async( std::launch::async, read_note ).get(), 1 );
+    });
+
+    db.close();
+    bfs::remove_all( temp );
+  } catch ( ... ) {
+    bfs::remove_all( temp );
+    throw;
+  }
+}
+
 // BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -24,6 +24,20 @@ class sha256
     static sha256 hash( const string& );
     static sha256 hash( const sha256& );
 
+    /**
+     * Hashes count independent messages at once: out[i] = hash( data[i], sizes[i] ).
+     * Uses multi-lane (AVX2/AVX-512) or SHA extension kernel when CPU supports it, which is
+     * much faster than hashing messages one by one when there are many short messages.
+     * out must not overlap with hashed data.
+     */
+    static void hash_batch( const char* const* data, const uint32_t* sizes, size_t count, sha256* out );
+    /// Name of the kernel used by hash_batch on this CPU ("avx512", "sha-ni", "avx2" or "openssl")
+    static const char* hash_batch_engine();
+    /// Names of kernels hash_batch can use on this CPU, preferred first ("openssl" is always last)
+    static std::vector<std::string> hash_batch_engines();
+    /// For tests only (not thread safe): makes hash_batch use given kernel from hash_batch_engines(), nullptr restores preferred one
+    static void force_hash_batch_engine( const char* name );
+
     template<typename T>
     static sha256 hash( const T& t )
     {
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <fc/log/appender.hpp>
+#include <fc/log/logger.hpp>
+#include <fc/variant.hpp>
+
+#include <memory>
+
+namespace fc {
+
+/**
+ *  Appender that moves formatting and output of log records off the logging thread.
+ *
+ *  log() only stores already captured record (log_message shares its context and arguments, so
+ *  that is a reference count increment) in a lock-free ring buffer owned by the calling thread;
+ *  the buffer is found through per-thread cache, a mutex is only taken on first use by the thread.
+ *  Single background thread drains buffers of all threads, orders collected records by timestamp
+ *  and passes them to the wrapped appender (file, console...), which does all the formatting
+ *  and I/O. When buffer of some thread is full the record is dropped instead of blocking the
+ *  caller; warning with number of records dropped since last report and in total is logged
+ *  through the wrapped appender.
+ *
+ *  Destruction of the appender waits until all buffered records are written. Records that are
+ *  still in buffers when the process is killed are lost.
+ */
+class async_appender : public appender {
+    public:
+         struct config {
+            fc::string                         type;             ///< type of wrapped appender ("file", "console")
+            variant                            args;             ///< config of wrapped appender
+            uint32_t                           queue_size = 4096;///< capacity of buffer of each thread (rounded up to power of 2)
+            uint32_t                           drain_interval_ms = 10;///< how long writer sleeps when all buffers are empty
+         };
+         async_appender( const variant& args );
+         ~async_appender();
+         virtual void log( const log_message& m )override;
+
+         /// Number of records dropped because buffer of logging thread was full
+         uint64_t get_dropped_count()const;
+
+      private:
+         class impl;
+         std::unique_ptr<impl> my;
+   };
+} // namespace fc
+
+#include <fc/reflect/reflect.hpp>
+FC_REFLECT( fc::async_appender::config,
+            (type)(args)(queue_size)(drain_interval_ms) )
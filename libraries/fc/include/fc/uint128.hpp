@@ -1,5 +1,6 @@
 #pragma once
 #include <limits>
+#include <stdexcept>
 #include <stdint.h>
 #include <string>
 
@@ -11,12 +12,22 @@
   #pragma warning (disable : 4244)
 #endif //// _MSC_VER
 
+/*
+ * When compiler provides unsigned __int128, multiplication, division, shifts and related operations
+ * are inline and use native type. Define FC_UINT128_PORTABLE to force portable out-of-line
+ * implementation (the one from fc::detail::uint128_portable, also used as reference in tests).
+ */
+#if defined(__SIZEOF_INT128__) && !defined(FC_UINT128_PORTABLE)
+  #define FC_HAS_NATIVE_UINT128 1
+#endif
+
 namespace fc
 {
   class bigint;
   /**
    *  @brief an implementation of 128 bit unsigned integer
    *
+   *  Value is kept as two 64-bit halves (hi first), which defines its reflected and binary form.
    */
   class uint128
   {
@@ -50,14 +61,46 @@ namespace fc
       uint128& operator |= ( const uint128& u ) { hi |= u.hi; lo |= u.lo; return *this; }
       uint128& operator &= ( const uint128& u ) { hi &= u.hi; lo &= u.lo; return *this; }
       uint128& operator ^= ( const uint128& u ) { hi ^= u.hi; lo ^= u.lo; return *this; }
-      uint128& operator <<= ( const uint128& u );
-      uint128& operator >>= ( const uint128& u );
 
       uint128& operator += ( const uint128& u ) { const uint64_t old = lo; lo += u.lo;  hi += u.hi + (lo < old); return *this; }
       uint128& operator -= ( const uint128& u ) { return *this += -u; }
+
+#ifdef FC_HAS_NATIVE_UINT128
+      uint128& operator <<= ( const uint128& u )
+      {
+        if( u.hi != 0 || u.lo >= 128 )
+          return assign_native( 0 );
+        return assign_native( to_native() << u.lo );
+      }
+      uint128& operator >>= ( const uint128& u )
+      {
+        if( u.hi != 0 || u.lo >= 128 )
+          return assign_native( 0 );
+        return assign_native( to_native() >> u.lo );
+      }
+
+      uint128& operator *= ( const uint128& u ) { return assign_native( to_native() * u.to_native() ); }
+      // exception types match portable implementation
+      uint128& operator /= ( const uint128& u )
+      {
+        if( !u )
+          throw std::overflow_error( "Division by zero." );
+        return assign_native( to_native() / u.to_native() );
+      }
+      uint128& operator %= ( const uint128& u )
+      {
+        if( !u )
+          throw std::domain_error( "divide by zero" );
+        return assign_native( to_native() % u.to_native() );
+      }
+#else
+      uint128& operator <<= ( const uint128& u );
+      uint128& operator >>= ( const uint128& u );
+
       uint128& operator *= ( const uint128& u );
       uint128& operator /= ( const uint128& u );
       uint128& operator %= ( const uint128& u );
+#endif
 
 
       friend uint128 operator + ( const uint128& l, const uint128& r )   { return uint128(l)+=r;   }
@@ -111,18 +154,54 @@ namespace fc
         return uint128( max64, max64 );
       }
 
+#ifdef FC_HAS_NATIVE_UINT128
+      static void full_product( const uint128& a, const uint128& b, uint128& result_hi, uint128& result_lo )
+      {
+        // P * 2**128 + (Q + R) * 2**64 + S, see portable version
+        const native_type s = native_type( a.lo ) * b.lo;
+        const native_type r = native_type( a.hi ) * b.lo;
+        const native_type q = native_type( a.lo ) * b.hi;
+        const native_type p = native_type( a.hi ) * b.hi;
+
+        const native_type mid = ( s >> 64 ) + uint64_t( r ) + uint64_t( q );
+        result_lo = uint128( uint64_t( mid ), uint64_t( s ) );
+        result_hi.assign_native( p + ( r >> 64 ) + ( q >> 64 ) + ( mid >> 64 ) );
+      }
+
+      uint8_t popcount() const { return uint8_t( __builtin_popcountll( lo ) + __builtin_popcountll( hi ) ); }
+#else
       static void full_product( const uint128& a, const uint128& b, uint128& result_hi, uint128& result_lo );
 
       uint8_t popcount() const;
+#endif
 
       // fields must be public for serialization
       uint64_t hi;
       uint64_t lo;
+
+#ifdef FC_HAS_NATIVE_UINT128
+    private:
+      __extension__ typedef unsigned __int128 native_type;
+
+      native_type to_native()const { return ( native_type( hi ) << 64 ) | lo; }
+      uint128& assign_native( native_type v ) { hi = uint64_t( v >> 64 ); lo = uint64_t( v ); return *this; }
+#endif
   };
   static_assert( sizeof(uint128) == 2*sizeof(uint64_t), "validate packing assumptions" );
 
   typedef uint128 uint128_t;
 
+  namespace detail { namespace uint128_portable {
+    /// Implementation of uint128 operations with 64-bit arithmetic only (used when there is no native 128-bit type)
+    void shift_left( uint128& a, const uint128& b );
+    void shift_right( uint128& a, const uint128& b );
+    void multiply( uint128& a, const uint128& b );
+    void divide( uint128& a, const uint128& b );
+    void modulo( uint128& a, const uint128& b );
+    void full_product( const uint128& a, const uint128& b, uint128& result_hi, uint128& result_lo );
+    uint8_t popcount( const uint128& a );
+  } }
+
   class variant;
 
   void to_variant( const uint128& var,  variant& vo );
@@ -0,0 +1,375 @@
+#include <fc/crypto/sha256.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define FC_SHA256_BATCH_X86
+#  include <cpuid.h>
+#  include <immintrin.h>
+#endif
+
+/*
+ *  Batch SHA-256: many independent messages hashed at once.
+ *
+ *  Kernels compress one block of each of their lanes per call. The driver below keeps every lane
+ *  busy - when message in some lane ends, its digest is stored and next message from the batch
+ *  takes over the lane, so messages of different lengths mix freely. Kernel is chosen once,
+ *  according to what CPU supports (in order of preference):
+ *  - "avx512"  - 16 lanes, each lane in one 32-bit element of a 512-bit vector,
+ *  - "sha-ni"  - single lane, SHA extensions,
+ *  - "avx2"    - 8 lanes, same over 256-bit vectors,
+ *  - "openssl" - no batch kernel, every message hashed separately.
+ */
+
+namespace fc {
+
+   namespace detail { namespace sha256_batch {
+
+      static const uint32_t K[64] = {
+         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+         0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+         0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+         0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+         0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+         0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+         0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+         0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+      };
+
+      static const uint32_t IV[8] = {
+         0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+      };
+
+      static const size_t max_lanes = 16;
+
+      /// state holds 8 words of state of each lane, word-major: state[ word * lanes + lane ]
+      typedef void (*compress_fn)( uint32_t* state, const uint8_t* const* blocks );
+
+      struct engine
+      {
+         const char*  name;
+         size_t       lanes;
+         compress_fn  compress;
+      };
+
+      inline uint32_t load_be32( const uint8_t* p )
+      {
+         return ( uint32_t( p[0] ) << 24 ) | ( uint32_t( p[1] ) << 16 ) | ( uint32_t( p[2] ) << 8 ) | uint32_t( p[3] );
+      }
+
+      inline void store_be32( uint8_t* p, uint32_t v )
+      {
+         p[0] = uint8_t( v >> 24 );
+         p[1] = uint8_t( v >> 16 );
+         p[2] = uint8_t( v >> 8 );
+         p[3] = uint8_t( v );
+      }
+
+#ifdef FC_SHA256_BATCH_X86
+
+#define FC_SHA256_ROTR( x, n ) ( ( (x) >> (n) ) | ( (x) << ( 32 - (n) ) ) )
+
+      /*
+       * Multi-lane compression written with vector extensions. It is instantiated only inside
+       * wrappers compiled for particular instruction set (always_inline makes the body part of
+       * the wrapper), so vector operations are emitted as AVX2 / AVX-512 instructions.
+       */
+      template< typename V >
+      inline __attribute__((always_inline)) void compress_lanes( uint32_t* state, const uint8_t* const* blocks )
+      {
+         const size_t lanes = sizeof( V ) / sizeof( uint32_t );
+
+         uint32_t words[ 16 ][ lanes ] __attribute__((aligned(64)));
+         for( size_t l = 0; l < lanes; ++l )
+            for( size_t i = 0; i < 16; ++i )
+               words[i][l] = load_be32( blocks[l] + 4 * i );
+
+         V w[16];
+         for( size_t i = 0; i < 16; ++i )
+            memcpy( &w[i], words[i], sizeof( V ) );
+
+         V s[8];
+         for( size_t i = 0; i < 8; ++i )
+            memcpy( &s[i], state + i * lanes, sizeof( V ) );
+
+         V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+         for( size_t i = 0; i < 64; ++i )
+         {
+            if( i >= 16 )
+            {
+               V w2 = w[ ( i - 2 ) & 15 ];
+               V w15 = w[ ( i - 15 ) & 15 ];
+               w[ i & 15 ] += ( FC_SHA256_ROTR( w2, 17 ) ^ FC_SHA256_ROTR( w2, 19 ) ^ ( w2 >> 10 ) )
+                  + w[ ( i - 7 ) & 15 ]
+                  + ( FC_SHA256_ROTR( w15, 7 ) ^ FC_SHA256_ROTR( w15, 18 ) ^ ( w15 >> 3 ) );
+            }
+
+            V t1 = h + ( FC_SHA256_ROTR( e, 6 ) ^ FC_SHA256_ROTR( e, 11 ) ^ FC_SHA256_ROTR( e, 25 ) )
+               + ( ( e & f ) ^ ( ~e & g ) ) + K[i] + w[ i & 15 ];
+            V t2 = ( FC_SHA256_ROTR( a, 2 ) ^ FC_SHA256_ROTR( a, 13 ) ^ FC_SHA256_ROTR( a, 22 ) )
+               + ( ( a & b ) ^ ( a & c ) ^ ( b & c ) );
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+         }
+
+         s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+         for( size_t i = 0; i < 8; ++i )
+            memcpy( state + i * lanes, &s[i], sizeof( V ) );
+      }
+
+#undef FC_SHA256_ROTR
+
+      typedef uint32_t v8u32 __attribute__((vector_size(32)));
+      typedef uint32_t v16u32 __attribute__((vector_size(64)));
+
+      __attribute__((target("avx2")))
+      void compress_avx2( uint32_t* state, const uint8_t* const* blocks )
+      {
+         compress_lanes< v8u32 >( state, blocks );
+      }
+
+      __attribute__((target("avx512f")))
+      void compress_avx512( uint32_t* state, const uint8_t* const* blocks )
+      {
+         compress_lanes< v16u32 >( state, blocks );
+      }
+
+      /// Single lane compression with SHA extensions (state kept in ABEF/CDGH layout the instructions use)
+      __attribute__((target("sha,sse4.1")))
+      void compress_shani( uint32_t* state, const uint8_t* const* blocks )
+      {
+         const __m128i byte_swap = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+         const uint8_t* block = blocks[0];
+
+         __m128i tmp = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i*)&state[0] ), 0xB1 ); // CDAB
+         __m128i state1 = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i*)&state[4] ), 0x1B ); // EFGH
+         __m128i state0 = _mm_alignr_epi8( tmp, state1, 8 ); // ABEF
+         state1 = _mm_blend_epi16( state1, tmp, 0xF0 ); // CDGH
+         const __m128i abef_save = state0;
+         const __m128i cdgh_save = state1;
+
+         __m128i msg[4];
+         for( int i = 0; i < 4; ++i )
+            msg[i] = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)( block + 16 * i ) ), byte_swap );
+
+         for( int i = 0; i < 16; ++i )
+         {
+            if( i >= 4 )
+            {
+               // words of group i from groups i-4 (msg[i&3]), i-3, i-2 and i-1
+               __m128i t = _mm_sha256msg1_epu32( msg[ i & 3 ], msg[ ( i + 1 ) & 3 ] );
+               t = _mm_add_epi32( t, _mm_alignr_epi8( msg[ ( i + 3 ) & 3 ], msg[ ( i + 2 ) & 3 ], 4 ) );
+               msg[ i & 3 ] = _mm_sha256msg2_epu32( t, msg[ ( i + 3 ) & 3 ] );
+            }
+            __m128i m = _mm_add_epi32( msg[ i & 3 ], _mm_loadu_si128( (const __m128i*)&K[ 4 * i ] ) );
+            state1 = _mm_sha256rnds2_epu32( state1, state0, m );
+            state0 = _mm_sha256rnds2_epu32( state0, state1, _mm_shuffle_epi32( m, 0x0E ) );
+         }
+
+         state0 = _mm_add_epi32( state0, abef_save );
+         state1 = _mm_add_epi32( state1, cdgh_save );
+
+         tmp = _mm_shuffle_epi32( state0, 0x1B ); // FEBA
+         state1 = _mm_shuffle_epi32( state1, 0xB1 ); // DCHG
+         _mm_storeu_si128( (__m128i*)&state[0], _mm_blend_epi16( tmp, state1, 0xF0 ) ); // DCBA
+         _mm_storeu_si128( (__m128i*)&state[4], _mm_alignr_epi8( state1, tmp, 8 ) ); // HGFE
+      }
+
+      /// kernels supported by CPU, in order of preference; fallback without batch kernel is always last
+      std::vector< engine > supported_engines()
+      {
+         std::vector< engine > result;
+         unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+         if( __get_cpuid_max( 0, nullptr ) < 7 )
+         {
+            result.push_back( engine{ "openssl", 1, nullptr } );
+            return result;
+         }
+
+         __get_cpuid( 1, &eax, &ebx, &ecx, &edx );
+         const bool sse41 = ( ecx & ( 1u << 19 ) ) != 0;
+         const bool osxsave = ( ecx & ( 1u << 27 ) ) != 0;
+         uint64_t xcr0 = 0;
+         if( osxsave )
+         {
+            uint32_t lo = 0, hi = 0;
+            __asm__( "xgetbv" : "=a"( lo ), "=d"( hi ) : "c"( 0 ) );
+            xcr0 = ( uint64_t( hi ) << 32 ) | lo;
+         }
+         const bool ymm_enabled = ( xcr0 & 0x6 ) == 0x6;
+         const bool zmm_enabled = ( xcr0 & 0xE6 ) == 0xE6;
+
+         __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+         const bool sha = ( ebx & ( 1u << 29 ) ) != 0;
+         const bool avx2 = ( ebx & ( 1u << 5 ) ) != 0;
+         const bool avx512f = ( ebx & ( 1u << 16 ) ) != 0;
+
+         if( avx512f && zmm_enabled )
+            result.push_back( engine{ "avx512", 16, compress_avx512 } );
+         if( sha && sse41 )
+            result.push_back( engine{ "sha-ni", 1, compress_shani } );
+         if( avx2 && ymm_enabled )
+            result.push_back( engine{ "avx2", 8, compress_avx2 } );
+         result.push_back( engine{ "openssl", 1, nullptr } );
+         return result;
+      }
+
+#else
+
+      std::vector< engine > supported_engines()
+      {
+         return std::vector< engine >{ engine{ "openssl", 1, nullptr } };
+      }
+
+#endif
+
+      /// kernel forced by tests, nullptr when preferred one is used
+      static const engine* forced_engine = nullptr;
+
+      const std::vector< engine >& get_supported_engines()
+      {
+         static const std::vector< engine > engines = supported_engines();
+         return engines;
+      }
+
+      const engine& get_engine()
+      {
+         return forced_engine != nullptr ? *forced_engine : get_supported_engines().front();
+      }
+
+      struct lane
+      {
+         bool           active = false;
+         size_t         message = 0;
+         const uint8_t* data = nullptr;
+         size_t         full_blocks = 0;
+         size_t         total_blocks = 0;
+         size_t         next_block = 0;
+         uint8_t        tail[128];
+
+         const uint8_t* block()const
+         {
+            return next_block < full_blocks ? data + 64 * next_block : tail + 64 * ( next_block - full_blocks );
+         }
+      };
+
+      void run( const engine& e, const char* const* data, const uint32_t* sizes, size_t count, sha256* out )
+      {
+         static const uint8_t idle_block[64] = {};
+
+         lane           lanes[ max_lanes ];
+         uint32_t       state[ 8 * max_lanes ] __attribute__((aligned(64)));
+         const uint8_t* blocks[ max_lanes ];
+         size_t         next_message = 0;
+         size_t         active = 0;
+
+         auto start = [&]( size_t l )
+         {
+            lane& ln = lanes[l];
+            ln.active = next_message < count;
+            if( !ln.active )
+               return;
+
+            const size_t m = next_message++;
+            const size_t size = sizes[m];
+            const size_t rest = size % 64;
+            ln.message = m;
+            ln.data = (const uint8_t*)data[m];
+            ln.full_blocks = size / 64;
+            ln.total_blocks = ln.full_blocks + ( rest < 56 ? 1 : 2 );
+            ln.next_block = 0;
+
+            const size_t tail_size = 64 * ( ln.total_blocks - ln.full_blocks );
+            if( rest != 0 )
+               memcpy( ln.tail, ln.data + 64 * ln.full_blocks, rest );
+            ln.tail[ rest ] = 0x80;
+            memset( ln.tail + rest + 1, 0, tail_size - rest - 1 );
+            const uint64_t bits = uint64_t( size ) * 8;
+            store_be32( ln.tail + tail_size - 8, uint32_t( bits >> 32 ) );
+            store_be32( ln.tail + tail_size - 4, uint32_t( bits ) );
+
+            for( size_t i = 0; i < 8; ++i )
+               state[ i * e.lanes + l ] = IV[i];
+            ++active;
+         };
+
+         for( size_t l = 0; l < e.lanes; ++l )
+            start( l );
+
+         while( active != 0 )
+         {
+            for( size_t l = 0; l < e.lanes; ++l )
+               blocks[l] = lanes[l].active ? lanes[l].block() : idle_block;
+
+            e.compress( state, blocks );
+
+            for( size_t l = 0; l < e.lanes; ++l )
+            {
+               lane& ln = lanes[l];
+               if( !ln.active || ++ln.next_block != ln.total_blocks )
+                  continue;
+
+               uint8_t* result = (uint8_t*)out[ ln.message ].data();
+               for( size_t i = 0; i < 8; ++i )
+                  store_be32( result + 4 * i, state[ i * e.lanes + l ] );
+               --active;
+               start( l );
+            }
+         }
+      }
+
+   } } // detail::sha256_batch
+
+   void sha256::hash_batch( const char* const* data, const uint32_t* sizes, size_t count, sha256* out )
+   {
+      const auto& e = detail::sha256_batch::get_engine();
+      if( e.compress == nullptr || count < 2 )
+      {
+         for( size_t i = 0; i < count; ++i )
+            out[i] = hash( data[i], sizes[i] );
+         return;
+      }
+      detail::sha256_batch::run( e, data, sizes, count, out );
+   }
+
+   const char* sha256::hash_batch_engine()
+   {
+      return detail::sha256_batch::get_engine().name;
+   }
+
+   std::vector< std::string > sha256::hash_batch_engines()
+   {
+      std::vector< std::string > names;
+      for( const auto& e : detail::sha256_batch::get_supported_engines() )
+         names.push_back( e.name );
+      return names;
+   }
+
+   void sha256::force_hash_batch_engine( const char* name )
+   {
+      detail::sha256_batch::forced_engine = nullptr;
+      if( name == nullptr )
+         return;
+      for( const auto& e : detail::sha256_batch::get_supported_engines() )
+      {
+         if( strcmp( e.name, name ) == 0 )
+         {
+            detail::sha256_batch::forced_engine = &e;
+            return;
+         }
+      }
+      FC_THROW_EXCEPTION( invalid_arg_exception, "SHA-256 batch kernel ${k} is not supported by this CPU", ("k", name) );
+   }
+
+} // fc
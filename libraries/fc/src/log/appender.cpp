@@ -8,6 +8,7 @@
 #include <fc/log/console_appender.hpp>
 #include <fc/log/file_appender.hpp>
 #include <fc/log/gelf_appender.hpp>
+#include <fc/log/async_appender.hpp>
 #include <fc/variant.hpp>
 #include <fc/macros.hpp>
 #include "console_defines.h"
@@ -91,4 +92,9 @@ namespace fc {
       return appender::register_appender<gelf_appender>( "gelf" );
    }( &reg_gelf_appender );
 
+   static bool reg_async_appender = []( __attribute__((unused)) bool* )->bool
+   {
+      return appender::register_appender<async_appender>( "async" );
+   }( &reg_async_appender );
+
 } // namespace fc
@@ -0,0 +1,298 @@
+#include <fc/exception/exception.hpp>
+#include <fc/log/async_appender.hpp>
+#include <fc/log/log_message.hpp>
+#include <fc/reflect/variant.hpp>
+#include <fc/variant.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fc {
+
+   extern std::unordered_map<std::string,appender_factory::ptr>& get_appender_factory_map();
+
+   namespace detail {
+
+      /// Single producer (owning thread), single consumer (writer thread) ring of log records
+      class log_ring
+      {
+         public:
+            log_ring( uint32_t capacity, const log_message& empty ) : _slots( capacity, empty ), _mask( capacity - 1 ) {}
+
+            bool push( const log_message& m )
+            {
+               uint64_t head = _head.load( std::memory_order_relaxed );
+               if( head - _tail.load( std::memory_order_acquire ) > _mask )
+                  return false;
+               _slots[ head & _mask ] = m;
+               _head.store( head + 1, std::memory_order_release );
+               return true;
+            }
+
+            /// Moves all available records to given batch, releases references held by emptied slots
+            void drain( std::vector<log_message>& batch, const log_message& empty )
+            {
+               uint64_t tail = _tail.load( std::memory_order_relaxed );
+               uint64_t head = _head.load( std::memory_order_acquire );
+               for( ; tail != head; ++tail )
+               {
+                  log_message& slot = _slots[ tail & _mask ];
+                  batch.push_back( slot );
+                  slot = empty;
+               }
+               _tail.store( tail, std::memory_order_release );
+            }
+
+            bool empty()const
+            {
+               return _head.load( std::memory_order_acquire ) == _tail.load( std::memory_order_relaxed );
+            }
+
+         private:
+            std::vector<log_message>            _slots;
+            const uint64_t                      _mask;
+            alignas(64) std::atomic<uint64_t>   _head{ 0 };
+            alignas(64) std::atomic<uint64_t>   _tail{ 0 };
+      };
+
+      /// Rings of single thread by id of async_appender they belong to. log() finds the ring in small cache
+      /// without locking; mutex is taken only when the thread logs to an appender for the first time (or
+      /// after cache collision) and by async_appender that unregisters its ring on destruction.
+      struct thread_rings
+      {
+         static const uint64_t no_appender = std::numeric_limits<uint64_t>::max();
+         static const size_t   cache_size = 4;
+
+         struct cache_entry
+         {
+            std::atomic<uint64_t>  id{ no_appender };
+            std::atomic<log_ring*> ring{ nullptr };
+         };
+
+         log_ring* find_cached( uint64_t id )const
+         {
+            const cache_entry& entry = cache[ id % cache_size ];
+            if( entry.id.load( std::memory_order_acquire ) != id )
+               return nullptr;
+            return entry.ring.load( std::memory_order_acquire );
+         }
+
+         /// must be called with mutex locked
+         void set_cached( uint64_t id, log_ring* ring )
+         {
+            cache_entry& entry = cache[ id % cache_size ];
+            entry.ring.store( nullptr, std::memory_order_release );
+            entry.id.store( id, std::memory_order_release );
+            entry.ring.store( ring, std::memory_order_release );
+         }
+
+         /// must be called with mutex locked
+         void unregister( uint64_t id )
+         {
+            cache_entry& entry = cache[ id % cache_size ];
+            if( entry.id.load( std::memory_order_relaxed ) == id )
+            {
+               entry.ring.store( nullptr, std::memory_order_release );
+               entry.id.store( no_appender, std::memory_order_release );
+            }
+            rings.erase( id );
+         }
+
+         cache_entry                                             cache[ cache_size ];
+         std::mutex                                              mutex;
+         std::unordered_map<uint64_t, std::shared_ptr<log_ring>> rings;
+      };
+
+      const std::shared_ptr<thread_rings>& get_thread_rings()
+      {
+         thread_local std::shared_ptr<thread_rings> rings = std::make_shared<thread_rings>();
+         return rings;
+      }
+
+      uint32_t round_up_to_power_of_2( uint32_t value )
+      {
+         uint32_t result = 1;
+         while( result < value && result < ( 1u << 31 ) )
+            result <<= 1;
+         return result;
+      }
+   }
+
+   class async_appender::impl
+   {
+      public:
+         impl( const config& c ) : cfg( c ), id( next_id++ )
+         {
+            auto fact_itr = get_appender_factory_map().find( cfg.type );
+            FC_ASSERT( fact_itr != get_appender_factory_map().end(), "Unknown appender type '${t}'", ("t", cfg.type) );
+            FC_ASSERT( cfg.type != "async", "Async appender cannot wrap another async appender" );
+            FC_ASSERT( cfg.queue_size > 0 );
+            target = fact_itr->second->create( cfg.args );
+            cfg.queue_size = detail::round_up_to_power_of_2( cfg.queue_size );
+            writer = std::thread( [this]() { write_loop(); } );
+         }
+
+         ~impl()
+         {
+            {
+               std::lock_guard<std::mutex> guard( mutex );
+               stop = true;
+            }
+            cv.notify_one();
+            if( writer.joinable() )
+               writer.join();
+
+            // remove rings from maps of threads that are still alive, so they don't keep growing
+            // when appenders are recreated (e.g. on logging reconfiguration)
+            std::vector<std::weak_ptr<detail::thread_rings>> threads;
+            {
+               std::lock_guard<std::mutex> guard( mutex );
+               threads.swap( registered_threads );
+            }
+            for( auto& t : threads )
+            {
+               if( auto rings = t.lock() )
+               {
+                  std::lock_guard<std::mutex> guard( rings->mutex );
+                  rings->unregister( id );
+               }
+            }
+         }
+
+         detail::log_ring& get_ring()
+         {
+            const auto& rings = detail::get_thread_rings();
+            detail::log_ring* cached = rings->find_cached( id );
+            if( cached != nullptr )
+               return *cached;
+
+            std::lock_guard<std::mutex> rings_guard( rings->mutex );
+            auto itr = rings->rings.find( id );
+            if( itr != rings->rings.end() )
+            {
+               rings->set_cached( id, itr->second.get() );
+               return *itr->second;
+            }
+
+            auto ring = std::make_shared<detail::log_ring>( cfg.queue_size, empty );
+            {
+               std::lock_guard<std::mutex> guard( mutex );
+               all_rings.push_back( ring );
+               registered_threads.push_back( rings );
+            }
+            rings->rings[ id ] = ring;
+            rings->set_cached( id, ring.get() );
+            return *ring;
+         }
+
+         /// Collects records from all rings, forgets rings of threads that finished and were emptied
+         void collect( std::vector<log_message>& batch )
+         {
+            std::lock_guard<std::mutex> guard( mutex );
+            for( auto& ring : all_rings )
+               ring->drain( batch, empty );
+            all_rings.erase( std::remove_if( all_rings.begin(), all_rings.end(),
+               []( const std::shared_ptr<detail::log_ring>& r ) { return r.use_count() == 1 && r->empty(); } ), all_rings.end() );
+            registered_threads.erase( std::remove_if( registered_threads.begin(), registered_threads.end(),
+               []( const std::weak_ptr<detail::thread_rings>& t ) { return t.expired(); } ), registered_threads.end() );
+         }
+
+         void write( std::vector<log_message>& batch )
+         {
+            std::stable_sort( batch.begin(), batch.end(), []( const log_message& a, const log_message& b )
+               { return a.get_context().get_timestamp() < b.get_context().get_timestamp(); } );
+            for( const auto& m : batch )
+            {
+               try
+               {
+                  target->log( m );
+               }
+               catch( ... )
+               {
+               }
+            }
+            batch.clear();
+
+            uint64_t dropped_now = dropped.load( std::memory_order_relaxed );
+            if( dropped_now != reported_dropped )
+            {
+               try
+               {
+                  target->log( FC_LOG_MESSAGE( warn, "Async appender dropped ${n} log records (buffer of logging thread was full), ${total} in total",
+                     ("n", dropped_now - reported_dropped)("total", dropped_now) ) );
+               }
+               catch( ... )
+               {
+               }
+               reported_dropped = dropped_now;
+            }
+         }
+
+         void write_loop()
+         {
+            std::vector<log_message> batch;
+            bool stopping = false;
+            while( !stopping )
+            {
+               collect( batch );
+               if( batch.empty() )
+               {
+                  std::unique_lock<std::mutex> lock( mutex );
+                  if( !stop )
+                     cv.wait_for( lock, std::chrono::milliseconds( cfg.drain_interval_ms ) );
+                  stopping = stop;
+                  if( !stopping )
+                     continue;
+                  lock.unlock();
+                  collect( batch ); // final drain
+               }
+               write( batch );
+            }
+         }
+
+         config                                         cfg;
+         const uint64_t                                 id;
+         appender::ptr                                  target;
+         const log_message                              empty;
+         std::atomic<uint64_t>                          dropped{ 0 };
+         uint64_t                                       reported_dropped = 0;
+
+         std::mutex                                     mutex;
+         std::condition_variable                        cv;
+         bool                                           stop = false;
+         std::vector<std::shared_ptr<detail::log_ring>> all_rings;
+         std::vector<std::weak_ptr<detail::thread_rings>> registered_threads; ///< threads that have ring of this appender
+         std::thread                                    writer;
+
+         static std::atomic<uint64_t>                   next_id;
+   };
+
+   std::atomic<uint64_t> async_appender::impl::next_id{ 0 };
+
+   async_appender::async_appender( const variant& args ) :
+     my( new impl( args.as<config>() ) )
+   {}
+
+   async_appender::~async_appender()
+   {
+   }
+
+   void async_appender::log( const log_message& m )
+   {
+      if( !my->get_ring().push( m ) )
+         my->dropped.fetch_add( 1, std::memory_order_relaxed );
+   }
+
+   uint64_t async_appender::get_dropped_count()const
+   {
+      return my->dropped.load( std::memory_order_relaxed );
+   }
+
+} // fc
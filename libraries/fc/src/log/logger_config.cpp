@@ -6,6 +6,7 @@
 #include <string>
 #include <fc/log/console_appender.hpp>
 #include <fc/log/file_appender.hpp>
+#include <fc/log/async_appender.hpp>
 #include <fc/reflect/variant.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/io/stdio.hpp>
@@ -24,6 +25,7 @@ namespace fc {
       try {
       static bool reg_console_appender = appender::register_appender<console_appender>( "console" );
       static bool reg_file_appender = appender::register_appender<file_appender>( "file" );
+      static bool reg_async_appender = appender::register_appender<async_appender>( "async" );
       get_logger_map().clear();
       get_appender_map().clear();
 
@@ -48,7 +50,7 @@ namespace fc {
             if( ap ) { lgr.add_appender(ap); }
          }
       }
-      return reg_console_appender || reg_file_appender;
+      return reg_console_appender || reg_file_appender || reg_async_appender;
       } catch ( exception& e )
       {
          fc::cerr<<e.to_detail_string()<<"\n";
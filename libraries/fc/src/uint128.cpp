@@ -134,25 +134,29 @@ namespace fc
 
       // at worst it will be size digits (base 2) so make our buffer
       // that plus room for null terminator
-      static char sz [128 + 1];
-       sz[sizeof(sz) - 1] = '\0';
+      char sz [128 + 1];
+      sz[sizeof(sz) - 1] = '\0';
 
       uint128 ii(*this);
       int i = 128 - 1;
 
       while (ii != 0 && i) {
 
-      uint128 remainder;
-      divide(ii, uint128(10), ii, remainder);
+      uint128 quotient = ii / 10;
+      uint128 remainder = ii - quotient * 10;
+      ii = quotient;
           sz [--i] = "0123456789abcdefghijklmnopqrstuvwxyz"[remainder.to_integer()];
       }
 
       return &sz[i];
     }
 
+namespace detail { namespace uint128_portable {
 
-    uint128& uint128::operator<<=(const uint128& rhs) 
+    void shift_left( uint128& a, const uint128& rhs )
     {
+        uint64_t& hi = a.hi;
+        uint64_t& lo = a.lo;
         if(rhs >= 128) 
         {
           hi = 0;
@@ -182,12 +186,12 @@ namespace fc
                 lo <<= n;
             }
        }
-
-       return *this;
     }
 
-    uint128 & uint128::operator>>=(const uint128& rhs) 
+    void shift_right( uint128& a, const uint128& rhs )
     {
+       uint64_t& hi = a.hi;
+       uint64_t& lo = a.lo;
        if(rhs >= 128)
        {
          hi = 0;
@@ -218,48 +222,29 @@ namespace fc
                hi >>= n;
            }
       }
-      return *this;
    }
 
-    uint128& uint128::operator/=(const uint128 &b) 
+    void divide( uint128& a, const uint128& b )
     {
-        auto self = (m128(hi) << 64) + m128(lo);
+        auto self = (m128(a.hi) << 64) + m128(a.lo);
         auto other = (m128(b.hi) << 64) + m128(b.lo);
         self /= other;
-        hi = static_cast<uint64_t>(self >> 64);
-        lo = static_cast<uint64_t>((self << 64 ) >> 64);
-
-        /*
-        uint128 remainder;
-        divide(*this, b, *this, remainder ); //, *this);
-        if( tmp.hi != hi || tmp.lo != lo ) {
-           std::cerr << tmp.hi << "  " << hi <<"\n";
-           std::cerr << tmp.lo << "  " << lo << "\n";
-           exit(1);
-        }
-        */
-       
-        /*
-        const auto&  b128 = std::reinterpret_cast<const m128&>(b);
-        auto&     this128 = std::reinterpret_cast<m128&>(*this);
-        this128 /= b128;
-        */
-        return *this;
+        a.hi = static_cast<uint64_t>(self >> 64);
+        a.lo = static_cast<uint64_t>((self << 64 ) >> 64);
     }
 
-    uint128& uint128::operator%=(const uint128 &b) 
+    void modulo( uint128& a, const uint128& b )
     {
         uint128 quotient;
-        divide(*this, b, quotient, *this);
-        return *this;
+        fc::divide(a, b, quotient, a);
     }
 
-    uint128& uint128::operator*=(const uint128 &b) 
+    void multiply( uint128& a, const uint128& b )
     {
-        uint64_t a0 = (uint32_t) (this->lo        );
-        uint64_t a1 = (uint32_t) (this->lo >> 0x20);
-        uint64_t a2 = (uint32_t) (this->hi        );
-        uint64_t a3 = (uint32_t) (this->hi >> 0x20);
+        uint64_t a0 = (uint32_t) (a.lo        );
+        uint64_t a1 = (uint32_t) (a.lo >> 0x20);
+        uint64_t a2 = (uint32_t) (a.hi        );
+        uint64_t a3 = (uint32_t) (a.hi >> 0x20);
 
         uint64_t b0 = (uint32_t) (b.lo        );
         uint64_t b1 = (uint32_t) (b.lo >> 0x20);
@@ -275,26 +260,26 @@ namespace fc
         // (a3 * b0 + a2 * b1 + a1 * b2 + a0 * b3) << 0x60
         //
         // all other cross terms are << 0x80 or higher, thus do not appear in result
-        
-        this->hi = 0;
-        this->lo = a3*b0;
-        (*this) += a2*b1;
-        (*this) += a1*b2;
-        (*this) += a0*b3;
-        (*this) <<= 0x20;
-        (*this) += a2*b0;
-        (*this) += a1*b1;
-        (*this) += a0*b2;
-        (*this) <<= 0x20;
-        (*this) += a1*b0;
-        (*this) += a0*b1;
-        (*this) <<= 0x20;
-        (*this) += a0*b0;
-
-        return *this;
+
+        // additions are done on uint128 without native multiplication, so shifts have to be portable too
+        uint128 result( 0, a3*b0 );
+        result += a2*b1;
+        result += a1*b2;
+        result += a0*b3;
+        shift_left( result, 0x20 );
+        result += a2*b0;
+        result += a1*b1;
+        result += a0*b2;
+        shift_left( result, 0x20 );
+        result += a1*b0;
+        result += a0*b1;
+        shift_left( result, 0x20 );
+        result += a0*b0;
+
+        a = result;
    }
    
-   void uint128::full_product( const uint128& a, const uint128& b, uint128& result_hi, uint128& result_lo )
+   void full_product( const uint128& a, const uint128& b, uint128& result_hi, uint128& result_lo )
    {
        //   (ah * 2**64 + al) * (bh * 2**64 + bl)
        // = (ah * bh * 2**128 + al * bh * 2**64 + ah * bl * 2**64 + al * bl
@@ -311,13 +296,13 @@ namespace fc
        uint64_t bl = b.lo;
 
        uint128 s = al;
-       s *= bl;
+       multiply( s, bl );
        uint128 r = ah;
-       r *= bl;
+       multiply( r, bl );
        uint128 q = al;
-       q *= bh;
+       multiply( q, bh );
        uint128 p = ah;
-       p *= bh;
+       multiply( p, bh );
        
        uint64_t sl = s.lo;
        uint64_t sh = s.hi;
@@ -358,9 +343,6 @@ namespace fc
          0x0000FFFF0000FFFFULL,
          0x00000000FFFFFFFFULL
       };
-      // TODO future optimization:  replace slow, portable version
-      // with fast, non-portable __builtin_popcountll intrinsic
-      // (when available)
 
       for( int i=0, w=1; i<6; i++, w+=w )
       {
@@ -369,10 +351,30 @@ namespace fc
       return uint8_t(x);
    }
 
+   uint8_t popcount( const uint128& a )
+   {
+      return _popcount_64( a.lo ) + _popcount_64( a.hi );
+   }
+
+} } // detail::uint128_portable
+
+#ifndef FC_HAS_NATIVE_UINT128
+   uint128& uint128::operator<<=( const uint128& rhs ) { detail::uint128_portable::shift_left( *this, rhs ); return *this; }
+   uint128& uint128::operator>>=( const uint128& rhs ) { detail::uint128_portable::shift_right( *this, rhs ); return *this; }
+   uint128& uint128::operator*=( const uint128& b ) { detail::uint128_portable::multiply( *this, b ); return *this; }
+   uint128& uint128::operator/=( const uint128& b ) { detail::uint128_portable::divide( *this, b ); return *this; }
+   uint128& uint128::operator%=( const uint128& b ) { detail::uint128_portable::modulo( *this, b ); return *this; }
+
+   void uint128::full_product( const uint128& a, const uint128& b, uint128& result_hi, uint128& result_lo )
+   {
+      detail::uint128_portable::full_product( a, b, result_hi, result_lo );
+   }
+
    uint8_t uint128::popcount()const
    {
-      return _popcount_64( lo ) + _popcount_64( hi );
+      return detail::uint128_portable::popcount( *this );
    }
+#endif
 
    void to_variant( const uint128& var,  variant& vo )  { vo = std::string(var);         }
    void from_variant( const variant& var,  uint128& vo ){ vo = uint128(var.as_string()); }
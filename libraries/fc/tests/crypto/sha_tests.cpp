@@ -157,6 +157,57 @@ BOOST_AUTO_TEST_CASE(sha256_test)
     BOOST_CHECK_EQUAL( "d61967f63c7dd183914a4ae452c9f6ad5d462ce3d277798075b107615c1a8a30", (std::string) fc::sha256::hash(fourth) );
 }
 
+BOOST_AUTO_TEST_CASE(sha256_batch_test)
+{
+    init_5();
+    const auto engines = fc::sha256::hash_batch_engines();
+    BOOST_REQUIRE( !engines.empty() );
+    BOOST_CHECK_EQUAL( engines.front(), fc::sha256::hash_batch_engine() );
+    BOOST_CHECK_EQUAL( engines.back(), "openssl" );
+    BOOST_CHECK_THROW( fc::sha256::force_hash_batch_engine( "unknown" ), fc::invalid_arg_exception );
+
+    // messages of all lengths around block boundaries, mixed with long ones
+    std::vector<const char*> data;
+    std::vector<uint32_t> sizes;
+    for( uint32_t i = 0; i < 300; i++ )
+    {
+        data.push_back( TEST5 + i );
+        sizes.push_back( i % 3 == 0 ? 1000 + i * 7 : i );
+    }
+
+    // every kernel supported by this CPU, with batch sizes that don't fill all lanes of the last round
+    for( const auto& engine : engines )
+    {
+        BOOST_TEST_MESSAGE( "Kernel " + engine );
+        fc::sha256::force_hash_batch_engine( engine.c_str() );
+        BOOST_CHECK_EQUAL( engine, fc::sha256::hash_batch_engine() );
+        for( size_t count : { size_t( 2 ), size_t( 3 ), size_t( 7 ), size_t( 8 ), size_t( 9 ), size_t( 15 ), size_t( 16 ), size_t( 17 ), size_t( 33 ), data.size() } )
+        {
+            // messages are taken from different offsets, so lengths of messages in lanes differ for each count
+            const size_t first = count % 5;
+            std::vector<fc::sha256> out( count );
+            fc::sha256::hash_batch( data.data() + first, sizes.data() + first, count, out.data() );
+            for( size_t i = 0; i < count; i++ )
+                BOOST_CHECK_EQUAL( (std::string) fc::sha256::hash( data[ first + i ], sizes[ first + i ] ), (std::string) out[i] );
+        }
+
+        // messages of equal length end in the same round
+        std::vector<const char*> same( 20, TEST5 );
+        std::vector<uint32_t> same_sizes( same.size(), 119 );
+        std::vector<fc::sha256> out( same.size() );
+        fc::sha256::hash_batch( same.data(), same_sizes.data(), same.size(), out.data() );
+        for( const auto& h : out )
+            BOOST_CHECK_EQUAL( (std::string) fc::sha256::hash( TEST5, 119 ), (std::string) h );
+
+        const char* single[] = { TEST1.c_str() };
+        const uint32_t single_size[] = { 3 };
+        fc::sha256::hash_batch( single, single_size, 1, out.data() );
+        BOOST_CHECK_EQUAL( "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", (std::string) out[0] );
+    }
+    fc::sha256::force_hash_batch_engine( nullptr );
+    BOOST_CHECK_EQUAL( engines.front(), fc::sha256::hash_batch_engine() );
+}
+
 BOOST_AUTO_TEST_CASE(sha512_test)
 {
     init_5();
@@ -0,0 +1,188 @@
+#include <boost/test/unit_test.hpp>
+
+#include <fc/log/async_appender.hpp>
+#include <fc/log/log_message.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace fc;
+
+namespace {
+
+/// Appender that keeps messages in memory; writing of the first message can be held until released
+class capture_appender : public appender
+{
+   public:
+      struct state
+      {
+         std::mutex                mutex;
+         std::condition_variable   cv;
+         std::vector<std::string>  messages;
+         bool                      hold_first = false;
+      };
+
+      static state& get_state()
+      {
+         static state s;
+         return s;
+      }
+
+      static void reset( bool hold_first )
+      {
+         std::lock_guard<std::mutex> guard( get_state().mutex );
+         get_state().messages.clear();
+         get_state().hold_first = hold_first;
+      }
+
+      /// waits until writer thread is inside log() of the first message
+      static void wait_for_first()
+      {
+         std::unique_lock<std::mutex> lock( get_state().mutex );
+         get_state().cv.wait( lock, []() { return !get_state().messages.empty(); } );
+      }
+
+      static void release()
+      {
+         {
+            std::lock_guard<std::mutex> guard( get_state().mutex );
+            get_state().hold_first = false;
+         }
+         get_state().cv.notify_all();
+      }
+
+      static std::vector<std::string> get_messages()
+      {
+         std::lock_guard<std::mutex> guard( get_state().mutex );
+         return get_state().messages;
+      }
+
+      capture_appender( const variant& ) {}
+
+      virtual void log( const log_message& m )override
+      {
+         std::unique_lock<std::mutex> lock( get_state().mutex );
+         get_state().messages.push_back( m.get_message() );
+         get_state().cv.notify_all();
+         get_state().cv.wait( lock, []() { return !get_state().hold_first; } );
+      }
+};
+
+static bool reg_capture_appender = appender::register_appender<capture_appender>( "capture" );
+
+variant make_config( uint32_t queue_size, uint32_t drain_interval_ms )
+{
+   async_appender::config cfg;
+   cfg.type = "capture";
+   cfg.queue_size = queue_size;
+   cfg.drain_interval_ms = drain_interval_ms;
+   return variant( cfg );
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(async_appender_tests)
+
+BOOST_AUTO_TEST_CASE(drains_in_timestamp_order)
+{
+   BOOST_REQUIRE( reg_capture_appender );
+   capture_appender::reset( true );
+   {
+      async_appender a( make_config( 16, 10 ) );
+      a.log( FC_LOG_MESSAGE( info, "first" ) );
+      capture_appender::wait_for_first();
+
+      // writer is held, so following records are collected in one batch; they are created in
+      // order of their names, but logged by different threads in reverse order
+      log_message m1 = FC_LOG_MESSAGE( info, "m1" );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      log_message m2 = FC_LOG_MESSAGE( info, "m2" );
+      std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      log_message m3 = FC_LOG_MESSAGE( info, "m3" );
+      std::thread( [&]() { a.log( m3 ); } ).join();
+      a.log( m2 );
+      std::thread( [&]() { a.log( m1 ); } ).join();
+
+      capture_appender::release();
+   }
+   BOOST_CHECK( ( capture_appender::get_messages() == std::vector<std::string>{ "first", "m1", "m2", "m3" } ) );
+}
+
+BOOST_AUTO_TEST_CASE(counts_dropped_records)
+{
+   capture_appender::reset( true );
+   {
+      async_appender a( make_config( 4, 10 ) );
+      a.log( FC_LOG_MESSAGE( info, "first" ) );
+      capture_appender::wait_for_first();
+
+      // first record was already taken from the buffer, so it has room for 4 more
+      for( int i = 0; i < 10; ++i )
+         a.log( FC_LOG_MESSAGE( info, "r${i}", ("i", i) ) );
+      BOOST_CHECK_EQUAL( a.get_dropped_count(), 6u );
+
+      capture_appender::release();
+   }
+   auto messages = capture_appender::get_messages();
+   BOOST_REQUIRE_EQUAL( messages.size(), 6u );
+   BOOST_CHECK_EQUAL( messages[0], "first" );
+   // drops are reported after the batch that was being written when they happened
+   BOOST_CHECK_EQUAL( messages[1], "Async appender dropped 6 log records (buffer of logging thread was full), 6 in total" );
+   for( int i = 0; i < 4; ++i )
+      BOOST_CHECK_EQUAL( messages[ i + 2 ], "r" + std::to_string( i ) );
+}
+
+BOOST_AUTO_TEST_CASE(flushes_on_destruction)
+{
+   capture_appender::reset( false );
+   {
+      // writer would sleep long after the first empty check, so records are written by the final drain
+      async_appender a( make_config( 1024, 60000 ) );
+      std::thread( [&]() { for( int i = 0; i < 100; ++i ) a.log( FC_LOG_MESSAGE( info, "t${i}", ("i", i) ) ); } ).join();
+      for( int i = 0; i < 100; ++i )
+         a.log( FC_LOG_MESSAGE( info, "m${i}", ("i", i) ) );
+      BOOST_CHECK_EQUAL( a.get_dropped_count(), 0u );
+   }
+   BOOST_CHECK_EQUAL( capture_appender::get_messages().size(), 200u );
+
+   BOOST_TEST_MESSAGE( "Thread keeps logging to appenders created after previous ones were destroyed" );
+   for( int n = 0; n < 3; ++n )
+   {
+      capture_appender::reset( false );
+      {
+         async_appender a( make_config( 16, 10 ) );
+         a.log( FC_LOG_MESSAGE( info, "again" ) );
+      }
+      BOOST_CHECK( ( capture_appender::get_messages() == std::vector<std::string>{ "again" } ) );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(many_appenders_per_thread)
+{
+   capture_appender::reset( false );
+   {
+      // more appenders than buffers cached per thread, so some of them share cache entry
+      std::vector<std::unique_ptr<async_appender>> appenders;
+      for( int i = 0; i < 6; ++i )
+         appenders.emplace_back( new async_appender( make_config( 64, 10 ) ) );
+      for( int n = 0; n < 10; ++n )
+      {
+         for( auto& a : appenders )
+            a->log( FC_LOG_MESSAGE( info, "m" ) );
+      }
+      // destroyed appender leaves cache of the thread, the rest keeps working
+      appenders.erase( appenders.begin() + 1 );
+      for( auto& a : appenders )
+         a->log( FC_LOG_MESSAGE( info, "m" ) );
+      for( auto& a : appenders )
+         BOOST_CHECK_EQUAL( a->get_dropped_count(), 0u );
+   }
+   BOOST_CHECK_EQUAL( capture_appender::get_messages().size(), 6u * 10 + 5 );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,113 @@
+#include <fc/uint128.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <random>
+
+BOOST_AUTO_TEST_SUITE(fc)
+
+using fc::uint128;
+using std::string;
+
+namespace portable = fc::detail::uint128_portable;
+typedef boost::multiprecision::uint128_t m128;
+
+static m128 to_m128( const uint128& v ) { return ( m128( v.hi ) << 64 ) + m128( v.lo ); }
+
+/// random values biased towards edge cases: zero or full halves, small numbers and powers of two
+static uint128 random_value( std::mt19937_64& gen )
+{
+  uint64_t kind = gen() % 8;
+  switch( kind )
+  {
+    case 0: return uint128( 0, gen() );
+    case 1: return uint128( 0, gen() % 1000 );
+    case 2: return uint128( gen(), 0 );
+    case 3: return uint128( 1 ) << uint128( gen() % 128 );
+    case 4: return ( uint128( 1 ) << uint128( gen() % 128 ) ) - 1;
+    case 5: return uint128( gen() >> ( gen() % 64 ), gen() );
+    case 6: return uint128::max_value() - uint128( 0, gen() % 1000 );
+    default: return uint128( gen(), gen() );
+  }
+}
+
+#define CHECK_SAME( native, reference ) \
+  BOOST_REQUIRE_MESSAGE( (native) == (reference), #native " differs from reference for a = " << string( a ) << ", b = " << string( b ) )
+
+BOOST_AUTO_TEST_CASE(uint128_differential_test)
+{
+  std::mt19937_64 gen( 20261018 );
+
+  for( int i = 0; i < 200000; ++i )
+  {
+    const uint128 a = random_value( gen );
+    const uint128 b = random_value( gen );
+
+    uint128 expected = a;
+    portable::multiply( expected, b );
+    CHECK_SAME( a * b, expected );
+    CHECK_SAME( to_m128( a * b ), ( to_m128( a ) * to_m128( b ) ) & m128( to_m128( uint128::max_value() ) ) );
+
+    if( b != 0 )
+    {
+      expected = a;
+      portable::divide( expected, b );
+      CHECK_SAME( a / b, expected );
+      CHECK_SAME( to_m128( a / b ), to_m128( a ) / to_m128( b ) );
+
+      expected = a;
+      portable::modulo( expected, b );
+      CHECK_SAME( a % b, expected );
+      CHECK_SAME( to_m128( a % b ), to_m128( a ) % to_m128( b ) );
+    }
+
+    const uint128 shift = gen() % 140;
+    expected = a;
+    portable::shift_left( expected, shift );
+    CHECK_SAME( a << shift, expected );
+    expected = a;
+    portable::shift_right( expected, shift );
+    CHECK_SAME( a >> shift, expected );
+
+    uint128 hi, lo, expected_hi, expected_lo;
+    uint128::full_product( a, b, hi, lo );
+    portable::full_product( a, b, expected_hi, expected_lo );
+    CHECK_SAME( hi, expected_hi );
+    CHECK_SAME( lo, expected_lo );
+
+    BOOST_REQUIRE_EQUAL( a.popcount(), portable::popcount( a ) );
+    BOOST_REQUIRE( uint128( string( a ) ) == a );
+    BOOST_REQUIRE_EQUAL( string( a ), to_m128( a ).str() );
+  }
+}
+
+BOOST_AUTO_TEST_CASE(uint128_edge_cases)
+{
+  const uint128 max = uint128::max_value();
+  BOOST_CHECK( max * max == uint128( 1 ) );
+  BOOST_CHECK( max / max == uint128( 1 ) );
+  BOOST_CHECK( max % uint128( 10 ) == uint128( 5 ) );
+  BOOST_CHECK( ( max << uint128( 128 ) ) == uint128() );
+  BOOST_CHECK( ( max >> uint128( 1, 0 ) ) == uint128() );
+  BOOST_CHECK( ( max >> uint128( 64 ) ) == uint128( 0, max.lo ) );
+  BOOST_CHECK_EQUAL( max.popcount(), 128 );
+
+  uint128 hi, lo;
+  uint128::full_product( max, max, hi, lo );
+  BOOST_CHECK( hi == max - uint128( 1 ) );
+  BOOST_CHECK( lo == uint128( 1 ) );
+
+  // division by zero reports the same exceptions as before
+  BOOST_CHECK_THROW( uint128( 1 ) / uint128(), std::overflow_error );
+  BOOST_CHECK_THROW( uint128( 1 ) % uint128(), std::domain_error );
+
+  // binary form stays hi, lo
+  uint128 v( 1, 2 );
+  uint64_t raw[2];
+  memcpy( raw, &v, sizeof( v ) );
+  BOOST_CHECK_EQUAL( raw[0], 1u );
+  BOOST_CHECK_EQUAL( raw[1], 2u );
+  BOOST_CHECK_EQUAL( string( uint128( "340282366920938463463374607431768211455" ) ), "340282366920938463463374607431768211455" );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -29,6 +29,9 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+#include <mutex>
+
 namespace graphene { namespace net {
 
   /**
@@ -45,21 +48,95 @@ namespace graphene { namespace net {
 
   typedef fc::uint160_t message_hash_type;
 
+  /**
+   *  Immutable, reference counted contents of a message. All copies of a message (in send queues
+   *  of all peers, in message cache...) share the same buffer, so queueing a block to many peers
+   *  does not copy it.
+   *
+   *  The buffer holds the message in the form it travels on the wire: header, payload and zero
+   *  padding to a multiple of 16 bytes. Such frame is written to sockets as is, and frames read from
+   *  sockets are kept without copying, so relayed messages are never re-encoded. Hash of the payload
+   *  (message id) is computed on first request and remembered.
+   */
+  class message_data
+  {
+     public:
+        message_data() {}
+        /// Copies payload (of header.size bytes) into new frame with given header
+        message_data( const message_header& header, const char* payload );
+        /// Takes over complete frame (header, payload, padding)
+        explicit message_data( std::vector<char>&& frame );
+
+        static size_t frame_size_for( uint32_t payload_size )
+        {
+           return 16 * ( ( sizeof(message_header) + payload_size + 15 ) / 16 );
+        }
+
+        /// payload
+        const char* data()const { return _buffer ? _buffer->frame.data() + sizeof(message_header) : nullptr; }
+        size_t size()const { return _buffer ? _buffer->payload_size : 0; }
+        bool empty()const { return size() == 0; }
+        const char* begin()const { return data(); }
+        const char* end()const { return data() + size(); }
+
+        /// true when the frame was built with given header, i.e. frame() can be sent for message with that header
+        bool has_frame_for( const message_header& header )const;
+        /// this message data when it has frame for given header, otherwise copy of the payload in new frame with that header
+        message_data with_frame_for( const message_header& header )const;
+        const char* frame()const { return _buffer ? _buffer->frame.data() : nullptr; }
+        size_t frame_size()const { return _buffer ? _buffer->frame.size() : 0; }
+
+        /// ripemd160 of the payload, computed once per buffer
+        const message_hash_type& id()const;
+
+        /// number of messages sharing the buffer
+        long use_count()const { return _buffer.use_count(); }
+
+        // serialized in the same format as std::vector<char> with the payload
+        template<typename Stream>
+        inline friend Stream& operator<<( Stream& s, const message_data& d )
+        {
+           fc::raw::pack( s, fc::unsigned_int( (uint32_t)d.size() ) );
+           if( d.size() )
+              s.write( d.data(), d.size() );
+           return s;
+        }
+
+        template<typename Stream>
+        inline friend Stream& operator>>( Stream& s, message_data& d )
+        {
+           std::vector<char> payload;
+           fc::raw::unpack( s, payload );
+           message_header header;
+           header.size = (uint32_t)payload.size();
+           d = message_data( header, payload.data() );
+           return s;
+        }
+
+     private:
+        struct buffer
+        {
+           std::vector<char>          frame;
+           uint32_t                   payload_size = 0;
+           mutable std::once_flag     id_computed;
+           mutable message_hash_type  id;
+        };
+
+        std::shared_ptr<const buffer> _buffer;
+  };
+
   /**
    *  Abstracts the process of packing/unpacking a message for a 
    *  particular channel.
    */
   struct message : public message_header
   {
-     std::vector<char> data;
+     message_data data;
 
      message(){}
 
-     message( message&& m )
-     :message_header(m),data( std::move(m.data) ){}
-
-     message( const message& m )
-     :message_header(m),data( m.data ){}
+     message( const message_header& header, message_data data )
+     :message_header(header),data( std::move(data) ){}
 
      /**
       *  Assumes that T::type specifies the message type
@@ -68,13 +145,19 @@ namespace graphene { namespace net {
      message( const T& m ) 
      {
         msg_type = T::type;
-        data     = fc::raw::pack_to_vector(m);
-        size     = (uint32_t)data.size();
+        size     = (uint32_t)fc::raw::pack_size(m);
+
+        // serialized straight into the frame that will be sent
+        std::vector<char> frame( message_data::frame_size_for( size ) );
+        memcpy( frame.data(), (const message_header*)this, sizeof(message_header) );
+        fc::datastream<char*> ds( frame.data() + sizeof(message_header), size );
+        fc::raw::pack( ds, m );
+        data     = message_data( std::move(frame) );
      }
 
-     fc::uint160_t id()const
+     const fc::uint160_t& id()const
      {
-        return fc::ripemd160::hash( data.data(), (uint32_t)data.size() );
+        return data.id();
      }
 
      /**
@@ -113,5 +196,11 @@ namespace graphene { namespace net {
 
 } } // graphene::net
 
+namespace fc {
+  void to_variant( const graphene::net::message_data& d, variant& v );
+  void from_variant( const variant& v, graphene::net::message_data& d );
+}
+
 FC_REFLECT( graphene::net::message_header, (size)(msg_type) )
+FC_REFLECT_TYPENAME( graphene::net::message_data )
 FC_REFLECT_DERIVED( graphene::net::message, (graphene::net::message_header), (data) )
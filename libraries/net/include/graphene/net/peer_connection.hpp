@@ -131,8 +131,9 @@ namespace graphene { namespace net
         virtual ~queued_message() {}
       };
 
-      /* when you queue up a 'real_queued_message', a full copy of the message is
-       * stored on the heap until it is sent
+      /* when you queue up a 'real_queued_message', the message is kept until it is sent;
+       * its contents are shared with all other copies of the message (other peers' queues,
+       * message cache), so this does not copy the payload
        */
       struct real_queued_message : queued_message
       {
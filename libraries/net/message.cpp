@@ -0,0 +1,84 @@
+#include <graphene/net/message.hpp>
+
+#include <fc/variant.hpp>
+
+namespace graphene { namespace net {
+
+  message_data::message_data( const message_header& header, const char* payload )
+  {
+    auto b = std::make_shared<buffer>();
+    b->frame.resize( frame_size_for( header.size ) );
+    b->payload_size = header.size;
+    memcpy( b->frame.data(), &header, sizeof(message_header) );
+    if( header.size )
+      memcpy( b->frame.data() + sizeof(message_header), payload, header.size );
+    _buffer = std::move( b );
+  }
+
+  message_data::message_data( std::vector<char>&& frame )
+  {
+    FC_ASSERT( frame.size() >= sizeof(message_header) );
+    message_header header;
+    memcpy( &header, frame.data(), sizeof(message_header) );
+    FC_ASSERT( frame.size() == frame_size_for( header.size ), "Invalid size of message frame",
+               ("frame_size", frame.size())("payload_size", header.size) );
+
+    auto b = std::make_shared<buffer>();
+    b->frame = std::move( frame );
+    b->payload_size = header.size;
+    // padding is always sent as zeros, also when the frame came from a peer that did not clear it
+    memset( b->frame.data() + sizeof(message_header) + header.size, 0,
+            b->frame.size() - sizeof(message_header) - header.size );
+    _buffer = std::move( b );
+  }
+
+  bool message_data::has_frame_for( const message_header& header )const
+  {
+    if( !_buffer )
+      return false;
+    message_header frame_header;
+    memcpy( &frame_header, _buffer->frame.data(), sizeof(message_header) );
+    return frame_header.size == header.size && frame_header.msg_type == header.msg_type;
+  }
+
+  message_data message_data::with_frame_for( const message_header& header )const
+  {
+    if( has_frame_for( header ) )
+      return *this;
+    FC_ASSERT( header.size <= size(), "Message header does not match its payload",
+               ("header_size", header.size)("payload_size", size()) );
+    return message_data( header, data() );
+  }
+
+  const message_hash_type& message_data::id()const
+  {
+    static const message_hash_type empty_id = fc::ripemd160::hash( (const char*)nullptr, 0 );
+    if( !_buffer )
+      return empty_id;
+
+    std::call_once( _buffer->id_computed, [this]()
+    {
+      _buffer->id = fc::ripemd160::hash( data(), (uint32_t)size() );
+    } );
+    return _buffer->id;
+  }
+
+} } // graphene::net
+
+namespace fc {
+
+  void to_variant( const graphene::net::message_data& d, variant& v )
+  {
+    to_variant( std::vector<char>( d.begin(), d.end() ), v );
+  }
+
+  void from_variant( const variant& v, graphene::net::message_data& d )
+  {
+    std::vector<char> payload;
+    from_variant( v, payload );
+    graphene::net::message_header header;
+    header.size = (uint32_t)payload.size();
+    d = graphene::net::message_data( header, payload.data() );
+  }
+
+}
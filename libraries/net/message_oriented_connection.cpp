@@ -152,25 +152,26 @@ namespace graphene { namespace net {
 
       try
       {
-        message m;
         while( true )
         {
           char buffer[BUFFER_SIZE];
           _sock.read(buffer, BUFFER_SIZE);
           _bytes_received += BUFFER_SIZE;
-          memcpy((char*)&m, buffer, sizeof(message_header));
+          message_header header;
+          memcpy((char*)&header, buffer, sizeof(message_header));
 
-          FC_ASSERT( m.size <= MAX_MESSAGE_SIZE, "", ("m.size",m.size)("MAX_MESSAGE_SIZE",MAX_MESSAGE_SIZE) );
+          FC_ASSERT( header.size <= MAX_MESSAGE_SIZE, "", ("m.size",header.size)("MAX_MESSAGE_SIZE",MAX_MESSAGE_SIZE) );
 
-          size_t remaining_bytes_with_padding = 16 * ((m.size - LEFTOVER + 15) / 16);
-          m.data.resize(LEFTOVER + remaining_bytes_with_padding); //give extra 16 bytes to allow for padding added in send call
-          std::copy(buffer + sizeof(message_header), buffer + sizeof(buffer), m.data.begin());
+          // the whole frame (with padding added in send call) is kept, so the message can be relayed as is
+          size_t remaining_bytes_with_padding = 16 * ((header.size - LEFTOVER + 15) / 16);
+          std::vector<char> frame(BUFFER_SIZE + remaining_bytes_with_padding);
+          memcpy(frame.data(), buffer, BUFFER_SIZE);
           if (remaining_bytes_with_padding)
           {
-            _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
+            _sock.read(frame.data() + BUFFER_SIZE, remaining_bytes_with_padding);
             _bytes_received += remaining_bytes_with_padding;
           }
-          m.data.resize(m.size); // truncate off the padding bytes
+          message m(header, message_data(std::move(frame)));
 
           _last_message_received_time = fc::time_point::now();
 
@@ -255,20 +256,15 @@ namespace graphene { namespace net {
 
       try
       {
-        size_t size_of_message_and_header = sizeof(message_header) + message_to_send.size;
         if( message_to_send.size > MAX_MESSAGE_SIZE )
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
-        //pad the message we send to a multiple of 16 bytes
-        size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
 
-        memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
-        memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        char* paddingSpace = padded_message.get() + sizeof(message_header) + message_to_send.size;
-        size_t toClean = size_with_padding - size_of_message_and_header;
-        memset(paddingSpace, 0, toClean);
+        // normally the message already carries its frame (header, payload padded to a multiple of 16 bytes),
+        // shared by all copies of the message; it only has to be built when the header was changed
+        message_data frame_owner = message_to_send.data.with_frame_for( message_to_send );
+        size_t size_with_padding = frame_owner.frame_size();
 
-        _sock.write(padded_message.get(), size_with_padding);
+        _sock.write(frame_owner.frame(), size_with_padding);
         _sock.flush();
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
@@ -645,7 +645,7 @@ namespace graphene { namespace net {
       void process_backlog_of_sync_blocks();
       void trigger_process_backlog_of_sync_blocks();
       void process_block_during_sync(peer_connection* originating_peer, const graphene::net::block_message& block_message, const message_hash_type& message_hash);
-      void process_block_during_normal_operation(peer_connection* originating_peer, const graphene::net::block_message& block_message, const message_hash_type& message_hash);
+      void process_block_during_normal_operation(peer_connection* originating_peer, const message& message_to_process, const graphene::net::block_message& block_message, const message_hash_type& message_hash);
       void process_block_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
 
       void process_ordinary_message(peer_connection* originating_peer, const message& message_to_process, const message_hash_type& message_hash);
@@ -3447,6 +3447,7 @@ namespace graphene { namespace net {
     }
 
     void node_impl::process_block_during_normal_operation( peer_connection* originating_peer,
+                                                           const message& message_to_process,
                                                            const graphene::net::block_message& block_message_to_process,
                                                            const message_hash_type& message_hash )
     {
@@ -3535,7 +3536,8 @@ namespace graphene { namespace net {
           peer->clear_old_inventory();
         }
         message_propagation_data propagation_data{message_receive_time, message_validated_time, originating_peer->node_id};
-        broadcast( block_message_to_process, propagation_data );
+        // relay the message as received - its frame and hash are shared, not rebuilt
+        broadcast( message_to_process, propagation_data );
         _message_cache.block_accepted();
 
         if (is_hard_fork_block(block_number))
@@ -3621,7 +3623,7 @@ namespace graphene { namespace net {
       if (item_iter != originating_peer->items_requested_from_peer.end())
       {
         originating_peer->items_requested_from_peer.erase(item_iter);
-        process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash);
+        process_block_during_normal_operation(originating_peer, message_to_process, block_message_to_process, message_hash);
         if (originating_peer->idle())
           trigger_fetch_items_loop();
         return;
@@ -51,8 +51,11 @@ namespace graphene { namespace net
         // it won't work for anything after a variable-length field
         std::vector<char> packed_current_time = fc::raw::pack_to_vector(fc::time_point::now());
         assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset,
+        // message contents are shared and immutable, so the patched message gets its own copy
+        std::vector<char> payload(message_to_send.data.begin(), message_to_send.data.end());
+        memcpy(payload.data() + message_send_time_field_offset,
                packed_current_time.data(), packed_current_time.size());
+        message_to_send.data = message_data(message_to_send, payload.data());
       }
       return message_to_send;
     }
@@ -28,8 +28,8 @@ class account_by_key_plugin_impl
     flat_set< public_key_type >   cached_keys;
     database&                     _db;
     account_by_key_plugin&        _self;
-    boost::signals2::connection   _pre_apply_operation_conn;
-    boost::signals2::connection   _post_apply_operation_conn;
+    hive::chain::util::notification_connection   _pre_apply_operation_conn;
+    hive::chain::util::notification_connection   _post_apply_operation_conn;
 };
 
 struct pre_operation_visitor
@@ -42,7 +42,7 @@ class account_history_plugin_impl
     flat_set< string >                               _op_list;
     bool                                             _prune = true;
     database&                        _db;
-    boost::signals2::connection      _pre_apply_operation_conn;
+    hive::chain::util::notification_connection      _pre_apply_operation_conn;
 };
 
 struct operation_visitor
@@ -147,12 +147,9 @@ struct operation_visitor_filter : operation_visitor
 
 void account_history_plugin_impl::on_pre_apply_operation( const operation_notification& note )
 {
-  flat_set<account_name_type> impacted;
-
   const operation_object* new_obj = nullptr;
-  app::operation_get_impacted_accounts( note.op, impacted );
 
-  for( const auto& item : impacted ) {
+  for( const auto& item : note.get_impacted_accounts() ) {
     auto itr = _tracked_accounts.lower_bound( item );
 
     /*
@@ -15,6 +15,7 @@
 #include <hive/plugins/chain/state_snapshot_provider.hpp>
 
 #include <hive/utilities/benchmark_dumper.hpp>
+#include <hive/utilities/ordered_pipeline.hpp>
 #include <hive/utilities/plugin_utilities.hpp>
 
 #include <hive/plugins/condenser_api/condenser_api.hpp>
@@ -31,6 +32,7 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/container/flat_set.hpp>
 
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 
@@ -55,6 +57,7 @@ namespace bpo = boost::program_options;
 #define BY_TRANSACTION_ID 6
 
 #define WRITE_BUFFER_FLUSH_LIMIT     10
+#define INGESTION_QUEUE_DEFAULT_SIZE 100000
 #define ACCOUNT_HISTORY_LENGTH_LIMIT 30
 #define ACCOUNT_HISTORY_TIME_LIMIT   30
 #define VIRTUAL_OP_FLAG              0x8000000000000000
@@ -560,10 +563,14 @@ public:
     _currently_processed_block.store(0);
 
     HIVE_ADD_PLUGIN_INDEX(_mainDb, volatile_operation_index);
+
+    if(_asyncIngestion)
+      startIngestion();
     }
 
   ~impl()
   {
+    stopIngestion();
 
     chain::util::disconnect_signal(_on_post_apply_operation_con);
     chain::util::disconnect_signal(_on_irreversible_block_conn);
@@ -643,8 +650,26 @@ public:
   bool find_transaction_info(const protocol::transaction_id_type& trxId, bool include_reversible, uint32_t* blockNo,
     uint32_t* txInBlock) const;
 
+  uint32_t get_cached_irreversible_block() const
+  {
+    return _cached_irreversible_block.load();
+  }
+
   void shutdownDb()
   {
+    try
+    {
+      drainIngestion();
+    }
+    catch(const fc::exception& e)
+    {
+      elog("Operations queued for asynchronous ingestion have not been stored: ${e}", ("e", e.to_detail_string()));
+    }
+    catch(const std::exception& e)
+    {
+      elog("Operations queued for asynchronous ingestion have not been stored: ${e}", ("e", e.what()));
+    }
+
     if(_storage)
     {
       flushStorage();
@@ -834,6 +859,8 @@ private:
   void on_post_apply_operation(const operation_notification& opNote);
 
   void on_irreversible_block( uint32_t block_num );
+  /// Moves ops of newly irreversible block(s) from volatile index to ingestion queue (followed by LIB marker).
+  void enqueue_irreversible_ops( uint32_t block_num );
 
   void on_post_apply_block(const block_notification& bn);
   void on_pre_apply_block(const  block_notification& bn);
@@ -852,6 +879,8 @@ private:
     *  \see isTrackedAccount.
     */
   std::vector<account_name_type> getImpactedAccounts(const operation& op) const;
+  /// Variant filtering already computed set (e.g. the one shared through operation notification).
+  std::vector<account_name_type> getImpactedAccounts(const hive::app::impacted_accounts& impacted) const;
 
   /** Returns true if given operation should be collected.
     *  Depends on `account-history-blacklist-ops`, `account-history-whitelist-ops`.
@@ -864,6 +893,31 @@ private:
   std::vector<rocksdb_operation_object> collectReversibleOps(uint32_t* blockRangeBegin, uint32_t* blockRangeEnd,
     uint32_t* collectedIrreversibleBlock) const;
 
+  /** Returns true if ops from given block range are being moved from volatile index to the storage, i.e. they
+    *  belong to blocks (_cached_irreversible_block, _currently_persisted_irreversible_block].
+    */
+  bool isPersistingBlockRange(uint32_t blockRangeBegin, uint32_t blockRangeEnd) const
+  {
+    uint32_t persisted = _currently_persisted_irreversible_block;
+    return persisted != 0 && persisted >= blockRangeBegin && _cached_irreversible_block < blockRangeEnd;
+  }
+
+  /// Item of the ingestion queue: either operation to be imported or marker of last irreversible block.
+  struct ingestion_item
+  {
+    rocksdb_operation_object         op;
+    std::vector<account_name_type>   impacted;
+    /// When nonzero, all ops up to given block have been queued and the item carries no operation.
+    uint32_t                         irreversible_block = 0;
+  };
+
+  void startIngestion();
+  void stopIngestion();
+  /// Blocks until all queued items are processed by ingestion thread (no-op when ingestion is synchronous).
+  void drainIngestion();
+  void enqueueIngestion(ingestion_item&& item);
+  void processIngestionItem(ingestion_item& item);
+
 /// Class attributes:
 private:
   typedef flat_map< account_name_type, account_name_type > account_name_range_index;
@@ -876,21 +930,22 @@ private:
   std::vector<ColumnFamilyHandle*> _columnHandles;
   CachableWriteBatch               _writeBuffer;
 
-  boost::signals2::connection      _on_post_apply_operation_con;
-  boost::signals2::connection      _on_irreversible_block_conn;
-  boost::signals2::connection      _on_pre_apply_block_conn;
-  boost::signals2::connection      _on_post_apply_block_conn;
-  boost::signals2::connection      _on_fail_apply_block_conn;
+  hive::chain::util::notification_connection      _on_post_apply_operation_con;
+  hive::chain::util::notification_connection      _on_irreversible_block_conn;
+  hive::chain::util::notification_connection      _on_pre_apply_block_conn;
+  hive::chain::util::notification_connection      _on_post_apply_block_conn;
+  hive::chain::util::notification_connection      _on_fail_apply_block_conn;
 
   /// Helper member to be able to detect another incomming tx and increment tx-counter.
   transaction_id_type              _lastTx;
-  size_t                           _txNo = 0;
+  /// Statistics are updated by ingestion thread (when enabled) and reported by block writer thread, hence atomics.
+  std::atomic< size_t >            _txNo{ 0 };
   /// Total processed ops in this session (counts every operation, even excluded by filtering).
-  size_t                           _totalOps = 0;
+  std::atomic< size_t >            _totalOps{ 0 };
   /// Total number of ops being skipped by filtering options.
-  size_t                           _excludedOps = 0;
+  std::atomic< size_t >            _excludedOps{ 0 };
   /// Total number of accounts (impacted by ops) excluded from processing because of filtering.
-  mutable size_t                   _excludedAccountCount = 0;
+  mutable std::atomic< size_t >    _excludedAccountCount{ 0 };
   /// IDs to be assigned to object.id field.
   uint64_t                         _operationSeqId = 0;
   uint64_t                         _accountHistorySeqId = 0;
@@ -901,8 +956,9 @@ private:
     *    - if blocks come from network, there is no need for delaying write, becasue they appear quite rare (limit == 1)
     *    - if reindex process or direct import has been spawned, this massive operation can need reduction of direct
         writes (limit == WRITE_BUFFER_FLUSH_LIMIT).
+    *  Read by ingestion thread while chain thread switches it around reindex and direct import.
     */
-  unsigned int                     _collectedOpsWriteLimit = 1;
+  std::atomic_uint                 _collectedOpsWriteLimit{1};
 
   /// <summary>
   /// Information if mutex is locked/unlocked.
@@ -937,6 +993,16 @@ private:
 
   bool                             _reindexing = false;
 
+  /** When set, ops are stored by dedicated ingestion thread instead of chain write thread. Queue is bounded by
+    *  `_ingestionQueueLimit` items, so when storage can't keep up, block processing is throttled down to its pace.
+    */
+  bool                             _asyncIngestion = false;
+  size_t                           _ingestionQueueLimit = INGESTION_QUEUE_DEFAULT_SIZE;
+  /// Items are stored in queue order by the pipeline's output thread (there is no parallel stage).
+  std::unique_ptr<hive::utilities::ordered_pipeline<ingestion_item, ingestion_item>> _ingestion;
+  /// Last irreversible block which ops were put into ingestion queue (only accessed by chain write thread).
+  uint32_t                         _enqueuedIrreversibleBlock = 0;
+
   bool                             _prune = false;
 
   struct saved_balances
@@ -1020,6 +1086,21 @@ void account_history_rocksdb_plugin::impl::collectOptions(const boost::program_o
     _balance_csv_file.flush();
   }
 
+  if(options.count("account-history-rocksdb-async-ingestion"))
+    _asyncIngestion = options.at("account-history-rocksdb-async-ingestion").as<bool>();
+
+  if(options.count("account-history-rocksdb-ingestion-queue-size"))
+    _ingestionQueueLimit = options.at("account-history-rocksdb-ingestion-queue-size").as<uint32_t>();
+
+  FC_ASSERT(_ingestionQueueLimit > 0, "account-history-rocksdb-ingestion-queue-size must be greater than 0");
+
+  if(_asyncIngestion)
+  {
+    /// Ops of irreversible blocks are written in one batch together with their LIB marker.
+    _collectedOpsWriteLimit = std::numeric_limits<unsigned int>::max();
+    ilog( "Account History: asynchronous ingestion enabled, queue size: ${s}", ("s", _ingestionQueueLimit) );
+  }
+
   appbase::app().get_plugin< chain::chain_plugin >().report_state_options( _self.name(), state_opts );
 }
 
@@ -1072,8 +1153,13 @@ inline bool account_history_rocksdb_plugin::impl::isTrackedAccount(const account
 
 std::vector<account_name_type> account_history_rocksdb_plugin::impl::getImpactedAccounts(const operation& op) const
 {
-  flat_set<account_name_type> impacted;
+  hive::app::impacted_accounts impacted;
   hive::app::operation_get_impacted_accounts(op, impacted);
+  return getImpactedAccounts(impacted);
+}
+
+std::vector<account_name_type> account_history_rocksdb_plugin::impl::getImpactedAccounts(const hive::app::impacted_accounts& impacted) const
+{
   std::vector<account_name_type> retVal;
 
   if(impacted.empty())
@@ -1132,7 +1218,7 @@ account_history_rocksdb_plugin::impl::collectReversibleOps(uint32_t* blockRangeB
 {
   FC_ASSERT(*blockRangeBegin < *blockRangeEnd, "Wrong block range");
 
-  if(_currently_persisted_irreversible_block >= *blockRangeBegin && _currently_persisted_irreversible_block <= *blockRangeEnd)
+  if(isPersistingBlockRange(*blockRangeBegin, *blockRangeEnd))
   {
     ilog("Awaiting for the end of save current irreversible block ${b} block, requested by call: [${rb}, ${re}]",
       ("b", _currently_persisted_irreversible_block.operator unsigned int())("rb", *blockRangeBegin)("re", *blockRangeEnd));
@@ -1145,7 +1231,7 @@ account_history_rocksdb_plugin::impl::collectReversibleOps(uint32_t* blockRangeB
     _currently_persisted_irreversible_cv.wait(lk,
       [this, blockRangeBegin, blockRangeEnd]() -> bool
       {
-        return _currently_persisted_irreversible_block < *blockRangeBegin || _currently_persisted_irreversible_block > * blockRangeEnd;
+        return isPersistingBlockRange(*blockRangeBegin, *blockRangeEnd) == false;
       }
     );
 
@@ -1511,6 +1597,8 @@ void account_history_rocksdb_plugin::impl::supplement_snapshot(const hive::chain
   if(bfs::exists(actual_path) == false)
     bfs::create_directories(actual_path);
 
+  drainIngestion();
+
   auto pathString = actual_path.to_native_ansi_path();
 
   ::rocksdb::Env* backupEnv = ::rocksdb::Env::Default();
@@ -1839,6 +1927,7 @@ void account_history_rocksdb_plugin::impl::on_pre_reindex(const hive::chain::rei
   ilog("Setting write limit to massive level");
 
   _collectedOpsWriteLimit = WRITE_BUFFER_FLUSH_LIMIT;
+  _enqueuedIrreversibleBlock = 0;
 
   _lastTx = transaction_id_type();
   _txNo = 0;
@@ -1854,8 +1943,9 @@ void account_history_rocksdb_plugin::impl::on_post_reindex(const hive::chain::re
   ilog("Reindex completed up to block: ${b}. Setting back write limit to non-massive level.",
     ("b", note.last_block_number));
 
+  drainIngestion();
   flushStorage();
-  _collectedOpsWriteLimit = 1;
+  _collectedOpsWriteLimit = _asyncIngestion ? std::numeric_limits<unsigned int>::max() : 1;
   _reindexing = false;
   uint32_t last_irreversible_block_num =_mainDb.get_last_irreversible_block_num();
   update_lib( last_irreversible_block_num ); // Set same value as in main database, as result of witness participation
@@ -1878,10 +1968,10 @@ void account_history_rocksdb_plugin::impl::printReport(uint32_t blockNo, const c
       "${ea} accounts have been filtered out due to configured options.",
     ("t", detailText)
     ("n", blockNo)
-    ("tx", _txNo)
-    ("op", _totalOps)
-    ("ep", _excludedOps)
-    ("ea", _excludedAccountCount)
+    ("tx", _txNo.load())
+    ("op", _totalOps.load())
+    ("ep", _excludedOps.load())
+    ("ea", _excludedAccountCount.load())
     );
 }
 
@@ -1895,6 +1985,11 @@ void account_history_rocksdb_plugin::impl::importData(unsigned int blockLimit)
 
   ilog("Starting data import...");
 
+  drainIngestion();
+  /// Ops are imported directly here, so batch size must not depend on ingestion thread's LIB markers.
+  const unsigned int savedWriteLimit = _collectedOpsWriteLimit;
+  _collectedOpsWriteLimit = std::min(savedWriteLimit, static_cast<unsigned int>(WRITE_BUFFER_FLUSH_LIMIT));
+
   block_id_type lastBlock;
   size_t blockNo = 0;
 
@@ -1951,6 +2046,7 @@ void account_history_rocksdb_plugin::impl::importData(unsigned int blockLimit)
   );
 
   flushWriteBuffer();
+  _collectedOpsWriteLimit = savedWriteLimit;
 
   const auto& measure = dumper.measure(blockNo, [](benchmark_dumper::index_memory_details_cntr_t&, bool){});
   ilog( "RocksDb data import - Performance report at block ${n}. Elapsed time: ${rt} ms (real), ${ct} ms (cpu). Memory usage: ${cm} (current), ${pm} (peak) kilobytes.",
@@ -1971,10 +2067,10 @@ void account_history_rocksdb_plugin::impl::on_post_apply_operation(const operati
         " ${ep} operations have been filtered out due to configured options.\n"
         " ${ea} accounts have been filtered out due to configured options.",
       ("n", n.block)
-      ("tx", _txNo)
-      ("op", _totalOps)
-      ("ep", _excludedOps)
-      ("ea", _excludedAccountCount)
+      ("tx", _txNo.load())
+      ("op", _totalOps.load())
+      ("ep", _excludedOps.load())
+      ("ea", _excludedAccountCount.load())
       );
   }
 
@@ -1984,7 +2080,7 @@ void account_history_rocksdb_plugin::impl::on_post_apply_operation(const operati
     return;
   }
 
-  auto impacted = getImpactedAccounts(n.op);
+  auto impacted = getImpactedAccounts(n.get_impacted_accounts());
   if( impacted.empty() )
     return; // Ignore operations not impacting any account (according to original implementation)
 
@@ -2004,7 +2100,17 @@ void account_history_rocksdb_plugin::impl::on_post_apply_operation(const operati
     fc::datastream< char* > ds( obj.serialized_op.data(), size );
     fc::raw::pack( ds, n.op );
 
-    importOperation( obj, impacted );
+    if( _asyncIngestion )
+    {
+      ingestion_item item;
+      item.op = std::move( obj );
+      item.impacted = std::move( impacted );
+      enqueueIngestion( std::move( item ) );
+    }
+    else
+    {
+      importOperation( obj, impacted );
+    }
   }
   else
   {
@@ -2029,6 +2135,20 @@ void account_history_rocksdb_plugin::impl::on_irreversible_block( uint32_t block
 {
   if( _reindexing ) return;
 
+  if( _asyncIngestion )
+  {
+    const auto& volatile_idx = _mainDb.get_index< volatile_operation_index, by_block >();
+    auto itr = volatile_idx.begin();
+    if( itr == volatile_idx.end() || itr->block >= block_num )
+    {
+      enqueue_irreversible_ops( block_num );
+      return;
+    }
+
+    /// Leftovers of already imported blocks have to be verified against the storage, so it is done synchronously.
+    drainIngestion();
+  }
+
   uint32_t fallbackIrreversibleBlock = 0;
   
   /// In case of genesis block (and fresh testnet) there can be no LIB at begin.
@@ -2094,12 +2214,137 @@ void account_history_rocksdb_plugin::impl::on_irreversible_block( uint32_t block
     );
 
     update_lib(block_num);
+
+    if( _asyncIngestion )
+    {
+      flushWriteBuffer();
+      _enqueuedIrreversibleBlock = block_num;
+    }
   }
 
   _currently_persisted_irreversible_block.store(0);
   _currently_persisted_irreversible_cv.notify_all();
 }
 
+void account_history_rocksdb_plugin::impl::enqueue_irreversible_ops( uint32_t block_num )
+{
+  uint32_t fallbackIrreversibleBlock = 0;
+  uint32_t stored_lib = _enqueuedIrreversibleBlock;
+  if( stored_lib == 0 )
+    stored_lib = get_lib(&fallbackIrreversibleBlock);
+
+  FC_ASSERT(block_num > stored_lib, "New irreversible block: ${nb} can't be less than already queued one: ${ob}", ("nb", block_num)("ob", stored_lib));
+
+  auto& volatileOpsGenericIndex = _mainDb.get_mutable_index<volatile_operation_index>();
+  const auto& volatile_idx = _mainDb.get_index< volatile_operation_index, by_block >();
+
+  {
+    /// Ops of the range are not visible in volatile index from now on, until ingestion thread writes them to the storage
+    std::lock_guard<std::mutex> lk(_currently_persisted_irreversible_mtx);
+    _currently_persisted_irreversible_block.store(block_num);
+  }
+
+  std::vector<ingestion_item> items;
+  volatileOpsGenericIndex.move_to_external_storage<by_block>(volatile_idx.upper_bound(stored_lib), volatile_idx.upper_bound(block_num),
+    [&items](const volatile_operation_object& operation) -> void
+    {
+      items.emplace_back();
+      items.back().op = rocksdb_operation_object(operation);
+      items.back().impacted.assign(operation.impacted.begin(), operation.impacted.end());
+    }
+  );
+
+  items.emplace_back();
+  items.back().irreversible_block = block_num;
+
+  for(auto& item : items)
+    enqueueIngestion(std::move(item));
+
+  _enqueuedIrreversibleBlock = block_num;
+}
+
+void account_history_rocksdb_plugin::impl::startIngestion()
+{
+  _ingestion = std::make_unique<hive::utilities::ordered_pipeline<ingestion_item, ingestion_item>>(0, _ingestionQueueLimit,
+    [](ingestion_item& item) -> ingestion_item { return std::move(item); },
+    [this](ingestion_item& item, bool)
+    {
+      /// Storage is not consistent with queued items anymore - pipeline drops the rest and every following attempt to queue ops will fail.
+      auto onFailure = [this]()
+      {
+        {
+          std::lock_guard<std::mutex> lk(_currently_persisted_irreversible_mtx);
+          _currently_persisted_irreversible_block.store(0);
+        }
+        _currently_persisted_irreversible_cv.notify_all();
+      };
+
+      try
+      {
+        processIngestionItem(item);
+      }
+      catch(const fc::exception& e)
+      {
+        elog("Account History RocksDB ingestion failed: ${e}", ("e", e.to_detail_string()));
+        onFailure();
+        throw;
+      }
+      catch(const std::exception& e)
+      {
+        elog("Account History RocksDB ingestion failed: ${e}", ("e", e.what()));
+        onFailure();
+        throw;
+      }
+    });
+  ilog("Account History RocksDB ingestion started");
+}
+
+void account_history_rocksdb_plugin::impl::stopIngestion()
+{
+  if(!_ingestion)
+    return;
+
+  _ingestion->stop();
+  _ingestion.reset();
+  ilog("Account History RocksDB ingestion finished");
+}
+
+void account_history_rocksdb_plugin::impl::drainIngestion()
+{
+  /// Also covers stopped ingestion - stopping already processed everything that was queued.
+  if(!_ingestion)
+    return;
+
+  _ingestion->drain();
+}
+
+void account_history_rocksdb_plugin::impl::enqueueIngestion(ingestion_item&& item)
+{
+  _ingestion->push(std::move(item));
+}
+
+void account_history_rocksdb_plugin::impl::processIngestionItem(ingestion_item& item)
+{
+  if(item.irreversible_block == 0)
+  {
+    importOperation(item.op, item.impacted);
+    return;
+  }
+
+  /// LIB is written in the same batch as all ops up to it, so the storage never claims irreversibility of incomplete data
+  auto s = _writeBuffer.Put( _columnHandles[ CURRENT_LIB ], LIB_ID, lib_slice_t( item.irreversible_block ) );
+  checkStatus( s );
+  flushWriteBuffer();
+
+  {
+    std::lock_guard<std::mutex> lk(_currently_persisted_irreversible_mtx);
+    _cached_irreversible_block.store(item.irreversible_block);
+    if(_currently_persisted_irreversible_block <= item.irreversible_block)
+      _currently_persisted_irreversible_block.store(0);
+  }
+  _currently_persisted_irreversible_cv.notify_all();
+}
+
 void account_history_rocksdb_plugin::impl::on_pre_apply_block(const block_notification& bn)
 {
   if(_reindexing) return;
@@ -2249,6 +2494,10 @@ void account_history_rocksdb_plugin::set_program_options(
     ("account-history-rocksdb-track-account-range", boost::program_options::value< std::vector<std::string> >()->composing()->multitoken(), "Defines a range of accounts to track as a json pair [\"from\",\"to\"] [from,to] Can be specified multiple times.")
     ("account-history-rocksdb-whitelist-ops", boost::program_options::value< std::vector<std::string> >()->composing(), "Defines a list of operations which will be explicitly logged.")
     ("account-history-rocksdb-blacklist-ops", boost::program_options::value< std::vector<std::string> >()->composing(), "Defines a list of operations which will be explicitly ignored.")
+    ("account-history-rocksdb-async-ingestion", bpo::value<bool>()->default_value(false),
+      "Store operations in dedicated thread instead of chain write thread. Ops of irreversible blocks become visible to API calls once stored together with their last irreversible block.")
+    ("account-history-rocksdb-ingestion-queue-size", bpo::value<uint32_t>()->default_value(INGESTION_QUEUE_DEFAULT_SIZE),
+      "Maximum number of operations waiting for asynchronous ingestion. When it is reached, block processing waits for the ingestion thread.")
 
   ;
   command_line_options.add_options()
@@ -2328,6 +2577,11 @@ bool account_history_rocksdb_plugin::find_transaction_info(const protocol::trans
   return _my->find_transaction_info(trxId, include_reversible, blockNo, txInBlock);
   }
 
+uint32_t account_history_rocksdb_plugin::get_last_irreversible_block() const
+  {
+  return _my->get_cached_irreversible_block();
+  }
+
 } } }
 
 FC_REFLECT( hive::plugins::account_history_rocksdb::account_history_info,
@@ -46,6 +46,8 @@ public:
     fc::optional<uint64_t> operationBegin, fc::optional<uint32_t> limit,
     std::function<bool(const rocksdb_operation_object&, uint64_t, bool)> processor) const;
   bool find_transaction_info(const protocol::transaction_id_type& trxId, bool include_reversible, uint32_t* blockNo, uint32_t* txInBlock) const;
+  /// Last irreversible block which operations were already imported to the storage.
+  uint32_t get_last_irreversible_block() const;
 
 private:
   class impl;
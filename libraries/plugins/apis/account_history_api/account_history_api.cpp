@@ -52,6 +52,9 @@ DEFINE_API_IMPL( account_history_api_chainbase_impl, get_ops_in_block )
       ++itr;
     }
 
+    if( args.block_num <= _db.get_last_irreversible_block_num() )
+      json_rpc::mark_response_cacheable();
+
     return result;
   });
 }
@@ -78,6 +81,9 @@ DEFINE_API_IMPL( account_history_api_chainbase_impl, get_transaction )
       result = blk->transactions[itr->trx_in_block];
       result.block_num       = itr->block;
       result.transaction_num = itr->trx_in_block;
+
+      if( itr->block <= _db.get_last_irreversible_block_num() )
+        json_rpc::mark_response_cacheable();
     }
     else
     {
@@ -153,6 +159,11 @@ DEFINE_API_IMPL( account_history_api_rocksdb_impl, get_ops_in_block )
         result.ops.emplace(std::move(temp));
     }
   );
+
+  // only blocks fully imported to the storage are safe to cache
+  if( args.block_num <= _dataSource.get_last_irreversible_block() )
+    json_rpc::mark_response_cacheable();
+
   return result;
 }
 
@@ -243,6 +254,9 @@ DEFINE_API_IMPL( account_history_api_rocksdb_impl, get_transaction )
     result.transaction_num = txInBlock;
     });
 
+    if( blockNo <= _dataSource.get_last_irreversible_block() )
+      json_rpc::mark_response_cacheable();
+
     return result;
     }
   else
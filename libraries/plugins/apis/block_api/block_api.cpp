@@ -54,7 +54,11 @@ DEFINE_API_IMPL( block_api_impl, get_block_header )
   optional<signed_block> block = _db.fetch_block_by_number_unlocked( args.block_num );
 
   if( block )
+  {
     result.header = *block;
+    if( args.block_num <= _db.get_last_irreversible_block_num() )
+      json_rpc::mark_response_cacheable();
+  }
 
   return result;
 }
@@ -65,7 +69,11 @@ DEFINE_API_IMPL( block_api_impl, get_block )
   optional<signed_block> block = _db.fetch_block_by_number_unlocked( args.block_num );
 
   if( block )
+  {
     result.block = *block;
+    if( args.block_num <= _db.get_last_irreversible_block_num() )
+      json_rpc::mark_response_cacheable();
+  }
 
   return result;
 }
@@ -76,6 +84,8 @@ DEFINE_API_IMPL( block_api_impl, get_block_range )
   vector<signed_block> blocks = _db.fetch_block_range_unlocked( args.starting_block_num, args.count );
   for (const signed_block& block : blocks)
     result.blocks.push_back(block);
+  if( blocks.size() == args.count && args.starting_block_num + args.count - 1 <= _db.get_last_irreversible_block_num() )
+    json_rpc::mark_response_cacheable();
   return result;
 }
 
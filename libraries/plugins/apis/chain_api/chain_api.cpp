@@ -12,7 +12,8 @@ class chain_api_impl
 
     DECLARE_API_IMPL(
       (push_block)
-      (push_transaction) )
+      (push_transaction)
+      (get_apply_trace) )
 
   private:
     chain_plugin& _chain;
@@ -72,6 +73,13 @@ DEFINE_API_IMPL( chain_api_impl, push_transaction )
   return result;
 }
 
+DEFINE_API_IMPL( chain_api_impl, get_apply_trace )
+{
+  FC_ASSERT( _chain.db().get_apply_tracer().is_enabled(), "Tracing of block application is disabled, set apply-trace-buffer-size to enable it" );
+  // ring buffer of tracer is read without locking
+  return _chain.db().get_apply_tracer().get_trace( args.blocks );
+}
+
 } // detail
 
 chain_api::chain_api(): my( new detail::chain_api_impl() )
@@ -84,6 +92,7 @@ chain_api::~chain_api() {}
 DEFINE_LOCKLESS_APIS( chain_api,
   (push_block)
   (push_transaction)
+  (get_apply_trace)
 )
 
 } } } //hive::plugins::chain
@@ -3,6 +3,8 @@
 
 #include <hive/protocol/types.hpp>
 
+#include <hive/chain/util/apply_trace.hpp>
+
 #include <fc/optional.hpp>
 
 namespace hive { namespace plugins { namespace chain {
@@ -30,6 +32,14 @@ struct push_transaction_return
   optional<string>  error;
 };
 
+struct get_apply_trace_args
+{
+  uint32_t blocks = 1; ///< number of last applied blocks to return trace of
+};
+
+/// trace in Chrome trace format, can be saved to file and opened in chrome://tracing or ui.perfetto.dev
+typedef hive::chain::util::chrome_trace get_apply_trace_return;
+
 
 class chain_api
 {
@@ -39,7 +49,8 @@ class chain_api
 
     DECLARE_API(
       (push_block)
-      (push_transaction) )
+      (push_transaction)
+      (get_apply_trace) )
     
   private:
     std::unique_ptr< detail::chain_api_impl > my;
@@ -50,3 +61,4 @@ class chain_api
 FC_REFLECT( hive::plugins::chain::push_block_args, (block)(currently_syncing) )
 FC_REFLECT( hive::plugins::chain::push_block_return, (success)(error) )
 FC_REFLECT( hive::plugins::chain::push_transaction_return, (success)(error) )
+FC_REFLECT( hive::plugins::chain::get_apply_trace_args, (blocks) )
@@ -1,5 +1,6 @@
 #include <hive/plugins/condenser_api/condenser_api.hpp>
 #include <hive/plugins/condenser_api/condenser_api_plugin.hpp>
+#include <hive/plugins/condenser_api/condenser_api_legacy_json.hpp>
 
 #include <hive/plugins/database_api/database_api_plugin.hpp>
 #include <hive/plugins/block_api/block_api_plugin.hpp>
@@ -171,7 +172,7 @@ namespace detail
       std::shared_ptr< market_history::market_history_api >             _market_history_api;
       map< transaction_id_type, confirmation_callback >                 _callbacks;
       map< time_point_sec, vector< transaction_id_type > >              _callback_expirations;
-      boost::signals2::connection                                       _on_post_apply_block_conn;
+      hive::chain::util::notification_connection                                       _on_post_apply_block_conn;
 
       boost::mutex                                                      _mtx;
   };
@@ -219,23 +220,15 @@ namespace detail
   {
     CHECK_ARG_SIZE( 1 )
     FC_ASSERT( _block_api, "block_api_plugin not enabled." );
-    get_block_return result;
     auto b = _block_api->get_block( { args[0].as< uint32_t >() } ).block;
 
+    auto json = std::make_shared< std::string >();
     if( b )
-    {
-      result = legacy_signed_block( *b );
-      uint32_t n = uint32_t( b->transactions.size() );
-      uint32_t block_num = block_header::num_from_id( b->block_id );
-      for( uint32_t i=0; i<n; i++ )
-      {
-        result->transactions[i].transaction_id = b->transactions[i].id();
-        result->transactions[i].block_num = block_num;
-        result->transactions[i].transaction_num = i;
-      }
-    }
+      write_legacy_block( *json, *b );
+    else
+      *json = "null";
 
-    return result;
+    return get_block_return{ std::move( json ) };
   }
 
   DEFINE_API_IMPL( condenser_api_impl, get_ops_in_block )
@@ -244,20 +237,10 @@ namespace detail
     FC_ASSERT( _account_history_api, "account_history_api_plugin not enabled." );
 
     auto ops = _account_history_api->get_ops_in_block( { args[0].as< uint32_t >(), args[1].as< bool >() } ).ops;
-    get_ops_in_block_return result;
 
-    legacy_operation l_op;
-    legacy_operation_conversion_visitor visitor( l_op );
-
-    for( auto& op_obj : ops )
-    {
-      if( op_obj.op.visit( visitor) )
-      {
-        result.push_back( api_operation_object( op_obj, visitor.l_op ) );
-      }
-    }
-
-    return result;
+    auto json = std::make_shared< std::string >();
+    write_legacy_operations( *json, ops );
+    return get_ops_in_block_return{ std::move( json ) };
   }
 
   DEFINE_API_IMPL( condenser_api_impl, get_config )
@@ -773,9 +756,10 @@ namespace detail
     CHECK_ARG_SIZE( 2 )
 
     vector< tags::vote_state > votes;
-    const auto& comment = _db.get_comment( args[0].as< account_name_type >(), args[1].as< string >() );
+    auto comment = _db.find_comment_for_api( args[0].as< account_name_type >(), args[1].as< string >() );
+    FC_ASSERT( comment != nullptr, "Comment ${a}/${p} does not exist", ("a", args[0])("p", args[1]) );
     const auto& idx = _db.get_index< chain::comment_vote_index, chain::by_comment_voter >();
-    chain::comment_id_type cid( comment.get_id() );
+    chain::comment_id_type cid( comment->get_id() );
     auto itr = idx.lower_bound( cid );
 
     while( itr != idx.end() && itr->comment == cid )
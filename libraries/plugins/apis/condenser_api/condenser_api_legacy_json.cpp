@@ -0,0 +1,165 @@
+#include <hive/plugins/condenser_api/condenser_api_legacy_json.hpp>
+
+#include <fc/io/json.hpp>
+
+namespace hive { namespace plugins { namespace condenser_api {
+
+namespace
+{
+  /// Leaf values still go through variant, so their text is exactly the same as in regular serialization
+  template< typename T >
+  void write_value( std::string& out, const T& value )
+  {
+    out += fc::json::to_string( fc::variant( value ) );
+  }
+
+  void write_key( std::string& out, const char* key, bool first = false )
+  {
+    if( !first )
+      out += ',';
+    out += '"';
+    out += key;
+    out += "\":";
+  }
+
+  template< typename Container >
+  void write_array( std::string& out, const Container& values )
+  {
+    out += '[';
+    bool first = true;
+    for( const auto& v : values )
+    {
+      if( !first )
+        out += ',';
+      first = false;
+      write_value( out, v );
+    }
+    out += ']';
+  }
+
+  /// Same output as legacy_signed_transaction of a block with id and position of transaction filled in
+  void write_legacy_transaction( std::string& out, const signed_transaction& t, const transaction_id_type& id,
+    uint32_t block_num, uint32_t transaction_num )
+  {
+    out += '{';
+    write_key( out, "ref_block_num", true );
+    out += std::to_string( t.ref_block_num );
+    write_key( out, "ref_block_prefix" );
+    out += std::to_string( t.ref_block_prefix );
+    write_key( out, "expiration" );
+    write_value( out, t.expiration );
+
+    write_key( out, "operations" );
+    out += '[';
+    for( size_t i = 0; i < t.operations.size(); ++i )
+    {
+      if( i )
+        out += ',';
+      legacy_operation op;
+      t.operations[i].visit( legacy_operation_conversion_visitor( op ) );
+      write_value( out, op );
+    }
+    out += ']';
+
+    // Signed transaction extensions field exists, but must be empty (legacy form never carries them)
+    write_key( out, "extensions" );
+    out += "[]";
+    write_key( out, "signatures" );
+    write_array( out, t.signatures );
+    write_key( out, "transaction_id" );
+    write_value( out, id );
+    write_key( out, "block_num" );
+    out += std::to_string( block_num );
+    write_key( out, "transaction_num" );
+    out += std::to_string( transaction_num );
+    out += '}';
+  }
+}
+
+void write_legacy_block( std::string& out, const block_api::api_signed_block_object& b )
+{
+  out += '{';
+    write_key( out, "previous", true );
+  write_value( out, b.previous );
+  write_key( out, "timestamp" );
+  write_value( out, b.timestamp );
+  write_key( out, "witness" );
+  write_value( out, string( b.witness ) );
+  write_key( out, "transaction_merkle_root" );
+  write_value( out, b.transaction_merkle_root );
+
+  write_key( out, "extensions" );
+  out += '[';
+  bool first = true;
+  for( const auto& e : b.extensions )
+  {
+    if( !first )
+      out += ',';
+    first = false;
+    legacy_block_header_extensions ext;
+    e.visit( convert_to_legacy_static_variant< legacy_block_header_extensions >( ext ) );
+    write_value( out, ext );
+  }
+  out += ']';
+
+  write_key( out, "witness_signature" );
+  write_value( out, b.witness_signature );
+
+  write_key( out, "transactions" );
+  out += '[';
+  uint32_t block_num = block_header::num_from_id( b.block_id );
+  for( uint32_t i = 0; i < b.transactions.size(); ++i )
+  {
+    if( i )
+      out += ',';
+    write_legacy_transaction( out, b.transactions[i], b.transaction_ids[i], block_num, i );
+  }
+  out += ']';
+
+  write_key( out, "block_id" );
+  write_value( out, b.block_id );
+  write_key( out, "signing_key" );
+  write_value( out, b.signing_key );
+  write_key( out, "transaction_ids" );
+  write_array( out, b.transaction_ids );
+  out += '}';
+}
+
+void write_legacy_operations( std::string& out, const std::multiset< account_history::api_operation_object >& ops )
+{
+  legacy_operation l_op;
+  legacy_operation_conversion_visitor visitor( l_op );
+
+  out += '[';
+  bool first = true;
+  for( const auto& op_obj : ops )
+  {
+    if( !op_obj.op.visit( visitor ) )
+      continue;
+
+    if( !first )
+      out += ',';
+    first = false;
+
+    out += '{';
+    write_key( out, "trx_id", true );
+    write_value( out, op_obj.trx_id );
+    write_key( out, "block" );
+    out += std::to_string( op_obj.block );
+    write_key( out, "trx_in_block" );
+    out += std::to_string( op_obj.trx_in_block );
+    // legacy api_operation_object never carried position of operation in transaction
+    write_key( out, "op_in_trx" );
+    out += '0';
+    write_key( out, "virtual_op" );
+    out += std::to_string( op_obj.virtual_op );
+    write_key( out, "timestamp" );
+    write_value( out, op_obj.timestamp );
+    write_key( out, "op" );
+    write_value( out, l_op );
+    out += '}';
+  }
+  out += ']';
+}
+
+} } } // hive::plugins::condenser_api
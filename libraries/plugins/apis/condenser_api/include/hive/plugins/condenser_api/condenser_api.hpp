@@ -876,8 +876,8 @@ DEFINE_API_ARGS( get_trending_tags,                      vector< variant >,   ve
 DEFINE_API_ARGS( get_state,                              vector< variant >,   state )
 DEFINE_API_ARGS( get_active_witnesses,                   vector< variant >,   vector< account_name_type > )
 DEFINE_API_ARGS( get_block_header,                       vector< variant >,   optional< block_header > )
-DEFINE_API_ARGS( get_block,                              vector< variant >,   optional< legacy_signed_block > )
-DEFINE_API_ARGS( get_ops_in_block,                       vector< variant >,   vector< api_operation_object > )
+DEFINE_API_ARGS( get_block,                              vector< variant >,   json_rpc::serialized_result< optional< legacy_signed_block > > )
+DEFINE_API_ARGS( get_ops_in_block,                       vector< variant >,   json_rpc::serialized_result< vector< api_operation_object > > )
 DEFINE_API_ARGS( get_config,                             vector< variant >,   fc::variant_object )
 DEFINE_API_ARGS( get_dynamic_global_properties,          vector< variant >,   extended_dynamic_global_properties )
 DEFINE_API_ARGS( get_chain_properties,                   vector< variant >,   api_chain_properties )
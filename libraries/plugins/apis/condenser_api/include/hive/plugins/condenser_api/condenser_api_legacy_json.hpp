@@ -0,0 +1,25 @@
+#pragma once
+#include <hive/plugins/condenser_api/condenser_api_legacy_objects.hpp>
+
+#include <hive/plugins/account_history_api/account_history_api.hpp>
+#include <hive/plugins/block_api/block_api_objects.hpp>
+
+#include <set>
+#include <string>
+
+namespace hive { namespace plugins { namespace condenser_api {
+
+/* Writers of condenser_api (legacy) JSON representation of blocks and operations. They produce
+  * exactly the same text as serialization of legacy_signed_block / vector< api_operation_object >
+  * would, but write it straight from source objects - there are no intermediate legacy copies of
+  * whole block and no variant tree of the response. Only single legacy operation is built at a time
+  * (legacy names of operations and legacy asset format come from legacy_operation serialization).
+  */
+
+/// Appends block as legacy_signed_block; transaction ids are taken from ids already computed for the block
+void write_legacy_block( std::string& out, const block_api::api_signed_block_object& b );
+
+/// Appends operations as vector< api_operation_object >, skipping operations that have no legacy form
+void write_legacy_operations( std::string& out, const std::multiset< account_history::api_operation_object >& ops );
+
+} } } // hive::plugins::condenser_api
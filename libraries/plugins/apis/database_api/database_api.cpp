@@ -1184,7 +1184,7 @@ DEFINE_API_IMPL(database_api_impl, get_comment_pending_payouts)
 
   for(const auto& key : args.comments)
   {
-    const comment_object* comment = _db.find_comment(key.first, key.second);
+    auto comment = _db.find_comment_for_api(key.first, key.second);
     if(comment != nullptr)
     {
       retval.cashout_infos.emplace_back();
@@ -1210,7 +1210,7 @@ DEFINE_API_IMPL( database_api_impl, find_comments )
 
   for( auto& key: args.comments )
   {
-    auto comment = _db.find_comment( key.first, key.second );
+    auto comment = _db.find_comment_for_api( key.first, key.second );
 
     if( comment != nullptr )
       result.comments.emplace_back( *comment, _db );
@@ -1707,9 +1707,9 @@ DEFINE_API_IMPL( database_api_impl, verify_authority )
 {
   args.trx.verify_authority(
     _db.get_chain_id(),
-    [&]( string account_name ){ return authority( _db.get< chain::account_authority_object, chain::by_account >( account_name ).active  ); },
-    [&]( string account_name ){ return authority( _db.get< chain::account_authority_object, chain::by_account >( account_name ).owner   ); },
-    [&]( string account_name ){ return authority( _db.get< chain::account_authority_object, chain::by_account >( account_name ).posting ); },
+    [&]( const string& account_name ){ return authority_view( _db.get< chain::account_authority_object, chain::by_account >( account_name ).active  ); },
+    [&]( const string& account_name ){ return authority_view( _db.get< chain::account_authority_object, chain::by_account >( account_name ).owner   ); },
+    [&]( const string& account_name ){ return authority_view( _db.get< chain::account_authority_object, chain::by_account >( account_name ).posting ); },
     HIVE_MAX_SIG_CHECK_DEPTH,
     HIVE_MAX_AUTHORITY_MEMBERSHIP,
     HIVE_MAX_SIG_CHECK_ACCOUNTS,
@@ -14,7 +14,10 @@ using namespace hive::plugins::market_history;
 class market_history_api_impl
 {
   public:
-    market_history_api_impl() : _db( appbase::app().get_plugin< hive::plugins::chain::chain_plugin >().db() ) {}
+    market_history_api_impl() :
+      _db( appbase::app().get_plugin< hive::plugins::chain::chain_plugin >().db() ),
+      _lock_domains( chainbase::database::lock_domain_mask( _db.register_lock_domain( HIVE_MARKET_HISTORY_LOCK_DOMAIN ) ) )
+    {}
 
     DECLARE_API_IMPL(
       (get_ticker)
@@ -27,6 +30,8 @@ class market_history_api_impl
     )
 
     chain::database& _db;
+    /// history of trades and buckets, without consensus state (current order book, head block time)
+    const uint32_t   _lock_domains;
 };
 
 DEFINE_API_IMPL( market_history_api_impl, get_ticker )
@@ -196,6 +201,9 @@ DEFINE_READ_APIS( market_history_api,
   (get_ticker)
   (get_volume)
   (get_order_book)
+)
+
+DEFINE_DOMAIN_READ_APIS( market_history_api, my->_lock_domains,
   (get_trade_history)
   (get_recent_trades)
   (get_market_history)
@@ -1,11 +1,6 @@
 
-#define BOOST_THREAD_PROVIDES_EXECUTORS
-#define BOOST_THREAD_PROVIDES_FUTURE
-#define BOOST_THREAD_PROVIDES_FUTURE_CONTINUATION
-#define BOOST_THREAD_USES_MOVE
-
-
 #include <hive/plugins/block_data_export/block_data_export_plugin.hpp>
+#include <hive/plugins/block_data_export/export_output.hpp>
 #include <hive/plugins/block_data_export/exportable_block_data.hpp>
 
 #include <hive/chain/account_object.hpp>
@@ -13,10 +8,12 @@
 #include <hive/chain/global_property_object.hpp>
 #include <hive/chain/index.hpp>
 
-#include <boost/thread/future.hpp>
-#include <boost/thread/sync_bounded_queue.hpp>
+#include <hive/utilities/ordered_pipeline.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <boost/thread/thread.hpp>
 
-#include <fstream>
 #include <iostream>
 #include <queue>
 #include <sstream>
@@ -51,21 +48,37 @@ FC_REFLECT( hive::plugins::block_data_export::detail::api_export_data_object, (b
 
 namespace hive { namespace plugins { namespace block_data_export { namespace detail {
 
-struct work_item
+enum class export_format
 {
-  std::shared_ptr< api_export_data_object >          edo;
-  boost::promise< std::shared_ptr< std::string > >   edo_json_promise;
-  boost::future< std::shared_ptr< std::string > >    edo_json_future = edo_json_promise.get_future();
+  json,   ///< one JSON document per line
+  binary  ///< uint32 length of the record followed by fc::raw packed block_id, previous, number of export
+          ///< objects and for each its name, uint32 length and object packed by exportable_block_data::pack
 };
 
+/// appends fc::raw packed value without temporary buffer
+template< typename T >
+void append_packed( std::vector< char >& data, const T& value )
+{
+  size_t offset = data.size();
+  data.resize( offset + fc::raw::pack_size( value ) );
+  fc::datastream< char* > ds( data.data() + offset, data.size() - offset );
+  fc::raw::pack( ds, value );
+}
+
+/// writes uint32 length of data that follows it (written in place of placeholder at given offset)
+void finish_length_prefix( std::vector< char >& data, size_t offset )
+{
+  uint32_t length = static_cast< uint32_t >( data.size() - offset - sizeof( uint32_t ) );
+  fc::datastream< char* > ds( data.data() + offset, sizeof( uint32_t ) );
+  fc::raw::pack( ds, length );
+}
+
 class block_data_export_plugin_impl
 {
   public:
     block_data_export_plugin_impl( block_data_export_plugin& _plugin ) :
       _db( appbase::app().get_plugin< hive::plugins::chain::chain_plugin >().db() ),
-      _self( _plugin ),
-      _data_queue( _max_queue_size ),
-      _output_queue( _max_queue_size ) {}
+      _self( _plugin ) {}
 
     void on_pre_apply_block( const block_notification& note );
     void on_post_apply_block( const block_notification& note );
@@ -73,17 +86,19 @@ class block_data_export_plugin_impl
     void register_export_data_factory( const std::string& name, std::function< std::shared_ptr< exportable_block_data >() >& factory );
     void create_export_data( const block_id_type& previous, const block_id_type& block_id );
     void send_export_data();
+    void fail_export( const std::string& error );
     std::shared_ptr< exportable_block_data > find_abstract_export_data( const std::string& name );
 
     void start_threads();
     void stop_threads();
-    void convert_to_json_thread_main();
-    void output_thread_main();
+    std::string convert( const api_export_data_object& edo ) const;
+    void output( const std::string& edo_data, bool more_ready );
+    void write_batch();
 
     database&                     _db;
     block_data_export_plugin&     _self;
-    boost::signals2::connection   _pre_apply_block_conn;
-    boost::signals2::connection   _post_apply_block_conn;
+    hive::chain::util::notification_connection   _pre_apply_block_conn;
+    hive::chain::util::notification_connection   _post_apply_block_conn;
     std::shared_ptr< api_export_data_object >
                         _edo;
     std::vector< std::pair<
@@ -92,91 +107,106 @@ class block_data_export_plugin_impl
       > >                        _factory_list;
     std::string                   _output_name;
     bool                          _enabled = false;
+    bool                          _failed = false; ///< export was stopped because of conversion or output error
+    export_format                 _format = export_format::json;
+    export_output                 _output;
+    size_t                        _batch_size = 1024*1024;
+    uint32_t                      _flush_blocks = 100;
 
-    size_t                        _max_queue_size = 100;
-    boost::concurrent::sync_bounded_queue< std::shared_ptr< work_item > >    _data_queue;
-    boost::concurrent::sync_bounded_queue< std::shared_ptr< work_item > >    _output_queue;
+    std::string                   _batch;
+    uint32_t                      _unflushed_blocks = 0;
 
+    size_t                        _max_queue_size = 100;
     size_t                        _thread_stack_size = 4096*1024;
-    std::shared_ptr< boost::thread >                      _output_thread;
 
-    std::vector< boost::thread >  _json_conversion_threads;
+    /// blocks are converted in parallel and written in order; block processing waits when queue is full
+    std::unique_ptr< hive::utilities::ordered_pipeline< std::shared_ptr< api_export_data_object >, std::string > >
+                                  _pipeline;
 };
 
 void block_data_export_plugin_impl::start_threads()
 {
-  boost::thread::attributes attrs;
-  attrs.set_stack_size( _thread_stack_size );
+  _batch.reserve( _batch_size );
 
   size_t num_threads = boost::thread::hardware_concurrency()+1;
-  for( size_t i=0; i<num_threads; i++ )
-  {
-    _json_conversion_threads.emplace_back( attrs, [this]() { convert_to_json_thread_main(); } );
-  }
-
-  _output_thread = std::make_shared< boost::thread >( attrs, [this]() { output_thread_main(); } );
+  _pipeline = std::make_unique< hive::utilities::ordered_pipeline< std::shared_ptr< api_export_data_object >, std::string > >(
+    num_threads, _max_queue_size,
+    [this]( std::shared_ptr< api_export_data_object >& edo ) { return convert( *edo ); },
+    [this]( std::string& edo_data, bool more_ready ) { output( edo_data, more_ready ); },
+    _thread_stack_size );
 }
 
 void block_data_export_plugin_impl::stop_threads()
 {
-  //
-  // We must close the output queue first:  The output queue may be waiting on a future.
-  // If the conversion threads are still alive, the future will complete,
-  // the output thread will then wait on _output_queue and see close() has been called.
-  //
-  // (If we closed the conversion threads first, the future would never complete,
-  // and the output thread would wait forever.)
-  //
-  _output_queue.close();
-  _output_thread->join();
-  _output_thread.reset();
-
-  _data_queue.close();
-  for( boost::thread& t : _json_conversion_threads )
-    t.join();
-  _json_conversion_threads.clear();
-}
+  // all queued blocks are written before the pipeline stops
+  _pipeline->stop();
+  _pipeline.reset();
 
-void block_data_export_plugin_impl::convert_to_json_thread_main()
-{
-  while( true )
+  if( !_failed )
   {
-    std::shared_ptr< work_item > work;
     try
     {
-      _data_queue.pull_front( work );
+      write_batch();
+      _output.flush();
     }
-    catch( const boost::concurrent::sync_queue_is_closed& e )
+    catch( const fc::exception& e )
     {
-      break;
+      elog( "Block data export failed to write last blocks: ${e}", ("e", e.to_detail_string()) );
     }
-
-    // TODO exception handling
-    std::shared_ptr< std::string > edo_json = std::make_shared< std::string >( fc::json::to_string( work->edo ) );
-    work->edo_json_promise.set_value( edo_json );
   }
+  _output.close();
 }
 
-void block_data_export_plugin_impl::output_thread_main()
+std::string block_data_export_plugin_impl::convert( const api_export_data_object& edo ) const
 {
-  std::ofstream output_file( _output_name, std::ios::binary );
-  while( true )
+  std::string edo_data;
+  if( _format == export_format::binary )
   {
-    std::shared_ptr< work_item > work;
-    try
+    std::vector< char > packed;
+    packed.resize( sizeof( uint32_t ) );
+    append_packed( packed, edo.block_id );
+    append_packed( packed, edo.previous );
+    append_packed( packed, fc::unsigned_int( edo.export_data.size() ) );
+    for( const auto& entry : edo.export_data )
     {
-      _output_queue.pull_front( work );
-    }
-    catch( const boost::concurrent::sync_queue_is_closed& e )
-    {
-      break;
+      append_packed( packed, entry.first );
+      size_t length_offset = packed.size();
+      packed.resize( length_offset + sizeof( uint32_t ) );
+      entry.second->pack( packed );
+      finish_length_prefix( packed, length_offset );
     }
+    finish_length_prefix( packed, 0 );
+    edo_data.assign( packed.data(), packed.size() );
+  }
+  else
+  {
+    edo_data = fc::json::to_string( edo );
+    edo_data.push_back( '\n' );
+  }
+  return edo_data;
+}
 
-    std::shared_ptr< std::string > edo_json = work->edo_json_future.get();
+void block_data_export_plugin_impl::write_batch()
+{
+  _output.write( _batch.data(), _batch.size() );
+  _batch.clear();
+}
 
-    output_file.write( edo_json->c_str(), edo_json->length() );
-    output_file.put( '\n' );
-    output_file.flush();
+void block_data_export_plugin_impl::output( const std::string& edo_data, bool more_ready )
+{
+  _batch.append( edo_data );
+  ++_unflushed_blocks;
+
+  if( _batch.size() >= _batch_size )
+    write_batch();
+
+  // During replay the queue is always full and data is flushed every _flush_blocks blocks.
+  // When there is nothing more waiting (live sync) the block is flushed right away.
+  if( _unflushed_blocks >= _flush_blocks || !more_ready )
+  {
+    write_batch();
+    _output.flush();
+    _unflushed_blocks = 0;
   }
 }
 
@@ -191,7 +221,7 @@ void block_data_export_plugin_impl::register_export_data_factory(
 void block_data_export_plugin_impl::create_export_data( const block_id_type& previous, const block_id_type& block_id )
 {
   _edo.reset();
-  if( !_enabled )
+  if( !_enabled || _failed )
     return;
   _edo = std::make_shared< api_export_data_object >();
 
@@ -205,22 +235,33 @@ void block_data_export_plugin_impl::create_export_data( const block_id_type& pre
 
 void block_data_export_plugin_impl::send_export_data()
 {
-  std::shared_ptr< work_item > work = std::make_shared< work_item >();
-  work->edo = _edo;
-  _edo.reset();
-
+  if( !_edo )
+    return;
+  // blocks while too many blocks wait for conversion or output; rethrows failure of either, which must
+  // not fail application of the block, so export is stopped instead
   try
   {
-    _data_queue.push_back( work );
-    _output_queue.push_back( work );
+    _pipeline->push( std::move( _edo ) );
+  }
+  catch( const fc::exception& e )
+  {
+    fail_export( e.to_detail_string() );
+  }
+  catch( const std::exception& e )
+  {
+    fail_export( e.what() );
   }
-  catch( const boost::concurrent::sync_queue_is_closed& e )
+  catch( ... )
   {
-    // We should never see this exception because we should be done handling blocks
-    // by the time we're closing queues
-    elog( "Caught unexpected sync_queue_is_closed in block_data_export_plugin_impl::push_work()" );
+    fail_export( "unknown exception" );
   }
-  return;
+  _edo.reset();
+}
+
+void block_data_export_plugin_impl::fail_export( const std::string& error )
+{
+  elog( "Block data export to ${n} failed and is disabled until restart: ${e}", ("n", _output_name)("e", error) );
+  _failed = true;
 }
 
 std::shared_ptr< exportable_block_data > block_data_export_plugin_impl::find_abstract_export_data( const std::string& name )
@@ -246,6 +287,102 @@ void block_data_export_plugin_impl::on_post_apply_block( const block_notificatio
 
 } // detail
 
+void export_output::open( const std::string& name )
+{
+  static const std::string unix_prefix = "unix:";
+  if( name.compare( 0, unix_prefix.size(), unix_prefix ) == 0 )
+  {
+    _is_socket = true;
+    _endpoint = boost::asio::local::stream_protocol::endpoint( name.substr( unix_prefix.size() ) );
+    boost::system::error_code ec;
+    FC_ASSERT( connect( ec ), "Cannot connect to block data export socket ${n}: ${e}", ("n", name)("e", ec.message()) );
+  }
+  else
+  {
+    _file.open( name, std::ios::binary );
+    FC_ASSERT( _file.good(), "Cannot open block data export file ${n}", ("n", name) );
+  }
+}
+
+void export_output::write( const char* data, size_t size )
+{
+  if( !_is_socket )
+  {
+    _file.write( data, size );
+    FC_ASSERT( _file.good(), "Write of ${n} bytes to block data export file failed", ("n", size) );
+    return;
+  }
+
+  if( size == 0 )
+    return;
+
+  if( !_socket )
+  {
+    boost::system::error_code ec;
+    if( fc::time_point::now() - _last_connect_attempt < _reconnect_interval || !connect( ec ) )
+    {
+      _dropped_bytes += size;
+      return;
+    }
+    ilog( "Block data export consumer reconnected, ${n} bytes of data were dropped so far", ("n", _dropped_bytes) );
+  }
+
+  size_t written = 0;
+  while( written < size )
+  {
+    boost::system::error_code ec;
+    // MSG_NOSIGNAL - write to socket closed by consumer fails with EPIPE instead of killing the node with SIGPIPE
+    written += _socket->send( boost::asio::buffer( data + written, size - written ), MSG_NOSIGNAL, ec );
+    if( ec == boost::asio::error::interrupted )
+      continue;
+    if( ec )
+    {
+      wlog( "Block data export consumer disconnected: ${e}. Exported data is dropped until it reconnects", ("e", ec.message()) );
+      _dropped_bytes += size - written;
+      disconnect();
+      return;
+    }
+  }
+}
+
+void export_output::flush()
+{
+  if( !_is_socket )
+  {
+    _file.flush();
+    FC_ASSERT( _file.good(), "Flush of block data export file failed" );
+  }
+}
+
+void export_output::close()
+{
+  if( _is_socket )
+    disconnect();
+  else
+    _file.close();
+}
+
+bool export_output::connect( boost::system::error_code& ec )
+{
+  _last_connect_attempt = fc::time_point::now();
+  auto socket = std::make_unique< boost::asio::local::stream_protocol::socket >( _ios );
+  socket->connect( _endpoint, ec );
+  if( ec )
+    return false;
+  _socket = std::move( socket );
+  return true;
+}
+
+void export_output::disconnect()
+{
+  if( !_socket )
+    return;
+  boost::system::error_code ec;
+  _socket->shutdown( boost::asio::local::stream_protocol::socket::shutdown_both, ec );
+  _socket->close( ec );
+  _socket.reset();
+}
+
 block_data_export_plugin::block_data_export_plugin() {}
 block_data_export_plugin::~block_data_export_plugin() {}
 
@@ -265,7 +402,10 @@ std::shared_ptr< exportable_block_data > block_data_export_plugin::find_abstract
 void block_data_export_plugin::set_program_options( options_description& cli, options_description& cfg )
 {
   cfg.add_options()
-      ("block-data-export-file", boost::program_options::value< string >()->default_value("NONE"), "Where to export data (NONE to discard)")
+      ("block-data-export-file", boost::program_options::value< string >()->default_value("NONE"), "Where to export data (NONE to discard, unix:<path> to stream to unix socket)")
+      ("block-data-export-format", boost::program_options::value< string >()->default_value("json"), "Format of exported data: json (one line per block) or binary (length-prefixed fc::raw packed records)")
+      ("block-data-export-batch-size", boost::program_options::value< uint32_t >()->default_value(1024*1024), "Size in bytes of buffer collecting exported blocks before they are written")
+      ("block-data-export-flush-blocks", boost::program_options::value< uint32_t >()->default_value(100), "Flush exported data at least every given number of blocks (data is also flushed when there are no more blocks waiting)")
       ;
 }
 
@@ -281,6 +421,17 @@ void block_data_export_plugin::plugin_initialize( const boost::program_options::
     if( !my->_enabled )
       return;
 
+    const std::string format = options.at( "block-data-export-format" ).as< string >();
+    if( format == "binary" )
+      my->_format = detail::export_format::binary;
+    else
+      FC_ASSERT( format == "json", "Unknown block-data-export-format ${f}", ("f", format) );
+
+    my->_batch_size = options.at( "block-data-export-batch-size" ).as< uint32_t >();
+    my->_flush_blocks = std::max< uint32_t >( options.at( "block-data-export-flush-blocks" ).as< uint32_t >(), 1 );
+
+    my->_output.open( my->_output_name );
+
     my->_pre_apply_block_conn = my->_db.add_pre_apply_block_handler(
       [&]( const block_notification& note ){ my->on_pre_apply_block( note ); }, *this, -9300 );
     my->_post_apply_block_conn = my->_db.add_post_apply_block_handler(
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <fc/time.hpp>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace hive { namespace plugins { namespace block_data_export {
+
+/**
+  * Destination of exported data - regular file or (when name starts with `unix:`) unix domain
+  * socket that downstream consumer listens on. Writes to the socket are blocking, so slow
+  * consumer throttles export (and block processing once queues are full) instead of losing data.
+  *
+  * When the consumer disconnects, data is dropped (instead of stopping the node) and connection
+  * is retried before next write, at most once per reconnect interval. Callers write whole records
+  * at once, so consumer that reconnects starts reading at record boundary.
+  */
+class export_output
+{
+  public:
+    explicit export_output( fc::microseconds reconnect_interval = fc::seconds( 1 ) )
+      : _reconnect_interval( reconnect_interval ) {}
+
+    void open( const std::string& name );
+    void write( const char* data, size_t size );
+    void flush();
+    void close();
+
+    /// false when consumer on the other side of the socket is gone and data is dropped
+    bool is_connected()const { return !_is_socket || _socket != nullptr; }
+    /// number of bytes dropped because consumer was not connected
+    uint64_t get_dropped_bytes()const { return _dropped_bytes; }
+
+  private:
+    bool connect( boost::system::error_code& ec );
+    void disconnect();
+
+    std::ofstream                                                    _file;
+    boost::asio::io_service                                          _ios;
+    std::unique_ptr< boost::asio::local::stream_protocol::socket >   _socket;
+    bool                                                             _is_socket = false;
+    boost::asio::local::stream_protocol::endpoint                    _endpoint;
+    fc::microseconds                                                 _reconnect_interval;
+    fc::time_point                                                   _last_connect_attempt;
+    uint64_t                                                         _dropped_bytes = 0;
+};
+
+} } } // hive::plugins::block_data_export
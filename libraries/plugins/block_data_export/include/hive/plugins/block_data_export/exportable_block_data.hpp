@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace fc {
 class variant;
@@ -15,6 +16,8 @@ class exportable_block_data
     virtual ~exportable_block_data();
 
     virtual void to_variant( fc::variant& v )const = 0;
+    /// appends fc::raw packed data (used by binary export format, without conversion to variant)
+    virtual void pack( std::vector< char >& data )const = 0;
 };
 
 } } }
@@ -3,6 +3,7 @@
 #include <hive/plugins/chain/abstract_block_producer.hpp>
 #include <hive/plugins/chain/state_snapshot_provider.hpp>
 #include <hive/plugins/chain/chain_plugin.hpp>
+#include <hive/plugins/statsd/metrics.hpp>
 #include <hive/plugins/statsd/utility.hpp>
 
 #include <hive/utilities/benchmark_dumper.hpp>
@@ -94,6 +95,8 @@ class chain_plugin_impl
     void write_default_database_config( bfs::path& p );
 
     uint64_t                         shared_memory_size = 0;
+    uint64_t                         shared_memory_max_size = 0;
+    chainbase::mapping_options       shared_memory_mapping;
     uint16_t                         shared_file_full_threshold = 0;
     uint16_t                         shared_file_scale_rate = 0;
     uint32_t                         chainbase_flags = 0;
@@ -111,9 +114,16 @@ class chain_plugin_impl
     bool                             force_replay = false;
     uint32_t                         benchmark_interval = 0;
     uint32_t                         flush_interval = 0;
+    uint32_t                         background_flush_interval = 0;
     bool                             replay_in_memory = false;
     std::vector< std::string >       replay_memory_indices{};
+    bool                             comment_archive = false;
+    bool                             replica = false;
     flat_map<uint32_t,block_id_type> loaded_checkpoints;
+    bool                             fast_irreversible_sync = false;
+    uint32_t                         apply_trace_buffer_size = 0;
+    uint32_t                         apply_trace_threshold_ms = 0;
+    bfs::path                        apply_trace_dir;
 
     uint32_t allow_future_time = 5;
 
@@ -139,12 +149,32 @@ class chain_plugin_impl
     std::atomic<uint32_t>               peer_count;
 };
 
+struct write_metrics
+{
+  using metrics_registry = hive::plugins::statsd::metrics_registry;
+  using histogram_metric = hive::plugins::statsd::histogram_metric;
+
+  histogram_metric& push_block = metrics_registry::instance().histogram( "chain.write_time.push_block", "Time of pushing block from write queue in microseconds" );
+  histogram_metric& push_irreversible_block = metrics_registry::instance().histogram( "chain.write_time.push_irreversible_block", "Time of pushing block covered by checkpoint from write queue in microseconds" );
+  histogram_metric& push_transaction = metrics_registry::instance().histogram( "chain.write_time.push_transaction", "Time of pushing transaction from write queue in microseconds" );
+  histogram_metric& generate_block = metrics_registry::instance().histogram( "chain.write_time.generate_block", "Time of generating block in microseconds" );
+  histogram_metric& write_lock = metrics_registry::instance().histogram( "chain.lock_time.write_lock", "Time of holding write lock by write queue processing in microseconds" );
+  histogram_metric& write_lock_wait = metrics_registry::instance().histogram( "chain.lock_time.write_lock_wait", "Time of waiting for write lock by write queue processing in microseconds" );
+
+  static write_metrics& get()
+  {
+    static write_metrics metrics;
+    return metrics;
+  }
+};
+
 struct write_request_visitor
 {
   write_request_visitor() {}
 
   database* db;
   uint32_t  skip = 0;
+  bool      fast_irreversible_sync = false;
   fc::optional< fc::exception >* except;
   std::shared_ptr< abstract_block_producer > block_generator;
 
@@ -156,9 +186,16 @@ struct write_request_visitor
 
     try
     {
-      STATSD_START_TIMER( "chain", "write_time", "push_block", 1.0f )
-      result = db->push_block( *block, skip );
-      STATSD_STOP_TIMER( "chain", "write_time", "push_block" )
+      if( fast_irreversible_sync && db->is_known_irreversible( block->block_num() ) && block->block_num() > db->head_block_num() )
+      {
+        hive::plugins::statsd::scoped_timer timer( write_metrics::get().push_irreversible_block );
+        db->push_irreversible_block( *block, skip );
+      }
+      else
+      {
+        hive::plugins::statsd::scoped_timer timer( write_metrics::get().push_block );
+        result = db->push_block( *block, skip );
+      }
     }
     catch( fc::exception& e )
     {
@@ -179,9 +216,10 @@ struct write_request_visitor
 
     try
     {
-      STATSD_START_TIMER( "chain", "write_time", "push_transaction", 1.0f )
-      db->push_transaction( *trx );
-      STATSD_STOP_TIMER( "chain", "write_time", "push_transaction" )
+      {
+        hive::plugins::statsd::scoped_timer timer( write_metrics::get().push_transaction );
+        db->push_transaction( *trx );
+      }
 
       result = true;
     }
@@ -207,14 +245,15 @@ struct write_request_visitor
       if( !block_generator )
         FC_THROW_EXCEPTION( chain_exception, "Received a generate block request, but no block generator has been registered." );
 
-      STATSD_START_TIMER( "chain", "write_time", "generate_block", 1.0f )
-      req->block = block_generator->generate_block(
-        req->when,
-        req->witness_owner,
-        req->block_signing_private_key,
-        req->skip
-        );
-      STATSD_STOP_TIMER( "chain", "write_time", "generate_block" )
+      {
+        hive::plugins::statsd::scoped_timer timer( write_metrics::get().generate_block );
+        req->block = block_generator->generate_block(
+          req->when,
+          req->witness_owner,
+          req->block_signing_private_key,
+          req->skip
+          );
+      }
 
       result = true;
     }
@@ -257,6 +296,7 @@ void chain_plugin_impl::start_write_processing()
     write_request_visitor req_visitor;
     req_visitor.db = &db;
     req_visitor.block_generator = block_generator;
+    req_visitor.fast_irreversible_sync = fast_irreversible_sync;
 
     request_promise_visitor prom_visitor;
 
@@ -293,13 +333,14 @@ void chain_plugin_impl::start_write_processing()
         {
           fc::time_point write_lock_acquired_time = fc::time_point::now();
           fc::microseconds write_lock_acquisition_time = write_lock_acquired_time - write_lock_request_time;
+          write_metrics::get().write_lock_wait.record( write_lock_acquisition_time );
           if( write_lock_acquisition_time > fc::milliseconds( 50 ) )
           {
             wlog("write_lock_acquisition_time = ${write_lock_aquisition_time}μs exceeds warning threshold of 50ms",
                  ("write_lock_aquisition_time", write_lock_acquisition_time.count()));
           }
 
-          STATSD_START_TIMER( "chain", "lock_time", "write_lock", 1.0f )
+          hive::plugins::statsd::scoped_timer write_lock_timer( write_metrics::get().write_lock );
           while( true )
           {
             req_visitor.skip = cxt->skip;
@@ -419,8 +460,10 @@ void chain_plugin_impl::initial_settings()
   }
 
   db.set_flush_interval( flush_interval );
+  db.set_background_flush_interval( background_flush_interval );
   db.add_checkpoints( loaded_checkpoints );
   db.set_require_locking( check_locks );
+  db.get_apply_tracer().configure( apply_trace_buffer_size, apply_trace_threshold_ms, apply_trace_dir );
 
   const auto& abstract_index_cntr = db.get_abstract_index_cntr();
 
@@ -445,6 +488,8 @@ void chain_plugin_impl::initial_settings()
   db_open_args.initial_supply = HIVE_INIT_SUPPLY;
   db_open_args.hbd_initial_supply = HIVE_HBD_INIT_SUPPLY;
   db_open_args.shared_file_size = shared_memory_size;
+  db_open_args.shared_file_max_size = shared_memory_max_size;
+  db_open_args.shared_file_mapping = shared_memory_mapping;
   db_open_args.shared_file_full_threshold = shared_file_full_threshold;
   db_open_args.shared_file_scale_rate = shared_file_scale_rate;
   db_open_args.chainbase_flags = chainbase_flags;
@@ -456,6 +501,7 @@ void chain_plugin_impl::initial_settings()
   db_open_args.database_cfg = database_config;
   db_open_args.replay_in_memory = replay_in_memory;
   db_open_args.replay_memory_indices = replay_memory_indices;
+  db_open_args.comment_archive = comment_archive;
 
   auto benchmark_lambda = [ this ] ( uint32_t current_block_number,
     const chainbase::database::abstract_index_cntr_t& abstract_index_cntr )
@@ -617,13 +663,35 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
       ("shared-file-dir", bpo::value<bfs::path>()->default_value("blockchain"), // NOLINT(clang-analyzer-optin.cplusplus.VirtualCall)
         "the location of the chain shared memory files (absolute path or relative to application data dir)")
       ("shared-file-size", bpo::value<string>()->default_value("54G"), "Size of the shared memory file. Default: 54G. If running a full node, increase this value to 200G.")
+      ("shared-file-max-size", bpo::value<string>()->default_value("0"),
+        "Size up to which the shared memory file can be autoscaled without stopping the node (virtual address space of that size is reserved up front, which uses neither memory nor disk space). Growing above that size, or when it is 0, requires reopening the file between blocks." )
+      ("shared-file-huge-pages", bpo::value<bool>()->default_value(false),
+        "Back shared memory file mapping with transparent huge pages (effective when shared-file-dir is on tmpfs). Shared memory file placed on hugetlbfs always uses huge pages." )
+      ("shared-file-access", bpo::value<string>()->default_value("normal"),
+        "Access pattern hint for shared memory file mapping: normal, random (no readahead, for state bigger than RAM), sequential or willneed (read whole file in background)" )
+      ("shared-file-prefault-threads", bpo::value<uint32_t>()->default_value(0),
+        "Number of threads that fault in whole shared memory file at startup, so first blocks and API calls don't wait for disk reads (0 disables prefaulting)" )
       ("shared-file-full-threshold", bpo::value<uint16_t>()->default_value(0),
         "A 2 precision percentage (0-10000) that defines the threshold for when to autoscale the shared memory file. Setting this to 0 disables autoscaling. Recommended value for consensus node is 9500 (95%). Full node is 9900 (99%)" )
       ("shared-file-scale-rate", bpo::value<uint16_t>()->default_value(0),
         "A 2 precision percentage (0-10000) that defines how quickly to scale the shared memory file. When autoscaling occurs the file's size will be increased by this percent. Setting this to 0 disables autoscaling. Recommended value is between 1000-2000 (10-20%)" )
       ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
+      ("fast-irreversible-sync", bpo::value<bool>()->default_value(false),
+        "apply synced blocks covered by last checkpoint without undo state and fork database, writing them straight to block log (like replay does); witness signatures are still verified" )
+      ("apply-trace-buffer-size", bpo::value<uint32_t>()->default_value(0),
+        "number of trace spans (block phases, transactions, plugin handlers) of last applied blocks kept in memory and available through chain_api.get_apply_trace (0 disables tracing)" )
+      ("apply-trace-threshold-ms", bpo::value<uint32_t>()->default_value(0),
+        "write Chrome trace of every block that took longer than given number of milliseconds to apply into apply-trace-dir (0 disables, requires apply-trace-buffer-size)" )
+      ("apply-trace-dir", bpo::value<bfs::path>()->default_value("apply_traces"),
+        "the location of traces of slow blocks (absolute path or relative to application data dir)" )
       ("flush-state-interval", bpo::value<uint32_t>(),
         "flush shared memory changes to disk every N blocks")
+      ("flush-state-background-interval", bpo::value<uint32_t>()->default_value(0),
+        "write dirty pages of shared memory file to disk continuously in background thread, so each pass over the whole file takes N seconds; this makes periodic flushes (and shutdown) short (0 disables background flushing)")
+      ("comment-archive", bpo::value<bool>()->default_value(false),
+        "move comments paid out in irreversible blocks from shared memory to RocksDB storage in shared-file-dir. Once enabled it stays enabled until replay with --force-replay" )
+      ("read-only-replica", bpo::value<bool>()->default_value(false),
+        "map shared memory file of another node (running with the same shared-file-dir and data dir) in read only mode and only serve API calls from it; such node does not process blocks nor transactions; it can't serve state of node that uses comment archive" )
       ;
   cli.add_options()
       ("replay-blockchain", bpo::bool_switch()->default_value(false), "clear chain database and replay all blocks" )
@@ -656,6 +724,23 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
   }
 
   my->shared_memory_size = fc::parse_size( options.at( "shared-file-size" ).as< string >() );
+  my->shared_memory_max_size = fc::parse_size( options.at( "shared-file-max-size" ).as< string >() );
+
+  my->shared_memory_mapping.huge_pages = options.at( "shared-file-huge-pages" ).as< bool >();
+  my->shared_memory_mapping.prefault_threads = options.at( "shared-file-prefault-threads" ).as< uint32_t >();
+  {
+    const auto& access = options.at( "shared-file-access" ).as< string >();
+    if( access == "normal" )
+      my->shared_memory_mapping.access = chainbase::mapping_access::normal;
+    else if( access == "random" )
+      my->shared_memory_mapping.access = chainbase::mapping_access::random;
+    else if( access == "sequential" )
+      my->shared_memory_mapping.access = chainbase::mapping_access::sequential;
+    else if( access == "willneed" )
+      my->shared_memory_mapping.access = chainbase::mapping_access::willneed;
+    else
+      FC_ASSERT( false, "Unknown shared-file-access value ${a}", ("a", access) );
+  }
 
   if( options.count( "shared-file-full-threshold" ) )
     my->shared_file_full_threshold = options.at( "shared-file-full-threshold" ).as< uint16_t >();
@@ -675,6 +760,16 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
   my->check_locks         = options.at( "check-locks" ).as< bool >();
   my->validate_invariants = options.at( "validate-database-invariants" ).as<bool>();
   my->dump_memory_details = options.at( "dump-memory-details" ).as<bool>();
+  my->comment_archive     = options.at( "comment-archive" ).as< bool >();
+  my->replica             = options.at( "read-only-replica" ).as< bool >();
+  if( my->replica )
+  {
+    FC_ASSERT( !my->replay && !my->resync, "Read only replica can't replay nor resync blockchain" );
+    FC_ASSERT( !my->comment_archive, "Read only replica can't be used together with comment archive" );
+    my->chainbase_flags |= chainbase::read_only_replica;
+    my->is_p2p_enabled = false;
+  }
+  my->background_flush_interval = options.at( "flush-state-background-interval" ).as< uint32_t >();
   if( options.count( "flush-state-interval" ) )
     my->flush_interval = options.at( "flush-state-interval" ).as<uint32_t>();
   else
@@ -691,6 +786,16 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
     }
   }
 
+  my->fast_irreversible_sync = options.at( "fast-irreversible-sync" ).as< bool >();
+
+  my->apply_trace_buffer_size = options.at( "apply-trace-buffer-size" ).as< uint32_t >();
+  my->apply_trace_threshold_ms = options.at( "apply-trace-threshold-ms" ).as< uint32_t >();
+  FC_ASSERT( my->apply_trace_threshold_ms == 0 || my->apply_trace_buffer_size != 0,
+    "apply-trace-threshold-ms requires nonzero apply-trace-buffer-size" );
+  my->apply_trace_dir = options.at( "apply-trace-dir" ).as< bfs::path >();
+  if( my->apply_trace_dir.is_relative() )
+    my->apply_trace_dir = app().data_dir() / my->apply_trace_dir;
+
   my->benchmark_is_enabled = (options.count( "advanced-benchmark" ) != 0);
 
   if( options.count( "statsd-record-on-replay" ) )
@@ -724,6 +829,12 @@ void chain_plugin::plugin_startup()
   ilog("Database opening...");
   my->open();
 
+  if( my->replica )
+  {
+    ilog("Serving API from read only replica, blocks are processed by the node owning the state...");
+    return;
+  }
+
   ilog("Snapshot processing...");
   my->process_snapshot();
 
@@ -788,6 +899,8 @@ void chain_plugin::connection_count_changed(uint32_t peer_count)
 
 bool chain_plugin::accept_block( const hive::chain::signed_block& block, bool currently_syncing, uint32_t skip )
 {
+  FC_ASSERT( !my->replica, "Read only replica can't accept blocks" );
+
   if (currently_syncing && block.block_num() % 10000 == 0) {
     ilog("Syncing Blockchain --- Got block: #${n} time: ${t} producer: ${p}",
         ("t", block.timestamp)
@@ -814,6 +927,8 @@ bool chain_plugin::accept_block( const hive::chain::signed_block& block, bool cu
 
 void chain_plugin::accept_transaction( const hive::chain::signed_transaction& trx )
 {
+  FC_ASSERT( !my->replica, "Read only replica can't accept transactions" );
+
   boost::promise< void > prom;
   write_context cxt;
   cxt.req_ptr = &trx;
@@ -834,6 +949,7 @@ hive::chain::signed_block chain_plugin::generate_block(
   const fc::ecc::private_key& block_signing_private_key,
   uint32_t skip )
 {
+  FC_ASSERT( !my->replica, "Read only replica can't generate blocks" );
   generate_block_request req( when, witness_owner, block_signing_private_key, skip );
   boost::promise< void > prom;
   write_context cxt;
@@ -26,7 +26,7 @@ class debug_node_plugin_impl
     virtual ~debug_node_plugin_impl();
 
     chain::database&                          _db;
-    boost::signals2::connection               _post_apply_block_conn;
+    hive::chain::util::notification_connection               _post_apply_block_conn;
 };
 
 debug_node_plugin_impl::debug_node_plugin_impl() :
@@ -39,8 +39,8 @@ class follow_plugin_impl
 
     chain::database&              _db;
     follow_plugin&                _self;
-    boost::signals2::connection   _pre_apply_operation_conn;
-    boost::signals2::connection   _post_apply_operation_conn;
+    hive::chain::util::notification_connection   _pre_apply_operation_conn;
+    hive::chain::util::notification_connection   _post_apply_operation_conn;
 };
 
 struct pre_operation_visitor
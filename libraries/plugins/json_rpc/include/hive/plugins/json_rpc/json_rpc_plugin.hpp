@@ -2,6 +2,8 @@
 #include <hive/chain/hive_fwd.hpp>
 #include <appbase/application.hpp>
 
+#include <hive/plugins/json_rpc/utility.hpp>
+
 #include <fc/variant.hpp>
 #include <fc/io/json.hpp>
 #include <fc/reflect/variant.hpp>
@@ -52,6 +54,7 @@
 #define JSON_RPC_NO_PARAMS          (-32001)
 #define JSON_RPC_PARSE_PARAMS_ERROR (-32002)
 #define JSON_RPC_ERROR_DURING_CALL  (-32003)
+#define JSON_RPC_SERVER_BUSY        (-32004)
 
 namespace hive { namespace plugins { namespace json_rpc {
 
@@ -80,6 +83,15 @@ struct api_method_signature
   fc::variant ret;
 };
 
+/**
+  * Should be called by API method while handling a call when its result depends only on irreversible
+  * data (f.e. block at or below last irreversible block). Such result is kept in response cache and
+  * subsequent calls of the same method with the same params are answered without calling the method.
+  * Applies only to the innermost api_call_scope, i.e. marking in API method called directly by other
+  * API method does not make response of the outer method cacheable.
+  */
+void mark_response_cacheable();
+
 namespace detail
 {
   class json_rpc_plugin_impl;
@@ -111,6 +123,22 @@ class json_rpc_plugin : public appbase::plugin< json_rpc_plugin >
 
 namespace detail {
 
+  /// Passes already serialized result of currently handled call to json_rpc (see serialized_result)
+  void set_serialized_result( std::shared_ptr< const std::string > json );
+
+  template< typename T >
+  fc::variant to_api_result( T&& result )
+  {
+    return fc::variant( std::forward< T >( result ) );
+  }
+
+  template< typename T >
+  fc::variant to_api_result( serialized_result< T >&& result )
+  {
+    set_serialized_result( std::move( result.json ) );
+    return fc::variant();
+  }
+
   class register_api_method_visitor
   {
     public:
@@ -130,7 +158,7 @@ namespace detail {
         _json_rpc_plugin.add_api_method( _api_name, method_name,
           [&plugin,method]( const fc::variant& args ) -> fc::variant
           {
-            return fc::variant( (plugin.*method)( args.as< Args >(), /* lock= */ true ) ); //lock=true means it will lock if not in DEFINE_LOCKLESS_API
+            return to_api_result( (plugin.*method)( args.as< Args >(), /* lock= */ true ) ); //lock=true means it will lock if not in DEFINE_LOCKLESS_API
           },
           api_method_signature{ fc::variant( Args() ), fc::variant( Ret() ) } );
       }
@@ -4,9 +4,15 @@
 
 #include <fc/reflect/reflect.hpp>
 #include <fc/macros.hpp>
+#include <fc/variant.hpp>
+#include <fc/io/json.hpp>
+
+#include <memory>
+#include <string>
 
 #include <boost/preprocessor/seq/for_each.hpp>
 #include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/tuple/elem.hpp>
 
 #define DECLARE_API_METHOD_HELPER( r, data, method ) \
 BOOST_PP_CAT( method, _return ) method( const BOOST_PP_CAT( method, _args )& args, bool lock = false );
@@ -51,6 +57,7 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
   }                                                                                                     \
   else                                                                                                  \
   {                                                                                                     \
+    hive::plugins::json_rpc::api_call_scope nested_call; /* called directly by other code */           \
     return my->method( args );                                                                         \
   }                                                                                                     \
 }
@@ -64,6 +71,23 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
   }                                                                                                     \
   else                                                                                                  \
   {                                                                                                     \
+    hive::plugins::json_rpc::api_call_scope nested_call; /* called directly by other code */           \
+    return my->method( args );                                                                         \
+  }                                                                                                     \
+}
+
+/// Read API that only takes read locks of lock domains given by DOMAINS expression (see chainbase::database::with_read_lock_in_domains)
+#define DEFINE_DOMAIN_READ_API_HELPER( r, class_and_domains, method )                                              \
+BOOST_PP_CAT( method, _return ) BOOST_PP_TUPLE_ELEM( 2, 0, class_and_domains ) :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
+{                                                                                                        \
+  if( lock )                                                                                            \
+  {                                                                                                     \
+    return my->_db.with_read_lock_in_domains( BOOST_PP_TUPLE_ELEM( 2, 1, class_and_domains ),           \
+      [&args, this](){ return my->method( args ); });                                                   \
+  }                                                                                                     \
+  else                                                                                                  \
+  {                                                                                                     \
+    hive::plugins::json_rpc::api_call_scope nested_call; /* called directly by other code */           \
     return my->method( args );                                                                         \
   }                                                                                                     \
 }
@@ -71,7 +95,9 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
 #define DEFINE_LOCKLESS_API_HELPER( r, class, method )                                                   \
 BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _args )& args, bool lock ) \
 {                                                                                                        \
-  FC_UNUSED( lock );                                                                                     \
+  if( lock )                                                                                            \
+    return my->method( args );                                                                         \
+  hive::plugins::json_rpc::api_call_scope nested_call; /* called directly by other code */             \
   return my->method( args );                                                                            \
 }
 
@@ -81,6 +107,9 @@ BOOST_PP_CAT( method, _return ) class :: method ( const BOOST_PP_CAT( method, _a
 #define DEFINE_WRITE_APIS( class, METHODS ) \
   BOOST_PP_SEQ_FOR_EACH( DEFINE_WRITE_API_HELPER, class, METHODS )
 
+#define DEFINE_DOMAIN_READ_APIS( class, DOMAINS, METHODS ) \
+  BOOST_PP_SEQ_FOR_EACH( DEFINE_DOMAIN_READ_API_HELPER, ( class, DOMAINS ), METHODS )
+
 #define DEFINE_LOCKLESS_APIS( class, METHODS ) \
   BOOST_PP_SEQ_FOR_EACH( DEFINE_LOCKLESS_API_HELPER, class, METHODS )
 
@@ -88,6 +117,64 @@ namespace hive { namespace plugins { namespace json_rpc {
 
 struct void_type {};
 
+/**
+  * Result of API method that was already written as JSON text. Methods returning big responses can
+  * produce JSON directly instead of building fc::variant tree, json_rpc puts the text into response
+  * (and response cache) as is. T is the type represented by the JSON - it is used for signature
+  * of the method and when the result is converted to variant by code that does not talk JSON.
+  */
+template< typename T >
+struct serialized_result
+{
+  std::shared_ptr< const std::string > json;
+};
+
+/**
+  * Collects what API method reports about its response (see mark_response_cacheable) while it is handled.
+  * json_rpc opens scope for every call it dispatches, API methods called directly (with lock = false, f.e.
+  * by other API method) get their own scope. Reports go to innermost scope of the thread, so f.e. cacheable
+  * result of nested call does not make response of the outer call cacheable.
+  */
+class api_call_scope
+{
+  public:
+    api_call_scope();
+    ~api_call_scope();
+
+    api_call_scope( const api_call_scope& ) = delete;
+    api_call_scope& operator=( const api_call_scope& ) = delete;
+
+    void mark_response_cacheable() { _response_cacheable = true; }
+    bool is_response_cacheable()const { return _response_cacheable; }
+
+    void set_serialized_result( std::shared_ptr< const std::string > json ) { _serialized_result = std::move( json ); }
+    std::shared_ptr< const std::string > take_serialized_result() { return std::move( _serialized_result ); }
+
+  private:
+    api_call_scope*                        _outer;
+    bool                                   _response_cacheable = false;
+    std::shared_ptr< const std::string >   _serialized_result;
+};
+
 } } } // hive::plugins::json_rpc
 
+namespace fc {
+
+template< typename T >
+void to_variant( const hive::plugins::json_rpc::serialized_result< T >& r, fc::variant& v )
+{
+  if( r.json )
+    v = fc::json::from_string( *r.json );
+  else
+    v = fc::variant( T() );
+}
+
+template< typename T >
+void from_variant( const fc::variant& v, hive::plugins::json_rpc::serialized_result< T >& r )
+{
+  r.json = std::make_shared< const std::string >( fc::json::to_string( v ) );
+}
+
+}
+
 FC_REFLECT( hive::plugins::json_rpc::void_type, )
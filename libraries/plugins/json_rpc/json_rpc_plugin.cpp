@@ -1,23 +1,38 @@
 #include <hive/plugins/json_rpc/json_rpc_plugin.hpp>
 #include <hive/plugins/json_rpc/utility.hpp>
 
-#include <hive/plugins/statsd/utility.hpp>
+#include <hive/plugins/statsd/metrics.hpp>
 
 #include <boost/algorithm/string.hpp>
 
 #include <fc/log/logger_config.hpp>
+#include <fc/string.hpp>
 #include <fc/exception/exception.hpp>
 #include <fc/macros.hpp>
 #include <fc/io/fstream.hpp>
 
 #include <chainbase/chainbase.hpp>
 
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 #define ENABLE_JSON_RPC_LOG
 
+#ifndef HIVE_JSON_RPC_CACHE_SHARDS
+  #define HIVE_JSON_RPC_CACHE_SHARDS 16
+#endif
+
 namespace hive { namespace plugins { namespace json_rpc {
 
 namespace detail
 {
+  using hive::plugins::statsd::metrics_registry;
+  using hive::plugins::statsd::histogram_metric;
+  using hive::plugins::statsd::counter_metric;
+  using hive::plugins::statsd::scoped_timer;
+
   struct json_rpc_error
   {
     json_rpc_error()
@@ -37,6 +52,8 @@ namespace detail
     fc::optional< fc::variant >      result;
     fc::optional< json_rpc_error >   error;
     fc::variant                      id;
+
+    std::shared_ptr< const std::string > serialized_result; ///< already serialized result (from response cache), not reflected
   };
 
   typedef void_type             get_methods_args;
@@ -49,6 +66,159 @@ namespace detail
 
   typedef api_method_signature  get_signature_return;
 
+  typedef void_type             get_cache_stats_args;
+
+  struct get_cache_stats_return
+  {
+    uint64_t capacity = 0; ///< maximum size of cached responses in bytes (0 when cache is disabled)
+    uint64_t size = 0;
+    uint64_t entries = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  std::string to_json( const json_rpc_response& response )
+  {
+    if( !response.serialized_result )
+      return fc::json::to_string( response );
+
+    std::string result = "{\"jsonrpc\":\"2.0\",\"result\":";
+    result.reserve( result.size() + response.serialized_result->size() + 32 );
+    result += *response.serialized_result;
+    result += ",\"id\":";
+    result += fc::json::to_string( response.id );
+    result += '}';
+    return result;
+  }
+
+  /// Sorts keys of all objects, so params that differ only in order of members give the same cache key
+  fc::variant canonical_params( const fc::variant& v )
+  {
+    if( v.is_object() )
+    {
+      const auto& obj = v.get_object();
+      std::vector< std::pair< std::string, fc::variant > > members;
+      members.reserve( obj.size() );
+      for( const auto& entry : obj )
+        members.emplace_back( entry.key(), canonical_params( entry.value() ) );
+      std::sort( members.begin(), members.end(),
+        []( const std::pair< std::string, fc::variant >& a, const std::pair< std::string, fc::variant >& b ) { return a.first < b.first; } );
+
+      fc::mutable_variant_object result;
+      for( auto& member : members )
+        result( member.first, std::move( member.second ) );
+      return fc::variant( std::move( result ) );
+    }
+    else if( v.is_array() )
+    {
+      const auto& arr = v.get_array();
+      fc::variants result;
+      result.reserve( arr.size() );
+      for( const auto& item : arr )
+        result.push_back( canonical_params( item ) );
+      return fc::variant( std::move( result ) );
+    }
+    return v;
+  }
+
+  thread_local api_call_scope* current_call_scope = nullptr;
+
+  /**
+    * Size bounded LRU cache of serialized results of API calls that depend only on irreversible data.
+    * Entries are spread over independently locked shards, so concurrent API threads rarely contend.
+    */
+  class response_cache
+  {
+    public:
+      typedef std::shared_ptr< const std::string > value_type;
+
+      explicit response_cache( uint64_t capacity ) : _capacity( capacity ), _shard_capacity( capacity / HIVE_JSON_RPC_CACHE_SHARDS ) {}
+
+      value_type find( const std::string& key )
+      {
+        auto& shard = get_shard( key );
+        std::lock_guard< std::mutex > guard( shard.mutex );
+
+        auto found = shard.lookup.find( key );
+        if( found == shard.lookup.end() )
+        {
+          ++_misses;
+          return value_type();
+        }
+
+        shard.entries.splice( shard.entries.begin(), shard.entries, found->second );
+        ++_hits;
+        return found->second->second;
+      }
+
+      void insert( const std::string& key, const value_type& value )
+      {
+        uint64_t entry_size = key.size() + value->size();
+        if( entry_size > _shard_capacity )
+          return;
+
+        auto& shard = get_shard( key );
+        std::lock_guard< std::mutex > guard( shard.mutex );
+
+        if( shard.lookup.count( key ) )
+          return; // other thread was faster
+
+        shard.entries.emplace_front( key, value );
+        shard.lookup.emplace( key, shard.entries.begin() );
+        shard.size += entry_size;
+
+        while( shard.size > _shard_capacity )
+        {
+          const auto& oldest = shard.entries.back();
+          shard.size -= oldest.first.size() + oldest.second->size();
+          shard.lookup.erase( oldest.first );
+          shard.entries.pop_back();
+          ++_evictions;
+        }
+      }
+
+      get_cache_stats_return get_stats()
+      {
+        get_cache_stats_return result;
+        result.capacity = _capacity;
+        for( auto& shard : _shards )
+        {
+          std::lock_guard< std::mutex > guard( shard.mutex );
+          result.size += shard.size;
+          result.entries += shard.entries.size();
+        }
+        result.hits = _hits.load();
+        result.misses = _misses.load();
+        result.evictions = _evictions.load();
+        return result;
+      }
+
+    private:
+      typedef std::list< std::pair< std::string, value_type > > entry_list;
+
+      struct shard_type
+      {
+        std::mutex                                                mutex;
+        entry_list                                                entries; ///< most recently used first
+        std::unordered_map< std::string, entry_list::iterator >  lookup;
+        uint64_t                                                  size = 0;
+      };
+
+      shard_type& get_shard( const std::string& key )
+      {
+        return _shards[ std::hash< std::string >()( key ) % HIVE_JSON_RPC_CACHE_SHARDS ];
+      }
+
+      const uint64_t                        _capacity;
+      const uint64_t                        _shard_capacity;
+      std::array< shard_type, HIVE_JSON_RPC_CACHE_SHARDS > _shards;
+
+      std::atomic< uint64_t >               _hits = { 0 };
+      std::atomic< uint64_t >               _misses = { 0 };
+      std::atomic< uint64_t >               _evictions = { 0 };
+  };
+
   class json_rpc_logger
   {
   public:
@@ -144,6 +314,9 @@ namespace detail
       map< string, api_description >                     _registered_apis;
       vector< string >                                   _methods;
       map< string, map< string, api_method_signature > > _method_sigs;
+      map< string, histogram_metric* >                   _method_times;
+      /// set when method returns first cacheable response - other methods are not looked up in response cache
+      map< string, std::unique_ptr< std::atomic< bool > > > _method_cacheable;
     } data, proxy_data;
 
     public:
@@ -165,14 +338,29 @@ namespace detail
       void log(const fc::variant_object& request, json_rpc_response& response)
       {
         if (_logger)
+        {
+          if( response.serialized_result && !response.result.valid() )
+            response.result = fc::json::from_string( *response.serialized_result );
           _logger->log(request, response);
+        }
       }
 
       DECLARE_API(
         (get_methods)
-        (get_signature) )
+        (get_signature)
+        (get_cache_stats) )
 
       std::unique_ptr< json_rpc_logger >                 _logger;
+      std::unique_ptr< response_cache >                  _cache;
+
+      histogram_metric& _call_time           = metrics_registry::instance().histogram( "jsonrpc.overhead.call", "Total time of handling API request in microseconds" );
+      histogram_metric& _total_time          = metrics_registry::instance().histogram( "jsonrpc.overhead.total", "Time of handling single JSON-RPC message in microseconds" );
+      histogram_metric& _find_api_method_time = metrics_registry::instance().histogram( "jsonrpc.overhead.find_api_method", "Time of API method lookup in microseconds" );
+      histogram_metric& _process_params_time = metrics_registry::instance().histogram( "jsonrpc.overhead.process_params", "Time of processing request params in microseconds" );
+      histogram_metric& _rpc_id_time         = metrics_registry::instance().histogram( "jsonrpc.overhead.rpc_id", "Time of processing request id in microseconds" );
+      histogram_metric& _rpc_jsonrpc_time    = metrics_registry::instance().histogram( "jsonrpc.overhead.rpc_jsonrpc", "Time of dispatching JSON-RPC message in microseconds" );
+      counter_metric&   _cache_hits          = metrics_registry::instance().counter( "jsonrpc.cache.hit", "Number of API calls answered from response cache" );
+      counter_metric&   _cache_misses        = metrics_registry::instance().counter( "jsonrpc.cache.miss", "Number of API calls not found in response cache" );
   };
 
   json_rpc_plugin_impl::json_rpc_plugin_impl() {}
@@ -186,6 +374,9 @@ namespace detail
     std::stringstream canonical_name;
     canonical_name << api_name << '.' << method_name;
     proxy_data._methods.push_back( canonical_name.str() );
+    proxy_data._method_times[ canonical_name.str() ] = &metrics_registry::instance().histogram(
+      "jsonrpc.api." + canonical_name.str(), "Time of executing " + canonical_name.str() + " in microseconds" );
+    proxy_data._method_cacheable[ canonical_name.str() ].reset( new std::atomic< bool >( false ) );
   }
 
   void json_rpc_plugin_impl::plugin_finalize_startup()
@@ -195,6 +386,8 @@ namespace detail
     data._registered_apis = std::move( proxy_data._registered_apis );
     data._methods         = std::move( proxy_data._methods );
     data._method_sigs     = std::move( proxy_data._method_sigs );
+    data._method_times    = std::move( proxy_data._method_times );
+    data._method_cacheable = std::move( proxy_data._method_cacheable );
   }
 
   void json_rpc_plugin_impl::plugin_pre_shutdown()
@@ -202,6 +395,8 @@ namespace detail
     data._registered_apis.clear();
     data._methods.clear();
     data._method_sigs.clear();
+    data._method_times.clear();
+    data._method_cacheable.clear();
   }
 
   void json_rpc_plugin_impl::initialize()
@@ -231,9 +426,17 @@ namespace detail
     return method_itr->second;
   }
 
+  get_cache_stats_return json_rpc_plugin_impl::get_cache_stats( const get_cache_stats_args& args, bool lock )
+  {
+    FC_UNUSED( lock )
+    if( !_cache )
+      return get_cache_stats_return();
+    return _cache->get_stats();
+  }
+
   api_method* json_rpc_plugin_impl::find_api_method( const std::string& api, const std::string& method )
   {
-    STATSD_START_TIMER( "jsonrpc", "overhead", "find_api_method", 1.0f );
+    scoped_timer timer( _find_api_method_time );
     auto api_itr = data._registered_apis.find( api );
     FC_ASSERT( api_itr != data._registered_apis.end(), "Could not find API ${api}", ("api", api) );
 
@@ -245,7 +448,7 @@ namespace detail
 
   api_method* json_rpc_plugin_impl::process_params( string method, const fc::variant_object& request, fc::variant& func_args, string* method_name )
   {
-    STATSD_START_TIMER( "jsonrpc", "overhead", "process_params", 1.0f );
+    scoped_timer timer( _process_params_time );
     api_method* ret = nullptr;
 
     if( method == "call" )
@@ -287,7 +490,7 @@ namespace detail
 
   void json_rpc_plugin_impl::rpc_id( const fc::variant_object& request, json_rpc_response& response )
   {
-    STATSD_START_TIMER( "jsonrpc", "overhead", "rpc_id", 1.0f );
+    scoped_timer timer( _rpc_id_time );
     if( request.contains( "id" ) )
     {
       const fc::variant& _id = request[ "id" ];
@@ -308,7 +511,7 @@ namespace detail
 
   void json_rpc_plugin_impl::rpc_jsonrpc( const fc::variant_object& request, json_rpc_response& response )
   {
-    STATSD_START_TIMER( "jsonrpc", "overhead", "rpc_jsonrpc", 1.0f );
+    scoped_timer timer( _rpc_jsonrpc_time );
     if( request.contains( "jsonrpc" ) && request[ "jsonrpc" ].is_string() && request[ "jsonrpc" ].as_string() == "2.0" )
     {
       if( request.contains( "method" ) && request[ "method" ].is_string() )
@@ -337,8 +540,43 @@ namespace detail
             {
               if( call )
               {
-                STATSD_START_TIMER( "jsonrpc", "api", method_name, 1.0f );
-                response.result = (*call)( func_args );
+                std::string cache_key;
+                std::atomic< bool >& method_cacheable = *data._method_cacheable.at( method_name );
+                if( _cache && method_cacheable.load( std::memory_order_relaxed ) )
+                {
+                  cache_key = method_name + fc::json::to_string( canonical_params( func_args ) );
+                  response.serialized_result = _cache->find( cache_key );
+                  if( response.serialized_result )
+                    _cache_hits.increment();
+                  else
+                    _cache_misses.increment();
+                }
+
+                if( !response.serialized_result )
+                {
+                  scoped_timer api_timer( *data._method_times.at( method_name ) );
+                  api_call_scope call_scope;
+                  response.result = (*call)( func_args );
+
+                  response.serialized_result = call_scope.take_serialized_result();
+                  if( response.serialized_result )
+                    response.result.reset();
+
+                  if( _cache && call_scope.is_response_cacheable() )
+                  {
+                    if( cache_key.empty() )
+                    {
+                      method_cacheable.store( true, std::memory_order_relaxed );
+                      cache_key = method_name + fc::json::to_string( canonical_params( func_args ) );
+                    }
+                    if( !response.serialized_result )
+                    {
+                      response.serialized_result = std::make_shared< const std::string >( fc::json::to_string( *response.result ) );
+                      response.result.reset();
+                    }
+                    _cache->insert( cache_key, response.serialized_result );
+                  }
+                }
               }
             }
             catch( chainbase::lock_exception& e )
@@ -379,7 +617,7 @@ namespace detail
 
     ddump( (message) );
 
-    STATSD_START_TIMER( "jsonrpc", "overhead", "total", 1.0f );
+    scoped_timer timer( _total_time );
 
     try
     {
@@ -442,6 +680,8 @@ void json_rpc_plugin::set_program_options( options_description& , options_descri
 {
   cfg.add_options()
     ("log-json-rpc", bpo::value< string >(), "json-rpc log directory name.")
+    ("rpc-response-cache-size", bpo::value< string >()->default_value( "64M" ),
+      "Size of cache for responses of API calls referring only to irreversible data (f.e. blocks). 0 disables the cache." )
     ;
 }
 
@@ -460,6 +700,10 @@ void json_rpc_plugin::plugin_initialize( const variables_map& options )
     fc::create_directories(p);
     my->_logger.reset(new json_rpc_logger(dir_name));
   }
+
+  uint64_t cache_size = fc::parse_size( options.at( "rpc-response-cache-size" ).as< string >() );
+  if( cache_size > 0 )
+    my->_cache.reset( new detail::response_cache( cache_size ) );
 }
 
 void json_rpc_plugin::plugin_startup() {}
@@ -483,7 +727,7 @@ void json_rpc_plugin::add_api_method( const string& api_name, const string& meth
 
 string json_rpc_plugin::call( const string& message )
 {
-  STATSD_START_TIMER( "jsonrpc", "overhead", "call", 1.0f );
+  hive::plugins::statsd::scoped_timer timer( my->_call_time );
   try
   {
     fc::variant v = fc::json::from_string( message );
@@ -500,7 +744,15 @@ string json_rpc_plugin::call( const string& message )
         for( auto& m : messages )
           responses.push_back( my->rpc( m ) );
 
-        return fc::json::to_string( responses );
+        std::string result = "[";
+        for( size_t i = 0; i < responses.size(); ++i )
+        {
+          if( i > 0 )
+            result += ',';
+          result += detail::to_json( responses[i] );
+        }
+        result += ']';
+        return result;
       }
       else
       {
@@ -512,7 +764,7 @@ string json_rpc_plugin::call( const string& message )
     }
     else
     {
-      return fc::json::to_string( my->rpc( v ) );
+      return detail::to_json( my->rpc( v ) );
     }
   }
   catch( fc::exception& e )
@@ -531,9 +783,32 @@ string json_rpc_plugin::call( const string& message )
 
 }
 
+api_call_scope::api_call_scope() : _outer( detail::current_call_scope )
+{
+  detail::current_call_scope = this;
+}
+
+api_call_scope::~api_call_scope()
+{
+  detail::current_call_scope = _outer;
+}
+
+void mark_response_cacheable()
+{
+  if( detail::current_call_scope != nullptr )
+    detail::current_call_scope->mark_response_cacheable();
+}
+
+void detail::set_serialized_result( std::shared_ptr< const std::string > json )
+{
+  if( detail::current_call_scope != nullptr )
+    detail::current_call_scope->set_serialized_result( std::move( json ) );
+}
+
 } } } // hive::plugins::json_rpc
 
 FC_REFLECT( hive::plugins::json_rpc::detail::json_rpc_error, (code)(message)(data) )
 FC_REFLECT( hive::plugins::json_rpc::detail::json_rpc_response, (jsonrpc)(result)(error)(id) )
 
 FC_REFLECT( hive::plugins::json_rpc::detail::get_signature_args, (method) )
+FC_REFLECT( hive::plugins::json_rpc::detail::get_cache_stats_return, (capacity)(size)(entries)(hits)(misses)(evictions) )
@@ -22,6 +22,9 @@
 #define HIVE_MARKET_HISTORY_PLUGIN_NAME "market_history"
 #endif
 
+// lock domain of market history indices, so API reads of them don't wait for unrelated block processing
+#define HIVE_MARKET_HISTORY_LOCK_DOMAIN "market_history"
+
 
 namespace hive { namespace plugins { namespace market_history {
 
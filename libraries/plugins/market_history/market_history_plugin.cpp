@@ -33,7 +33,7 @@ class market_history_plugin_impl
     chain::database&     _db;
     flat_set<uint32_t>            _tracked_buckets = flat_set<uint32_t>  { 15, 60, 300, 3600, 86400 };
     int32_t                       _maximum_history_per_bucket_size = 1000;
-    boost::signals2::connection   _post_apply_operation_conn;
+    hive::chain::util::notification_connection   _post_apply_operation_conn;
 };
 
 void market_history_plugin_impl::on_post_apply_operation( const operation_notification& o )
@@ -170,9 +170,10 @@ void market_history_plugin::plugin_initialize( const boost::program_options::var
     ilog( "market_history: plugin_initialize() begin" );
     my = std::make_unique< detail::market_history_plugin_impl >();
 
-    my->_post_apply_operation_conn = my->_db.add_post_apply_operation_handler( [&]( const operation_notification& note ){ my->on_post_apply_operation( note ); }, *this, 0 );
-    HIVE_ADD_PLUGIN_INDEX(my->_db, bucket_index);
-    HIVE_ADD_PLUGIN_INDEX(my->_db, order_history_index);
+    my->_post_apply_operation_conn = my->_db.add_post_apply_operation_handler( [&]( const operation_notification& note ){ my->on_post_apply_operation( note ); }, *this, 0,
+      database::operation_tags< fill_order_operation >() );
+    HIVE_ADD_PLUGIN_INDEX_IN_LOCK_DOMAIN(my->_db, bucket_index, HIVE_MARKET_HISTORY_LOCK_DOMAIN);
+    HIVE_ADD_PLUGIN_INDEX_IN_LOCK_DOMAIN(my->_db, order_history_index, HIVE_MARKET_HISTORY_LOCK_DOMAIN);
 
     fc::mutable_variant_object state_opts;
 
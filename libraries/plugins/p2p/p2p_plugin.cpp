@@ -1,6 +1,6 @@
 #include <hive/plugins/p2p/p2p_plugin.hpp>
 #include <hive/plugins/p2p/p2p_default_seeds.hpp>
-#include <hive/plugins/statsd/utility.hpp>
+#include <hive/plugins/statsd/metrics.hpp>
 
 #include <graphene/net/node.hpp>
 #include <graphene/net/exceptions.hpp>
@@ -178,8 +178,10 @@ bool p2p_plugin_impl::handle_block( const graphene::net::block_message& blk_msg,
 
       if( !sync_mode )
       {
+        static hive::plugins::statsd::histogram_metric& block_arrival = hive::plugins::statsd::metrics_registry::instance().histogram(
+          "p2p.offset.block_arrival", "Time between block timestamp and its arrival from network in microseconds" );
         fc::microseconds offset = fc::time_point::now() - blk_msg.block.timestamp;
-        STATSD_TIMER( "p2p", "offset", "block_arrival", offset, 1.0f )
+        block_arrival.record( offset );
         ilog( "Got ${t} transactions on block ${b} by ${w} -- Block Time Offset: ${l} ms",
           ("t", blk_msg.block.transactions.size())
           ("b", blk_msg.block.block_num())
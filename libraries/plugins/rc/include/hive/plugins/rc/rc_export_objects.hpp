@@ -41,6 +41,7 @@ struct exp_rc_data
   virtual ~exp_rc_data();
 
   virtual void to_variant( fc::variant& v )const override;
+  virtual void pack( std::vector< char >& data )const override;
 
   rc_block_info                          block_info;
   std::vector< rc_transaction_info >     tx_info;
@@ -15,6 +15,8 @@
 
 #include <hive/jsonball/jsonball.hpp>
 
+#include <fc/io/raw.hpp>
+
 #include <boost/algorithm/string.hpp>
 
 #define HIVE_RC_REGEN_TIME   (60*60*24*5)
@@ -81,15 +83,15 @@ class rc_plugin_impl
     std::set< account_name_type > _whitelist;
 #endif
 
-    boost::signals2::connection   _pre_reindex_conn;
-    boost::signals2::connection   _post_reindex_conn;
-    boost::signals2::connection   _post_apply_block_conn;
-    boost::signals2::connection   _pre_apply_transaction_conn;
-    boost::signals2::connection   _post_apply_transaction_conn;
-    boost::signals2::connection   _pre_apply_operation_conn;
-    boost::signals2::connection   _post_apply_operation_conn;
-    boost::signals2::connection   _pre_apply_optional_action_conn;
-    boost::signals2::connection   _post_apply_optional_action_conn;
+    hive::chain::util::notification_connection   _pre_reindex_conn;
+    hive::chain::util::notification_connection   _post_reindex_conn;
+    hive::chain::util::notification_connection   _post_apply_block_conn;
+    hive::chain::util::notification_connection   _pre_apply_transaction_conn;
+    hive::chain::util::notification_connection   _post_apply_transaction_conn;
+    hive::chain::util::notification_connection   _pre_apply_operation_conn;
+    hive::chain::util::notification_connection   _post_apply_operation_conn;
+    hive::chain::util::notification_connection   _pre_apply_optional_action_conn;
+    hive::chain::util::notification_connection   _post_apply_optional_action_conn;
 };
 
 inline int64_t get_next_vesting_withdrawal( const account_object& account )
@@ -1282,6 +1284,12 @@ void exp_rc_data::to_variant( fc::variant& v )const
   fc::to_variant( *this, v );
 }
 
+void exp_rc_data::pack( std::vector< char >& data )const
+{
+  std::vector< char > packed = fc::raw::pack_to_vector( *this );
+  data.insert( data.end(), packed.begin(), packed.end() );
+}
+
 int64_t get_maximum_rc( const account_object& account, const rc_account_object& rc_account )
 {
   int64_t result = account.vesting_shares.amount.value;
@@ -37,8 +37,8 @@ class reputation_plugin_impl
 
     chain::database&              _db;
     reputation_plugin&            _self;
-    boost::signals2::connection   _pre_apply_operation_conn;
-    boost::signals2::connection   _post_apply_operation_conn;
+    hive::chain::util::notification_connection   _pre_apply_operation_conn;
+    hive::chain::util::notification_connection   _post_apply_operation_conn;
 };
 
 struct pre_operation_visitor
@@ -203,8 +203,11 @@ void reputation_plugin::plugin_initialize( const boost::program_options::variabl
 
     my = std::make_unique< detail::reputation_plugin_impl >( *this );
 
-    my->_pre_apply_operation_conn = my->_db.add_pre_apply_operation_handler( [&]( const operation_notification& note ){ my->pre_operation( note ); }, *this, 0 );
-    my->_post_apply_operation_conn = my->_db.add_post_apply_operation_handler( [&]( const operation_notification& note ){ my->post_operation( note ); }, *this, 0 );
+    // only votes affect reputation
+    my->_pre_apply_operation_conn = my->_db.add_pre_apply_operation_handler( [&]( const operation_notification& note ){ my->pre_operation( note ); }, *this, 0,
+      database::operation_tags< vote_operation >() );
+    my->_post_apply_operation_conn = my->_db.add_post_apply_operation_handler( [&]( const operation_notification& note ){ my->post_operation( note ); }, *this, 0,
+      database::operation_tags< vote_operation >() );
     HIVE_ADD_PLUGIN_INDEX(my->_db, reputation_index);
 
     appbase::app().get_plugin< chain::chain_plugin >().report_state_options( name(), fc::variant_object() );
@@ -1236,6 +1236,9 @@ void state_snapshot_plugin::impl::prepare_snapshot(const std::string& snapshotNa
 
   ilog("Request to generate snapshot in the location: `${p}'", ("p", actualStoragePath.string()));
 
+  FC_ASSERT(_mainDb.get_comment_archive() == nullptr,
+    "Snapshot cannot be created while comment archive is in use - archived comments are not part of the snapshot. Creating snapshot rejected.");
+
   if(bfs::exists(actualStoragePath) == false)
     bfs::create_directories(actualStoragePath);
   else
@@ -1319,6 +1322,9 @@ void state_snapshot_plugin::impl::load_snapshot(const std::string& snapshotName,
 
   ilog("Trying to access snapshot in the location: `${p}'", ("p", actualStoragePath.string()));
 
+  FC_ASSERT(openArgs.comment_archive == false && _mainDb.get_comment_archive() == nullptr,
+    "Snapshot cannot be loaded while comment archive is in use - disable `comment-archive' and remove comment archive storage first.");
+
   benchmark_dumper dumper;
   dumper.initialize([](benchmark_dumper::database_object_sizeof_cntr_t&) {}, "state_snapshot_load.json");
 
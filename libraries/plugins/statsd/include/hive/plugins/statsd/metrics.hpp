@@ -0,0 +1,194 @@
+#pragma once
+
+#include <fc/time.hpp>
+
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef HIVE_METRICS_STRIPES
+  #define HIVE_METRICS_STRIPES 8
+#endif
+
+namespace hive { namespace plugins { namespace statsd {
+
+/* Registry of pre-registered metrics. Unlike statsd_plugin calls, recording a value in a metric
+  * handle does not build any strings nor send anything - it is a single relaxed atomic operation
+  * on a cache line that is (most likely) used only by the current thread. Values are aggregated
+  * over all threads only when they are exported (periodically to statsd by statsd_plugin or on
+  * request as Prometheus text by webserver), so instrumentation can stay enabled all the time.
+  *
+  * Handles are registered once (usually into static reference or member during initialization)
+  * and stay valid for the lifetime of the process. Metric names use statsd convention
+  * "namespace.stat.key".
+  */
+
+namespace detail
+{
+  /// Index of accumulation stripe used by the current thread
+  inline uint32_t metrics_stripe()
+  {
+    static std::atomic< uint32_t > next_stripe{ 0 };
+    thread_local uint32_t stripe = next_stripe++ % HIVE_METRICS_STRIPES;
+    return stripe;
+  }
+
+  struct alignas( 64 ) padded_counter
+  {
+    std::atomic< int64_t > value{ 0 };
+  };
+}
+
+enum class metric_type
+{
+  counter,
+  gauge,
+  histogram
+};
+
+class metric
+{
+  public:
+    metric( const std::string& _name, const std::string& _description, metric_type _type ) :
+      name( _name ), description( _description ), type( _type ) {}
+    virtual ~metric() {}
+
+    const std::string name;
+    const std::string description;
+    const metric_type type;
+};
+
+/// Monotonic counter
+class counter_metric : public metric
+{
+  public:
+    counter_metric( const std::string& name, const std::string& description ) : metric( name, description, metric_type::counter ) {}
+
+    void increment( int64_t delta = 1 )
+    {
+      _stripes[ detail::metrics_stripe() ].value.fetch_add( delta, std::memory_order_relaxed );
+    }
+
+    int64_t value()const;
+
+  private:
+    std::array< detail::padded_counter, HIVE_METRICS_STRIPES > _stripes;
+};
+
+/// Current value of something (size of a queue, number of connections etc.)
+class gauge_metric : public metric
+{
+  public:
+    gauge_metric( const std::string& name, const std::string& description ) : metric( name, description, metric_type::gauge ) {}
+
+    void set( int64_t value ) { _value.store( value, std::memory_order_relaxed ); }
+    void add( int64_t delta ) { _value.fetch_add( delta, std::memory_order_relaxed ); }
+    int64_t value()const { return _value.load( std::memory_order_relaxed ); }
+
+  private:
+    std::atomic< int64_t > _value{ 0 };
+};
+
+/* Latency histogram with log-linear buckets (HDR-style): each power of two range is split into
+  * 4 sub-buckets, which gives at most 25% relative error of reported percentiles. Values are
+  * microseconds (or any other unsigned quantity), values above 2^40 are clamped.
+  */
+class histogram_metric : public metric
+{
+  public:
+    enum : uint32_t
+    {
+      sub_bucket_bits = 2,
+      sub_buckets     = 1 << sub_bucket_bits,
+      max_value_bits  = 40,
+      bucket_count    = ( max_value_bits - sub_bucket_bits + 1 ) * sub_buckets
+    };
+
+    struct snapshot
+    {
+      std::array< uint64_t, bucket_count > buckets = {};
+      uint64_t count = 0;
+      uint64_t sum = 0;
+
+      /// Value below which given fraction (0..1) of samples falls (upper bound of the bucket)
+      uint64_t percentile( double fraction )const;
+      uint64_t max()const;
+
+      /// Returns values recorded since given (earlier) snapshot of the same histogram
+      snapshot operator-( const snapshot& earlier )const;
+    };
+
+    histogram_metric( const std::string& name, const std::string& description ) : metric( name, description, metric_type::histogram ) {}
+
+    void record( uint64_t value )
+    {
+      auto& stripe = _stripes[ detail::metrics_stripe() ];
+      stripe.buckets[ bucket_index( value ) ].fetch_add( 1, std::memory_order_relaxed );
+      stripe.sum.fetch_add( value, std::memory_order_relaxed );
+    }
+
+    void record( const fc::microseconds& duration )
+    {
+      record( duration.count() > 0 ? uint64_t( duration.count() ) : 0 );
+    }
+
+    snapshot get_snapshot()const;
+
+    static uint32_t bucket_index( uint64_t value );
+    /// Exclusive upper bound of values that fall into given bucket
+    static uint64_t bucket_upper_bound( uint32_t index );
+
+  private:
+    struct alignas( 64 ) stripe
+    {
+      std::array< std::atomic< uint64_t >, bucket_count > buckets = {};
+      std::atomic< uint64_t >                             sum{ 0 };
+    };
+
+    std::array< stripe, HIVE_METRICS_STRIPES > _stripes;
+};
+
+/// Records time from construction to destruction in given histogram
+class scoped_timer
+{
+  public:
+    explicit scoped_timer( histogram_metric& histogram ) : _histogram( histogram ), _start( fc::time_point::now() ) {}
+    ~scoped_timer() { _histogram.record( fc::time_point::now() - _start ); }
+
+  private:
+    histogram_metric& _histogram;
+    fc::time_point    _start;
+};
+
+class metrics_registry
+{
+  public:
+    static metrics_registry& instance();
+
+    /// Registers new metric or returns already registered one with the same name (type has to match)
+    counter_metric&   counter( const std::string& name, const std::string& description );
+    gauge_metric&     gauge( const std::string& name, const std::string& description );
+    histogram_metric& histogram( const std::string& name, const std::string& description );
+
+    /// All registered metrics in order of registration
+    std::vector< const metric* > get_metrics()const;
+
+    /// Current values of all metrics in Prometheus text exposition format
+    std::string to_prometheus()const;
+
+  private:
+    metrics_registry() {}
+
+    template< typename MetricType >
+    MetricType& register_metric( const std::string& name, const std::string& description, metric_type type );
+
+    mutable std::mutex                         _mutex;
+    std::vector< std::unique_ptr< metric > >   _metrics;
+    std::map< std::string, metric* >           _by_name;
+};
+
+} } } // hive::plugins::statsd
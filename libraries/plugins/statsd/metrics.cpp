@@ -0,0 +1,205 @@
+#include <hive/plugins/statsd/metrics.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <cctype>
+#include <sstream>
+
+namespace hive { namespace plugins { namespace statsd {
+
+int64_t counter_metric::value()const
+{
+  int64_t result = 0;
+  for( const auto& stripe : _stripes )
+    result += stripe.value.load( std::memory_order_relaxed );
+  return result;
+}
+
+uint32_t histogram_metric::bucket_index( uint64_t value )
+{
+  if( value < sub_buckets )
+    return uint32_t( value );
+  if( value >= ( uint64_t( 1 ) << max_value_bits ) )
+    value = ( uint64_t( 1 ) << max_value_bits ) - 1;
+
+  uint32_t msb = 63 - __builtin_clzll( value );
+  uint32_t sub = ( value >> ( msb - sub_bucket_bits ) ) & ( sub_buckets - 1 );
+  return ( msb - sub_bucket_bits + 1 ) * sub_buckets + sub;
+}
+
+uint64_t histogram_metric::bucket_upper_bound( uint32_t index )
+{
+  if( index < sub_buckets )
+    return index + 1;
+
+  uint32_t shift = index / sub_buckets - 1;
+  uint64_t lower = uint64_t( sub_buckets + index % sub_buckets ) << shift;
+  return lower + ( uint64_t( 1 ) << shift );
+}
+
+histogram_metric::snapshot histogram_metric::get_snapshot()const
+{
+  snapshot result;
+  for( const auto& stripe : _stripes )
+  {
+    for( uint32_t i = 0; i < bucket_count; ++i )
+    {
+      uint64_t n = stripe.buckets[i].load( std::memory_order_relaxed );
+      result.buckets[i] += n;
+      result.count += n;
+    }
+    result.sum += stripe.sum.load( std::memory_order_relaxed );
+  }
+  return result;
+}
+
+uint64_t histogram_metric::snapshot::percentile( double fraction )const
+{
+  if( count == 0 )
+    return 0;
+
+  uint64_t threshold = uint64_t( fraction * count );
+  if( threshold == 0 )
+    threshold = 1;
+
+  uint64_t cumulative = 0;
+  for( uint32_t i = 0; i < bucket_count; ++i )
+  {
+    cumulative += buckets[i];
+    if( cumulative >= threshold )
+      return bucket_upper_bound( i ) - 1;
+  }
+  return bucket_upper_bound( bucket_count - 1 ) - 1;
+}
+
+uint64_t histogram_metric::snapshot::max()const
+{
+  for( uint32_t i = bucket_count; i > 0; --i )
+  {
+    if( buckets[ i - 1 ] )
+      return bucket_upper_bound( i - 1 ) - 1;
+  }
+  return 0;
+}
+
+histogram_metric::snapshot histogram_metric::snapshot::operator-( const snapshot& earlier )const
+{
+  snapshot result;
+  for( uint32_t i = 0; i < bucket_count; ++i )
+    result.buckets[i] = buckets[i] - earlier.buckets[i];
+  result.count = count - earlier.count;
+  result.sum = sum - earlier.sum;
+  return result;
+}
+
+metrics_registry& metrics_registry::instance()
+{
+  static metrics_registry registry;
+  return registry;
+}
+
+template< typename MetricType >
+MetricType& metrics_registry::register_metric( const std::string& name, const std::string& description, metric_type type )
+{
+  std::lock_guard< std::mutex > guard( _mutex );
+
+  auto itr = _by_name.find( name );
+  if( itr != _by_name.end() )
+  {
+    FC_ASSERT( itr->second->type == type, "Metric ${n} already registered with different type", ("n", name) );
+    return static_cast< MetricType& >( *itr->second );
+  }
+
+  _metrics.emplace_back( new MetricType( name, description ) );
+  _by_name[ name ] = _metrics.back().get();
+  return static_cast< MetricType& >( *_metrics.back() );
+}
+
+counter_metric& metrics_registry::counter( const std::string& name, const std::string& description )
+{
+  return register_metric< counter_metric >( name, description, metric_type::counter );
+}
+
+gauge_metric& metrics_registry::gauge( const std::string& name, const std::string& description )
+{
+  return register_metric< gauge_metric >( name, description, metric_type::gauge );
+}
+
+histogram_metric& metrics_registry::histogram( const std::string& name, const std::string& description )
+{
+  return register_metric< histogram_metric >( name, description, metric_type::histogram );
+}
+
+std::vector< const metric* > metrics_registry::get_metrics()const
+{
+  std::lock_guard< std::mutex > guard( _mutex );
+
+  std::vector< const metric* > result;
+  result.reserve( _metrics.size() );
+  for( const auto& m : _metrics )
+    result.push_back( m.get() );
+  return result;
+}
+
+namespace
+{
+  std::string prometheus_name( const std::string& name )
+  {
+    std::string result = "hived_";
+    result.reserve( result.size() + name.size() );
+    for( char c : name )
+      result += ( std::isalnum( static_cast< unsigned char >( c ) ) || c == '_' ) ? c : '_';
+    return result;
+  }
+}
+
+std::string metrics_registry::to_prometheus()const
+{
+  std::stringstream ss;
+
+  for( const metric* m : get_metrics() )
+  {
+    std::string name = prometheus_name( m->name );
+
+    switch( m->type )
+    {
+      case metric_type::counter:
+        ss << "# HELP " << name << "_total " << m->description << '\n'
+           << "# TYPE " << name << "_total counter\n"
+           << name << "_total " << static_cast< const counter_metric* >( m )->value() << '\n';
+        break;
+
+      case metric_type::gauge:
+        ss << "# HELP " << name << ' ' << m->description << '\n'
+           << "# TYPE " << name << " gauge\n"
+           << name << ' ' << static_cast< const gauge_metric* >( m )->value() << '\n';
+        break;
+
+      case metric_type::histogram:
+      {
+        auto snap = static_cast< const histogram_metric* >( m )->get_snapshot();
+        ss << "# HELP " << name << ' ' << m->description << '\n'
+           << "# TYPE " << name << " histogram\n";
+
+        // sub-buckets are merged so only power of two boundaries are exported; all of them are always present,
+        // because Prometheus can only aggregate histograms (and compute quantiles over time) with the same set of buckets
+        uint64_t cumulative = 0;
+        for( uint32_t i = 0; i < histogram_metric::bucket_count; ++i )
+        {
+          cumulative += snap.buckets[i];
+          if( i % histogram_metric::sub_buckets == histogram_metric::sub_buckets - 1 )
+            ss << name << "_bucket{le=\"" << histogram_metric::bucket_upper_bound( i ) - 1 << "\"} " << cumulative << '\n';
+        }
+
+        ss << name << "_bucket{le=\"+Inf\"} " << snap.count << '\n'
+           << name << "_sum " << snap.sum << '\n'
+           << name << "_count " << snap.count << '\n';
+        break;
+      }
+    }
+  }
+
+  return ss.str();
+}
+
+} } } // hive::plugins::statsd
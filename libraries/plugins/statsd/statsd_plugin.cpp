@@ -1,11 +1,14 @@
 #include <hive/plugins/statsd/statsd_plugin.hpp>
+#include <hive/plugins/statsd/metrics.hpp>
 
 #include <fc/network/resolve.hpp>
 #include <fc/thread/thread.hpp>
 
 #include <boost/algorithm/string.hpp>
 
+#include <condition_variable>
 #include <sstream>
+#include <thread>
 
 #include "StatsdClient.hpp"
 
@@ -46,6 +49,10 @@ namespace detail
       void gauge(     const std::string& ns, const std::string& stat, const std::string& key, const uint64_t value, const float frequency ) const noexcept;
       void timing(    const std::string& ns, const std::string& stat, const std::string& key, const uint32_t ms,    const float frequency ) const noexcept;
 
+      void start_metrics_export();
+      void stop_metrics_export();
+      void export_metrics();
+
 
       bool                                               _filter_stats = false;
       bool                                               _blacklist    = false;
@@ -59,6 +66,14 @@ namespace detail
       uint32_t                                           _statsd_batchsize = 1;
 
       std::unique_ptr< StatsdClient >                    _statsd;
+
+      uint32_t                                           _metrics_interval = 10;
+      std::thread                                        _metrics_thread;
+      std::mutex                                         _metrics_mutex;
+      std::condition_variable                            _metrics_cv;
+      bool                                               _metrics_stop = false;
+      std::map< const metric*, int64_t >                 _last_counter_values;
+      std::map< const metric*, histogram_metric::snapshot > _last_histogram_values;
   };
 
   void statsd_plugin_impl::start()
@@ -81,12 +96,17 @@ namespace detail
 
     _statsd.reset( new StatsdClient( host, port, "hived.", _statsd_batchsize ) );
     _started = true;
+
+    if( _statsd_endpoint.valid() && _metrics_interval > 0 )
+      start_metrics_export();
   }
 
   void statsd_plugin_impl::shutdown()
   {
     ilog("Shutting down statsd Plugin");
 
+    stop_metrics_export();
+
     _shutdown_in_progress.store( true );
 
     //Wait until all operations will be finished during 2 seconds
@@ -140,6 +160,81 @@ namespace detail
     op();
   }
 
+  void statsd_plugin_impl::start_metrics_export()
+  {
+    _metrics_stop = false;
+    _metrics_thread = std::thread( [this]()
+    {
+      std::unique_lock< std::mutex > lock( _metrics_mutex );
+      while( !_metrics_stop )
+      {
+        _metrics_cv.wait_for( lock, std::chrono::seconds( _metrics_interval ), [this](){ return _metrics_stop; } );
+        export_metrics();
+      }
+    });
+  }
+
+  void statsd_plugin_impl::stop_metrics_export()
+  {
+    if( !_metrics_thread.joinable() )
+      return;
+
+    {
+      std::lock_guard< std::mutex > guard( _metrics_mutex );
+      _metrics_stop = true;
+    }
+    _metrics_cv.notify_one();
+    _metrics_thread.join();
+  }
+
+  /// Sends values of registered metrics accumulated since last export (counters and histograms) or current values (gauges)
+  void statsd_plugin_impl::export_metrics()
+  {
+    for( const metric* m : metrics_registry::instance().get_metrics() )
+    {
+      // metric names follow ns.stat.key convention so they can be filtered the same way as regular stats
+      auto ns_end = m->name.find( '.' );
+      std::string ns = m->name.substr( 0, ns_end );
+      std::string stat;
+      if( ns_end != std::string::npos )
+        stat = m->name.substr( ns_end + 1, m->name.find( '.', ns_end + 1 ) - ns_end - 1 );
+      if( !filter_by_namespace( ns, stat ) )
+        continue;
+
+      switch( m->type )
+      {
+        case metric_type::counter:
+        {
+          int64_t value = static_cast< const counter_metric* >( m )->value();
+          int64_t& last = _last_counter_values[ m ];
+          if( value != last )
+            _statsd->count( m->name, int( value - last ) );
+          last = value;
+          break;
+        }
+        case metric_type::gauge:
+          _statsd->gauge( m->name, unsigned( static_cast< const gauge_metric* >( m )->value() ) );
+          break;
+        case metric_type::histogram:
+        {
+          auto current = static_cast< const histogram_metric* >( m )->get_snapshot();
+          auto& last = _last_histogram_values[ m ];
+          auto delta = current - last;
+          last = current;
+          if( delta.count == 0 )
+            break;
+
+          _statsd->count( m->name + ".count", int( delta.count ) );
+          _statsd->gauge( m->name + ".p50", unsigned( delta.percentile( 0.5 ) ) );
+          _statsd->gauge( m->name + ".p90", unsigned( delta.percentile( 0.9 ) ) );
+          _statsd->gauge( m->name + ".p99", unsigned( delta.percentile( 0.99 ) ) );
+          _statsd->gauge( m->name + ".max", unsigned( delta.max() ) );
+          break;
+        }
+      }
+    }
+  }
+
   void statsd_plugin_impl::increment( const std::string& ns, const std::string& stat, const std::string& key, const float frequency ) const noexcept
   {
     execute_operation( ns, stat, [ &, this ](){ _statsd->increment( compose_key( ns, stat, key ), frequency ); } );
@@ -177,6 +272,7 @@ void statsd_plugin::set_program_options( options_description& cli, options_descr
   cfg.add_options()
     ("statsd-endpoint", bpo::value< std::string >(), "Endpoint to send statsd messages to.")
     ("statsd-batchsize", bpo::value< uint32_t >()->default_value( 1 ), "Size to batch statsd messages." )
+    ("statsd-metrics-interval", bpo::value< uint32_t >()->default_value( 10 ), "Interval (in seconds) of sending aggregated values of registered metrics, 0 to disable." )
     ("statsd-whitelist", bpo::value< vector< std::string > >()->composing(), "Whitelist of statistics to capture.")
     ("statsd-blacklist", bpo::value< vector< std::string > >()->composing(), "Blacklist of statistics to capture.");
 }
@@ -192,6 +288,8 @@ void statsd_plugin::plugin_initialize( const boost::program_options::variables_m
     ilog( "Configured statsd to send to ${ep}", ("ep", endpoints[0]) );
   }
 
+  my->_metrics_interval = options.at( "statsd-metrics-interval" ).as< uint32_t >();
+
   if( options.count( "statsd-whitelist" ) )
   {
     my->_filter_stats = true;
@@ -57,8 +57,8 @@ public:
   uint32_t                      actual_track_after_block = 0;  //!< Calculated track-after-block
   bool                          tracking = false;
   bool                          rebuild_state_flag = false;
-  boost::signals2::connection   post_apply_transaction_connection;
-  boost::signals2::connection   post_apply_block_connection;
+  hive::chain::util::notification_connection   post_apply_transaction_connection;
+  hive::chain::util::notification_connection   post_apply_block_connection;
   bool                          state_is_valid();
   void                          rebuild_state();
   uint32_t                      get_earliest_tracked_block_num();
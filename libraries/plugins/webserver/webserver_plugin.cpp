@@ -2,6 +2,7 @@
 #include <hive/plugins/webserver/local_endpoint.hpp>
 
 #include <hive/plugins/chain/chain_plugin.hpp>
+#include <hive/plugins/statsd/metrics.hpp>
 
 #include <fc/network/ip.hpp>
 #include <fc/log/logger_config.hpp>
@@ -11,6 +12,8 @@
 #include <boost/asio.hpp>
 #include <boost/optional.hpp>
 #include <boost/bind.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/preprocessor/stringize.hpp>
 
 #include <websocketpp/config/asio_client.hpp>
@@ -22,9 +25,21 @@
 #include <websocketpp/logger/stub.hpp>
 #include <websocketpp/logger/syslog.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <map>
 #include <memory>
 #include <iostream>
+#include <vector>
+
+#ifndef HIVE_WEBSERVER_METRICS_INTERVAL_MS
+  #define HIVE_WEBSERVER_METRICS_INTERVAL_MS 1000
+#endif
 
 #define LOG_DELAY(start_time, log_threshold, msg) \
   { fc::time_point current_time = fc::time_point::now(); \
@@ -47,6 +62,11 @@ using boost::asio::ip::tcp;
 using std::shared_ptr;
 using websocketpp::connection_hdl;
 
+using hive::plugins::statsd::metrics_registry;
+using hive::plugins::statsd::histogram_metric;
+using hive::plugins::statsd::counter_metric;
+using hive::plugins::statsd::gauge_metric;
+
 typedef uint32_t thread_pool_size_t;
 
 namespace detail {
@@ -136,14 +156,365 @@ namespace detail {
 using websocket_server_type = websocketpp::server< detail::asio_with_stub_log_and_permessage_deflate >;
 using websocket_local_server_type = websocketpp::server<detail::asio_local_with_stub_log_and_permessage_deflate>;
 
+/**
+  * Queue class of API requests. Each lane has its own FIFO and its own worker threads, so flood of
+  * expensive calls assigned to one lane cannot delay requests handled by other lanes. When number of
+  * requests waiting in the lane reaches max_depth new requests are rejected immediately instead of
+  * being queued behind the ones that will likely time out anyway.
+  */
+class request_lane
+{
+  public:
+    request_lane( const string& _name, thread_pool_size_t _threads, uint32_t _max_depth ) :
+      name( _name ), threads( _threads ), max_depth( _max_depth ),
+      wait_time( metrics_registry::instance().histogram( "webserver.queue_wait." + _name, "Time requests spent in '" + _name + "' queue in microseconds" ) ),
+      accepted( metrics_registry::instance().counter( "webserver.accepted." + _name, "Number of requests queued in '" + _name + "' queue" ) ),
+      rejected( metrics_registry::instance().counter( "webserver.rejected." + _name, "Number of requests rejected because '" + _name + "' queue was full" ) ),
+      queue_depth( metrics_registry::instance().gauge( "webserver.queue_depth." + _name, "Number of requests waiting in '" + _name + "' queue" ) )
+    {}
+
+    void start()
+    {
+      work.reset( new asio::io_service::work( ios ) );
+      for( uint32_t i = 0; i < threads; ++i )
+        pool.create_thread( boost::bind( &asio::io_service::run, &ios ) );
+    }
+
+    void stop()
+    {
+      ios.stop();
+      pool.join_all();
+      work.reset();
+    }
+
+    /// Queues job for execution unless the lane is full, in which case job is dropped and false is returned
+    template< typename Job >
+    bool post( Job job )
+    {
+      uint32_t queued = ++depth;
+      if( max_depth != 0 && queued > max_depth )
+      {
+        --depth;
+        rejected.increment();
+        return false;
+      }
+      accepted.increment();
+      queue_depth.set( queued );
+
+      fc::time_point enqueue_time = fc::time_point::now();
+      ios.post( [this, enqueue_time, job]()
+      {
+        queue_depth.set( --depth );
+        wait_time.record( fc::time_point::now() - enqueue_time );
+        job();
+      });
+      return true;
+    }
+
+    void log_stats()const
+    {
+      auto wait = wait_time.get_snapshot();
+      ilog( "webserver lane '${n}': accepted ${a}, rejected ${r}, average queue wait ${avg} us, max queue wait ${max} us",
+        ("n", name)("a", accepted.value())("r", rejected.value())
+        ("avg", wait.count ? wait.sum / wait.count : 0)("max", wait.max()) );
+    }
+
+    const string             name;
+    const thread_pool_size_t threads;
+    const uint32_t           max_depth; ///< 0 means unlimited
+
+  private:
+    boost::thread_group                       pool;
+    asio::io_service                          ios;
+    std::unique_ptr< asio::io_service::work > work;
+
+    std::atomic< uint32_t > depth{ 0 };
+
+    histogram_metric& wait_time;
+    counter_metric&   accepted;
+    counter_metric&   rejected;
+    gauge_metric&     queue_depth;
+};
+
+/**
+  * Prometheus text of registered metrics, rendered periodically by its own thread. Aggregating all
+  * metrics takes time proportional to their number, so /metrics requests are answered with the last
+  * rendered text and scraping never holds up network thread.
+  */
+class metrics_snapshot
+{
+  public:
+    void start( uint32_t interval_ms )
+    {
+      refresh();
+      stopping = false;
+      thread = std::thread( [this, interval_ms]()
+      {
+        std::unique_lock< std::mutex > lock( stop_mutex );
+        while( !stop_cv.wait_for( lock, std::chrono::milliseconds( interval_ms ), [this](){ return stopping; } ) )
+        {
+          lock.unlock();
+          refresh();
+          lock.lock();
+        }
+      } );
+    }
+
+    void stop()
+    {
+      if( !thread.joinable() )
+        return;
+      {
+        std::lock_guard< std::mutex > guard( stop_mutex );
+        stopping = true;
+      }
+      stop_cv.notify_one();
+      thread.join();
+    }
+
+    shared_ptr< const string > get()const
+    {
+      std::lock_guard< std::mutex > guard( text_mutex );
+      return text;
+    }
+
+  private:
+    void refresh()
+    {
+      auto rendered = std::make_shared< const string >( metrics_registry::instance().to_prometheus() );
+      std::lock_guard< std::mutex > guard( text_mutex );
+      text = std::move( rendered );
+    }
+
+    std::thread                 thread;
+    std::mutex                  stop_mutex;
+    std::condition_variable     stop_cv;
+    bool                        stopping = false;
+
+    mutable std::mutex          text_mutex;
+    shared_ptr< const string >  text = std::make_shared< const string >();
+};
+
+/**
+  * Tokenizer of top level JSON-RPC request object that runs on the network thread. It does not build any
+  * values, it only finds where values of "method", "params" and "id" keys of the top level object are,
+  * skipping everything else (including nested objects that might contain keys of the same names).
+  * Anything unexpected - batch, malformed JSON, duplicated or escaped keys - makes the request invalid,
+  * which means it goes to default lane; actual validation is done later by json_rpc plugin.
+  */
+class request_peek
+{
+  public:
+    explicit request_peek( const string& body ) : _body( body )
+    {
+      _valid = scan();
+    }
+
+    bool is_valid()const { return _valid; }
+
+    /// "api.method" (or bare method name in case of unqualified calls), empty when it cannot be determined
+    string api_method()const
+    {
+      string method;
+      if( !_valid || !read_plain_string( _method.first, _method.second, method ) )
+        return string();
+      if( method != "call" )
+        return method;
+
+      // "call" style request: "params":["api","method",[args]]
+      size_t pos = _params.first;
+      if( pos == string::npos || _body[ pos ] != '[' )
+        return method;
+      string api, api_method;
+      pos = skip_ws( pos + 1 );
+      size_t end = skip_string( pos );
+      if( end == string::npos || !read_plain_string( pos, end, api ) )
+        return method;
+      pos = skip_ws( end );
+      if( pos >= _body.size() || _body[ pos ] != ',' )
+        return api;
+      pos = skip_ws( pos + 1 );
+      end = skip_string( pos );
+      if( end == string::npos || !read_plain_string( pos, end, api_method ) )
+        return api;
+      return api + "." + api_method;
+    }
+
+    /// id of request as JSON text when it is integer or string (same as accepted by json_rpc plugin), "null" otherwise
+    string id()const
+    {
+      if( !_valid || _id.first == string::npos || _id.second - _id.first > max_id_length )
+        return "null";
+      char first = _body[ _id.first ];
+      if( first == '"' )
+        return _body.substr( _id.first, _id.second - _id.first );
+      for( size_t i = _id.first; i < _id.second; ++i )
+      {
+        if( !isdigit( _body[i] ) && !( i == _id.first && first == '-' ) )
+          return "null";
+      }
+      return _id.second - _id.first > ( first == '-' ? 1 : 0 ) ? _body.substr( _id.first, _id.second - _id.first ) : "null";
+    }
+
+  private:
+    typedef std::pair< size_t, size_t > token; ///< [begin, end) of value, begin is npos when key was not present
+
+    static const size_t max_id_length = 256;
+
+    bool scan()
+    {
+      size_t pos = skip_ws( 0 );
+      if( pos >= _body.size() || _body[ pos ] != '{' )
+        return false; // batch or not JSON object
+      pos = skip_ws( pos + 1 );
+      if( pos < _body.size() && _body[ pos ] == '}' )
+        return skip_ws( pos + 1 ) == _body.size();
+
+      while( true )
+      {
+        size_t key_end = skip_string( pos );
+        if( key_end == string::npos )
+          return false;
+        string key;
+        if( !read_plain_string( pos, key_end, key ) )
+          return false; // escaped key could hide duplicate of one of the keys we look for
+        pos = skip_ws( key_end );
+        if( pos >= _body.size() || _body[ pos ] != ':' )
+          return false;
+        pos = skip_ws( pos + 1 );
+        size_t value_end = skip_value( pos );
+        if( value_end == string::npos )
+          return false;
+
+        token* target = key == "method" ? &_method : key == "params" ? &_params : key == "id" ? &_id : nullptr;
+        if( target != nullptr )
+        {
+          if( target->first != string::npos )
+            return false; // duplicated key
+          *target = token( pos, value_end );
+        }
+
+        pos = skip_ws( value_end );
+        if( pos >= _body.size() )
+          return false;
+        if( _body[ pos ] == '}' )
+          return skip_ws( pos + 1 ) == _body.size();
+        if( _body[ pos ] != ',' )
+          return false;
+        pos = skip_ws( pos + 1 );
+      }
+    }
+
+    size_t skip_ws( size_t pos )const
+    {
+      while( pos < _body.size() && ( _body[ pos ] == ' ' || _body[ pos ] == '\t' || _body[ pos ] == '\n' || _body[ pos ] == '\r' ) )
+        ++pos;
+      return pos;
+    }
+
+    /// position right after string that starts at pos, npos when there is no valid string
+    size_t skip_string( size_t pos )const
+    {
+      if( pos >= _body.size() || _body[ pos ] != '"' )
+        return string::npos;
+      for( ++pos; pos < _body.size(); ++pos )
+      {
+        char c = _body[ pos ];
+        if( c == '"' )
+          return pos + 1;
+        if( static_cast< unsigned char >( c ) < 0x20 )
+          return string::npos;
+        if( c == '\\' && ++pos >= _body.size() )
+          return string::npos;
+      }
+      return string::npos;
+    }
+
+    /// position right after value that starts at pos, npos when there is no valid value; content of
+    /// nested containers is not validated, only brackets are matched and strings are skipped
+    size_t skip_value( size_t pos )const
+    {
+      if( pos >= _body.size() )
+        return string::npos;
+      char c = _body[ pos ];
+      if( c == '"' )
+        return skip_string( pos );
+      if( c == '{' || c == '[' )
+      {
+        std::vector< char > closing;
+        while( pos < _body.size() )
+        {
+          c = _body[ pos ];
+          if( c == '"' )
+          {
+            pos = skip_string( pos );
+            if( pos == string::npos )
+              return pos;
+            continue;
+          }
+          if( c == '{' )
+            closing.push_back( '}' );
+          else if( c == '[' )
+            closing.push_back( ']' );
+          else if( c == '}' || c == ']' )
+          {
+            if( closing.back() != c )
+              return string::npos;
+            closing.pop_back();
+            if( closing.empty() )
+              return pos + 1;
+          }
+          ++pos;
+        }
+        return string::npos;
+      }
+      size_t end = pos;
+      while( end < _body.size() && ( isalnum( _body[ end ] ) || _body[ end ] == '-' || _body[ end ] == '+' || _body[ end ] == '.' ) )
+        ++end;
+      return end != pos ? end : string::npos;
+    }
+
+    /// content of string token without escape sequences, false when token is not such a string
+    bool read_plain_string( size_t begin, size_t end, string& out )const
+    {
+      if( begin == string::npos || end - begin < 2 || _body[ begin ] != '"' || _body[ end - 1 ] != '"' )
+        return false;
+      if( std::find( _body.begin() + begin + 1, _body.begin() + end - 1, '\\' ) != _body.begin() + end - 1 )
+        return false;
+      out.assign( _body, begin + 1, end - begin - 2 );
+      return true;
+    }
+
+    const string& _body;
+    token         _method{ string::npos, string::npos };
+    token         _params{ string::npos, string::npos };
+    token         _id{ string::npos, string::npos };
+    bool          _valid = false;
+};
+
+/**
+  * JSON-RPC error for request rejected because its lane is full. It carries id of the request found by the
+  * same scan that selected the lane (no parsing on the network thread), so clients that send many calls over
+  * one websocket can tell which of them was rejected. Batches and malformed requests get null id.
+  */
+string server_busy_response( const string& body )
+{
+  return "{\"jsonrpc\":\"2.0\",\"error\":{\"code\":" BOOST_PP_STRINGIZE( JSON_RPC_SERVER_BUSY ) ",\"message\":\"Server busy, try again later\"},\"id\":" +
+    request_peek( body ).id() + "}";
+}
+
 class webserver_plugin_impl
 {
   public:
-    webserver_plugin_impl( thread_pool_size_t _thread_pool_size, plugins::chain::chain_plugin& c ) :
-      thread_pool_size( _thread_pool_size ), chain( c )
+    webserver_plugin_impl( thread_pool_size_t _thread_pool_size, uint32_t _max_queue_depth, plugins::chain::chain_plugin& c ) :
+      chain( c )
     {
+      lanes.emplace_back( new request_lane( "default", _thread_pool_size, _max_queue_depth ) );
     }
 
+    void add_lane( const string& definition );
+    request_lane& select_lane( const string& body );
+
     void prepare_threads();
 
     void start_webserver();
@@ -153,7 +524,14 @@ class webserver_plugin_impl
     void handle_http_message( websocket_server_type*, connection_hdl );
     void handle_http_request( websocket_local_server_type*, connection_hdl );
 
-    thread_pool_size_t         thread_pool_size;
+    template< typename Connection >
+    bool handle_metrics_request( const Connection& con );
+
+    /// lanes.front() is the default lane that handles all requests not assigned to any other lane
+    std::vector< std::unique_ptr< request_lane > > lanes;
+    std::map< string, request_lane* >               lane_by_api;
+    bool                                            metrics_enabled = false;
+    metrics_snapshot                                metrics;
 
     shared_ptr< std::thread >  http_thread;
     asio::io_service           http_ios;
@@ -170,22 +548,72 @@ class webserver_plugin_impl
     optional< tcp::endpoint >  ws_endpoint;
     websocket_server_type      ws_server;
 
-    boost::thread_group        thread_pool;
-    asio::io_service           thread_pool_ios;
-    std::unique_ptr< asio::io_service::work > thread_pool_work;
-
     plugins::json_rpc::json_rpc_plugin* api = nullptr;
     boost::signals2::connection         chain_sync_con;
 
     plugins::chain::chain_plugin& chain;
 };
 
+void webserver_plugin_impl::add_lane( const string& definition )
+{
+  // NAME:THREADS:MAX_QUEUE_DEPTH:API[,API...]
+  std::vector< string > parts;
+  boost::split( parts, definition, boost::is_any_of( ":" ) );
+  FC_ASSERT( parts.size() == 4, "Invalid webserver-queue-class '${d}', expected NAME:THREADS:MAX_QUEUE_DEPTH:API[,API...]", ("d", definition) );
+
+  const string& name = parts[0];
+  FC_ASSERT( !name.empty(), "Missing queue class name in '${d}'", ("d", definition) );
+  for( const auto& lane : lanes )
+    FC_ASSERT( lane->name != name, "Queue class '${n}' defined more than once", ("n", name) );
+
+  thread_pool_size_t threads = boost::lexical_cast< thread_pool_size_t >( parts[1] );
+  uint32_t max_depth = boost::lexical_cast< uint32_t >( parts[2] );
+  FC_ASSERT( threads > 0, "Queue class '${n}' needs at least one thread", ("n", name) );
+
+  lanes.emplace_back( new request_lane( name, threads, max_depth ) );
+
+  std::vector< string > apis;
+  boost::split( apis, parts[3], boost::is_any_of( "," ) );
+  for( auto& api_name : apis )
+  {
+    boost::trim( api_name );
+    if( api_name.empty() )
+      continue;
+    FC_ASSERT( lane_by_api.emplace( api_name, lanes.back().get() ).second,
+      "API '${a}' assigned to more than one queue class", ("a", api_name) );
+  }
+
+  ilog( "configured queue class '${n}' with ${t} threads, max queue depth ${d}, apis: ${a}",
+    ("n", name)("t", threads)("d", max_depth)("a", parts[3]) );
+}
+
+request_lane& webserver_plugin_impl::select_lane( const string& body )
+{
+  if( lane_by_api.empty() )
+    return *lanes.front();
+
+  // exact "api.method" assignment takes precedence over whole api
+  string method = request_peek( body ).api_method();
+  if( method.empty() )
+    return *lanes.front();
+  auto itr = lane_by_api.find( method );
+  if( itr == lane_by_api.end() )
+  {
+    auto dot = method.find( '.' );
+    if( dot != string::npos )
+      itr = lane_by_api.find( method.substr( 0, dot ) );
+  }
+
+  return itr != lane_by_api.end() ? *itr->second : *lanes.front();
+}
+
 void webserver_plugin_impl::prepare_threads()
 {
-  thread_pool_work.reset( new asio::io_service::work( this->thread_pool_ios ) );
+  for( auto& lane : lanes )
+    lane->start();
 
-  for( uint32_t i = 0; i < thread_pool_size; ++i )
-    thread_pool.create_thread( boost::bind( &asio::io_service::run, &thread_pool_ios ) );
+  if( metrics_enabled )
+    metrics.start( HIVE_WEBSERVER_METRICS_INTERVAL_MS );
 }
 
 void webserver_plugin_impl::start_webserver()
@@ -291,8 +719,13 @@ void webserver_plugin_impl::stop_webserver()
   if( unix_server.is_listening() )
     unix_server.stop_listening();
 
-  thread_pool_ios.stop();
-  thread_pool.join_all();
+  for( auto& lane : lanes )
+  {
+    lane->stop();
+    lane->log_stats();
+  }
+
+  metrics.stop();
 
   if( ws_thread )
   {
@@ -316,12 +749,36 @@ void webserver_plugin_impl::stop_webserver()
   }
 }
 
+/// Serves last snapshot of registered metrics in Prometheus text format under /metrics (when enabled); returns false for all other requests
+template< typename Connection >
+bool webserver_plugin_impl::handle_metrics_request( const Connection& con )
+{
+  if( !metrics_enabled || con->get_resource() != "/metrics" )
+    return false;
+
+  con->set_body( *metrics.get() );
+  con->append_header( "Content-Type", "text/plain; version=0.0.4" );
+  con->set_status( websocketpp::http::status_code::ok );
+  return true;
+}
+
+template< typename Connection >
+void reject_http_request( const Connection& con )
+{
+  con->set_body( server_busy_response( con->get_request_body() ) );
+  con->append_header( "Content-Type", "application/json" );
+  con->append_header( "Retry-After", "1" );
+  con->set_status( websocketpp::http::status_code::service_unavailable );
+  con->send_http_response();
+}
+
 void webserver_plugin_impl::handle_ws_message( websocket_server_type* server, connection_hdl hdl, const detail::websocket_server_type::message_ptr& msg )
 {
   auto con = server->get_con_from_hdl( std::move( hdl ) );
 
   fc::time_point arrival_time = fc::time_point::now();
-  thread_pool_ios.post( [con, msg, this, arrival_time]()
+  request_lane& lane = select_lane( msg->get_payload() );
+  bool queued = lane.post( [con, msg, this, arrival_time]()
   {
     LOG_DELAY(arrival_time, fc::seconds(2), "Excessive delay to begin processing ws API call");
 
@@ -365,15 +822,21 @@ void webserver_plugin_impl::handle_ws_message( websocket_server_type* server, co
       }
     }
   });
+
+  if( !queued )
+    con->send( server_busy_response( msg->get_payload() ) );
 }
 
 void webserver_plugin_impl::handle_http_message( websocket_server_type* server, connection_hdl hdl )
 {
   auto con = server->get_con_from_hdl( std::move( hdl ) );
+  if( handle_metrics_request( con ) )
+    return;
   con->defer_http_response();
 
   fc::time_point arrival_time = fc::time_point::now();
-  thread_pool_ios.post( [con, this, arrival_time]()
+  request_lane& lane = select_lane( con->get_request_body() );
+  bool queued = lane.post( [con, this, arrival_time]()
   {
     LOG_DELAY(arrival_time, fc::seconds(2), "Excessive delay to begin processing API call");
 
@@ -418,13 +881,19 @@ void webserver_plugin_impl::handle_http_message( websocket_server_type* server,
     LOG_DELAY(arrival_time, fc::seconds(10), "Excessive delay to process API call");
     con->send_http_response();
   });
+
+  if( !queued )
+    reject_http_request( con );
 }
 
 void webserver_plugin_impl::handle_http_request(websocket_local_server_type* server, connection_hdl hdl ) {
   auto con = server->get_con_from_hdl( std::move( hdl ) );
+  if( handle_metrics_request( con ) )
+    return;
   con->defer_http_response();
 
-  thread_pool_ios.post( [con, this]()
+  request_lane& lane = select_lane( con->get_request_body() );
+  bool queued = lane.post( [con, this]()
   {
     auto body = con->get_request_body();
 
@@ -463,6 +932,9 @@ void webserver_plugin_impl::handle_http_request(websocket_local_server_type* ser
 
     con->send_http_response();
   });
+
+  if( !queued )
+    reject_http_request( con );
 }
 
 } // detail
@@ -481,6 +953,15 @@ void webserver_plugin::set_program_options( options_description&, options_descri
     ("rpc-endpoint", bpo::value< string >(), "Local http and websocket endpoint for webserver requests. Deprecated in favor of webserver-http-endpoint and webserver-ws-endpoint" )
     ("webserver-thread-pool-size", bpo::value<thread_pool_size_t>()->default_value(32),
       "Number of threads used to handle queries. Default: 32.")
+    ("webserver-max-queue-depth", bpo::value<uint32_t>()->default_value(0),
+      "Maximum number of queries waiting for a thread of default queue class. Excess queries are rejected with 503. Default: 0 (unlimited).")
+    ("webserver-queue-class", bpo::value< std::vector< string > >()->composing()->multitoken(),
+      "Separate queue for selected APIs, with its own threads and queue depth limit, in form NAME:THREADS:MAX_QUEUE_DEPTH:API[,API...] "
+      "where API is either whole api (e.g. network_broadcast_api) or single method (e.g. database_api.get_dynamic_global_properties). "
+      "Queries not assigned to any class are handled by default class (webserver-thread-pool-size threads). Can be specified multiple times.")
+    ("webserver-enable-metrics", bpo::value< bool >()->default_value( false ),
+      "Serve values of registered metrics in Prometheus text format under /metrics path of http endpoints. "
+      "Values are rendered every " BOOST_PP_STRINGIZE( HIVE_WEBSERVER_METRICS_INTERVAL_MS ) " ms.")
     ;
 }
 
@@ -488,8 +969,17 @@ void webserver_plugin::plugin_initialize( const variables_map& options )
 {
   auto thread_pool_size = options.at("webserver-thread-pool-size").as<thread_pool_size_t>();
   FC_ASSERT(thread_pool_size > 0, "webserver-thread-pool-size must be greater than 0");
-  ilog("configured with ${tps} thread pool size", ("tps", thread_pool_size));
-  my.reset( new detail::webserver_plugin_impl( thread_pool_size, appbase::app().get_plugin< plugins::chain::chain_plugin >() ) );
+  auto max_queue_depth = options.at("webserver-max-queue-depth").as<uint32_t>();
+  ilog("configured with ${tps} thread pool size, max queue depth ${d}", ("tps", thread_pool_size)("d", max_queue_depth));
+  my.reset( new detail::webserver_plugin_impl( thread_pool_size, max_queue_depth, appbase::app().get_plugin< plugins::chain::chain_plugin >() ) );
+
+  my->metrics_enabled = options.at( "webserver-enable-metrics" ).as< bool >();
+
+  if( options.count( "webserver-queue-class" ) )
+  {
+    for( const auto& definition : options.at( "webserver-queue-class" ).as< std::vector< string > >() )
+      my->add_lane( definition );
+  }
 
   if( options.count( "webserver-http-endpoint" ) )
   {
@@ -80,9 +80,9 @@ namespace detail {
 
     plugins::chain::chain_plugin& _chain_plugin;
     chain::database&              _db;
-    boost::signals2::connection   _post_apply_block_conn;
-    boost::signals2::connection   _pre_apply_operation_conn;
-    boost::signals2::connection   _post_apply_operation_conn;
+    hive::chain::util::notification_connection   _post_apply_block_conn;
+    hive::chain::util::notification_connection   _pre_apply_operation_conn;
+    hive::chain::util::notification_connection   _post_apply_operation_conn;
 
     std::shared_ptr< witness::block_producer >                         _block_producer;
   };
@@ -242,10 +242,7 @@ namespace detail {
       case operation::tag< custom_binary_operation >::value:
         if( _db.is_producing() )
         {
-          flat_set< account_name_type > impacted;
-          app::operation_get_impacted_accounts( note.op, impacted );
-
-          for( const account_name_type& account : impacted )
+          for( const account_name_type& account : note.get_impacted_accounts() )
           {
             // Possible alternative implementation:  Don't call find(), simply catch
             // the exception thrown by db.create() when violating uniqueness (std::logic_error).
@@ -13,6 +13,16 @@ void authority::add_authority( const account_name_type& k, weight_type w )
   account_auths[k] = w;
 }
 
+authority authority_view::to_authority()const
+{
+  authority result;
+  result.weight_threshold = weight_threshold;
+  // viewed entries are already sorted and unique
+  result.account_auths.insert( boost::container::ordered_unique_range, account_auths.begin(), account_auths.end() );
+  result.key_auths.insert( boost::container::ordered_unique_range, key_auths.begin(), key_auths.end() );
+  return result;
+}
+
 vector< public_key_type > authority::get_keys()const
 {
   vector< public_key_type > result;
@@ -117,3 +127,12 @@ bool operator == ( const authority& a, const authority& b )
 }
 
 } } // hive::protocol
+
+namespace fc {
+
+void to_variant( const hive::protocol::authority_view& a, fc::variant& var )
+{
+  to_variant( a.to_authority(), var );
+}
+
+} // fc
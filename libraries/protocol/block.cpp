@@ -39,31 +39,124 @@ namespace hive { namespace protocol {
     return signee( canon_type ) == expected_signee;
   }
 
+  namespace {
+
+    /* Serializes every transaction once and hashes all of them in one batch. Packed signed transaction
+      * starts with packed transaction (signatures are serialized last), so the same buffer provides
+      * message for merkle digest (whole) and for transaction id (without signatures).
+      */
+    void hash_transactions( const vector< signed_transaction >& transactions, vector< digest_type >* merkle_digests,
+      vector< transaction_id_type >* ids )
+    {
+      const size_t count = transactions.size();
+      vector< uint32_t > full_sizes( count );
+      vector< uint32_t > unsigned_sizes( count );
+      size_t total_size = 0;
+      for( size_t i = 0; i < count; ++i )
+      {
+        full_sizes[i] = fc::raw::pack_size( transactions[i] );
+        unsigned_sizes[i] = full_sizes[i] - fc::raw::pack_size( transactions[i].signatures );
+        total_size += full_sizes[i];
+      }
+
+      vector< char > packed( total_size );
+      vector< const char* > data;
+      vector< uint32_t > sizes;
+      data.reserve( 2 * count );
+      sizes.reserve( 2 * count );
+      fc::datastream< char* > ds( packed.data(), packed.size() );
+      for( size_t i = 0; i < count; ++i )
+      {
+        const char* begin = packed.data() + ds.tellp();
+        fc::raw::pack( ds, transactions[i] );
+        if( merkle_digests != nullptr )
+        {
+          data.push_back( begin );
+          sizes.push_back( full_sizes[i] );
+        }
+        if( ids != nullptr )
+        {
+          data.push_back( begin );
+          sizes.push_back( unsigned_sizes[i] );
+        }
+      }
+
+      vector< digest_type > digests( data.size() );
+      digest_type::hash_batch( data.data(), sizes.data(), data.size(), digests.data() );
+
+      const size_t step = data.size() / count;
+      if( merkle_digests != nullptr )
+      {
+        merkle_digests->resize( count );
+        for( size_t i = 0; i < count; ++i )
+          (*merkle_digests)[i] = digests[ i * step ];
+      }
+      if( ids != nullptr )
+      {
+        ids->resize( count );
+        for( size_t i = 0; i < count; ++i )
+        {
+          const digest_type& h = digests[ i * step + step - 1 ];
+          memcpy( (*ids)[i]._hash, h._hash, std::min( sizeof( transaction_id_type ), sizeof( digest_type ) ) );
+        }
+      }
+    }
+
+    checksum_type merkle_root_from_digests( vector< digest_type >& ids )
+    {
+      // pair of neighbouring digests is hashed straight from the vector, just like packed std::pair would be
+      static_assert( sizeof( digest_type ) == 32, "digests must be tightly packed" );
+
+      vector< digest_type > next;
+      vector< const char* > data;
+      vector< uint32_t > sizes;
+      while( ids.size() > 1 )
+      {
+        // hash ID's in pairs
+        const size_t pairs = ids.size() / 2;
+        data.resize( pairs );
+        sizes.assign( pairs, 2 * sizeof( digest_type ) );
+        for( size_t i = 0; i < pairs; ++i )
+          data[i] = ids[ 2 * i ].data();
+
+        next.resize( pairs + ( ids.size() & 1 ) );
+        digest_type::hash_batch( data.data(), sizes.data(), pairs, next.data() );
+        if( ids.size() & 1 )
+          next[ pairs ] = ids.back();
+        ids.swap( next );
+      }
+      return checksum_type::hash( ids[0] );
+    }
+
+  }
+
   checksum_type signed_block::calculate_merkle_root()const
   {
     if( transactions.size() == 0 )
       return checksum_type();
 
-    vector<digest_type> ids;
-    ids.resize( transactions.size() );
-    for( uint32_t i = 0; i < transactions.size(); ++i )
-      ids[i] = transactions[i].merkle_digest();
+    vector< digest_type > ids;
+    hash_transactions( transactions, &ids, nullptr );
+    return merkle_root_from_digests( ids );
+  }
 
-    vector<digest_type>::size_type current_number_of_hashes = ids.size();
-    while( current_number_of_hashes > 1 )
-    {
-      // hash ID's in pairs
-      uint32_t i_max = current_number_of_hashes - (current_number_of_hashes&1);
-      uint32_t k = 0;
+  checksum_type signed_block::calculate_merkle_root( vector< transaction_id_type >& transaction_ids )const
+  {
+    transaction_ids.clear();
+    if( transactions.size() == 0 )
+      return checksum_type();
 
-      for( uint32_t i = 0; i < i_max; i += 2 )
-        ids[k++] = digest_type::hash( std::make_pair( ids[i], ids[i+1] ) );
+    vector< digest_type > ids;
+    hash_transactions( transactions, &ids, &transaction_ids );
+    return merkle_root_from_digests( ids );
+  }
 
-      if( current_number_of_hashes&1 )
-        ids[k++] = ids[i_max];
-      current_number_of_hashes = k;
-    }
-    return checksum_type::hash( ids[0] );
+  vector< transaction_id_type > signed_block::calculate_transaction_ids()const
+  {
+    vector< transaction_id_type > result;
+    if( transactions.size() != 0 )
+      hash_transactions( transactions, nullptr, &result );
+    return result;
   }
 
 } } // hive::protocol
@@ -54,6 +54,59 @@ namespace hive { namespace protocol {
     key_authority_map                                               key_auths;
   };
 
+/**
+  * Non-owning view of authority (or any authority-like type with the same flat map layout, like
+  * shared_authority of chain objects). Allows checking signatures directly over authorities kept
+  * in shared memory without copying their key and account maps. The view is valid as long as the
+  * viewed authority is not modified nor destroyed.
+  */
+struct authority_view
+{
+  typedef std::pair< account_name_type, weight_type > account_auth_type;
+  typedef std::pair< public_key_type, weight_type >   key_auth_type;
+
+  template< typename T >
+  struct range
+  {
+    const T* begin()const { return _begin; }
+    const T* end()const { return _end; }
+    size_t size()const { return _end - _begin; }
+
+    const T* _begin = nullptr;
+    const T* _end = nullptr;
+  };
+
+  authority_view(){}
+
+  template< typename AuthorityType >
+  explicit authority_view( const AuthorityType& a ) : weight_threshold( a.weight_threshold )
+  {
+    static_assert( std::is_same< typename AuthorityType::account_authority_map::value_type, account_auth_type >::value &&
+      std::is_same< typename AuthorityType::key_authority_map::value_type, key_auth_type >::value,
+      "Authority type has to keep its entries in flat maps of account/key and weight pairs" );
+    set_range( account_auths, a.account_auths );
+    set_range( key_auths, a.key_auths );
+  }
+
+  authority to_authority()const;
+
+  uint32_t                    weight_threshold = 0;
+  range< account_auth_type >  account_auths;
+  range< key_auth_type >      key_auths;
+
+  private:
+    template< typename T, typename FlatMap >
+    static void set_range( range< T >& r, const FlatMap& m )
+    {
+      // flat maps keep their elements in contiguous storage
+      if( !m.empty() )
+      {
+        r._begin = &*m.begin();
+        r._end = r._begin + m.size();
+      }
+    }
+};
+
 template< typename AuthorityType >
 void add_authority_accounts(
   flat_set<account_name_type>& result,
@@ -101,6 +154,12 @@ bool operator == ( const authority& a, const authority& b );
 } } // namespace hive::protocol
 
 
+namespace fc {
+
+void to_variant( const hive::protocol::authority_view& a, fc::variant& var );
+
+} // fc
+
 FC_REFLECT_TYPENAME( hive::protocol::authority::account_authority_map)
 FC_REFLECT_TYPENAME( hive::protocol::authority::key_authority_map)
 FC_REFLECT( hive::protocol::authority, (weight_threshold)(account_auths)(key_auths) )
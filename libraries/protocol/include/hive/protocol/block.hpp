@@ -7,6 +7,11 @@ namespace hive { namespace protocol {
   struct signed_block : public signed_block_header
   {
     checksum_type calculate_merkle_root()const;
+    /// Same as above, also fills ids of all transactions (transactions are serialized only once for both)
+    checksum_type calculate_merkle_root( vector< transaction_id_type >& transaction_ids )const;
+    /// Ids of all transactions of the block, computed together with batch hashing
+    vector< transaction_id_type > calculate_transaction_ids()const;
+
     vector<signed_transaction> transactions;
   };
 
@@ -3,9 +3,34 @@
 #include <hive/protocol/authority.hpp>
 #include <hive/protocol/types.hpp>
 
+#include <deque>
+#include <memory>
+
 namespace hive { namespace protocol {
 
 typedef std::function<authority(const string&)> authority_getter;
+/// Returns view of authority that stays valid at least until the end of signature verification
+typedef std::function<authority_view(const string&)> authority_view_getter;
+
+/**
+  * Adapts authority_getter that returns authorities by value to authority_view_getter.
+  * Authorities are kept by the adapter, so views returned by it are valid as long as the adapter.
+  */
+class authority_materializer
+{
+  public:
+    explicit authority_materializer( const authority_getter& getter ) : _getter( getter ) {}
+
+    authority_view operator()( const string& name )
+    {
+      _storage.emplace_back( _getter( name ) );
+      return authority_view( _storage.back() );
+    }
+
+  private:
+    authority_getter        _getter;
+    std::deque< authority > _storage;
+};
 
 struct sign_state
 {
@@ -20,14 +45,17 @@ struct sign_state
     *  the accounts specified in authority or the keys specified.
     */
   bool check_authority( const authority& au, uint32_t depth = 0, uint32_t account_auth_count = 0 );
+  bool check_authority( const authority_view& au, uint32_t depth = 0, uint32_t account_auth_count = 0 );
 
   bool remove_unused_signatures();
 
   sign_state( const flat_set<public_key_type>& sigs,
           const authority_getter& a,
           const flat_set<public_key_type>& keys );
+  sign_state( const flat_set<public_key_type>& sigs,
+          const authority_view_getter& a,
+          const flat_set<public_key_type>& keys );
 
-  const authority_getter&          get_active;
   const flat_set<public_key_type>& available_keys;
 
   flat_map<public_key_type,bool>   provided_signatures;
@@ -37,7 +65,13 @@ struct sign_state
   uint32_t                         max_account_auths = ~0;
 
   private:
-    bool check_authority_impl( const authority& au, uint32_t depth, uint32_t* account_auth_count );
+    bool check_authority_impl( const authority_view& au, uint32_t depth, uint32_t* account_auth_count );
+    /// Resolves authority of given account through getter, each account at most once
+    authority_view get_active( const account_name_type& name );
+
+    authority_view_getter                           _get_active;
+    /// authorities already resolved during lifetime of this sign_state (usually single transaction)
+    flat_map< account_name_type, authority_view >   _resolved;
 };
 
 } } // hive::protocol
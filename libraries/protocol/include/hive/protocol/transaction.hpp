@@ -82,6 +82,18 @@ using fc::ecc::canonical_signature_type;
       canonical_signature_type canon_type = fc::ecc::fc_canonical
       )const;
 
+    /// Same as above, but authorities are not copied (views have to stay valid during verification)
+    void verify_authority(
+      const chain_id_type& chain_id,
+      const authority_view_getter& get_active,
+      const authority_view_getter& get_owner,
+      const authority_view_getter& get_posting,
+      uint32_t max_recursion/* = HIVE_MAX_SIG_CHECK_DEPTH*/,
+      uint32_t max_membership = HIVE_MAX_AUTHORITY_MEMBERSHIP,
+      uint32_t max_account_auths = HIVE_MAX_SIG_CHECK_ACCOUNTS,
+      canonical_signature_type canon_type = fc::ecc::fc_canonical
+      )const;
+
     set<public_key_type> minimize_required_signatures(
       const chain_id_type& chain_id,
       const flat_set<public_key_type>& available_keys,
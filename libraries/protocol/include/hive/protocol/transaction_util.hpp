@@ -6,9 +6,9 @@ namespace hive { namespace protocol {
 
 template< typename AuthContainerType >
 void verify_authority( const vector<AuthContainerType>& auth_containers, const flat_set<public_key_type>& sigs,
-                const authority_getter& get_active,
-                const authority_getter& get_owner,
-                const authority_getter& get_posting,
+                const authority_view_getter& get_active,
+                const authority_view_getter& get_owner,
+                const authority_view_getter& get_posting,
                 uint32_t max_recursion_depth = HIVE_MAX_SIG_CHECK_DEPTH,
                 uint32_t max_membership = HIVE_MAX_AUTHORITY_MEMBERSHIP,
                 uint32_t max_account_auths = HIVE_MAX_SIG_CHECK_ACCOUNTS,
@@ -102,4 +102,27 @@ void verify_authority( const vector<AuthContainerType>& auth_containers, const f
     );
 } FC_CAPTURE_AND_RETHROW( (auth_containers)(sigs) ) }
 
+template< typename AuthContainerType >
+void verify_authority( const vector<AuthContainerType>& auth_containers, const flat_set<public_key_type>& sigs,
+                const authority_getter& get_active,
+                const authority_getter& get_owner,
+                const authority_getter& get_posting,
+                uint32_t max_recursion_depth = HIVE_MAX_SIG_CHECK_DEPTH,
+                uint32_t max_membership = HIVE_MAX_AUTHORITY_MEMBERSHIP,
+                uint32_t max_account_auths = HIVE_MAX_SIG_CHECK_ACCOUNTS,
+                bool allow_committe = false,
+                const flat_set< account_name_type >& active_approvals = flat_set< account_name_type >(),
+                const flat_set< account_name_type >& owner_approvals = flat_set< account_name_type >(),
+                const flat_set< account_name_type >& posting_approvals = flat_set< account_name_type >()
+                )
+{
+  authority_materializer active( get_active );
+  authority_materializer owner( get_owner );
+  authority_materializer posting( get_posting );
+  verify_authority( auth_containers, sigs, authority_view_getter( std::ref( active ) ),
+    authority_view_getter( std::ref( owner ) ), authority_view_getter( std::ref( posting ) ),
+    max_recursion_depth, max_membership, max_account_auths, allow_committe,
+    active_approvals, owner_approvals, posting_approvals );
+}
+
 } } // hive::protocol
@@ -24,11 +24,24 @@ bool sign_state::check_authority( const string& id )
 }
 
 bool sign_state::check_authority( const authority& auth, uint32_t depth, uint32_t account_auth_count )
+{
+  return check_authority_impl( authority_view( auth ), depth, &account_auth_count );
+}
+
+bool sign_state::check_authority( const authority_view& auth, uint32_t depth, uint32_t account_auth_count )
 {
   return check_authority_impl( auth, depth, &account_auth_count );
 }
 
-bool sign_state::check_authority_impl( const authority& auth, uint32_t depth, uint32_t* account_auth_count )
+authority_view sign_state::get_active( const account_name_type& name )
+{
+  auto itr = _resolved.find( name );
+  if( itr == _resolved.end() )
+    itr = _resolved.emplace( name, _get_active( name ) ).first;
+  return itr->second;
+}
+
+bool sign_state::check_authority_impl( const authority_view& auth, uint32_t depth, uint32_t* account_auth_count )
 {
   uint32_t total_weight = 0;
   size_t membership = 0;
@@ -102,7 +115,21 @@ sign_state::sign_state(
   const flat_set<public_key_type>& sigs,
   const authority_getter& a,
   const flat_set<public_key_type>& keys
-  ) : get_active(a), available_keys(keys)
+  ) : available_keys(keys)
+{
+  auto materializer = std::make_shared< authority_materializer >( a );
+  _get_active = [materializer]( const string& name ) { return (*materializer)( name ); };
+
+  for( const auto& key : sigs )
+    provided_signatures[ key ] = false;
+  approved_by.insert( "temp"  );
+}
+
+sign_state::sign_state(
+  const flat_set<public_key_type>& sigs,
+  const authority_view_getter& a,
+  const flat_set<public_key_type>& keys
+  ) : available_keys(keys), _get_active(a)
 {
   for( const auto& key : sigs )
     provided_signatures[ key ] = false;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <fc/log/async_appender.hpp>
 #include <fc/log/console_appender.hpp>
 #include <fc/log/file_appender.hpp>
 #include <fc/log/logger.hpp>
@@ -18,6 +19,7 @@ struct appender_args
   std::string file;
   std::string stream;
   std::string time_format;
+  bool        async = false; ///< format and write records in background thread (see fc::async_appender)
 
   void validate();
 };
@@ -37,5 +39,5 @@ fc::optional<fc::logging_config> load_logging_config( const boost::program_optio
 
 } } // hive::utilities
 
-FC_REFLECT( hive::utilities::appender_args, (appender)(file)(stream)(time_format) )
+FC_REFLECT( hive::utilities::appender_args, (appender)(file)(stream)(time_format)(async) )
 FC_REFLECT( hive::utilities::logger_args, (name)(level)(appender) )
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <fc/exception/exception.hpp>
+
+#include <boost/optional.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace hive { namespace utilities {
+
+/**
+  * Processes stream of items in two stages:
+  * - transform: runs concurrently on a pool of worker threads (e.g. conversion of data to JSON),
+  * - consume: runs on single output thread and always receives results in the order items were pushed.
+  *
+  * Number of items in flight (pushed, but not yet consumed) is bounded by capacity - when the limit
+  * is reached, push() blocks, so slow consumer throttles the producer instead of accumulating data.
+  * With no workers the transform is done by output thread right before consume.
+  *
+  * Exception thrown by either stage stops processing: pending items are dropped and the exception
+  * is rethrown to the producer by the next push() or drain().
+  */
+template< typename Input, typename Output >
+class ordered_pipeline
+{
+  public:
+    typedef std::function< Output( Input& ) >                 transform_type;
+    /// second parameter tells if there are more items ready to be consumed right after current one
+    typedef std::function< void( Output&, bool more_ready ) > consume_type;
+
+    ordered_pipeline( size_t workers, size_t capacity, transform_type transform, consume_type consume,
+      size_t thread_stack_size = 0 )
+      : _slots( std::max< size_t >( capacity, 1 ) ), _transform( std::move( transform ) ), _consume( std::move( consume ) )
+    {
+      boost::thread::attributes attrs;
+      if( thread_stack_size != 0 )
+        attrs.set_stack_size( thread_stack_size );
+
+      _inline_transform = ( workers == 0 );
+      for( size_t i = 0; i < workers; ++i )
+        _workers.emplace_back( attrs, [this]() { worker_main(); } );
+      _output_thread = boost::thread( attrs, [this]() { output_main(); } );
+    }
+
+    ~ordered_pipeline() { stop(); }
+
+    ordered_pipeline( const ordered_pipeline& ) = delete;
+    ordered_pipeline& operator=( const ordered_pipeline& ) = delete;
+
+    /// Queues item for processing; blocks while pipeline is full
+    void push( Input&& item )
+    {
+      {
+        std::unique_lock< std::mutex > lk( _mtx );
+        FC_ASSERT( !_stopping, "Cannot push items into stopped pipeline" );
+        _space_cv.wait( lk, [this]() { return _pushed - _consumed < _slots.size() || _error; } );
+        rethrow_error();
+        slot& s = _slots[ _pushed % _slots.size() ];
+        s.input = std::move( item );
+        s.output.reset();
+        ++_pushed;
+      }
+      if( _inline_transform )
+        _output_cv.notify_one();
+      else
+        _work_cv.notify_one();
+    }
+
+    /// Blocks until all pushed items are consumed
+    void drain()
+    {
+      std::unique_lock< std::mutex > lk( _mtx );
+      _space_cv.wait( lk, [this]() { return _consumed == _pushed || _error; } );
+      rethrow_error();
+    }
+
+    /// Processes all pushed items (unless pipeline failed) and joins threads; pipeline can't be used afterwards
+    void stop()
+    {
+      {
+        std::lock_guard< std::mutex > lk( _mtx );
+        if( _stopping )
+          return;
+        _stopping = true;
+      }
+      _output_cv.notify_all();
+      _output_thread.join();
+      // output thread only exits when everything was consumed (or pipeline failed), so workers are idle now
+      _work_cv.notify_all();
+      for( auto& t : _workers )
+        t.join();
+      _workers.clear();
+    }
+
+    /// Number of items pushed but not yet consumed
+    size_t size() const
+    {
+      std::lock_guard< std::mutex > lk( _mtx );
+      return _pushed - _consumed;
+    }
+
+    bool failed() const
+    {
+      std::lock_guard< std::mutex > lk( _mtx );
+      return bool( _error );
+    }
+
+  private:
+    struct slot
+    {
+      boost::optional< Input >  input;
+      boost::optional< Output > output;
+    };
+
+    void rethrow_error()
+    {
+      if( _error )
+        std::rethrow_exception( _error );
+    }
+
+    /// must be called with mutex locked
+    void fail( std::exception_ptr error )
+    {
+      if( !_error )
+        _error = error;
+      _consumed = _pushed;
+      _taken = _pushed;
+      for( auto& s : _slots )
+      {
+        s.input.reset();
+        s.output.reset();
+      }
+      _space_cv.notify_all();
+      _output_cv.notify_all();
+    }
+
+    void worker_main()
+    {
+      std::unique_lock< std::mutex > lk( _mtx );
+      while( true )
+      {
+        _work_cv.wait( lk, [this]() { return _taken < _pushed || ( _stopping && _consumed == _pushed ); } );
+        if( _taken == _pushed )
+          break;
+
+        size_t index = _taken++;
+        slot& s = _slots[ index % _slots.size() ];
+        Input input = std::move( *s.input );
+        s.input.reset();
+        lk.unlock();
+
+        boost::optional< Output > output;
+        std::exception_ptr error;
+        try
+        {
+          output = _transform( input );
+        }
+        catch( ... )
+        {
+          error = std::current_exception();
+        }
+
+        lk.lock();
+        if( error )
+          fail( error );
+        else if( index >= _consumed ) // not dropped because of failure in the meantime
+          s.output = std::move( output );
+        if( index == _consumed )
+          _output_cv.notify_one();
+      }
+    }
+
+    void output_main()
+    {
+      std::unique_lock< std::mutex > lk( _mtx );
+      while( true )
+      {
+        _output_cv.wait( lk, [this]() { return ready( _consumed ) || ( _stopping && _consumed == _pushed ); } );
+        if( !ready( _consumed ) )
+          break;
+
+        size_t index = _consumed;
+        slot& s = _slots[ index % _slots.size() ];
+        boost::optional< Input > input;
+        boost::optional< Output > output;
+        if( _inline_transform )
+        {
+          input = std::move( s.input );
+          s.input.reset();
+          ++_taken;
+        }
+        else
+        {
+          output = std::move( s.output );
+          s.output.reset();
+        }
+        bool more_ready = ready( index + 1 );
+        lk.unlock();
+
+        std::exception_ptr error;
+        try
+        {
+          if( input )
+            output = _transform( *input );
+          _consume( *output, more_ready );
+        }
+        catch( ... )
+        {
+          error = std::current_exception();
+        }
+
+        lk.lock();
+        if( error )
+        {
+          fail( error );
+        }
+        else if( index == _consumed ) // not dropped because of failure of worker in the meantime
+        {
+          ++_consumed;
+          _space_cv.notify_all();
+        }
+        if( _stopping && _consumed == _pushed )
+          _work_cv.notify_all();
+      }
+    }
+
+    /// must be called with mutex locked
+    bool ready( size_t index ) const
+    {
+      if( index >= _pushed )
+        return false;
+      const slot& s = _slots[ index % _slots.size() ];
+      return _inline_transform ? bool( s.input ) : bool( s.output );
+    }
+
+    std::vector< slot >            _slots;
+    transform_type                 _transform;
+    consume_type                   _consume;
+    bool                           _inline_transform = false;
+
+    mutable std::mutex             _mtx;
+    std::condition_variable        _work_cv;   ///< new items for workers (or stop)
+    std::condition_variable        _output_cv; ///< next item in order is ready (or stop)
+    std::condition_variable        _space_cv;  ///< items were consumed
+    size_t                         _pushed = 0;
+    size_t                         _taken = 0;
+    size_t                         _consumed = 0;
+    bool                           _stopping = false;
+    std::exception_ptr             _error;
+
+    std::vector< boost::thread >   _workers;
+    boost::thread                  _output_thread;
+};
+
+} } // hive::utilities
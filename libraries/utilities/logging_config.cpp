@@ -26,6 +26,20 @@ void logger_args::validate()
   FC_ASSERT( appender.length(), "Must specify an appender name" );
 }
 
+namespace
+{
+  fc::appender_config make_appender_config( const appender_args& appender, const string& type, const fc::variant& args )
+  {
+    if( !appender.async )
+      return fc::appender_config( appender.appender, type, args );
+
+    fc::async_appender::config async_appender_config;
+    async_appender_config.type = type;
+    async_appender_config.args = args;
+    return fc::appender_config( appender.appender, "async", fc::variant( async_appender_config ) );
+  }
+}
+
 void set_logging_program_options( boost::program_options::options_description& options )
 {
   std::vector< std::string > default_appender(
@@ -41,7 +55,8 @@ void set_logging_program_options( boost::program_options::options_description& o
 
   options.add_options()
     ("log-appender", boost::program_options::value< std::vector< std::string > >()->composing()->default_value( default_appender, str_default_appender ),
-      "Appender definition json: {\"appender\", \"stream\", \"file\"} Can only specify a file OR a stream" )
+      "Appender definition json: {\"appender\", \"stream\", \"file\", \"async\"} Can only specify a file OR a stream. "
+      "With \"async\":true records are formatted and written by background thread (dropped when producer outpaces it)" )
     ("log-console-appender", boost::program_options::value< std::vector< std::string > >()->composing() )
     ("log-file-appender", boost::program_options::value< std::vector< std::string > >()->composing() )
     ("log-logger", boost::program_options::value< std::vector< std::string > >()->composing()->default_value( default_logger, str_default_logger ),
@@ -99,8 +114,7 @@ fc::optional<fc::logging_config> load_logging_config( const boost::program_optio
           console_appender_config.stream = fc::variant( appender.stream ).as< fc::console_appender::stream::type >();
           if (appender.time_format.length())
             console_appender_config.time_format = fc::variant( appender.time_format ).as<fc::appender::time_format>();
-          logging_config.appenders.push_back(
-                                  fc::appender_config( appender.appender, "console", fc::variant( console_appender_config ) ) );
+          logging_config.appenders.push_back( make_appender_config( appender, "console", fc::variant( console_appender_config ) ) );
           found_logging_config = true;
         }
         else // validate ensures the is either a stream or file configured
@@ -119,8 +133,7 @@ fc::optional<fc::logging_config> load_logging_config( const boost::program_optio
           file_appender_config.rotation_limit = fc::days(1);
           if (appender.time_format.length())
             file_appender_config.time_format = fc::variant( appender.time_format ).as<fc::appender::time_format>();
-          logging_config.appenders.push_back(
-                                  fc::appender_config( appender.appender, "file", fc::variant( file_appender_config ) ) );
+          logging_config.appenders.push_back( make_appender_config( appender, "file", fc::variant( file_appender_config ) ) );
           found_logging_config = true;
         }
       }
@@ -0,0 +1,718 @@
+#include <hive/chain/hive_fwd.hpp>
+
+#include <hive/protocol/protocol.hpp>
+#include <hive/protocol/hive_operations.hpp>
+
+#include <hive/utilities/key_conversion.hpp>
+#include <hive/wallet/remote_node_api.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+#include <fc/network/http/websocket.hpp>
+#include <fc/rpc/websocket_api.hpp>
+#include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <vector>
+
+/*
+ * Synthetic transaction load generator for testnet / debug nodes.
+ *
+ * Setup phase creates (or reuses) --accounts test accounts named <prefix><n>, all controlled by
+ * single key derived from the prefix, funds them from --creator and makes one root post per
+ * account to be used as target of votes and replies.
+ *
+ * Load phase submits signed transactions with configured mix of operations through
+ * network_broadcast path (condenser_api.broadcast_transaction) at each of --tps-steps rates for
+ * --step-duration seconds. For every step it reports submitted/accepted/included transactions per
+ * second, admission latency (time until node accepted or rejected transaction), inclusion latency,
+ * rejections grouped by reason, backlog of accepted but not yet included transactions (estimate
+ * of pending pool, which is not exposed by API) and block fill. Step is marked as saturated when
+ * node no longer keeps up with target rate; saturation point is printed at the end.
+ *
+ * Example (testnet node with initminer):
+ *   load_generator -s ws://127.0.0.1:8090 --accounts 200 --tps-steps 50,100,200,400 \
+ *     --mix transfer=50,vote=20,comment=10,custom_json=20 --report load.json
+ */
+
+namespace bpo = boost::program_options;
+
+namespace hive { namespace load_generator {
+
+using namespace hive::protocol;
+using hive::plugins::condenser_api::legacy_signed_transaction;
+using hive::plugins::condenser_api::legacy_signed_block;
+using hive::plugins::condenser_api::legacy_asset;
+
+struct latency_summary
+{
+  uint64_t count = 0;
+  double   avg_ms = 0;
+  double   p50_ms = 0;
+  double   p90_ms = 0;
+  double   p99_ms = 0;
+  double   max_ms = 0;
+};
+
+struct rejection_entry
+{
+  std::string reason;
+  uint64_t    count = 0;
+};
+
+struct step_report
+{
+  uint32_t                       target_tps = 0;
+  double                         duration_seconds = 0;
+  uint64_t                       submitted = 0;
+  uint64_t                       accepted = 0;
+  uint64_t                       rejected = 0;
+  /// transactions not submitted because --max-in-flight requests were already waiting for node
+  uint64_t                       throttled = 0;
+  uint64_t                       included = 0;
+  double                         submitted_tps = 0;
+  double                         accepted_tps = 0;
+  double                         included_tps = 0;
+  latency_summary                admission_latency;
+  latency_summary                inclusion_latency;
+  std::vector< rejection_entry > rejections;
+  /// accepted but not yet included transactions at the end of step (estimate of pending pool)
+  uint64_t                       backlog_end = 0;
+  uint64_t                       backlog_max = 0;
+  uint32_t                       blocks = 0;
+  double                         avg_transactions_per_block = 0;
+  double                         avg_block_fill = 0;
+  double                         max_block_fill = 0;
+  bool                           saturated = false;
+};
+
+struct report
+{
+  std::string                node;
+  uint32_t                   accounts = 0;
+  std::string                mix;
+  uint32_t                   operations_per_transaction = 0;
+  std::vector< step_report > steps;
+  /// highest target rate that node kept up with (0 if none)
+  uint32_t                   max_sustained_tps = 0;
+};
+
+} } // hive::load_generator
+
+FC_REFLECT( hive::load_generator::latency_summary, (count)(avg_ms)(p50_ms)(p90_ms)(p99_ms)(max_ms) )
+FC_REFLECT( hive::load_generator::rejection_entry, (reason)(count) )
+FC_REFLECT( hive::load_generator::step_report,
+  (target_tps)(duration_seconds)(submitted)(accepted)(rejected)(throttled)(included)
+  (submitted_tps)(accepted_tps)(included_tps)(admission_latency)(inclusion_latency)(rejections)
+  (backlog_end)(backlog_max)(blocks)(avg_transactions_per_block)(avg_block_fill)(max_block_fill)(saturated) )
+FC_REFLECT( hive::load_generator::report,
+  (node)(accounts)(mix)(operations_per_transaction)(steps)(max_sustained_tps) )
+
+namespace hive { namespace load_generator {
+
+enum class load_operation { transfer, vote, comment, custom_json };
+
+struct settings
+{
+  std::string                  server;
+  chain_id_type                chain_id;
+  account_name_type            creator;
+  fc::ecc::private_key         creator_key;
+  uint32_t                     accounts = 100;
+  std::string                  account_prefix = "load";
+  asset                        fund_liquid = asset( 10000, HIVE_SYMBOL );
+  asset                        fund_vesting = asset( 10000, HIVE_SYMBOL );
+  bool                         skip_setup = false;
+  std::vector< uint32_t >      tps_steps;
+  uint32_t                     step_duration = 30;
+  std::string                  mix_string;
+  std::vector< std::pair< load_operation, uint32_t > > mix;
+  uint32_t                     operations_per_transaction = 1;
+  uint32_t                     max_in_flight = 1000;
+  uint32_t                     comment_size = 200;
+  uint32_t                     expiration = 60;
+  std::string                  report_file = "load_generator.json";
+};
+
+static std::vector< std::pair< load_operation, uint32_t > > parse_mix( const std::string& mix )
+{
+  static const std::map< std::string, load_operation > names = {
+    { "transfer", load_operation::transfer },
+    { "vote", load_operation::vote },
+    { "comment", load_operation::comment },
+    { "custom_json", load_operation::custom_json }
+  };
+
+  std::vector< std::pair< load_operation, uint32_t > > result;
+  std::vector< std::string > entries;
+  boost::split( entries, mix, boost::is_any_of( "," ) );
+  for( auto& entry : entries )
+  {
+    boost::trim( entry );
+    if( entry.empty() )
+      continue;
+    auto eq = entry.find( '=' );
+    FC_ASSERT( eq != std::string::npos, "Mix entry '${e}' has to be in form name=weight", ( "e", entry ) );
+    auto name = entry.substr( 0, eq );
+    auto it = names.find( name );
+    FC_ASSERT( it != names.end(), "Unknown operation '${n}' in mix", ( "n", name ) );
+    result.emplace_back( it->second, std::stoul( entry.substr( eq + 1 ) ) );
+  }
+  uint32_t total = 0;
+  for( const auto& m : result )
+    total += m.second;
+  FC_ASSERT( total > 0, "Mix has to contain at least one operation with nonzero weight" );
+  return result;
+}
+
+static latency_summary summarize( std::vector< int64_t >& samples_us )
+{
+  latency_summary result;
+  result.count = samples_us.size();
+  if( samples_us.empty() )
+    return result;
+  std::sort( samples_us.begin(), samples_us.end() );
+  auto at = [&]( double p ) { return samples_us[ std::min< size_t >( samples_us.size() - 1, size_t( p * samples_us.size() ) ) ] / 1000.0; };
+  int64_t sum = 0;
+  for( auto s : samples_us )
+    sum += s;
+  result.avg_ms = sum / 1000.0 / samples_us.size();
+  result.p50_ms = at( 0.5 );
+  result.p90_ms = at( 0.9 );
+  result.p99_ms = at( 0.99 );
+  result.max_ms = samples_us.back() / 1000.0;
+  return result;
+}
+
+/// shortens exception message to a line that can be used to group rejections
+static std::string rejection_reason( const fc::exception& e )
+{
+  std::string reason = e.to_string( fc::log_level::error );
+  auto eol = reason.find( '\n' );
+  if( eol != std::string::npos )
+    reason.resize( eol );
+  if( reason.size() > 120 )
+    reason.resize( 120 );
+  return reason;
+}
+
+class generator
+{
+  public:
+    generator( const settings& s, fc::api< hive::wallet::remote_node_api > api )
+      : _settings( s ), _api( api ), _random( 20261018 )
+    {
+      _account_key = fc::ecc::private_key::regenerate( fc::sha256::hash( "load_generator " + _settings.account_prefix ) );
+      for( uint32_t i = 0; i < _settings.accounts; ++i )
+        _accounts.emplace_back( _settings.account_prefix + std::to_string( i ) );
+      for( const auto& m : _settings.mix )
+        _mix_total += m.second;
+      _run_id = std::to_string( fc::time_point::now().sec_since_epoch() );
+      _report.node = _settings.server;
+      _report.accounts = _settings.accounts;
+      _report.mix = _settings.mix_string;
+      _report.operations_per_transaction = _settings.operations_per_transaction;
+    }
+
+    void setup()
+    {
+      auto props = _api->get_chain_properties();
+      asset fee = props.account_creation_fee;
+      public_key_type key = _account_key.get_public_key();
+
+      std::set< account_name_type > existing;
+      for( size_t i = 0; i < _accounts.size(); i += 100 )
+      {
+        std::vector< account_name_type > chunk( _accounts.begin() + i, _accounts.begin() + std::min( _accounts.size(), i + 100 ) );
+        for( const auto& a : _api->get_accounts( chunk ) )
+          existing.insert( a.name );
+      }
+
+      std::vector< operation > ops;
+      for( const auto& name : _accounts )
+      {
+        if( existing.count( name ) )
+          continue;
+        account_create_operation op;
+        op.fee = fee;
+        op.creator = _settings.creator;
+        op.new_account_name = name;
+        op.owner = authority( 1, key, 1 );
+        op.active = authority( 1, key, 1 );
+        op.posting = authority( 1, key, 1 );
+        op.memo_key = key;
+        ops.push_back( op );
+      }
+      std::cout << "Creating " << ops.size() << " accounts (" << existing.size() << " already exist)" << std::endl;
+      push_setup_operations( ops, _settings.creator_key );
+
+      ops.clear();
+      for( const auto& name : _accounts )
+      {
+        if( _settings.fund_liquid.amount > 0 )
+        {
+          transfer_operation op;
+          op.from = _settings.creator;
+          op.to = name;
+          op.amount = _settings.fund_liquid;
+          ops.push_back( op );
+        }
+        if( _settings.fund_vesting.amount > 0 )
+        {
+          transfer_to_vesting_operation op;
+          op.from = _settings.creator;
+          op.to = name;
+          op.amount = _settings.fund_vesting;
+          ops.push_back( op );
+        }
+      }
+      std::cout << "Funding accounts" << std::endl;
+      push_setup_operations( ops, _settings.creator_key );
+
+      // one root post per account as target for votes and replies (reposting existing one is just an edit)
+      ops.clear();
+      for( const auto& name : _accounts )
+      {
+        comment_operation op;
+        op.parent_permlink = "loadgen";
+        op.author = name;
+        op.permlink = root_permlink;
+        op.title = "load generator target";
+        op.body = "Target post for votes and replies of load generator.";
+        ops.push_back( op );
+      }
+      std::cout << "Creating root posts" << std::endl;
+      push_setup_operations( ops, _account_key );
+    }
+
+    void run()
+    {
+      refresh_head();
+      _last_seen_block = _head.head_block_number;
+      _watching = true;
+      fc::future< void > watcher = fc::async( [this]() { watch_blocks(); }, "block watcher" );
+
+      for( auto tps : _settings.tps_steps )
+      {
+        run_step( tps );
+        print_step( _report.steps.back() );
+        if( _report.steps.back().saturated == false )
+          _report.max_sustained_tps = std::max( _report.max_sustained_tps, tps );
+      }
+
+      _watching = false;
+      watcher.wait();
+
+      fc::json::save_to_file( _report, fc::path( _settings.report_file ) );
+      std::cout << std::endl;
+      if( _report.max_sustained_tps == _settings.tps_steps.back() )
+        std::cout << "Node kept up with all steps; highest tested rate: " << _report.max_sustained_tps << " tx/s" << std::endl;
+      else
+        std::cout << "Highest sustained rate: " << _report.max_sustained_tps << " tx/s" << std::endl;
+      std::cout << "Report written to " << _settings.report_file << std::endl;
+    }
+
+  private:
+    struct step_state
+    {
+      std::vector< int64_t >              admission_us;
+      std::vector< int64_t >              inclusion_us;
+      std::map< std::string, uint64_t >   rejections;
+      uint64_t                            backlog_max = 0;
+      uint32_t                            blocks = 0;
+      uint64_t                            block_transactions = 0;
+      double                              fill_sum = 0;
+      double                              fill_max = 0;
+    };
+
+    static constexpr const char* root_permlink = "loadgen-root";
+
+    void push_setup_operations( const std::vector< operation >& ops, const fc::ecc::private_key& key )
+    {
+      const size_t batch = 20;
+      for( size_t i = 0; i < ops.size(); i += batch )
+      {
+        refresh_head();
+        signed_transaction tx;
+        tx.operations.assign( ops.begin() + i, ops.begin() + std::min( ops.size(), i + batch ) );
+        sign( tx, key );
+        _api->broadcast_transaction_synchronous( legacy_signed_transaction( tx ) );
+      }
+    }
+
+    void refresh_head()
+    {
+      _head = _api->get_dynamic_global_properties();
+    }
+
+    void sign( signed_transaction& tx, const fc::ecc::private_key& key )
+    {
+      tx.set_reference_block( _head.head_block_id );
+      tx.set_expiration( _head.time + fc::seconds( _settings.expiration ) );
+      tx.sign( key, _settings.chain_id, fc::ecc::fc_canonical );
+    }
+
+    const account_name_type& random_account()
+    {
+      return _accounts[ _random() % _accounts.size() ];
+    }
+
+    load_operation pick_operation()
+    {
+      uint32_t r = _random() % _mix_total;
+      for( const auto& m : _settings.mix )
+      {
+        if( r < m.second )
+          return m.first;
+        r -= m.second;
+      }
+      return _settings.mix.back().first;
+    }
+
+    /// all operations of single transaction share author, so single signature of common key covers them
+    operation make_operation( const account_name_type& actor )
+    {
+      uint64_t seq = _sequence++;
+      switch( pick_operation() )
+      {
+        case load_operation::transfer:
+        {
+          transfer_operation op;
+          op.from = actor;
+          do { op.to = random_account(); } while( op.to == actor && _accounts.size() > 1 );
+          op.amount = asset( 1, HIVE_SYMBOL );
+          op.memo = "load " + std::to_string( seq );
+          return op;
+        }
+        case load_operation::vote:
+        {
+          vote_operation op;
+          op.voter = actor;
+          op.author = random_account();
+          op.permlink = root_permlink;
+          op.weight = int16_t( ( seq % 100 + 1 ) * ( HIVE_100_PERCENT / 100 ) );
+          return op;
+        }
+        case load_operation::comment:
+        {
+          comment_operation op;
+          op.parent_author = random_account();
+          op.parent_permlink = root_permlink;
+          op.author = actor;
+          op.permlink = "re-" + _run_id + "-" + std::to_string( seq );
+          op.body = std::string( _settings.comment_size, 'x' );
+          return op;
+        }
+        case load_operation::custom_json:
+        default:
+        {
+          custom_json_operation op;
+          op.required_posting_auths.insert( actor );
+          op.id = "load_generator";
+          op.json = "{\"seq\":" + std::to_string( seq ) + "}";
+          return op;
+        }
+      }
+    }
+
+    signed_transaction make_transaction()
+    {
+      signed_transaction tx;
+      const auto& actor = random_account();
+      for( uint32_t i = 0; i < _settings.operations_per_transaction; ++i )
+        tx.operations.push_back( make_operation( actor ) );
+      sign( tx, _account_key );
+      return tx;
+    }
+
+    void submit( signed_transaction tx )
+    {
+      ++_in_flight;
+      auto start = fc::time_point::now();
+      try
+      {
+        _api->broadcast_transaction( legacy_signed_transaction( tx ) );
+        auto now = fc::time_point::now();
+        _state.admission_us.push_back( ( now - start ).count() );
+        _pending.emplace( tx.id(), now );
+        ++_current.accepted;
+        _state.backlog_max = std::max< uint64_t >( _state.backlog_max, _pending.size() );
+      }
+      catch( const fc::exception& e )
+      {
+        _state.admission_us.push_back( ( fc::time_point::now() - start ).count() );
+        ++_current.rejected;
+        ++_state.rejections[ rejection_reason( e ) ];
+      }
+      --_in_flight;
+    }
+
+    void run_step( uint32_t tps )
+    {
+      _current = step_report();
+      _current.target_tps = tps;
+      _state = step_state();
+
+      const fc::microseconds interval( tps ? 1000000 / tps : 1000000 );
+      const auto step_start = fc::time_point::now();
+      const auto step_end = step_start + fc::seconds( _settings.step_duration );
+      auto next = step_start;
+      std::vector< fc::future< void > > submissions;
+
+      while( next < step_end )
+      {
+        auto now = fc::time_point::now();
+        if( next > now )
+          fc::usleep( next - now );
+
+        if( _in_flight >= _settings.max_in_flight )
+        {
+          ++_current.throttled;
+        }
+        else
+        {
+          ++_current.submitted;
+          submissions.push_back( fc::async( [this, tx = make_transaction()]() { submit( tx ); }, "submit" ) );
+        }
+        next += interval;
+      }
+
+      for( auto& f : submissions )
+        f.wait();
+
+      const double seconds = ( fc::time_point::now() - step_start ).count() / 1000000.0;
+      _current.duration_seconds = seconds;
+      _current.submitted_tps = _current.submitted / seconds;
+      _current.accepted_tps = _current.accepted / seconds;
+      _current.included_tps = _current.included / seconds;
+      _current.admission_latency = summarize( _state.admission_us );
+      _current.inclusion_latency = summarize( _state.inclusion_us );
+      for( const auto& r : _state.rejections )
+        _current.rejections.push_back( { r.first, r.second } );
+      std::sort( _current.rejections.begin(), _current.rejections.end(),
+        []( const rejection_entry& a, const rejection_entry& b ) { return a.count > b.count; } );
+      _current.backlog_end = _pending.size();
+      _current.backlog_max = _state.backlog_max;
+      _current.blocks = _state.blocks;
+      if( _state.blocks )
+      {
+        _current.avg_transactions_per_block = double( _state.block_transactions ) / _state.blocks;
+        _current.avg_block_fill = _state.fill_sum / _state.blocks;
+      }
+      _current.max_block_fill = _state.fill_max;
+      // node does not keep up when it throttles us, rejects noticeable part of traffic or accepted
+      // transactions pile up instead of being included in blocks
+      _current.saturated = _current.throttled > 0 ||
+        _current.rejected * 20 > _current.submitted ||
+        _current.included_tps < 0.9 * tps;
+      _report.steps.push_back( _current );
+    }
+
+    void watch_blocks()
+    {
+      while( _watching )
+      {
+        try
+        {
+          refresh_head();
+          while( _last_seen_block < _head.head_block_number )
+          {
+            auto block = _api->get_block( _last_seen_block + 1 );
+            if( !block.valid() )
+              break;
+            ++_last_seen_block;
+            process_block( *block );
+          }
+        }
+        catch( const fc::exception& e )
+        {
+          wlog( "Error while watching blocks: ${e}", ( "e", e.to_detail_string() ) );
+        }
+        fc::usleep( fc::milliseconds( 250 ) );
+      }
+    }
+
+    void process_block( const legacy_signed_block& block )
+    {
+      auto now = fc::time_point::now();
+      // binary size of transactions in their legacy (API) form approximates size of the block
+      size_t size = fc::raw::pack_size( block.transactions );
+      double fill = _head.maximum_block_size ? double( size ) / _head.maximum_block_size : 0;
+      ++_state.blocks;
+      _state.block_transactions += block.transactions.size();
+      _state.fill_sum += fill;
+      _state.fill_max = std::max( _state.fill_max, fill );
+
+      for( const auto& id : block.transaction_ids )
+      {
+        auto it = _pending.find( id );
+        if( it == _pending.end() )
+          continue;
+        // inclusion is credited to the step that is running now, latency is measured from acceptance
+        _state.inclusion_us.push_back( ( now - it->second ).count() );
+        ++_current.included;
+        _pending.erase( it );
+      }
+
+      // transactions that expired are not going to be included anymore
+      auto expiration_limit = now - fc::seconds( _settings.expiration + 30 );
+      for( auto it = _pending.begin(); it != _pending.end(); )
+      {
+        if( it->second < expiration_limit )
+          it = _pending.erase( it );
+        else
+          ++it;
+      }
+    }
+
+    void print_step( const step_report& s )
+    {
+      std::cout << std::fixed << std::setprecision( 1 );
+      std::cout << std::endl << "=== target " << s.target_tps << " tx/s" << ( s.saturated ? " (SATURATED)" : "" ) << std::endl;
+      std::cout << "  submitted " << s.submitted_tps << " tx/s, accepted " << s.accepted_tps
+        << " tx/s, included " << s.included_tps << " tx/s, throttled " << s.throttled << std::endl;
+      std::cout << "  admission latency ms: p50 " << s.admission_latency.p50_ms << ", p90 " << s.admission_latency.p90_ms
+        << ", p99 " << s.admission_latency.p99_ms << ", max " << s.admission_latency.max_ms << std::endl;
+      std::cout << "  inclusion latency ms: p50 " << s.inclusion_latency.p50_ms << ", p99 " << s.inclusion_latency.p99_ms << std::endl;
+      std::cout << "  backlog end " << s.backlog_end << ", max " << s.backlog_max << "; blocks " << s.blocks
+        << ", avg tx/block " << s.avg_transactions_per_block << ", avg fill " << s.avg_block_fill * 100
+        << "%, max fill " << s.max_block_fill * 100 << "%" << std::endl;
+      for( const auto& r : s.rejections )
+        std::cout << "  rejected " << r.count << "x: " << r.reason << std::endl;
+    }
+
+    settings                                   _settings;
+    fc::api< hive::wallet::remote_node_api >   _api;
+    fc::ecc::private_key                       _account_key;
+    std::vector< account_name_type >           _accounts;
+    uint32_t                                   _mix_total = 0;
+    std::mt19937                               _random;
+    std::string                                _run_id;
+    uint64_t                                   _sequence = 0;
+
+    hive::plugins::condenser_api::extended_dynamic_global_properties _head;
+    uint32_t                                   _last_seen_block = 0;
+    bool                                       _watching = false;
+
+    uint32_t                                   _in_flight = 0;
+    /// accepted transactions not yet seen in any block, with time of acceptance
+    std::map< transaction_id_type, fc::time_point > _pending;
+    step_report                                _current;
+    step_state                                 _state;
+    report                                     _report;
+};
+
+} } // hive::load_generator
+
+int main( int argc, char** argv )
+{
+  using namespace hive::load_generator;
+
+  try
+  {
+    const std::string default_fund = legacy_asset::from_asset( hive::protocol::asset( 10000, HIVE_SYMBOL ) ).to_string();
+
+    bpo::options_description opts;
+    opts.add_options()
+      ( "help,h", "Print this help message and exit." )
+      ( "server-rpc-endpoint,s", bpo::value< std::string >()->default_value( "ws://127.0.0.1:8090" ), "Server websocket RPC endpoint" )
+      ( "cert-authority,a", bpo::value< std::string >()->default_value( "_default" ), "Trusted CA bundle file for connecting to wss:// TLS server" )
+      ( "chain-id", bpo::value< std::string >()->default_value( std::string( HIVE_CHAIN_ID ) ), "chain ID to connect to" )
+      ( "creator", bpo::value< std::string >()->default_value( HIVE_INIT_MINER_NAME ), "Account that creates and funds test accounts" )
+      ( "creator-key", bpo::value< std::string >(), "WIF active key of creator (initminer key of testnet by default)" )
+      ( "accounts", bpo::value< uint32_t >()->default_value( 100 ), "Number of test accounts" )
+      ( "account-prefix", bpo::value< std::string >()->default_value( "load" ), "Prefix of test account names" )
+      ( "fund", bpo::value< std::string >()->default_value( default_fund ), "Liquid HIVE transferred to each test account" )
+      ( "fund-vesting", bpo::value< std::string >()->default_value( default_fund ), "HIVE powered up for each test account (gives RC and voting power)" )
+      ( "skip-setup", "Don't create/fund accounts and root posts (they exist from previous run)" )
+      ( "tps-steps", bpo::value< std::string >()->default_value( "10,50,100,200" ), "Comma separated list of target transaction rates" )
+      ( "step-duration", bpo::value< uint32_t >()->default_value( 30 ), "Duration of each step in seconds" )
+      ( "mix", bpo::value< std::string >()->default_value( "transfer=50,vote=20,comment=10,custom_json=20" ), "Weights of operation types" )
+      ( "ops-per-transaction", bpo::value< uint32_t >()->default_value( 1 ), "Number of operations in each transaction" )
+      ( "max-in-flight", bpo::value< uint32_t >()->default_value( 1000 ), "Maximum number of transactions waiting for response of node" )
+      ( "comment-size", bpo::value< uint32_t >()->default_value( 200 ), "Size of body of generated comments" )
+      ( "expiration", bpo::value< uint32_t >()->default_value( 60 ), "Expiration of transactions in seconds" )
+      ( "report", bpo::value< std::string >()->default_value( "load_generator.json" ), "File to write JSON report to" )
+      ;
+
+    bpo::variables_map options;
+    bpo::store( bpo::parse_command_line( argc, argv, opts ), options );
+    bpo::notify( options );
+
+    if( options.count( "help" ) )
+    {
+      std::cout << opts << "\n";
+      return 0;
+    }
+
+    settings s;
+    s.server = options.at( "server-rpc-endpoint" ).as< std::string >();
+    s.chain_id = hive::protocol::chain_id_type( options.at( "chain-id" ).as< std::string >() );
+    s.creator = options.at( "creator" ).as< std::string >();
+    if( options.count( "creator-key" ) )
+    {
+      auto key = hive::utilities::wif_to_key( options.at( "creator-key" ).as< std::string >() );
+      FC_ASSERT( key.valid(), "Invalid creator key" );
+      s.creator_key = *key;
+    }
+    else
+    {
+#ifdef IS_TEST_NET
+      s.creator_key = HIVE_INIT_PRIVATE_KEY;
+#else
+      FC_ASSERT( false, "--creator-key is required" );
+#endif
+    }
+    s.accounts = options.at( "accounts" ).as< uint32_t >();
+    s.account_prefix = options.at( "account-prefix" ).as< std::string >();
+    FC_ASSERT( s.accounts > 0, "At least one test account is required" );
+    FC_ASSERT( s.account_prefix.size() + std::to_string( s.accounts - 1 ).size() <= HIVE_MAX_ACCOUNT_NAME_LENGTH,
+      "Account prefix is too long for ${n} accounts", ( "n", s.accounts ) );
+    FC_ASSERT( hive::protocol::is_valid_account_name( s.account_prefix + "0" ), "Invalid account prefix" );
+    s.fund_liquid = legacy_asset::from_string( options.at( "fund" ).as< std::string >() ).to_asset();
+    s.fund_vesting = legacy_asset::from_string( options.at( "fund-vesting" ).as< std::string >() ).to_asset();
+    s.skip_setup = options.count( "skip-setup" ) > 0;
+
+    std::vector< std::string > steps;
+    boost::split( steps, options.at( "tps-steps" ).as< std::string >(), boost::is_any_of( "," ) );
+    for( const auto& step : steps )
+      if( !boost::trim_copy( step ).empty() )
+        s.tps_steps.push_back( std::stoul( step ) );
+    FC_ASSERT( !s.tps_steps.empty(), "At least one step is required" );
+
+    s.step_duration = options.at( "step-duration" ).as< uint32_t >();
+    s.mix_string = options.at( "mix" ).as< std::string >();
+    s.mix = parse_mix( s.mix_string );
+    s.operations_per_transaction = std::max( 1u, options.at( "ops-per-transaction" ).as< uint32_t >() );
+    s.max_in_flight = std::max( 1u, options.at( "max-in-flight" ).as< uint32_t >() );
+    s.comment_size = options.at( "comment-size" ).as< uint32_t >();
+    s.expiration = options.at( "expiration" ).as< uint32_t >();
+    FC_ASSERT( s.expiration > 0 && s.expiration <= HIVE_MAX_TIME_UNTIL_EXPIRATION, "Invalid expiration" );
+    s.report_file = options.at( "report" ).as< std::string >();
+
+    fc::http::websocket_client client( options.at( "cert-authority" ).as< std::string >() );
+    auto con = client.connect( s.server );
+    auto apic = std::make_shared< fc::rpc::websocket_api_connection >( *con );
+    auto remote_api = apic->get_remote_api< hive::wallet::remote_node_api >( 0, "condenser_api" );
+
+    generator gen( s, remote_api );
+    if( !s.skip_setup )
+      gen.setup();
+    gen.run();
+  }
+  catch( const fc::exception& e )
+  {
+    std::cerr << e.to_detail_string() << "\n";
+    return -1;
+  }
+  return 0;
+}
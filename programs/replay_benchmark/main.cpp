@@ -0,0 +1,604 @@
+#include <appbase/application.hpp>
+#include <hive/manifest/plugins.hpp>
+
+#include <hive/chain/block_log.hpp>
+#include <hive/chain/database.hpp>
+
+#include <hive/plugins/chain/chain_plugin.hpp>
+#include <hive/plugins/statsd/metrics.hpp>
+
+#include <hive/utilities/git_revision.hpp>
+#include <hive/utilities/logging_config.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/program_options.hpp>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <vector>
+
+/*
+ * Repeatable benchmark of block processing. Replays (or pushes like during sync) given slice of
+ * block_log and writes machine readable report with blocks/s, distribution of block processing
+ * time and, unless disabled, breakdown of time spent in evaluators, plugin handlers and handling
+ * of undo state (as recorded by advanced benchmark of database), write lock wait/hold times
+ * (push mode) and memory usage.
+ *
+ * Modes:
+ *  replay - blocks are applied by replay (reindex) up to --to block. State is loaded from snapshot
+ *           given with --snapshot or built from scratch (--force-replay); blocks before --from are
+ *           applied but not measured, so both variants start from the same state on every run.
+ *  push   - blocks from --source-block-log are pushed one by one with push_block under write lock,
+ *           like during sync (undo sessions, fork database, block_log writes, full validation).
+ *           State (data dir or --snapshot) has to end where block_log of data dir ends.
+ *
+ * Comparison mode: replay_benchmark --compare base.json current.json [--max-regression pct]
+ * prints differences between two reports; exit code is 1 when blocks/s dropped by more than
+ * given percentage.
+ *
+ * All other options (-d, --plugin, --shared-file-dir etc.) are passed to the node unchanged.
+ */
+
+namespace bpo = boost::program_options;
+
+namespace hive { namespace replay_benchmark {
+
+struct timing_entry
+{
+  std::string name;
+  uint64_t    time_us = 0;
+  double      us_per_block = 0;
+  /// fraction of total elapsed time
+  double      share = 0;
+};
+
+struct latency_summary
+{
+  uint64_t count = 0;
+  double   avg_us = 0;
+  uint64_t p50_us = 0;
+  uint64_t p90_us = 0;
+  uint64_t p99_us = 0;
+  uint64_t max_us = 0;
+};
+
+struct memory_stats
+{
+  uint64_t shared_memory_size = 0;
+  uint64_t shared_memory_used_begin = 0;
+  uint64_t shared_memory_used_end = 0;
+  int64_t  shared_memory_growth = 0;
+  uint64_t peak_rss_kb = 0;
+};
+
+struct report
+{
+  std::string                 label;
+  std::string                 mode;
+  std::string                 revision;
+  uint32_t                    first_block = 0;
+  uint32_t                    last_block = 0;
+  uint32_t                    blocks = 0;
+  double                      elapsed_seconds = 0;
+  double                      blocks_per_second = 0;
+  latency_summary             block_time;
+  bool                        breakdown = false;
+  std::vector< timing_entry > evaluators;
+  std::vector< timing_entry > plugins;
+  std::vector< timing_entry > undo;
+  std::vector< timing_entry > other;
+  bool                        locks_measured = false;
+  latency_summary             write_lock_wait;
+  latency_summary             write_lock_hold;
+  memory_stats                memory;
+};
+
+} } // hive::replay_benchmark
+
+FC_REFLECT( hive::replay_benchmark::timing_entry, (name)(time_us)(us_per_block)(share) )
+FC_REFLECT( hive::replay_benchmark::latency_summary, (count)(avg_us)(p50_us)(p90_us)(p99_us)(max_us) )
+FC_REFLECT( hive::replay_benchmark::memory_stats,
+  (shared_memory_size)(shared_memory_used_begin)(shared_memory_used_end)(shared_memory_growth)(peak_rss_kb) )
+FC_REFLECT( hive::replay_benchmark::report,
+  (label)(mode)(revision)(first_block)(last_block)(blocks)(elapsed_seconds)(blocks_per_second)(block_time)
+  (breakdown)(evaluators)(plugins)(undo)(other)(locks_measured)(write_lock_wait)(write_lock_hold)(memory) )
+
+namespace hive { namespace replay_benchmark {
+
+using hive::chain::database;
+using hive::plugins::statsd::histogram_metric;
+
+struct settings
+{
+  std::string mode = "replay";
+  uint32_t    from = 0;
+  uint32_t    to = 0;
+  std::string source_block_log;
+  std::string report_file = "replay_benchmark.json";
+  std::string label;
+  bool        breakdown = true;
+};
+
+static latency_summary summarize( const histogram_metric& histogram )
+{
+  auto s = histogram.get_snapshot();
+  latency_summary result;
+  result.count = s.count;
+  result.avg_us = s.count ? double( s.sum ) / s.count : 0;
+  result.p50_us = s.percentile( 0.5 );
+  result.p90_us = s.percentile( 0.9 );
+  result.p99_us = s.percentile( 0.99 );
+  result.max_us = s.max();
+  return result;
+}
+
+static uint64_t peak_rss_kb()
+{
+  struct rusage usage;
+  if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    return 0;
+  return uint64_t( usage.ru_maxrss );
+}
+
+class replay_benchmark_plugin : public appbase::plugin< replay_benchmark_plugin >
+{
+  public:
+    APPBASE_PLUGIN_REQUIRES( (hive::plugins::chain::chain_plugin) )
+
+    static const std::string& name() { static std::string name = "replay_benchmark"; return name; }
+
+    void configure( const settings& s ) { _settings = s; }
+
+    virtual void set_program_options( appbase::options_description& cli, appbase::options_description& cfg ) override {}
+
+    virtual void plugin_initialize( const appbase::variables_map& options ) override
+    {
+      _db = &appbase::app().get_plugin< hive::plugins::chain::chain_plugin >().db();
+
+      // first and last of all handlers, so time of block includes other plugins
+      _pre_apply_block_conn = _db->add_pre_apply_block_handler( [this]( const hive::chain::block_notification& note )
+      {
+        on_pre_apply_block( note.block_num );
+      }, *this, std::numeric_limits< int32_t >::min() );
+      _post_apply_block_conn = _db->add_post_apply_block_handler( [this]( const hive::chain::block_notification& note )
+      {
+        on_post_apply_block( note.block_num );
+      }, *this, std::numeric_limits< int32_t >::max() );
+    }
+
+    virtual void plugin_startup() override
+    {
+      if( _settings.mode == "push" )
+        push_blocks();
+    }
+
+    virtual void plugin_shutdown() override
+    {
+      _pre_apply_block_conn.disconnect();
+      _post_apply_block_conn.disconnect();
+    }
+
+    /// Writes report when it was not written yet (run ended before last block of the slice)
+    void finish()
+    {
+      if( _measuring && !_written )
+        write_report();
+    }
+
+  private:
+    typedef std::map< std::string, uint64_t > item_times;
+
+    item_times collect_items()const
+    {
+      item_times result;
+      for( const auto& i : _db->get_benchmark_dumper().get_items() )
+        result[ i.op_name ] = i.time;
+      return result;
+    }
+
+    uint64_t shared_memory_used()const
+    {
+      return _db->get_max_memory() - _db->get_free_memory();
+    }
+
+    void on_pre_apply_block( uint32_t block_num )
+    {
+      if( _written || block_num > _settings.to )
+        return;
+      if( !_measuring && block_num >= _settings.from )
+      {
+        _measuring = true;
+        _first_block = block_num;
+        _begin_items = collect_items();
+        _report.memory.shared_memory_size = _db->get_max_memory();
+        _report.memory.shared_memory_used_begin = shared_memory_used();
+        _begin_time = fc::time_point::now();
+        ilog( "Benchmark measurement starts at block ${b}", ("b", block_num) );
+      }
+      _block_start = fc::time_point::now();
+    }
+
+    void on_post_apply_block( uint32_t block_num )
+    {
+      if( !_measuring || _written || block_num > _settings.to )
+        return;
+      _end_time = fc::time_point::now();
+      _block_time.record( _end_time - _block_start );
+      _last_block = block_num;
+      ++_blocks;
+      _report.memory.shared_memory_used_end = shared_memory_used();
+      if( block_num == _settings.to )
+        write_report();
+    }
+
+    void push_blocks()
+    {
+      FC_ASSERT( !_settings.source_block_log.empty(), "push mode requires --source-block-log" );
+
+      hive::chain::block_log source;
+      source.open( fc::path( _settings.source_block_log ), true );
+
+      uint32_t head = _db->head_block_num();
+      auto log_head = _db->fetch_block_by_number( head );
+      FC_ASSERT( head == 0 || log_head.valid(), "block_log of data dir has to contain state head block ${b}", ("b", head) );
+      FC_ASSERT( _settings.to > head, "State is already at block ${h}, nothing to push", ("h", head) );
+
+      _report.locks_measured = true;
+      ilog( "Pushing blocks ${f}..${t} from ${s}", ("f", head + 1)("t", _settings.to)("s", _settings.source_block_log) );
+
+      for( uint32_t num = head + 1; num <= _settings.to && !appbase::app().is_interrupt_request(); ++num )
+      {
+        auto block = source.read_block_by_num( num );
+        FC_ASSERT( block.valid(), "Block ${b} is missing in source block_log", ("b", num) );
+
+        bool measured = num >= _settings.from;
+        auto wait_start = fc::time_point::now();
+        _db->with_write_lock( [&]()
+        {
+          auto hold_start = fc::time_point::now();
+          _db->push_block( *block, database::skip_nothing );
+          if( measured )
+          {
+            _lock_wait.record( hold_start - wait_start );
+            _lock_hold.record( fc::time_point::now() - hold_start );
+          }
+        } );
+      }
+
+      source.close();
+      appbase::app().generate_interrupt_request();
+    }
+
+    void add_entry( std::map< std::string, uint64_t >& group, const std::string& name, uint64_t time )
+    {
+      group[ name ] += time;
+    }
+
+    std::vector< timing_entry > to_entries( const std::map< std::string, uint64_t >& group, double elapsed_us )const
+    {
+      std::vector< timing_entry > result;
+      for( const auto& g : group )
+      {
+        timing_entry e;
+        e.name = g.first;
+        e.time_us = g.second;
+        e.us_per_block = _blocks ? double( g.second ) / _blocks : 0;
+        e.share = elapsed_us > 0 ? double( g.second ) / elapsed_us : 0;
+        result.push_back( e );
+      }
+      std::sort( result.begin(), result.end(), []( const timing_entry& a, const timing_entry& b ) { return a.time_us > b.time_us; } );
+      return result;
+    }
+
+    void build_breakdown( double elapsed_us )
+    {
+      static const std::string evaluator_prefix = "apply_context--->";
+      static const std::string undo_prefix = "undo--->";
+      static const std::string pre_prefix = "pre--->";
+      static const std::string post_prefix = "post--->";
+      static const std::string separator = "--->";
+
+      auto plugin_names = appbase::app().get_plugins_names();
+      std::map< std::string, uint64_t > evaluators, plugins, undo, other;
+
+      for( const auto& item : _end_items )
+      {
+        auto begin_itr = _begin_items.find( item.first );
+        uint64_t time = item.second - ( begin_itr == _begin_items.end() ? 0 : begin_itr->second );
+        if( time == 0 )
+          continue;
+
+        const std::string& n = item.first;
+        if( n.compare( 0, evaluator_prefix.size(), evaluator_prefix ) == 0 )
+          add_entry( evaluators, n.substr( evaluator_prefix.size() ), time );
+        else if( n.compare( 0, undo_prefix.size(), undo_prefix ) == 0 )
+          add_entry( undo, n.substr( undo_prefix.size() ), time );
+        else if( n.compare( 0, pre_prefix.size(), pre_prefix ) == 0 || n.compare( 0, post_prefix.size(), post_prefix ) == 0 )
+        {
+          // pre--->plugin--->operation
+          size_t start = n.find( separator ) + separator.size();
+          size_t end = n.find( separator, start );
+          add_entry( plugins, n.substr( start, end == std::string::npos ? std::string::npos : end - start ), time );
+        }
+        else if( n == name() )
+          continue;
+        else if( plugin_names.count( n ) )
+          add_entry( plugins, n, time );
+        else
+          add_entry( other, n, time );
+      }
+
+      _report.evaluators = to_entries( evaluators, elapsed_us );
+      _report.plugins = to_entries( plugins, elapsed_us );
+      _report.undo = to_entries( undo, elapsed_us );
+      _report.other = to_entries( other, elapsed_us );
+    }
+
+    void write_report()
+    {
+      _written = true;
+
+      double elapsed_us = double( ( _end_time - _begin_time ).count() );
+      _report.label = _settings.label;
+      _report.mode = _settings.mode;
+      _report.revision = hive::utilities::git_revision_sha;
+      _report.first_block = _first_block;
+      _report.last_block = _last_block;
+      _report.blocks = _blocks;
+      _report.elapsed_seconds = elapsed_us / 1000000.0;
+      _report.blocks_per_second = elapsed_us > 0 ? _blocks * 1000000.0 / elapsed_us : 0;
+      _report.block_time = summarize( _block_time );
+      _report.breakdown = _db->get_benchmark_dumper().is_enabled();
+      if( _report.breakdown )
+      {
+        // items are read once at the end, the same as dumper state after last measured block as long as
+        // no block is applied after it (replay and push both stop at the end of the slice)
+        _end_items = collect_items();
+        build_breakdown( elapsed_us );
+      }
+      if( _report.locks_measured )
+      {
+        _report.write_lock_wait = summarize( _lock_wait );
+        _report.write_lock_hold = summarize( _lock_hold );
+      }
+      _report.memory.shared_memory_growth = int64_t( _report.memory.shared_memory_used_end ) - int64_t( _report.memory.shared_memory_used_begin );
+      _report.memory.peak_rss_kb = peak_rss_kb();
+
+      fc::json::save_to_file( _report, fc::path( _settings.report_file ) );
+      ilog( "Benchmark of blocks ${f}..${l}: ${bps} blocks/s, report written to ${r}",
+        ("f", _first_block)("l", _last_block)("bps", _report.blocks_per_second)("r", _settings.report_file) );
+    }
+
+    settings                        _settings;
+    database*                       _db = nullptr;
+    hive::chain::util::notification_connection _pre_apply_block_conn;
+    hive::chain::util::notification_connection _post_apply_block_conn;
+
+    bool                            _measuring = false;
+    bool                            _written = false;
+    uint32_t                        _first_block = 0;
+    uint32_t                        _last_block = 0;
+    uint32_t                        _blocks = 0;
+    fc::time_point                  _begin_time;
+    fc::time_point                  _end_time;
+    fc::time_point                  _block_start;
+    item_times                      _begin_items;
+    item_times                      _end_items;
+
+    histogram_metric                _block_time{ "replay_benchmark.block_time", "Time of processing block in microseconds" };
+    histogram_metric                _lock_wait{ "replay_benchmark.write_lock_wait", "Time of waiting for write lock in microseconds" };
+    histogram_metric                _lock_hold{ "replay_benchmark.write_lock_hold", "Time of holding write lock in microseconds" };
+    report                          _report;
+};
+
+/// Relative change in percent (positive when current is bigger)
+static double change( double base, double current )
+{
+  if( base == 0 )
+    return current == 0 ? 0 : 100;
+  return ( current - base ) * 100.0 / base;
+}
+
+static void print_row( const std::string& name, double base, double current )
+{
+  std::cout << std::left << std::setw( 56 ) << name << std::right
+            << std::setw( 14 ) << std::fixed << std::setprecision( 2 ) << base
+            << std::setw( 14 ) << current
+            << std::setw( 10 ) << std::showpos << change( base, current ) << "%" << std::noshowpos << "\n";
+}
+
+static void compare_entries( const std::string& prefix, const std::vector< timing_entry >& base,
+  const std::vector< timing_entry >& current, size_t top )
+{
+  // compared per block, so reports of slices of different length remain comparable
+  std::map< std::string, std::pair< double, double > > rows;
+  for( const auto& e : base )
+    rows[ e.name ].first = e.us_per_block;
+  for( const auto& e : current )
+    rows[ e.name ].second = e.us_per_block;
+
+  std::vector< std::pair< std::string, std::pair< double, double > > > sorted( rows.begin(), rows.end() );
+  std::sort( sorted.begin(), sorted.end(), []( const auto& a, const auto& b )
+  {
+    return std::fabs( a.second.second - a.second.first ) > std::fabs( b.second.second - b.second.first );
+  } );
+  if( sorted.size() > top )
+    sorted.resize( top );
+  for( const auto& r : sorted )
+    print_row( prefix + r.first + " [us/block]", r.second.first, r.second.second );
+}
+
+static int compare_reports( const std::string& base_file, const std::string& current_file, double max_regression, size_t top )
+{
+  auto base = fc::json::from_file( fc::path( base_file ) ).as< report >();
+  auto current = fc::json::from_file( fc::path( current_file ) ).as< report >();
+
+  std::cout << "base:    " << base_file << " (" << base.label << ", " << base.mode << ", blocks " << base.first_block << ".." << base.last_block << ", " << base.revision << ")\n";
+  std::cout << "current: " << current_file << " (" << current.label << ", " << current.mode << ", blocks " << current.first_block << ".." << current.last_block << ", " << current.revision << ")\n";
+  if( base.mode != current.mode || base.first_block != current.first_block || base.last_block != current.last_block )
+    std::cout << "WARNING: reports were made for different slices or modes\n";
+  std::cout << "\n" << std::left << std::setw( 56 ) << "metric" << std::right << std::setw( 14 ) << "base" << std::setw( 14 ) << "current" << std::setw( 11 ) << "change" << "\n";
+
+  print_row( "blocks_per_second", base.blocks_per_second, current.blocks_per_second );
+  print_row( "block_time.avg_us", base.block_time.avg_us, current.block_time.avg_us );
+  print_row( "block_time.p50_us", base.block_time.p50_us, current.block_time.p50_us );
+  print_row( "block_time.p90_us", base.block_time.p90_us, current.block_time.p90_us );
+  print_row( "block_time.p99_us", base.block_time.p99_us, current.block_time.p99_us );
+  print_row( "block_time.max_us", base.block_time.max_us, current.block_time.max_us );
+  if( base.locks_measured && current.locks_measured )
+  {
+    print_row( "write_lock_wait.avg_us", base.write_lock_wait.avg_us, current.write_lock_wait.avg_us );
+    print_row( "write_lock_hold.avg_us", base.write_lock_hold.avg_us, current.write_lock_hold.avg_us );
+    print_row( "write_lock_hold.p99_us", base.write_lock_hold.p99_us, current.write_lock_hold.p99_us );
+  }
+  print_row( "memory.shared_memory_growth", base.memory.shared_memory_growth, current.memory.shared_memory_growth );
+  print_row( "memory.peak_rss_kb", base.memory.peak_rss_kb, current.memory.peak_rss_kb );
+  if( base.breakdown && current.breakdown )
+  {
+    compare_entries( "undo:", base.undo, current.undo, top );
+    compare_entries( "plugin:", base.plugins, current.plugins, top );
+    compare_entries( "evaluator:", base.evaluators, current.evaluators, top );
+    compare_entries( "other:", base.other, current.other, top );
+  }
+
+  double throughput_change = change( base.blocks_per_second, current.blocks_per_second );
+  if( max_regression > 0 && -throughput_change > max_regression )
+  {
+    std::cout << "\nREGRESSION: blocks/s dropped by " << -throughput_change << "% (allowed " << max_regression << "%)\n";
+    return 1;
+  }
+  return 0;
+}
+
+} } // hive::replay_benchmark
+
+int main( int argc, char** argv )
+{
+  using namespace hive::replay_benchmark;
+
+  try
+  {
+    bpo::options_description options( "Replay benchmark options (all other options are passed to the node)" );
+    options.add_options()
+      ("help", "Print this help message and exit.")
+      ("from", bpo::value< uint32_t >()->default_value( 0 ), "First measured block (earlier blocks are applied but not measured; 0 means first applied block)")
+      ("to", bpo::value< uint32_t >(), "Last block of benchmarked slice")
+      ("mode", bpo::value< std::string >()->default_value( "replay" ), "replay (reindex up to --to) or push (push_block of each block like during sync)")
+      ("snapshot", bpo::value< std::string >(), "Name of state snapshot (in snapshot-root-dir) to start from")
+      ("source-block-log", bpo::value< std::string >(), "block_log with blocks to push (push mode)")
+      ("report", bpo::value< std::string >()->default_value( "replay_benchmark.json" ), "File to write report to")
+      ("label", bpo::value< std::string >()->default_value( "" ), "Label of the run stored in report")
+      ("no-breakdown", bpo::bool_switch()->default_value( false ), "Do not measure evaluators, plugins and undo handling (measuring adds overhead)")
+      ("compare", bpo::value< std::vector< std::string > >()->multitoken(), "Compare two reports: --compare base.json current.json")
+      ("max-regression", bpo::value< double >()->default_value( 0 ), "With --compare: fail when blocks/s dropped by more than given percentage")
+      ("top", bpo::value< uint32_t >()->default_value( 20 ), "With --compare: number of entries shown for each breakdown category")
+      ;
+
+    bpo::variables_map vm;
+    auto parsed = bpo::command_line_parser( argc, argv ).options( options ).allow_unregistered().run();
+    bpo::store( parsed, vm );
+    bpo::notify( vm );
+
+    if( vm.count( "help" ) )
+    {
+      std::cout << options << "\n";
+      return 0;
+    }
+
+    if( vm.count( "compare" ) )
+    {
+      auto files = vm.at( "compare" ).as< std::vector< std::string > >();
+      FC_ASSERT( files.size() == 2, "--compare requires two report files" );
+      return compare_reports( files[0], files[1], vm.at( "max-regression" ).as< double >(), vm.at( "top" ).as< uint32_t >() );
+    }
+
+    FC_ASSERT( vm.count( "to" ), "--to is required" );
+
+    settings s;
+    s.mode = vm.at( "mode" ).as< std::string >();
+    s.from = vm.at( "from" ).as< uint32_t >();
+    s.to = vm.at( "to" ).as< uint32_t >();
+    s.report_file = vm.at( "report" ).as< std::string >();
+    s.label = vm.at( "label" ).as< std::string >();
+    s.breakdown = !vm.at( "no-breakdown" ).as< bool >();
+    if( vm.count( "source-block-log" ) )
+      s.source_block_log = vm.at( "source-block-log" ).as< std::string >();
+    FC_ASSERT( s.mode == "replay" || s.mode == "push", "Unknown mode ${m}", ("m", s.mode) );
+    FC_ASSERT( s.from <= s.to, "--from has to be lower than --to" );
+
+    // node options, benchmark options replaced with their node equivalents
+    std::vector< std::string > node_args = bpo::collect_unrecognized( parsed.options, bpo::include_positional );
+    if( vm.count( "snapshot" ) )
+    {
+      node_args.push_back( "--plugin=state_snapshot" );
+      node_args.push_back( "--load-snapshot=" + vm.at( "snapshot" ).as< std::string >() );
+    }
+    if( s.mode == "replay" )
+    {
+      node_args.push_back( vm.count( "snapshot" ) ? "--replay-blockchain" : "--force-replay" );
+      node_args.push_back( "--stop-replay-at-block=" + std::to_string( s.to ) );
+      node_args.push_back( "--exit-after-replay" );
+    }
+    if( s.breakdown )
+      node_args.push_back( "--advanced-benchmark" );
+
+    std::vector< char* > node_argv{ argv[0] };
+    for( auto& a : node_args )
+      node_argv.push_back( &a[0] );
+
+    auto& theApp = appbase::app();
+    bpo::options_description logging_options;
+    hive::utilities::set_logging_program_options( logging_options );
+    theApp.add_program_options( bpo::options_description(), logging_options );
+    hive::plugins::register_plugins();
+    auto& benchmark = theApp.register_plugin< replay_benchmark_plugin >();
+    benchmark.configure( s );
+    theApp.set_version_string( hive::utilities::git_revision_sha );
+    theApp.set_app_name( "replay_benchmark" );
+
+    if( !theApp.initialize< hive::plugins::chain::chain_plugin, replay_benchmark_plugin >( int( node_argv.size() ), node_argv.data() ) )
+      return 0;
+
+    try
+    {
+      fc::optional< fc::logging_config > logging_config = hive::utilities::load_logging_config( theApp.get_args(), theApp.data_dir() );
+      if( logging_config )
+        fc::configure_logging( *logging_config );
+    }
+    catch( const fc::exception& e )
+    {
+      wlog( "Error parsing logging config. ${e}", ("e", e.to_string()) );
+    }
+
+    theApp.startup();
+    theApp.exec();
+    benchmark.finish();
+    return 0;
+  }
+  catch ( const boost::exception& e )
+  {
+    std::cerr << boost::diagnostic_information(e) << "\n";
+  }
+  catch ( const fc::exception& e )
+  {
+    std::cerr << e.to_detail_string() << "\n";
+  }
+  catch ( const std::exception& e )
+  {
+    std::cerr << e.what() << "\n";
+  }
+  catch ( ... )
+  {
+    std::cerr << "unknown exception\n";
+  }
+  return -1;
+}
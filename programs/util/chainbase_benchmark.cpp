@@ -0,0 +1,543 @@
+/*
+  * Micro-benchmarks of chainbase index operations and undo state handling on real chain objects.
+  *
+  * State is filled with account_object, comment_object, comment_vote_object and limit_order_object
+  * at (scaled) mainnet-like cardinalities and then each benchmark measures cost of a single operation:
+  *
+  *   <type>/find_by_id, <type>/find_by_key - random lookups by id and by main consensus key
+  *   <type>/emplace, <type>/modify, <type>/remove - mutations done inside undo session, like in node
+  *   <type>/undo_<mutation> - cost of reverting previous mutation (per object) when session is undone
+  *   undo/start_session - starting and undoing empty session
+  *   undo/squash - squashing transaction session (3 mixed mutations) into block session
+  *   undo/undo_block - undoing block session (per transaction it contained)
+  *   undo/commit - committing block sessions (per transaction)
+  *
+  * Besides time it reports shared memory used per operation and state of segment manager (used and
+  * free memory, largest free block and fragmentation) after filling the state and after the churn.
+  * Boost segment manager does not count allocations, so memory is reported in bytes only.
+  *
+  *   chainbase_benchmark --dir /dev/shm/bench --scale 0.1 --filter comment --json result.json
+  */
+#include <hive/chain/account_object.hpp>
+#include <hive/chain/comment_object.hpp>
+#include <hive/chain/hive_objects.hpp>
+
+#include <chainbase/chainbase.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace hive::chain;
+namespace bfs = boost::filesystem;
+using fc::time_point_sec;
+using hive::protocol::asset;
+using hive::protocol::price;
+
+namespace
+{
+  typedef std::chrono::steady_clock clock_type;
+
+  struct bench_result
+  {
+    std::string name;
+    uint64_t    iterations = 0;
+    double      ns_per_op = 0;
+    int64_t     bytes_per_op = 0;
+  };
+
+  struct segment_stats
+  {
+    std::string label;
+    uint64_t    size = 0;
+    uint64_t    used = 0;
+    uint64_t    free = 0;
+    uint64_t    largest_free_block = 0;
+    /// 1 - largest_free_block / free; 0 means all free memory is one contiguous block
+    double      fragmentation = 0;
+  };
+
+  struct bench_report
+  {
+    uint64_t                     accounts = 0;
+    uint64_t                     comments = 0;
+    uint64_t                     votes = 0;
+    uint64_t                     orders = 0;
+    std::vector< bench_result >  results;
+    std::vector< segment_stats > segment;
+  };
+}
+
+FC_REFLECT( bench_result, (name)(iterations)(ns_per_op)(bytes_per_op) )
+FC_REFLECT( segment_stats, (label)(size)(used)(free)(largest_free_block)(fragmentation) )
+FC_REFLECT( bench_report, (accounts)(comments)(votes)(orders)(results)(segment) )
+
+namespace
+{
+  struct bench_config
+  {
+    bfs::path   dir = bfs::temp_directory_path() / "chainbase_benchmark";
+    /// multiplies default cardinalities (1.5M accounts, 1M comments, 4M votes, 20k orders)
+    double      scale = 1.0;
+    uint64_t    ops = 100000;
+    std::string filter;
+    std::string json_file;
+  };
+
+  class benchmark
+  {
+    public:
+      explicit benchmark( const bench_config& cfg ) : _cfg( cfg ), _rng( 42 )
+      {
+        _accounts = std::max< uint64_t >( 100, 1500000 * cfg.scale );
+        _comments = std::max< uint64_t >( 100, 1000000 * cfg.scale );
+        _votes = std::min( std::max< uint64_t >( 100, 4000000 * cfg.scale ), _comments * _accounts / 2 );
+        _orders = std::max< uint64_t >( 100, 20000 * cfg.scale );
+        _report.accounts = _accounts;
+        _report.comments = _comments;
+        _report.votes = _votes;
+        _report.orders = _orders;
+      }
+
+      void run()
+      {
+        // objects with their index nodes take 200-500 bytes, undo state of the benchmarks needs a bit more
+        size_t file_size = ( _accounts * 1024 + _comments * 512 + _votes * 384 + _orders * 512 ) + 256 * 1024 * 1024;
+        _db.open( _cfg.dir, 0, file_size, nullptr, nullptr, true );
+        _db.add_index< account_index >();
+        _db.add_index< comment_index >();
+        _db.add_index< comment_vote_index >();
+        _db.add_index< limit_order_index >();
+
+        _db.with_write_lock( [&]()
+        {
+          fill();
+          record_segment( "filled" );
+
+          account_benchmarks();
+          comment_benchmarks();
+          vote_benchmarks();
+          order_benchmarks();
+          undo_benchmarks();
+
+          record_segment( "after churn" );
+        } );
+
+        _db.close();
+        _db.wipe( _cfg.dir );
+
+        if( !_cfg.json_file.empty() )
+          fc::json::save_to_file( _report, fc::path( _cfg.json_file ) );
+      }
+
+    private:
+      static std::string account_name( uint64_t i ) { return "acc" + std::to_string( i ); }
+      static std::string permlink( uint64_t i ) { return "post-" + std::to_string( i ); }
+
+      uint64_t author_of( uint64_t comment ) const { return comment % _accounts; }
+      /// votes are spread over comments, each comment gets votes from consecutive accounts, so (comment, voter) pairs are unique
+      uint64_t vote_comment( uint64_t vote ) const { return vote % _comments; }
+      uint64_t vote_voter( uint64_t vote ) const { return ( vote % _comments + vote / _comments ) % _accounts; }
+
+      uint64_t random( uint64_t n ) { return std::uniform_int_distribution< uint64_t >( 0, n - 1 )( _rng ); }
+
+      const account_object& account( uint64_t i ) const { return _db.get< account_object >( account_object::id_type( i ) ); }
+      const comment_object& comment( uint64_t i ) const { return _db.get< comment_object >( comment_object::id_type( i ) ); }
+
+      void create_comment( uint64_t i )
+      {
+        // every fifth comment is a root post, the rest are replies to earlier comments
+        if( i % 5 == 0 || i < 5 )
+          _db.create< comment_object >( account( author_of( i ) ), permlink( i ), fc::optional< std::reference_wrapper< const comment_object > >() );
+        else
+          _db.create< comment_object >( account( author_of( i ) ), permlink( i ), std::cref( comment( i - 1 - random( std::min< uint64_t >( i, 1000 ) ) ) ) );
+      }
+
+      void create_vote( uint64_t i )
+      {
+        _db.create< comment_vote_object >( [&]( comment_vote_object& cv )
+        {
+          cv.voter = account_object::id_type( vote_voter( i ) );
+          cv.comment = comment_object::id_type( vote_comment( i ) );
+          cv.rshares = 1000 + i % 1000;
+          cv.vote_percent = HIVE_100_PERCENT;
+          cv.last_update = _now;
+        } );
+      }
+
+      void create_order( uint64_t i )
+      {
+        asset for_sale( 1000 + i % 1000, HIVE_SYMBOL );
+        price sell_price( for_sale, asset( 250 + i % 500, HBD_SYMBOL ) );
+        _db.create< limit_order_object >( account_name( i % _accounts ), for_sale, sell_price, _now, _now + fc::days( 28 ), uint32_t( i ) );
+      }
+
+      void fill()
+      {
+        auto start = clock_type::now();
+        size_t used = used_memory();
+        for( uint64_t i = 0; i < _accounts; ++i )
+          _db.create< account_object >( account_name( i ), public_key_type() );
+        report_fill( "account", _accounts, used );
+
+        used = used_memory();
+        for( uint64_t i = 0; i < _comments; ++i )
+          create_comment( i );
+        report_fill( "comment", _comments, used );
+
+        used = used_memory();
+        for( uint64_t i = 0; i < _votes; ++i )
+          create_vote( i );
+        report_fill( "vote", _votes, used );
+
+        used = used_memory();
+        for( uint64_t i = 0; i < _orders; ++i )
+          create_order( i );
+        report_fill( "order", _orders, used );
+
+        std::cout << "filled state in " << std::chrono::duration< double >( clock_type::now() - start ).count() << " s" << std::endl;
+      }
+
+      void report_fill( const char* type, uint64_t count, size_t used_before )
+      {
+        std::cout << std::left << std::setw( 8 ) << type << std::right << std::setw( 10 ) << count
+                  << " objects, " << ( used_memory() - used_before ) / count << " bytes each" << std::endl;
+      }
+
+      /// runs op for given number of iterations and records time and shared memory growth per iteration
+      void measure( const std::string& name, uint64_t iterations, const std::function< void( uint64_t ) >& op )
+      {
+        if( !_cfg.filter.empty() && name.find( _cfg.filter ) == std::string::npos )
+          return;
+        iterations = std::max< uint64_t >( 1, iterations );
+
+        size_t used = used_memory();
+        auto start = clock_type::now();
+        for( uint64_t i = 0; i < iterations; ++i )
+          op( i );
+        double ns = std::chrono::duration< double, std::nano >( clock_type::now() - start ).count();
+
+        bench_result r;
+        r.name = name;
+        r.iterations = iterations;
+        r.ns_per_op = ns / iterations;
+        r.bytes_per_op = ( int64_t( used_memory() ) - int64_t( used ) ) / int64_t( iterations );
+        print( r );
+        _report.results.push_back( r );
+      }
+
+      /// measures mutation inside undo session and then undo of that session
+      void measure_in_session( const std::string& type, const std::string& mutation, uint64_t iterations,
+        const std::function< void( uint64_t ) >& op )
+      {
+        if( !_cfg.filter.empty() && ( type + "/" + mutation ).find( _cfg.filter ) == std::string::npos )
+          return;
+
+        iterations = std::max< uint64_t >( 1, iterations );
+        auto session = _db.start_undo_session();
+        measure( type + "/" + mutation, iterations, op );
+        // undo of whole session is one call, report it per reverted object
+        auto start = clock_type::now();
+        session.undo();
+        record( type + "/undo_" + mutation, iterations, std::chrono::duration< double, std::nano >( clock_type::now() - start ).count() );
+      }
+
+      /// distinct pseudo-random indexes from [0, n) for remove benchmarks
+      std::vector< uint64_t > distinct( uint64_t n, uint64_t count )
+      {
+        std::vector< uint64_t > result( n );
+        for( uint64_t i = 0; i < n; ++i )
+          result[i] = i;
+        std::shuffle( result.begin(), result.end(), _rng );
+        result.resize( std::min( n, count ) );
+        return result;
+      }
+
+      void account_benchmarks()
+      {
+        const uint64_t ops = _cfg.ops;
+        measure( "account/find_by_id", ops, [&]( uint64_t ) { _checksum += _db.find< account_object >( account_object::id_type( random( _accounts ) ) )->comment_count; } );
+        measure( "account/find_by_key", ops, [&]( uint64_t ) { _checksum += _db.find< account_object, by_name >( account_name_type( account_name( random( _accounts ) ) ) )->comment_count; } );
+        measure_in_session( "account", "emplace", ops, [&]( uint64_t i ) { _db.create< account_object >( "new" + std::to_string( i ), public_key_type() ); } );
+        measure_in_session( "account", "modify", ops, [&]( uint64_t )
+        {
+          _db.modify( account( random( _accounts ) ), [&]( account_object& a )
+          {
+            a.balance.amount += 1;
+            a.last_vote_time = _now;
+          } );
+        } );
+        auto victims = distinct( _accounts, ops );
+        measure_in_session( "account", "remove", victims.size(), [&]( uint64_t i ) { _db.remove( account( victims[i] ) ); } );
+      }
+
+      void comment_benchmarks()
+      {
+        const uint64_t ops = _cfg.ops;
+        measure( "comment/find_by_id", ops, [&]( uint64_t ) { _checksum += _db.find< comment_object >( comment_object::id_type( random( _comments ) ) )->get_depth(); } );
+        measure( "comment/find_by_key", ops, [&]( uint64_t )
+        {
+          uint64_t i = random( _comments );
+          auto hash = comment_object::compute_author_and_permlink_hash( account_object::id_type( author_of( i ) ), permlink( i ) );
+          _checksum += _db.find< comment_object, by_permlink >( hash )->get_depth();
+        } );
+        measure_in_session( "comment", "emplace", ops, [&]( uint64_t i ) { create_comment( _comments + i ); } );
+        measure_in_session( "comment", "modify", ops, [&]( uint64_t )
+        {
+          _db.modify( comment( random( _comments ) ), []( comment_object& ) {} );
+        } );
+        auto victims = distinct( _comments, ops );
+        measure_in_session( "comment", "remove", victims.size(), [&]( uint64_t i ) { _db.remove( comment( victims[i] ) ); } );
+      }
+
+      void vote_benchmarks()
+      {
+        const uint64_t ops = _cfg.ops;
+        measure( "vote/find_by_id", ops, [&]( uint64_t ) { _checksum += _db.find< comment_vote_object >( comment_vote_object::id_type( random( _votes ) ) )->rshares; } );
+        measure( "vote/find_by_key", ops, [&]( uint64_t )
+        {
+          uint64_t i = random( _votes );
+          _checksum += _db.find< comment_vote_object, by_comment_voter >(
+            boost::make_tuple( comment_object::id_type( vote_comment( i ) ), account_object::id_type( vote_voter( i ) ) ) )->rshares;
+        } );
+        // new votes continue the pattern of existing ones, so they don't collide with them
+        measure_in_session( "vote", "emplace", std::min( ops, _comments * _accounts / 2 - _votes ), [&]( uint64_t i ) { create_vote( _votes + i ); } );
+        measure_in_session( "vote", "modify", ops, [&]( uint64_t )
+        {
+          _db.modify( _db.get< comment_vote_object >( comment_vote_object::id_type( random( _votes ) ) ), [&]( comment_vote_object& cv )
+          {
+            cv.rshares += 1;
+            cv.last_update = _now;
+            ++cv.num_changes;
+          } );
+        } );
+        auto victims = distinct( _votes, ops );
+        measure_in_session( "vote", "remove", victims.size(), [&]( uint64_t i )
+        {
+          _db.remove( _db.get< comment_vote_object >( comment_vote_object::id_type( victims[i] ) ) );
+        } );
+      }
+
+      void order_benchmarks()
+      {
+        const uint64_t ops = _cfg.ops;
+        measure( "order/find_by_id", ops, [&]( uint64_t ) { _checksum += _db.find< limit_order_object >( limit_order_object::id_type( random( _orders ) ) )->orderid; } );
+        measure( "order/find_by_key", ops, [&]( uint64_t )
+        {
+          uint64_t i = random( _orders );
+          _checksum += _db.find< limit_order_object, by_account >( boost::make_tuple( account_name_type( account_name( i % _accounts ) ), uint32_t( i ) ) )->orderid;
+        } );
+        measure_in_session( "order", "emplace", ops, [&]( uint64_t i ) { create_order( _orders + i ); } );
+        measure_in_session( "order", "modify", ops, [&]( uint64_t )
+        {
+          _db.modify( _db.get< limit_order_object >( limit_order_object::id_type( random( _orders ) ) ), []( limit_order_object& o )
+          {
+            o.for_sale -= 1;
+          } );
+        } );
+        auto victims = distinct( _orders, ops );
+        measure_in_session( "order", "remove", victims.size(), [&]( uint64_t i )
+        {
+          _db.remove( _db.get< limit_order_object >( limit_order_object::id_type( victims[i] ) ) );
+        } );
+      }
+
+      /// mutations typical for single transaction: balance change, vote change and new market order
+      void transaction_mutations()
+      {
+        _db.modify( account( random( _accounts ) ), [&]( account_object& a ) { a.balance.amount += 1; } );
+        _db.modify( _db.get< comment_vote_object >( comment_vote_object::id_type( random( _votes ) ) ), [&]( comment_vote_object& cv ) { cv.rshares += 1; } );
+        create_order( _orders + _new_orders++ );
+      }
+
+      void undo_benchmarks()
+      {
+        const uint64_t ops = _cfg.ops;
+        const uint64_t transactions_per_block = 100;
+        const uint64_t blocks = std::max< uint64_t >( 2, ops / transactions_per_block );
+
+        measure( "undo/start_session", ops, [&]( uint64_t )
+        {
+          auto session = _db.start_undo_session();
+          session.undo();
+        } );
+
+        if( !_cfg.filter.empty() && std::string( "undo/squash undo/undo_block undo/commit" ).find( _cfg.filter ) == std::string::npos )
+          return;
+
+        // blocks of transactions, each in its own session squashed into session of block, like in node
+        const int64_t first_revision = _db.revision();
+        double squash_ns = 0;
+        for( uint64_t b = 0; b < blocks; ++b )
+        {
+          auto block_session = _db.start_undo_session();
+          for( uint64_t t = 0; t < transactions_per_block; ++t )
+          {
+            auto tx_session = _db.start_undo_session();
+            transaction_mutations();
+            auto start = clock_type::now();
+            tx_session.squash();
+            squash_ns += std::chrono::duration< double, std::nano >( clock_type::now() - start ).count();
+          }
+          block_session.push();
+        }
+        record( "undo/squash", blocks * transactions_per_block, squash_ns );
+
+        // popping last block like during fork switch
+        auto start = clock_type::now();
+        _db.undo();
+        record( "undo/undo_block", transactions_per_block, std::chrono::duration< double, std::nano >( clock_type::now() - start ).count() );
+
+        // remaining blocks become irreversible
+        start = clock_type::now();
+        _db.commit( _db.revision() );
+        record( "undo/commit", ( blocks - 1 ) * transactions_per_block, std::chrono::duration< double, std::nano >( clock_type::now() - start ).count() );
+        FC_ASSERT( _db.revision() == first_revision + int64_t( blocks ) - 1 );
+      }
+
+      void record( const std::string& name, uint64_t iterations, double ns )
+      {
+        bench_result r;
+        r.name = name;
+        r.iterations = iterations;
+        r.ns_per_op = ns / iterations;
+        print( r );
+        _report.results.push_back( r );
+      }
+
+      void print( const bench_result& r )
+      {
+        if( !_header_printed )
+        {
+          std::cout << std::left << std::setw( 28 ) << "Benchmark" << std::right << std::setw( 14 ) << "Time"
+                    << std::setw( 14 ) << "Iterations" << std::setw( 12 ) << "Bytes/op" << std::endl
+                    << std::string( 68, '-' ) << std::endl;
+          _header_printed = true;
+        }
+        std::cout << std::left << std::setw( 28 ) << r.name << std::right << std::fixed << std::setprecision( 1 )
+                  << std::setw( 11 ) << r.ns_per_op << " ns" << std::setw( 14 ) << r.iterations
+                  << std::setw( 12 ) << r.bytes_per_op << std::endl;
+      }
+
+      size_t used_memory() const { return _db.get_max_memory() - _db.get_free_memory(); }
+
+      /// largest block segment manager is able to allocate, found by bisection
+      size_t largest_free_block()
+      {
+        auto* segment = _db.get_segment_manager();
+        size_t low = 0;
+        size_t high = segment->get_free_memory();
+        while( low < high )
+        {
+          size_t mid = low + ( high - low + 1 ) / 2;
+          void* p = segment->allocate( mid, std::nothrow );
+          if( p != nullptr )
+          {
+            segment->deallocate( p );
+            low = mid;
+          }
+          else
+          {
+            high = mid - 1;
+          }
+        }
+        return low;
+      }
+
+      void record_segment( const std::string& label )
+      {
+        segment_stats s;
+        s.label = label;
+        s.size = _db.get_max_memory();
+        s.free = _db.get_free_memory();
+        s.used = s.size - s.free;
+        s.largest_free_block = largest_free_block();
+        s.fragmentation = s.free ? 1.0 - double( s.largest_free_block ) / s.free : 0;
+        _report.segment.push_back( s );
+
+        std::cout << std::endl << "segment " << label << ": used " << s.used / ( 1024 * 1024 ) << " MB, free "
+                  << s.free / ( 1024 * 1024 ) << " MB, largest free block " << s.largest_free_block / ( 1024 * 1024 )
+                  << " MB, fragmentation " << std::setprecision( 2 ) << s.fragmentation * 100 << "%" << std::endl << std::endl;
+      }
+
+      bench_config       _cfg;
+      chainbase::database _db;
+      std::mt19937_64    _rng;
+      uint64_t           _accounts = 0;
+      uint64_t           _comments = 0;
+      uint64_t           _votes = 0;
+      uint64_t           _orders = 0;
+      uint64_t           _new_orders = 0;
+      time_point_sec     _now = time_point_sec( 1600000000 );
+      uint64_t           _checksum = 0;
+      bool               _header_printed = false;
+      bench_report       _report;
+  };
+
+  void usage()
+  {
+    std::cout << "Usage: chainbase_benchmark [--dir PATH] [--scale FACTOR] [--ops N] [--filter TEXT] [--json FILE]\n"
+                 "Fills shared memory file in PATH with accounts, comments, votes and limit orders (default\n"
+                 "cardinalities multiplied by FACTOR) and measures index operations and undo state handling.\n"
+                 "Only benchmarks with names containing TEXT are run when --filter is given.\n";
+  }
+}
+
+int main( int argc, char** argv )
+{
+  try
+  {
+    bench_config cfg;
+
+    for( int i = 1; i < argc; ++i )
+    {
+      std::string arg = argv[i];
+      auto value = [&]() -> std::string
+      {
+        if( i + 1 >= argc )
+          throw std::invalid_argument( "missing value of " + arg );
+        return argv[ ++i ];
+      };
+
+      if( arg == "--dir" )
+        cfg.dir = bfs::absolute( value() );
+      else if( arg == "--scale" )
+        cfg.scale = std::stod( value() );
+      else if( arg == "--ops" )
+        cfg.ops = std::stoull( value() );
+      else if( arg == "--filter" )
+        cfg.filter = value();
+      else if( arg == "--json" )
+        cfg.json_file = value();
+      else
+      {
+        usage();
+        return arg == "--help" ? 0 : 1;
+      }
+    }
+
+    if( cfg.scale <= 0 || cfg.ops == 0 )
+      throw std::invalid_argument( "scale and number of operations have to be positive" );
+
+    benchmark b( cfg );
+    b.run();
+    return 0;
+  }
+  catch( const fc::exception& e )
+  {
+    std::cerr << e.to_detail_string() << std::endl;
+    return 1;
+  }
+  catch( const std::exception& e )
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,111 @@
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <fc/crypto/sha256.hpp>
+
+#include <hive/protocol/block.hpp>
+#include <hive/protocol/hive_operations.hpp>
+
+/*
+ * Compares computation of transaction merkle root and transaction ids of a block done one
+ * transaction at a time (how it was done before batch hashing) with signed_block methods that
+ * use fc::sha256::hash_batch. Blocks of 1000 to 5000 transfer transactions are measured.
+ *
+ * Usage: merkle_benchmark [repetitions]
+ */
+
+using namespace hive::protocol;
+using std::vector;
+
+signed_block make_block( uint32_t num_tx )
+{
+  signed_block block;
+  block.transactions.resize( num_tx );
+  for( uint32_t i = 0; i < num_tx; ++i )
+  {
+    signed_transaction& tx = block.transactions[i];
+    tx.ref_block_num = uint16_t( i );
+    tx.ref_block_prefix = i * 2654435761u;
+    tx.expiration = fc::time_point_sec( 1600000000 + i );
+
+    transfer_operation op;
+    op.from = "alice";
+    op.to = "bob";
+    op.amount = asset( 1000 + i, HIVE_SYMBOL );
+    op.memo = std::string( i % 64, 'm' );
+    tx.operations.push_back( op );
+
+    signature_type sig;
+    for( size_t k = 0; k < sig.size(); ++k )
+      sig.data[k] = char( i + k );
+    tx.signatures.push_back( sig );
+  }
+  return block;
+}
+
+checksum_type sequential_merkle_root( const signed_block& block, vector< transaction_id_type >& ids )
+{
+  ids.clear();
+  for( const auto& tx : block.transactions )
+    ids.push_back( tx.id() );
+
+  vector< digest_type > digests;
+  for( const auto& tx : block.transactions )
+    digests.push_back( tx.merkle_digest() );
+
+  size_t count = digests.size();
+  while( count > 1 )
+  {
+    size_t k = 0;
+    for( size_t i = 0; i + 1 < count; i += 2 )
+      digests[k++] = digest_type::hash( std::make_pair( digests[i], digests[i+1] ) );
+    if( count & 1 )
+      digests[k++] = digests[count-1];
+    count = k;
+  }
+  return checksum_type::hash( digests[0] );
+}
+
+template< typename F >
+double measure( uint32_t repetitions, F&& f )
+{
+  auto start = std::chrono::steady_clock::now();
+  for( uint32_t r = 0; r < repetitions; ++r )
+    f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration< double, std::micro >( end - start ).count() / repetitions;
+}
+
+int main( int argc, char** argv )
+{
+  uint32_t repetitions = argc > 1 ? uint32_t( std::atoi( argv[1] ) ) : 20;
+  if( repetitions == 0 )
+    repetitions = 1;
+
+  std::cout << "batch hashing engine: " << fc::sha256::hash_batch_engine() << std::endl;
+  std::cout << "transactions  sequential[us]  batch[us]  speedup" << std::endl;
+
+  int errors = 0;
+  for( uint32_t num_tx = 1000; num_tx <= 5000; num_tx += 1000 )
+  {
+    signed_block block = make_block( num_tx );
+    vector< transaction_id_type > sequential_ids, batch_ids;
+    checksum_type sequential_root, batch_root;
+
+    double sequential_time = measure( repetitions, [&]() { sequential_root = sequential_merkle_root( block, sequential_ids ); } );
+    double batch_time = measure( repetitions, [&]() { batch_root = block.calculate_merkle_root( batch_ids ); } );
+
+    if( sequential_root != batch_root || sequential_ids != batch_ids )
+    {
+      std::cout << "results differ for block of " << num_tx << " transactions" << std::endl;
+      ++errors;
+    }
+
+    std::cout << num_tx << "  " << sequential_time << "  " << batch_time << "  " << sequential_time / batch_time << std::endl;
+  }
+
+  return errors == 0 ? 0 : 1;
+}
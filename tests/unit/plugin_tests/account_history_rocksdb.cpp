@@ -0,0 +1,219 @@
+#if defined IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <hive/plugins/account_history_rocksdb/account_history_rocksdb_plugin.hpp>
+
+#include <hive/utilities/tempdir.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <algorithm>
+
+#include "../db_fixture/database_fixture.hpp"
+
+using namespace hive::chain;
+using namespace hive::protocol;
+using hive::plugins::account_history_rocksdb::account_history_rocksdb_plugin;
+using hive::plugins::account_history_rocksdb::rocksdb_operation_object;
+
+// small queue, so chain thread has to wait for ingestion thread while blocks are produced
+#define AH_ROCKSDB_TEST_QUEUE_SIZE 4
+#define AH_ROCKSDB_TEST_QUEUE_SIZE_STR BOOST_PP_STRINGIZE( AH_ROCKSDB_TEST_QUEUE_SIZE )
+
+struct ah_rocksdb_fixture : public database_fixture
+{
+  ah_rocksdb_fixture( const fc::path& storage_path )
+  {
+    int argc = boost::unit_test::framework::master_test_suite().argc;
+    char** argv = boost::unit_test::framework::master_test_suite().argv;
+
+    for( int i = 1; i < argc; i++ )
+    {
+      const std::string arg = argv[ i ];
+      if( arg == "--record-assert-trip" )
+        fc::enable_record_assert_trip = true;
+      if( arg == "--show-test-names" )
+        std::cout << "running test " << boost::unit_test::framework::current_test_case().p_name << std::endl;
+    }
+
+    appbase::app().register_plugin< account_history_rocksdb_plugin >();
+    db_plugin = &appbase::app().register_plugin< hive::plugins::debug_node::debug_node_plugin >();
+    init_account_pub_key = init_account_priv_key.get_public_key();
+
+    // storage has absolute path, so it outlives data directory of the fixture
+    const std::string path = storage_path.string();
+    int test_argc = 7;
+    const char* test_argv[] = { boost::unit_test::framework::master_test_suite().argv[0],
+                        "--account-history-rocksdb-path", path.c_str(),
+                        "--account-history-rocksdb-async-ingestion", "true",
+                        "--account-history-rocksdb-ingestion-queue-size", AH_ROCKSDB_TEST_QUEUE_SIZE_STR };
+
+    db_plugin->logging = false;
+    appbase::app().initialize<
+      account_history_rocksdb_plugin,
+      hive::plugins::debug_node::debug_node_plugin >( test_argc, (char**)test_argv );
+
+    db = &appbase::app().get_plugin< hive::plugins::chain::chain_plugin >().db();
+    BOOST_REQUIRE( db );
+
+    ah = &appbase::app().get_plugin< account_history_rocksdb_plugin >();
+
+    open_database();
+  }
+
+  void init_witnesses()
+  {
+    generate_block();
+    db->set_hardfork( HIVE_NUM_HARDFORKS );
+    generate_block();
+
+    vest( "initminer", 10000 );
+
+    // Fill up the rest of the required miners
+    for( int i = HIVE_NUM_INIT_MINERS; i < HIVE_MAX_WITNESSES; i++ )
+    {
+      account_create( HIVE_INIT_MINER_NAME + fc::to_string( i ), init_account_pub_key );
+      fund( HIVE_INIT_MINER_NAME + fc::to_string( i ), HIVE_MIN_PRODUCER_REWARD.amount.value );
+      witness_create( HIVE_INIT_MINER_NAME + fc::to_string( i ), init_account_priv_key, "foo.bar", init_account_pub_key, HIVE_MIN_PRODUCER_REWARD.amount );
+    }
+
+    validate_database();
+  }
+
+  /// transfers 1, 2, ... count milli-TESTS from alice to bob, few in each block
+  void make_transfers( uint32_t count )
+  {
+    for( uint32_t i = 1; i <= count; ++i )
+    {
+      transfer( "alice", "bob", asset( i, HIVE_SYMBOL ) );
+      transfer_blocks.push_back( db->head_block_num() + 1 );
+      if( i % 3 == 0 )
+        generate_block();
+    }
+    generate_block();
+  }
+
+  /// number of transfers made in blocks up to given one
+  uint32_t count_transfers( uint32_t block_num ) const
+  {
+    return std::upper_bound( transfer_blocks.begin(), transfer_blocks.end(), block_num ) - transfer_blocks.begin();
+  }
+
+  void make_irreversible()
+  {
+    uint32_t head = db->head_block_num();
+    while( db->get_last_irreversible_block_num() < head )
+      generate_block();
+  }
+
+  /// amounts of transfers of given account kept in the storage, from the oldest
+  std::vector< share_type > get_stored_transfers( const std::string& account ) const
+  {
+    std::vector< share_type > result;
+    ah->find_account_history_data( account, std::numeric_limits< uint64_t >::max(), 1000, false,
+      [&]( unsigned int, const rocksdb_operation_object& obj ) -> bool
+      {
+        auto op = fc::raw::unpack_from_buffer< operation >( obj.serialized_op );
+        if( op.which() != operation::tag< transfer_operation >::value )
+          return false;
+        result.push_back( op.get< transfer_operation >().amount.amount );
+        return true;
+      } );
+    std::reverse( result.begin(), result.end() );
+    return result;
+  }
+
+  static std::vector< share_type > expected_transfers( uint32_t count )
+  {
+    std::vector< share_type > result;
+    for( uint32_t i = 1; i <= count; ++i )
+      result.push_back( i );
+    return result;
+  }
+
+  account_history_rocksdb_plugin* ah = nullptr;
+  std::vector< uint32_t >         transfer_blocks;
+};
+
+BOOST_AUTO_TEST_SUITE( account_history_rocksdb )
+
+BOOST_AUTO_TEST_CASE( async_ingestion_order )
+{
+  try
+  {
+    fc::temp_directory storage( hive::utilities::temp_directory_path() );
+    ah_rocksdb_fixture f( storage.path() / "ah" );
+    f.init_witnesses();
+    ACTORS_EXT( f, (alice)(bob) );
+    f.fund( "alice", ASSET( "1000.000 TESTS" ) );
+    f.generate_block();
+
+    const uint32_t count = 30;
+    f.make_transfers( count );
+    const uint32_t last_transfer_block = f.db->head_block_num();
+
+    BOOST_TEST_MESSAGE( "Stored LIB is never ahead of stored operations" );
+    while( f.ah->get_last_irreversible_block() < last_transfer_block )
+    {
+      f.generate_block();
+      // ingestion thread keeps working, so LIB is read before and after operations
+      uint32_t lib_before = f.ah->get_last_irreversible_block();
+      auto stored = f.get_stored_transfers( "alice" );
+      uint32_t lib_after = f.ah->get_last_irreversible_block();
+      BOOST_REQUIRE_LE( lib_after, f.db->get_last_irreversible_block_num() );
+      BOOST_REQUIRE_GE( stored.size(), f.count_transfers( lib_before ) );
+      BOOST_REQUIRE_LE( stored.size(), f.count_transfers( lib_after ) );
+      BOOST_REQUIRE( stored == ah_rocksdb_fixture::expected_transfers( stored.size() ) );
+    }
+
+    BOOST_TEST_MESSAGE( "Operations are stored in order they were applied" );
+    BOOST_REQUIRE( f.get_stored_transfers( "alice" ) == ah_rocksdb_fixture::expected_transfers( count ) );
+    BOOST_REQUIRE( f.get_stored_transfers( "bob" ) == ah_rocksdb_fixture::expected_transfers( count ) );
+
+    BOOST_TEST_MESSAGE( "Reads of reversible data see operations handed over to ingestion thread" );
+    f.transfer( "alice", "bob", asset( count + 1, HIVE_SYMBOL ) );
+    f.generate_block();
+    const uint32_t block = f.db->head_block_num();
+    f.make_irreversible();
+    uint32_t transfers = 0;
+    f.ah->find_operations_by_block( block, true, [&]( const rocksdb_operation_object& obj )
+    {
+      auto op = fc::raw::unpack_from_buffer< operation >( obj.serialized_op );
+      if( op.which() == operation::tag< transfer_operation >::value )
+        ++transfers;
+    } );
+    BOOST_REQUIRE_EQUAL( transfers, 1u );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( async_ingestion_shutdown_drain )
+{
+  try
+  {
+    fc::temp_directory storage( hive::utilities::temp_directory_path() );
+    const uint32_t count = 30;
+    uint32_t lib = 0;
+
+    {
+      ah_rocksdb_fixture f( storage.path() / "ah" );
+      f.init_witnesses();
+      ACTORS_EXT( f, (alice)(bob) );
+      f.fund( "alice", ASSET( "1000.000 TESTS" ) );
+      f.generate_block();
+      f.make_transfers( count );
+      f.make_irreversible();
+      lib = f.db->get_last_irreversible_block_num();
+      // no waiting for ingestion thread - destruction of the plugin has to store everything that was queued
+    }
+
+    BOOST_TEST_MESSAGE( "Operations queued before shutdown are in the storage after restart" );
+    ah_rocksdb_fixture f( storage.path() / "ah" );
+    BOOST_REQUIRE_EQUAL( f.ah->get_last_irreversible_block(), lib );
+    BOOST_REQUIRE( f.get_stored_transfers( "alice" ) == ah_rocksdb_fixture::expected_transfers( count ) );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -312,5 +312,98 @@ BOOST_AUTO_TEST_CASE( semantics_validation )
   FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( response_cache )
+{
+  try
+  {
+    auto& rpc = appbase::app().get_plugin< hive::plugins::json_rpc::json_rpc_plugin >();
+    auto get_stats = [&]() -> fc::variant_object
+    {
+      auto answer = fc::json::from_string( rpc.call( "{\"jsonrpc\":\"2.0\", \"method\":\"jsonrpc.get_cache_stats\", \"id\":1}" ) );
+      return answer[ "result" ].get_object();
+    };
+    auto get_block_request = []( uint32_t block_num )
+    {
+      return "{\"jsonrpc\":\"2.0\", \"method\":\"block_api.get_block\", \"params\":{\"block_num\":" + std::to_string( block_num ) + "}, \"id\":1}";
+    };
+
+    while( db->get_last_irreversible_block_num() < 2 )
+      generate_block();
+
+    BOOST_TEST_MESSAGE( "Methods that never returned cacheable response bypass the cache" );
+    auto stats = get_stats();
+    std::string dgpo_request = "{\"jsonrpc\":\"2.0\", \"method\":\"database_api.get_dynamic_global_properties\", \"id\":1}";
+    rpc.call( dgpo_request );
+    rpc.call( dgpo_request );
+    auto after = get_stats();
+    BOOST_REQUIRE_EQUAL( after[ "misses" ].as_uint64(), stats[ "misses" ].as_uint64() );
+    BOOST_REQUIRE_EQUAL( after[ "hits" ].as_uint64(), stats[ "hits" ].as_uint64() );
+    BOOST_REQUIRE_EQUAL( after[ "entries" ].as_uint64(), stats[ "entries" ].as_uint64() );
+
+    BOOST_TEST_MESSAGE( "Response about irreversible block is served from the cache with the same bytes" );
+    std::string first = rpc.call( get_block_request( 2 ) );
+    stats = get_stats();
+    BOOST_REQUIRE_EQUAL( stats[ "entries" ].as_uint64(), after[ "entries" ].as_uint64() + 1 );
+    std::string second = rpc.call( get_block_request( 2 ) );
+    after = get_stats();
+    BOOST_REQUIRE_EQUAL( second, first );
+    BOOST_REQUIRE_EQUAL( after[ "hits" ].as_uint64(), stats[ "hits" ].as_uint64() + 1 );
+    // the same params in different form give the same key
+    std::string reordered = rpc.call( "{\"jsonrpc\":\"2.0\", \"id\":1, \"params\":{\"block_num\":2}, \"method\":\"block_api.get_block\"}" );
+    BOOST_REQUIRE_EQUAL( reordered, first );
+    BOOST_REQUIRE_EQUAL( get_stats()[ "hits" ].as_uint64(), after[ "hits" ].as_uint64() + 1 );
+
+    BOOST_TEST_MESSAGE( "Response about reversible block is not cached, so new block replacing it is visible" );
+    uint32_t head = db->head_block_num();
+    BOOST_REQUIRE( db->get_last_irreversible_block_num() < head );
+    stats = get_stats();
+    auto old_block = fc::json::from_string( rpc.call( get_block_request( head ) ) );
+    BOOST_REQUIRE_EQUAL( get_stats()[ "entries" ].as_uint64(), stats[ "entries" ].as_uint64() );
+    BOOST_REQUIRE_EQUAL( old_block[ "result" ][ "block" ][ "block_id" ].as_string(), db->head_block_id().str() );
+
+    db->pop_block();
+    generate_block( 0, init_account_priv_key, 1 );
+    BOOST_REQUIRE_EQUAL( db->head_block_num(), head );
+    auto new_block = fc::json::from_string( rpc.call( get_block_request( head ) ) );
+    BOOST_REQUIRE_EQUAL( new_block[ "result" ][ "block" ][ "block_id" ].as_string(), db->head_block_id().str() );
+    BOOST_REQUIRE( new_block[ "result" ][ "block" ][ "block_id" ].as_string() != old_block[ "result" ][ "block" ][ "block_id" ].as_string() );
+
+    BOOST_TEST_MESSAGE( "Once the block becomes irreversible its response is cached" );
+    while( db->get_last_irreversible_block_num() < head )
+      generate_block();
+    stats = get_stats();
+    BOOST_REQUIRE_EQUAL( rpc.call( get_block_request( head ) ), rpc.call( get_block_request( head ) ) );
+    after = get_stats();
+    BOOST_REQUIRE_EQUAL( after[ "entries" ].as_uint64(), stats[ "entries" ].as_uint64() + 1 );
+    BOOST_REQUIRE_EQUAL( after[ "hits" ].as_uint64(), stats[ "hits" ].as_uint64() + 1 );
+
+    BOOST_TEST_MESSAGE( "Cacheable result of nested call does not make response of the outer method cacheable" );
+    std::string condenser_request = "{\"jsonrpc\":\"2.0\", \"method\":\"condenser_api.get_block\", \"params\":[2], \"id\":1}";
+    stats = get_stats();
+    auto condenser_block = fc::json::from_string( rpc.call( condenser_request ) );
+    BOOST_REQUIRE( condenser_block[ "result" ].is_object() );
+    rpc.call( condenser_request );
+    after = get_stats();
+    BOOST_REQUIRE_EQUAL( after[ "entries" ].as_uint64(), stats[ "entries" ].as_uint64() );
+    BOOST_REQUIRE_EQUAL( after[ "hits" ].as_uint64(), stats[ "hits" ].as_uint64() );
+    // block_api itself is still answered from the cache
+    BOOST_REQUIRE_EQUAL( rpc.call( get_block_request( 2 ) ), first );
+    BOOST_REQUIRE_EQUAL( get_stats()[ "hits" ].as_uint64(), after[ "hits" ].as_uint64() + 1 );
+
+    {
+      hive::plugins::json_rpc::api_call_scope outer;
+      {
+        hive::plugins::json_rpc::api_call_scope nested;
+        hive::plugins::json_rpc::mark_response_cacheable();
+        BOOST_REQUIRE( nested.is_response_cacheable() );
+      }
+      BOOST_REQUIRE( !outer.is_response_cacheable() );
+      hive::plugins::json_rpc::mark_response_cacheable();
+      BOOST_REQUIRE( outer.is_response_cacheable() );
+    }
+  }
+  FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif
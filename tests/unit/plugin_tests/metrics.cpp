@@ -0,0 +1,174 @@
+#ifdef IS_TEST_NET
+#include <boost/test/unit_test.hpp>
+
+#include <hive/plugins/statsd/metrics.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using hive::plugins::statsd::histogram_metric;
+using hive::plugins::statsd::metrics_registry;
+
+BOOST_AUTO_TEST_SUITE( metrics )
+
+BOOST_AUTO_TEST_CASE( histogram_buckets )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Small values have their own buckets" );
+    for( uint64_t value = 0; value < histogram_metric::sub_buckets; ++value )
+    {
+      BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( value ), value );
+      BOOST_REQUIRE_EQUAL( histogram_metric::bucket_upper_bound( value ), value + 1 );
+    }
+
+    BOOST_TEST_MESSAGE( "Each power of two range is split into sub-buckets" );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( 4 ), 4u );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( 7 ), 7u );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( 8 ), 8u );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( 9 ), 8u );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( 10 ), 9u );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( 1000 ), histogram_metric::bucket_index( 1023 ) );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( 1024 ), histogram_metric::bucket_index( 1023 ) + 1 );
+
+    BOOST_TEST_MESSAGE( "Buckets cover value range without gaps and both of their bounds map back to them" );
+    uint64_t lower = 0;
+    for( uint32_t i = 0; i < histogram_metric::bucket_count; ++i )
+    {
+      uint64_t upper = histogram_metric::bucket_upper_bound( i );
+      BOOST_REQUIRE_GT( upper, lower );
+      BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( lower ), i );
+      BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( upper - 1 ), i );
+      // relative width of a bucket (error of reported value) is at most 25%
+      if( lower >= histogram_metric::sub_buckets )
+        BOOST_REQUIRE_LE( ( upper - lower ) * 4, lower );
+      lower = upper;
+    }
+    BOOST_REQUIRE_EQUAL( lower, uint64_t( 1 ) << histogram_metric::max_value_bits );
+
+    BOOST_TEST_MESSAGE( "Values above the range are clamped to the last bucket" );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( lower ), histogram_metric::bucket_count - 1 );
+    BOOST_REQUIRE_EQUAL( histogram_metric::bucket_index( std::numeric_limits< uint64_t >::max() ), histogram_metric::bucket_count - 1 );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( histogram_percentiles )
+{
+  try
+  {
+    histogram_metric histogram( "test.percentiles", "test" );
+
+    BOOST_TEST_MESSAGE( "Empty histogram reports zeros" );
+    auto empty = histogram.get_snapshot();
+    BOOST_REQUIRE_EQUAL( empty.count, 0u );
+    BOOST_REQUIRE_EQUAL( empty.percentile( 0.5 ), 0u );
+    BOOST_REQUIRE_EQUAL( empty.max(), 0u );
+
+    BOOST_TEST_MESSAGE( "Percentiles are upper bounds of buckets that hold exact value" );
+    for( uint64_t value = 1; value <= 100; ++value )
+      histogram.record( value );
+    auto snap = histogram.get_snapshot();
+    BOOST_REQUIRE_EQUAL( snap.count, 100u );
+    BOOST_REQUIRE_EQUAL( snap.sum, 5050u );
+    BOOST_REQUIRE_EQUAL( snap.percentile( 0.5 ), 55u );  // 50 is in [48, 56)
+    BOOST_REQUIRE_EQUAL( snap.percentile( 0.9 ), 95u );  // 90 is in [80, 96)
+    BOOST_REQUIRE_EQUAL( snap.percentile( 0.99 ), 111u ); // 99 is in [96, 112)
+    BOOST_REQUIRE_EQUAL( snap.percentile( 1.0 ), 111u );
+    BOOST_REQUIRE_EQUAL( snap.percentile( 0.0 ), 1u );    // at least one sample is taken
+    BOOST_REQUIRE_EQUAL( snap.max(), 111u );
+    for( double fraction : { 0.1, 0.25, 0.5, 0.75, 0.9, 0.99 } )
+    {
+      uint64_t exact = uint64_t( fraction * 100 );
+      BOOST_REQUIRE_GE( snap.percentile( fraction ), exact );
+      BOOST_REQUIRE_LE( snap.percentile( fraction ), exact + exact / 4 );
+    }
+
+    BOOST_TEST_MESSAGE( "Negative durations are recorded as zero" );
+    histogram.record( fc::microseconds( -5 ) );
+    histogram.record( fc::microseconds( 2000 ) );
+
+    BOOST_TEST_MESSAGE( "Difference of snapshots holds only values recorded in between" );
+    auto delta = histogram.get_snapshot() - snap;
+    BOOST_REQUIRE_EQUAL( delta.count, 2u );
+    BOOST_REQUIRE_EQUAL( delta.sum, 2000u );
+    BOOST_REQUIRE_EQUAL( delta.buckets[0], 1u );
+    BOOST_REQUIRE_EQUAL( delta.percentile( 0.5 ), 0u );
+    BOOST_REQUIRE_EQUAL( delta.max(), histogram_metric::bucket_upper_bound( histogram_metric::bucket_index( 2000 ) ) - 1 );
+
+    BOOST_TEST_MESSAGE( "Values recorded by many threads are all accounted" );
+    histogram_metric shared( "test.threads", "test" );
+    std::vector< std::thread > threads;
+    for( int t = 0; t < 2 * HIVE_METRICS_STRIPES; ++t )
+      threads.emplace_back( [&shared]() { for( int i = 0; i < 1000; ++i ) shared.record( 10 ); } );
+    for( auto& t : threads )
+      t.join();
+    auto total = shared.get_snapshot();
+    BOOST_REQUIRE_EQUAL( total.count, 2u * HIVE_METRICS_STRIPES * 1000 );
+    BOOST_REQUIRE_EQUAL( total.buckets[ histogram_metric::bucket_index( 10 ) ], total.count );
+    BOOST_REQUIRE_EQUAL( total.sum, total.count * 10 );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( prometheus_export )
+{
+  try
+  {
+    auto& registry = metrics_registry::instance();
+    auto& counter = registry.counter( "test.export.calls", "Calls" );
+    auto& histogram = registry.histogram( "test.export.latency", "Latency" );
+    BOOST_REQUIRE( &registry.counter( "test.export.calls", "Calls" ) == &counter );
+    BOOST_REQUIRE_THROW( registry.gauge( "test.export.calls", "Calls" ), fc::exception );
+
+    auto histogram_lines = []( const std::string& text )
+    {
+      std::vector< std::string > result;
+      std::istringstream in( text );
+      std::string line;
+      while( std::getline( in, line ) )
+      {
+        if( line.compare( 0, 32, "hived_test_export_latency_bucket" ) == 0 )
+          result.push_back( line );
+      }
+      return result;
+    };
+
+    BOOST_TEST_MESSAGE( "All power of two buckets are exported even when histogram is empty" );
+    const size_t bucket_lines = histogram_metric::bucket_count / histogram_metric::sub_buckets + 1; // with +Inf
+    auto lines = histogram_lines( registry.to_prometheus() );
+    BOOST_REQUIRE_EQUAL( lines.size(), bucket_lines );
+    BOOST_REQUIRE_EQUAL( lines.front(), "hived_test_export_latency_bucket{le=\"3\"} 0" );
+    BOOST_REQUIRE_EQUAL( lines[1], "hived_test_export_latency_bucket{le=\"7\"} 0" );
+    BOOST_REQUIRE_EQUAL( lines[ bucket_lines - 2 ], "hived_test_export_latency_bucket{le=\"" +
+      std::to_string( ( uint64_t( 1 ) << histogram_metric::max_value_bits ) - 1 ) + "\"} 0" );
+    BOOST_REQUIRE_EQUAL( lines.back(), "hived_test_export_latency_bucket{le=\"+Inf\"} 0" );
+
+    BOOST_TEST_MESSAGE( "Same buckets with cumulative counts after values are recorded" );
+    counter.increment( 3 );
+    histogram.record( 2 );
+    histogram.record( 5 );
+    histogram.record( 100 );
+    std::string text = registry.to_prometheus();
+    lines = histogram_lines( text );
+    BOOST_REQUIRE_EQUAL( lines.size(), bucket_lines );
+    BOOST_REQUIRE_EQUAL( lines[0], "hived_test_export_latency_bucket{le=\"3\"} 1" );
+    BOOST_REQUIRE_EQUAL( lines[1], "hived_test_export_latency_bucket{le=\"7\"} 2" );
+    BOOST_REQUIRE_EQUAL( lines[4], "hived_test_export_latency_bucket{le=\"63\"} 2" );
+    BOOST_REQUIRE_EQUAL( lines[5], "hived_test_export_latency_bucket{le=\"127\"} 3" );
+    BOOST_REQUIRE_EQUAL( lines[ bucket_lines - 2 ], "hived_test_export_latency_bucket{le=\"" +
+      std::to_string( ( uint64_t( 1 ) << histogram_metric::max_value_bits ) - 1 ) + "\"} 3" );
+    BOOST_REQUIRE_EQUAL( lines.back(), "hived_test_export_latency_bucket{le=\"+Inf\"} 3" );
+    BOOST_REQUIRE( text.find( "hived_test_export_latency_sum 107\n" ) != std::string::npos );
+    BOOST_REQUIRE( text.find( "hived_test_export_latency_count 3\n" ) != std::string::npos );
+    BOOST_REQUIRE( text.find( "# TYPE hived_test_export_calls_total counter\nhived_test_export_calls_total 3\n" ) != std::string::npos );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
@@ -36,8 +36,15 @@
 #include <hive/chain/sps_objects.hpp>
 #include <hive/chain/transaction_object.hpp>
 
+#include <hive/chain/util/impacted.hpp>
+#include <hive/chain/util/notification_bus.hpp>
 #include <hive/chain/util/reward.hpp>
 
+#include <hive/utilities/ordered_pipeline.hpp>
+
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/message.hpp>
+
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/hex.hpp>
 #include "../db_fixture/database_fixture.hpp"
@@ -331,6 +338,19 @@ BOOST_AUTO_TEST_CASE( merkle_root )
 
   block.transactions.push_back( tx[9] );
   BOOST_CHECK( block.calculate_merkle_root() == c(dO) );
+
+  vector< transaction_id_type > ids;
+  BOOST_CHECK( block.calculate_merkle_root( ids ) == c(dO) );
+  BOOST_REQUIRE_EQUAL( ids.size(), num_tx );
+  for( uint32_t i=0; i<num_tx; i++ )
+    BOOST_CHECK( ids[i] == tx[i].id() );
+
+  // signatures are part of merkle digest but not of transaction id
+  block.transactions[3].signatures.push_back( signature_type() );
+  BOOST_CHECK( block.calculate_merkle_root() != c(dO) );
+  ids = block.calculate_transaction_ids();
+  BOOST_REQUIRE_EQUAL( ids.size(), num_tx );
+  BOOST_CHECK( ids[3] == tx[3].id() );
 }
 
 BOOST_AUTO_TEST_CASE( adjust_balance_test )
@@ -434,6 +454,336 @@ BOOST_AUTO_TEST_CASE( curation_weight_test )
 
 }
 
+BOOST_AUTO_TEST_CASE( authority_view_test )
+{
+  try
+  {
+    ACTORS( (alice)(bob) )
+
+    {
+      account_update_operation op;
+      op.account = "alice";
+      op.active = authority( 2, alice_private_key.get_public_key(), 1, "bob", 1 );
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      tx.set_expiration( db->head_block_time() + HIVE_MAX_TIME_UNTIL_EXPIRATION );
+      sign( tx, alice_private_key );
+      db->push_transaction( tx, 0 );
+    }
+
+    const auto& alice_auth = db->get< account_authority_object, by_account >( "alice" );
+    authority_view view( alice_auth.active );
+    BOOST_REQUIRE_EQUAL( view.weight_threshold, 2u );
+    BOOST_REQUIRE_EQUAL( view.key_auths.size(), 1u );
+    BOOST_REQUIRE_EQUAL( view.account_auths.size(), 1u );
+    BOOST_REQUIRE( view.to_authority() == authority( alice_auth.active ) );
+    BOOST_REQUIRE( authority_view().to_authority() == authority() );
+
+    uint32_t view_calls = 0;
+    authority_view_getter get_view = [&]( const string& name )
+    {
+      ++view_calls;
+      return authority_view( db->get< account_authority_object, by_account >( name ).active );
+    };
+    authority_getter get_copy = [&]( const string& name )
+    {
+      return authority( db->get< account_authority_object, by_account >( name ).active );
+    };
+
+    flat_set< public_key_type > sigs{ alice_private_key.get_public_key(), bob_private_key.get_public_key() };
+    flat_set< public_key_type > avail;
+    sign_state by_view( sigs, get_view, avail );
+    sign_state by_copy( sigs, get_copy, avail );
+    BOOST_REQUIRE( by_view.check_authority( "alice" ) );
+    BOOST_REQUIRE( by_copy.check_authority( "alice" ) );
+    BOOST_REQUIRE( !by_view.remove_unused_signatures() );
+    BOOST_REQUIRE( !by_copy.remove_unused_signatures() );
+
+    // accounts are resolved only once per sign_state
+    sign_state missing_bob( { alice_private_key.get_public_key() }, get_view, avail );
+    view_calls = 0;
+    BOOST_REQUIRE( !missing_bob.check_authority( "alice" ) );
+    BOOST_REQUIRE( !missing_bob.check_authority( "alice" ) );
+    BOOST_REQUIRE_EQUAL( view_calls, 2u );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( impacted_accounts_test )
+{
+  try
+  {
+    transfer_operation transfer;
+    transfer.from = "bob";
+    transfer.to = "alice";
+    transfer.amount = ASSET( "1.000 TESTS" );
+
+    vote_operation vote;
+    vote.voter = "carol";
+    vote.author = "alice";
+    vote.permlink = "test";
+    vote.weight = HIVE_100_PERCENT;
+
+    custom_json_operation custom;
+    custom.required_posting_auths = { "dave", "alice" };
+    custom.id = "test";
+    custom.json = "{}";
+
+    // small set must give the same result as flat_set based version
+    for( const operation& op : { operation( transfer ), operation( vote ), operation( custom ) } )
+    {
+      flat_set< account_name_type > expected;
+      hive::app::operation_get_impacted_accounts( op, expected );
+      hive::app::impacted_accounts impacted;
+      hive::app::operation_get_impacted_accounts( op, impacted );
+      BOOST_REQUIRE( std::equal( impacted.begin(), impacted.end(), expected.begin(), expected.end() ) );
+    }
+
+    hive::app::impacted_accounts impacted;
+    signed_transaction tx;
+    tx.operations = { transfer, vote, custom };
+    hive::app::transaction_get_impacted_accounts( tx, impacted );
+    BOOST_REQUIRE_EQUAL( impacted.size(), 4u );
+    BOOST_REQUIRE( impacted.count( "alice" ) && impacted.count( "bob" ) && impacted.count( "carol" ) && impacted.count( "dave" ) );
+    BOOST_REQUIRE( std::is_sorted( impacted.begin(), impacted.end() ) );
+
+    // notification computes the set once and shares it between handlers
+    operation transfer_op = transfer;
+    hive::chain::operation_notification note( transfer_op );
+    const auto& shared = note.get_impacted_accounts();
+    BOOST_REQUIRE_EQUAL( shared.size(), 2u );
+    BOOST_REQUIRE( &note.get_impacted_accounts() == &shared );
+
+    // pre notification of virtual operation hands the set over to post notification
+    hive::app::impacted_accounts handed_over;
+    BOOST_REQUIRE( note.take_impacted_accounts( handed_over ) );
+    hive::chain::operation_notification post_note( transfer_op );
+    post_note.set_impacted_accounts( std::move( handed_over ) );
+    BOOST_REQUIRE_EQUAL( post_note.get_impacted_accounts().size(), 2u );
+    BOOST_REQUIRE( post_note.get_impacted_accounts().count( "alice" ) && post_note.get_impacted_accounts().count( "bob" ) );
+    hive::chain::operation_notification unused_note( transfer_op );
+    BOOST_REQUIRE( !unused_note.take_impacted_accounts( handed_over ) );
+
+    // sets of all operations of a block are computed in one pass
+    signed_block block;
+    block.transactions.push_back( tx );
+    tx.operations = { vote };
+    block.transactions.push_back( tx );
+    hive::app::block_impacted_accounts batch;
+    BOOST_REQUIRE( !batch.has_block() );
+    batch.set_block( &block );
+    BOOST_REQUIRE_EQUAL( batch.size(), 4u );
+    BOOST_REQUIRE_EQUAL( batch[0].size(), 2u );
+    BOOST_REQUIRE_EQUAL( batch[1].size(), 2u );
+    BOOST_REQUIRE_EQUAL( batch[2].size(), 2u );
+    BOOST_REQUIRE( *batch[2].begin() == "alice" );
+    BOOST_REQUIRE( *( batch[2].end() - 1 ) == "dave" );
+    BOOST_REQUIRE( batch.get( 1, 0 ).begin() == batch[3].begin() );
+    BOOST_REQUIRE( *( batch.get( 1, 0 ).end() - 1 ) == "carol" );
+
+    // notification of block operation uses the batch
+    operation vote_op = vote;
+    hive::chain::operation_notification block_note( vote_op );
+    block_note.trx_in_block = 1;
+    block_note.op_in_trx = 0;
+    block_note.use_block_impacted_accounts( batch );
+    BOOST_REQUIRE( std::equal( block_note.get_impacted_accounts().begin(), block_note.get_impacted_accounts().end(),
+      batch[3].begin(), batch[3].end() ) );
+
+    // buffers are reused for next block
+    block.transactions.clear();
+    batch.set_block( &block );
+    BOOST_REQUIRE_EQUAL( batch.size(), 0u );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( ordered_pipeline_test )
+{
+  try
+  {
+    using hive::utilities::ordered_pipeline;
+
+    for( size_t workers : { 0, 1, 4 } )
+    {
+      std::vector< uint32_t > consumed;
+      std::atomic< uint32_t > in_flight_max( 0 );
+      std::atomic< uint32_t > in_flight( 0 );
+      {
+        ordered_pipeline< uint32_t, uint32_t > pipeline( workers, 8,
+          [&]( uint32_t& i )
+          {
+            // later items finish first, still they have to be consumed in order
+            boost::this_thread::sleep_for( boost::chrono::microseconds( ( 1000 - i ) % 7 * 50 ) );
+            return i * 2;
+          },
+          [&]( uint32_t& i, bool ) { consumed.push_back( i ); --in_flight; } );
+
+        for( uint32_t i = 0; i < 1000; ++i )
+        {
+          uint32_t current = ++in_flight;
+          if( current > in_flight_max )
+            in_flight_max = current;
+          pipeline.push( uint32_t( i ) );
+          BOOST_REQUIRE_LE( pipeline.size(), 8u );
+        }
+        pipeline.drain();
+        BOOST_REQUIRE_EQUAL( pipeline.size(), 0u );
+      }
+      BOOST_REQUIRE_EQUAL( consumed.size(), 1000u );
+      for( uint32_t i = 0; i < 1000; ++i )
+        BOOST_REQUIRE_EQUAL( consumed[i], i * 2 );
+      // producer was held back by full pipeline
+      BOOST_REQUIRE_LE( in_flight_max.load(), 9u );
+    }
+
+    // failure of a stage is reported to producer
+    ordered_pipeline< uint32_t, uint32_t > failing( 2, 4,
+      []( uint32_t& i ) { FC_ASSERT( i != 5 ); return i; },
+      []( uint32_t&, bool ) {} );
+    HIVE_REQUIRE_THROW(
+      {
+        for( uint32_t i = 0; i < 100; ++i )
+          failing.push( uint32_t( i ) );
+        failing.drain();
+      },
+      fc::assert_exception );
+    BOOST_REQUIRE( failing.failed() );
+    HIVE_REQUIRE_THROW( failing.drain(), fc::assert_exception );
+    failing.stop();
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( notification_channel_test )
+{
+  try
+  {
+    using hive::chain::util::notification_channel;
+    using hive::chain::util::notification_connection;
+    typedef std::vector< std::string > calls_t;
+
+    notification_channel< int > channel;
+    calls_t calls;
+    auto handler = [&calls]( const std::string& name )
+    {
+      return [&calls, name]( int value ) { calls.push_back( name + ":" + std::to_string( value ) ); };
+    };
+
+    BOOST_TEST_MESSAGE( "Handlers are called by group, then in order of subscription" );
+    auto late = channel.connect( 10, handler( "late" ), "late" );
+    auto first = channel.connect( -1, handler( "first" ), "first" );
+    auto second = channel.connect( -1, handler( "second" ), "second" );
+    auto early = channel.connect( -5, handler( "early" ), "early" );
+    channel( 1 );
+    BOOST_REQUIRE( calls == calls_t( { "early:1", "first:1", "second:1", "late:1" } ) );
+
+    BOOST_TEST_MESSAGE( "Disconnected handler is not called anymore" );
+    calls.clear();
+    first.disconnect();
+    BOOST_REQUIRE( !first.connected() );
+    BOOST_REQUIRE( second.connected() );
+    channel( 2 );
+    BOOST_REQUIRE( calls == calls_t( { "early:2", "second:2", "late:2" } ) );
+
+    BOOST_TEST_MESSAGE( "Handler can disconnect itself and handlers that follow it during dispatch" );
+    calls.clear();
+    notification_connection self;
+    self = channel.connect( -1, [&]( int value )
+    {
+      calls.push_back( "self:" + std::to_string( value ) );
+      self.disconnect();
+      late.disconnect();
+    }, "self" );
+    channel( 3 );
+    BOOST_REQUIRE( calls == calls_t( { "early:3", "second:3", "self:3" } ) );
+    calls.clear();
+    channel( 4 );
+    BOOST_REQUIRE( calls == calls_t( { "early:4", "second:4" } ) );
+
+    BOOST_TEST_MESSAGE( "Handler subscribed after others were disconnected keeps its place by group" );
+    calls.clear();
+    auto middle = channel.connect( -3, handler( "middle" ), "middle" );
+    channel( 5 );
+    BOOST_REQUIRE( calls == calls_t( { "early:5", "middle:5", "second:5" } ) );
+
+    BOOST_TEST_MESSAGE( "Handlers are recorded as spans while block is traced" );
+    hive::chain::util::apply_tracer tracer;
+    tracer.configure( 100, 0, fc::path() );
+    channel.set_tracer( &tracer );
+    calls.clear();
+    tracer.begin_block( 1 );
+    channel( 6 );
+    tracer.end_block();
+    BOOST_REQUIRE( calls == calls_t( { "early:6", "middle:6", "second:6" } ) );
+    calls_t spans;
+    for( const auto& e : tracer.get_trace( 1 ).traceEvents )
+    {
+      if( e.cat == "plugin" )
+        spans.push_back( e.name );
+    }
+    BOOST_REQUIRE( spans == calls_t( { "early", "middle", "second" } ) );
+
+    BOOST_TEST_MESSAGE( "Connection outliving its channel is not connected" );
+    notification_connection orphan;
+    {
+      notification_channel< int > temporary;
+      orphan = temporary.connect( 0, handler( "orphan" ), "orphan" );
+      BOOST_REQUIRE( orphan.connected() );
+    }
+    BOOST_REQUIRE( !orphan.connected() );
+    orphan.disconnect();
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( operation_notification_channel_test )
+{
+  try
+  {
+    using hive::chain::util::operation_notification_channel;
+    typedef std::vector< std::string > calls_t;
+
+    operation_notification_channel< operation_notification, operation > channel;
+    calls_t calls;
+    auto handler = [&calls]( const std::string& name )
+    {
+      return [&calls, name]( const operation_notification& ) { calls.push_back( name ); };
+    };
+
+    channel.connect( 0, handler( "all" ), "all" );
+    channel.connect( -1, handler( "transfer" ), "transfer", database::operation_tags< transfer_operation >() );
+    auto vote_or_transfer = channel.connect( 1, handler( "vote_or_transfer" ), "vote_or_transfer",
+      database::operation_tags< vote_operation, transfer_operation >() );
+
+    operation transfer = transfer_operation();
+    operation vote = vote_operation();
+    operation comment = comment_operation();
+
+    BOOST_TEST_MESSAGE( "Only handlers subscribed to type of operation are called, still in order of groups" );
+    channel( operation_notification( transfer ) );
+    BOOST_REQUIRE( calls == calls_t( { "transfer", "all", "vote_or_transfer" } ) );
+    calls.clear();
+    channel( operation_notification( vote ) );
+    BOOST_REQUIRE( calls == calls_t( { "all", "vote_or_transfer" } ) );
+    calls.clear();
+    channel( operation_notification( comment ) );
+    BOOST_REQUIRE( calls == calls_t( { "all" } ) );
+
+    BOOST_TEST_MESSAGE( "Disconnect removes handler from lists of all its operations" );
+    vote_or_transfer.disconnect();
+    calls.clear();
+    channel( operation_notification( transfer ) );
+    channel( operation_notification( vote ) );
+    BOOST_REQUIRE( calls == calls_t( { "transfer", "all", "all" } ) );
+
+    BOOST_TEST_MESSAGE( "Tags outside of operation variant are rejected" );
+    HIVE_REQUIRE_THROW( channel.connect( 0, handler( "bad" ), "bad", { -1 } ), fc::assert_exception );
+    HIVE_REQUIRE_THROW( channel.connect( 0, handler( "bad" ), "bad", { operation::count() } ), fc::assert_exception );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
 #ifndef ENABLE_STD_ALLOCATOR
 BOOST_AUTO_TEST_CASE( chain_object_size )
 {
@@ -525,4 +875,71 @@ BOOST_AUTO_TEST_CASE( chain_object_size )
 }
 #endif
 
+BOOST_AUTO_TEST_CASE( net_message_data_test )
+{
+  try
+  {
+    using graphene::net::message;
+    using graphene::net::message_data;
+    using graphene::net::message_header;
+
+    BOOST_TEST_MESSAGE( "Frame read from socket is adopted without copy and its padding is cleared" );
+    message_header header;
+    header.size = 5;
+    header.msg_type = graphene::net::closing_connection_message::type;
+    std::vector< char > frame( message_data::frame_size_for( header.size ), char( 0xff ) );
+    BOOST_REQUIRE_EQUAL( frame.size(), 16u );
+    memcpy( frame.data(), &header, sizeof( header ) );
+    memcpy( frame.data() + sizeof( header ), "hello", 5 );
+    const char* frame_buffer = frame.data();
+    message_data adopted( std::move( frame ) );
+    BOOST_REQUIRE( adopted.frame() == frame_buffer );
+    BOOST_REQUIRE_EQUAL( adopted.frame_size(), 16u );
+    BOOST_REQUIRE_EQUAL( adopted.size(), 5u );
+    BOOST_REQUIRE( std::string( adopted.begin(), adopted.end() ) == "hello" );
+    for( size_t i = sizeof( header ) + header.size; i < adopted.frame_size(); ++i )
+      BOOST_REQUIRE_EQUAL( adopted.frame()[i], 0 );
+    BOOST_REQUIRE( adopted.has_frame_for( header ) );
+
+    std::vector< char > short_frame( 12 );
+    memcpy( short_frame.data(), &header, sizeof( header ) );
+    HIVE_REQUIRE_THROW( message_data( std::move( short_frame ) ), fc::assert_exception );
+
+    BOOST_TEST_MESSAGE( "Message id is computed once and matches hash of the payload" );
+    message msg( graphene::net::closing_connection_message( "test" ) );
+    const auto& id = msg.id();
+    BOOST_REQUIRE( id == fc::ripemd160::hash( msg.data.data(), msg.data.size() ) );
+    BOOST_REQUIRE( &msg.id() == &id );
+    message copy = msg;
+    BOOST_REQUIRE_EQUAL( msg.data.use_count(), 2 );
+    BOOST_REQUIRE( &copy.id() == &id );
+    BOOST_REQUIRE( adopted.id() == fc::ripemd160::hash( "hello", 5 ) );
+
+    BOOST_TEST_MESSAGE( "Frame is shared while header is intact and built anew after header was changed" );
+    BOOST_REQUIRE( msg.data.has_frame_for( msg ) );
+    BOOST_REQUIRE( msg.data.with_frame_for( msg ).frame() == msg.data.frame() );
+    copy.msg_type = graphene::net::address_request_message::type;
+    BOOST_REQUIRE( !copy.data.has_frame_for( copy ) );
+    message_data rebuilt = copy.data.with_frame_for( copy );
+    BOOST_REQUIRE( rebuilt.frame() != msg.data.frame() );
+    BOOST_REQUIRE( rebuilt.has_frame_for( copy ) );
+    BOOST_REQUIRE( !rebuilt.has_frame_for( msg ) );
+    BOOST_REQUIRE_EQUAL( rebuilt.frame_size(), msg.data.frame_size() );
+    message_header rebuilt_header;
+    memcpy( &rebuilt_header, rebuilt.frame(), sizeof( rebuilt_header ) );
+    BOOST_REQUIRE_EQUAL( rebuilt_header.msg_type, copy.msg_type );
+    BOOST_REQUIRE_EQUAL( rebuilt_header.size, copy.size );
+    BOOST_REQUIRE( std::equal( rebuilt.begin(), rebuilt.end(), msg.data.begin(), msg.data.end() ) );
+    BOOST_REQUIRE( rebuilt.id() == id );
+    // frame of the original message is not affected
+    message_header original_header;
+    memcpy( &original_header, msg.data.frame(), sizeof( original_header ) );
+    BOOST_REQUIRE_EQUAL( original_header.msg_type, msg.msg_type );
+
+    copy.size = msg.size + 1;
+    HIVE_REQUIRE_THROW( copy.data.with_frame_for( copy ), fc::assert_exception );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -28,6 +28,7 @@
 
 #include <hive/protocol/exceptions.hpp>
 
+#include <hive/chain/comment_archive.hpp>
 #include <hive/chain/database.hpp>
 #include <hive/chain/hive_objects.hpp>
 #include <hive/chain/history_object.hpp>
@@ -246,6 +247,90 @@ BOOST_AUTO_TEST_CASE( fork_blocks )
   }
 }
 
+BOOST_AUTO_TEST_CASE( irreversible_fast_apply )
+{
+  try {
+    fc::temp_directory data_dir1( hive::utilities::temp_directory_path() );
+    fc::temp_directory data_dir2( hive::utilities::temp_directory_path() );
+
+    database db1;
+    witness::block_producer bp1( db1 );
+    db1._log_hardforks = false;
+    open_test_database( db1, data_dir1.path() );
+    database db2;
+    db2._log_hardforks = false;
+    open_test_database( db2, data_dir2.path() );
+
+    auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")) );
+    std::vector< signed_block > blocks;
+    for( uint32_t i = 0; i < 20; ++i )
+      blocks.push_back( bp1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing) );
+
+    flat_map< uint32_t, block_id_type > checkpoints;
+    checkpoints[ 15 ] = blocks[ 14 ].id();
+    db2.add_checkpoints( checkpoints );
+    BOOST_REQUIRE( db2.is_known_irreversible( 15 ) );
+    BOOST_REQUIRE( !db2.is_known_irreversible( 16 ) );
+
+    // blocks before fast apply run are still reversible and kept in fork database
+    for( uint32_t i = 0; i < 5; ++i )
+      PUSH_BLOCK( db2, blocks[i] );
+    // block must link to head
+    HIVE_REQUIRE_THROW( db2.push_irreversible_block( blocks[6] ), fc::exception );
+    BOOST_REQUIRE_EQUAL( db2.head_block_num(), 5u );
+    // block not signed by scheduled witness is rejected before anything is applied
+    signed_block forged = blocks[5];
+    forged.sign( fc::ecc::private_key::regenerate( fc::sha256::hash( string( "forged_key" ) ) ) );
+    HIVE_REQUIRE_THROW( db2.push_irreversible_block( forged ), fc::exception );
+    BOOST_REQUIRE_EQUAL( db2.head_block_id().str(), blocks[4].id().str() );
+
+    for( uint32_t i = 5; i < 10; ++i )
+      db2.push_irreversible_block( blocks[i] );
+    BOOST_REQUIRE_EQUAL( db2.head_block_id().str(), blocks[9].id().str() );
+
+    // properly signed block with transaction that cannot be applied is rejected, the node keeps going
+    signed_block invalid = blocks[10];
+    signed_transaction tx;
+    transfer_operation transfer;
+    transfer.from = "nobody";
+    transfer.to = HIVE_INIT_MINER_NAME;
+    transfer.amount = asset( 1, HIVE_SYMBOL );
+    tx.operations.push_back( transfer );
+    tx.set_expiration( invalid.timestamp + HIVE_MAX_TIME_UNTIL_EXPIRATION / 2 );
+    invalid.transactions.push_back( tx );
+    invalid.transaction_merkle_root = invalid.calculate_merkle_root();
+    invalid.sign( init_account_priv_key );
+    HIVE_REQUIRE_THROW( db2.push_irreversible_block( invalid ), fc::exception );
+    BOOST_REQUIRE_EQUAL( db2.head_block_id().str(), blocks[9].id().str() );
+    BOOST_REQUIRE_EQUAL( db2.get_dynamic_global_properties().head_block_number, 10u );
+    BOOST_REQUIRE( !db2.fetch_block_by_number( 11 ).valid() );
+
+    for( uint32_t i = 10; i < 15; ++i )
+      db2.push_irreversible_block( blocks[i] );
+    BOOST_REQUIRE_EQUAL( db2.head_block_id().str(), blocks[14].id().str() );
+    // undo state of each block is committed right after it is applied
+    BOOST_REQUIRE_EQUAL( db2.revision(), 15 );
+    // earlier reversible blocks were written to block log when fast apply started, the rest during apply
+    for( uint32_t i = 1; i <= 15; ++i )
+    {
+      auto block = db2.fetch_block_by_number( i );
+      BOOST_REQUIRE( block.valid() );
+      BOOST_REQUIRE_EQUAL( block->id().str(), blocks[i-1].id().str() );
+    }
+
+    // first regular block ends fast apply; following blocks can be undone again
+    for( uint32_t i = 15; i < 20; ++i )
+      PUSH_BLOCK( db2, blocks[i] );
+    BOOST_REQUIRE_EQUAL( db2.revision(), 20 );
+    BOOST_REQUIRE_EQUAL( db2.head_block_id().str(), db1.head_block_id().str() );
+    db2.pop_block();
+    BOOST_REQUIRE_EQUAL( db2.head_block_num(), 19u );
+  } catch (fc::exception& e) {
+    edump((e.to_detail_string()));
+    throw;
+  }
+}
+
 BOOST_AUTO_TEST_CASE( switch_forks_undo_create )
 {
   try {
@@ -911,5 +996,337 @@ BOOST_FIXTURE_TEST_CASE( generate_block_size, clean_database_fixture )
   FC_LOG_AND_RETHROW()
 }
 
+void reopen_database( database_fixture& fixture, bool comment_archive )
+{
+  fixture.db->close();
+  hive::chain::open_args args;
+  args.data_dir = fixture.data_dir->path();
+  args.shared_mem_dir = args.data_dir;
+  args.initial_supply = INITIAL_TEST_SUPPLY;
+  args.hbd_initial_supply = HBD_INITIAL_TEST_SUPPLY;
+  args.shared_file_size = 1024 * 1024 * database_fixture::shared_file_size_in_mb_512;
+  args.database_cfg = hive::utilities::default_database_configuration();
+  args.comment_archive = comment_archive;
+  fixture.db->open( args );
+}
+
+void make_irreversible( database_fixture& fixture )
+{
+  uint32_t head = fixture.db->head_block_num();
+  while( fixture.db->get_last_irreversible_block_num() < head )
+    fixture.generate_block();
+}
+
+BOOST_FIXTURE_TEST_CASE( comment_archive_paid_out, clean_database_fixture )
+{
+  try
+  {
+    ACTORS( (alice)(bob) )
+    generate_block();
+    reopen_database( *this, true );
+    BOOST_REQUIRE( db->get_comment_archive() != nullptr );
+
+    post_comment( "alice", "test", "title", "body", "test", alice_private_key );
+    generate_block();
+    comment_id_type id = db->get_comment( "alice", string( "test" ) ).get_id();
+    auto hash = db->get_comment( "alice", string( "test" ) ).get_author_and_permlink_hash();
+
+    BOOST_TEST_MESSAGE( "Paid out comment stays in shared memory until payout block becomes irreversible" );
+    generate_blocks( db->head_block_time() + HIVE_CASHOUT_WINDOW_SECONDS + HIVE_BLOCK_INTERVAL );
+    BOOST_REQUIRE( db->find_comment_cashout( id ) == nullptr );
+    BOOST_REQUIRE( db->get_last_irreversible_block_num() < db->head_block_num() );
+    BOOST_REQUIRE( ( db->find< comment_object, by_id >( id ) != nullptr ) );
+
+    BOOST_TEST_MESSAGE( "Undo of payout block brings back cashout of comment" );
+    db->pop_block();
+    BOOST_REQUIRE( db->find_comment_cashout( id ) != nullptr );
+    generate_block();
+    BOOST_REQUIRE( db->find_comment_cashout( id ) == nullptr );
+
+    BOOST_TEST_MESSAGE( "Comment is moved to archive once payout is irreversible" );
+    make_irreversible( *this );
+    BOOST_REQUIRE( ( db->find< comment_object, by_id >( id ) == nullptr ) );
+    BOOST_REQUIRE( ( db->find< comment_object, by_permlink >( hash ) == nullptr ) );
+    BOOST_REQUIRE_EQUAL( db->get_comment_archive()->get_comment_count(), 1u );
+    BOOST_REQUIRE( db->get_comment_archive()->get_last_irreversible_block() <= db->get_last_irreversible_block_num() );
+
+    BOOST_TEST_MESSAGE( "Lookups fall back to archive" );
+    const comment_object* archived = db->find_comment( "alice", string( "test" ) );
+    BOOST_REQUIRE( archived != nullptr );
+    BOOST_REQUIRE( archived->get_id() == id );
+    BOOST_REQUIRE( &db->get_comment( id ) == archived );
+    BOOST_REQUIRE( db->find_comment( "alice", string( "missing" ) ) == nullptr );
+    HIVE_REQUIRE_THROW( db->get_comment( "alice", string( "missing" ) ), fc::exception );
+
+    BOOST_TEST_MESSAGE( "API lookups get their own copies of archived comments" );
+    auto api_comment = db->find_comment_for_api( "alice", "test" );
+    BOOST_REQUIRE( api_comment != nullptr );
+    BOOST_REQUIRE( api_comment->get_id() == id );
+    BOOST_REQUIRE( api_comment.get() != archived );
+    BOOST_REQUIRE( db->find_comment_for_api( "alice", "missing" ) == nullptr );
+    BOOST_REQUIRE( db->find_comment_for_api( "nobody", "test" ) == nullptr );
+    post_comment( "alice", "memory", "title", "body", "test", alice_private_key );
+    generate_block();
+    BOOST_REQUIRE( db->find_comment_for_api( "alice", "memory" ).get() == db->find_comment( "alice", string( "memory" ) ) );
+
+    BOOST_TEST_MESSAGE( "Reply resolves archived parent" );
+    comment_operation reply;
+    reply.author = "bob";
+    reply.permlink = "reply";
+    reply.parent_author = "alice";
+    reply.parent_permlink = "test";
+    reply.title = "title";
+    reply.body = "body";
+    signed_transaction tx;
+    tx.operations.push_back( reply );
+    tx.set_expiration( db->head_block_time() + HIVE_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, bob_private_key );
+    db->push_transaction( tx, 0 );
+    generate_block();
+    const auto& bob_reply = db->get_comment( "bob", string( "reply" ) );
+    BOOST_REQUIRE( bob_reply.get_parent_id() == id );
+    BOOST_REQUIRE( bob_reply.get_root_id() == id );
+
+    BOOST_TEST_MESSAGE( "Undo of reversible blocks does not touch archived comments" );
+    BOOST_REQUIRE( db->get_last_irreversible_block_num() < db->head_block_num() );
+    db->pop_block();
+    BOOST_REQUIRE( db->find_comment( "bob", string( "reply" ) ) == nullptr );
+    BOOST_REQUIRE( db->find_comment( "alice", string( "test" ) ) != nullptr );
+
+    validate_database();
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( comment_archive_found_comments_stay_valid, clean_database_fixture )
+{
+  try
+  {
+    ACTORS( (alice) )
+    generate_block();
+    reopen_database( *this, true );
+
+    const uint32_t count = 40; // more than comments materialized by single thread used to be kept
+    for( uint32_t i = 0; i < count; ++i )
+    {
+      post_comment( "alice", "test" + std::to_string( i ), "title", "body", "test", alice_private_key );
+      generate_block();
+    }
+    generate_blocks( db->head_block_time() + HIVE_CASHOUT_WINDOW_SECONDS + HIVE_BLOCK_INTERVAL );
+    make_irreversible( *this );
+    BOOST_REQUIRE_EQUAL( db->get_comment_archive()->get_comment_count(), count );
+
+    const comment_object* first = db->find_comment( "alice", string( "test0" ) );
+    BOOST_REQUIRE( first != nullptr );
+    auto first_hash = first->get_author_and_permlink_hash();
+    std::vector< const comment_object* > found;
+    for( uint32_t i = 0; i < count; ++i )
+    {
+      found.push_back( db->find_comment( "alice", "test" + std::to_string( i ) ) );
+      BOOST_REQUIRE( found.back() != nullptr );
+    }
+    // all references are valid at the same time and repeated lookups return the same objects
+    BOOST_REQUIRE( found[ 0 ] == first );
+    BOOST_REQUIRE( first->get_author_and_permlink_hash() == first_hash );
+    for( uint32_t i = 0; i < count; ++i )
+    {
+      BOOST_REQUIRE( &db->get_comment( found[ i ]->get_id() ) == found[ i ] );
+      BOOST_REQUIRE( found[ i ]->get_author_and_permlink_hash() ==
+        comment_object::compute_author_and_permlink_hash( db->get_account( "alice" ).get_id(), "test" + std::to_string( i ) ) );
+    }
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( comment_archive_reopen, clean_database_fixture )
+{
+  try
+  {
+    ACTORS( (alice) )
+    generate_block();
+
+    post_comment( "alice", "test", "title", "body", "test", alice_private_key );
+    generate_block();
+    comment_id_type id = db->get_comment( "alice", string( "test" ) ).get_id();
+    generate_blocks( db->head_block_time() + HIVE_CASHOUT_WINDOW_SECONDS + HIVE_BLOCK_INTERVAL );
+    make_irreversible( *this );
+    BOOST_REQUIRE( db->get_comment_archive() == nullptr );
+    BOOST_REQUIRE( ( db->find< comment_object, by_id >( id ) != nullptr ) );
+
+    BOOST_TEST_MESSAGE( "Enabling archive on existing state moves comments paid out before" );
+    reopen_database( *this, true );
+    BOOST_REQUIRE( db->get_comment_archive() != nullptr );
+    BOOST_REQUIRE( ( db->find< comment_object, by_id >( id ) == nullptr ) );
+    BOOST_REQUIRE_EQUAL( db->get_comment_archive()->get_comment_count(), 1u );
+    BOOST_REQUIRE( db->get_comment( id ).get_author_and_permlink_hash() ==
+      comment_object::compute_author_and_permlink_hash( db->get_account( "alice" ).get_id(), "test" ) );
+
+    BOOST_TEST_MESSAGE( "Comment paid out while archive is enabled, but not irreversible at shutdown, is moved on next open" );
+    post_comment( "alice", "test2", "title", "body", "test", alice_private_key );
+    generate_block();
+    comment_id_type id2 = db->get_comment( "alice", string( "test2" ) ).get_id();
+    generate_blocks( db->head_block_time() + HIVE_CASHOUT_WINDOW_SECONDS + HIVE_BLOCK_INTERVAL );
+    BOOST_REQUIRE( db->find_comment_cashout( id2 ) == nullptr );
+    BOOST_REQUIRE( ( db->find< comment_object, by_id >( id2 ) != nullptr ) );
+    uint32_t lib = db->get_last_irreversible_block_num();
+
+    BOOST_TEST_MESSAGE( "Archive stays enabled when it exists, even if not requested" );
+    reopen_database( *this, false );
+    BOOST_REQUIRE( db->get_comment_archive() != nullptr );
+    BOOST_REQUIRE_EQUAL( db->head_block_num(), lib );
+    BOOST_REQUIRE( db->find_comment( "alice", string( "test" ) ) != nullptr );
+    // reopen rewinds to irreversible state, so payout of second comment is replayed by next blocks
+    make_irreversible( *this );
+    generate_blocks( db->head_block_time() + HIVE_CASHOUT_WINDOW_SECONDS + HIVE_BLOCK_INTERVAL );
+    make_irreversible( *this );
+    BOOST_REQUIRE( ( db->find< comment_object, by_id >( id2 ) == nullptr ) );
+    BOOST_REQUIRE( db->find_comment( "alice", string( "test2" ) ) != nullptr );
+    BOOST_REQUIRE_EQUAL( db->get_comment_archive()->get_comment_count(), 2u );
+
+    validate_database();
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( impacted_accounts_of_notifications, clean_database_fixture )
+{
+  try
+  {
+    ACTORS( (alice)(bob)(carol) )
+    fund( "alice", ASSET( "10.000 TESTS" ) );
+    fund( "bob", ASSET( "10.000 TESTS" ) );
+    generate_block();
+
+    // every handler has to see the same set as computed directly from the operation
+    uint32_t checked = 0;
+    uint32_t mismatched = 0;
+    auto check = [&]( const operation_notification& note )
+    {
+      flat_set< account_name_type > expected;
+      hive::app::operation_get_impacted_accounts( note.op, expected );
+      const auto& impacted = note.get_impacted_accounts();
+      if( !std::equal( impacted.begin(), impacted.end(), expected.begin(), expected.end() ) )
+        ++mismatched;
+      ++checked;
+    };
+    auto pre_handler = db->add_pre_apply_operation_handler( check, *db_plugin );
+    auto post_handler = db->add_post_apply_operation_handler( check, *db_plugin );
+
+    BOOST_TEST_MESSAGE( "Operations of block take impacted accounts from set computed for whole block" );
+    transfer( "alice", "bob", ASSET( "1.000 TESTS" ) );
+    transfer( "bob", "carol", ASSET( "1.000 TESTS" ) );
+    transfer( "alice", "carol", ASSET( "1.000 TESTS" ) );
+    generate_block();
+    BOOST_REQUIRE_EQUAL( db->fetch_block_by_number( db->head_block_num() )->transactions.size(), 3u );
+    BOOST_REQUIRE_GT( checked, 12u );
+    BOOST_REQUIRE_EQUAL( mismatched, 0u );
+
+    BOOST_TEST_MESSAGE( "Nested virtual operations get impacted accounts of their own pre notification" );
+    checked = 0;
+    operation outer = producer_reward_operation( "alice", ASSET( "1.000000 VESTS" ) );
+    operation inner = producer_reward_operation( "bob", ASSET( "1.000000 VESTS" ) );
+    db->pre_push_virtual_operation( outer );
+    db->pre_push_virtual_operation( inner );
+    db->post_push_virtual_operation( inner );
+    // the same object reused for next operation
+    inner = producer_reward_operation( "carol", ASSET( "1.000000 VESTS" ) );
+    db->pre_push_virtual_operation( inner );
+    db->post_push_virtual_operation( inner );
+    db->post_push_virtual_operation( outer );
+    BOOST_REQUIRE_EQUAL( checked, 6u );
+    BOOST_REQUIRE_EQUAL( mismatched, 0u );
+
+    pre_handler.disconnect();
+    post_handler.disconnect();
+  }
+  FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE( apply_trace, clean_database_fixture )
+{
+  try
+  {
+    auto& tracer = db->get_apply_tracer();
+    BOOST_REQUIRE( !tracer.is_enabled() );
+    generate_block();
+    BOOST_REQUIRE( !tracer.is_active() );
+
+    fc::temp_directory trace_dir( hive::utilities::temp_directory_path() );
+    tracer.configure( 10000, 0, trace_dir.path() );
+
+    signed_transaction tx;
+    tx.set_expiration( db->head_block_time() + HIVE_MAX_TIME_UNTIL_EXPIRATION );
+    transfer_operation op;
+    op.from = HIVE_INIT_MINER_NAME;
+    op.to = HIVE_TEMP_ACCOUNT;
+    op.amount = asset( 1000, HIVE_SYMBOL );
+    tx.operations.push_back( op );
+    sign( tx, init_account_priv_key );
+    db->push_transaction( tx, 0 );
+    BOOST_REQUIRE( !tracer.is_active() ); // only blocks are traced
+    generate_block();
+    generate_block();
+    BOOST_REQUIRE( !tracer.is_active() );
+
+    auto trace = tracer.get_trace( 1 );
+    BOOST_REQUIRE( !trace.traceEvents.empty() );
+    const auto& block = trace.traceEvents.back();
+    BOOST_REQUIRE_EQUAL( block.cat, "block" );
+    BOOST_REQUIRE_EQUAL( block.args[ "block" ].as< uint32_t >(), db->head_block_num() );
+    for( const auto& e : trace.traceEvents )
+    {
+      BOOST_REQUIRE_EQUAL( e.args[ "block" ].as< uint32_t >(), db->head_block_num() );
+      // all spans are nested in span of block
+      BOOST_REQUIRE( e.ts >= block.ts && e.ts + e.dur <= block.ts + block.dur );
+    }
+
+    auto find = [&]( const hive::chain::util::chrome_trace& t, const std::string& name ) -> const hive::chain::util::trace_event*
+    {
+      for( const auto& e : t.traceEvents )
+        if( e.name == name )
+          return &e;
+      return nullptr;
+    };
+    BOOST_REQUIRE( find( trace, "process_comment_cashout" ) != nullptr );
+    BOOST_REQUIRE( find( trace, "validate_block_header" ) != nullptr );
+    BOOST_REQUIRE( find( trace, "transaction" ) == nullptr );
+
+    // previous block contains the transfer
+    trace = tracer.get_trace( 2 );
+    const auto* trx = find( trace, "transaction" );
+    BOOST_REQUIRE( trx != nullptr );
+    BOOST_REQUIRE_EQUAL( trx->cat, "transaction" );
+    BOOST_REQUIRE_EQUAL( trx->args[ "trx_in_block" ].as< int32_t >(), 0 );
+    BOOST_REQUIRE_EQUAL( trx->args[ "block" ].as< uint32_t >(), db->head_block_num() - 1 );
+    size_t blocks = 0;
+    for( const auto& e : trace.traceEvents )
+      blocks += e.cat == "block";
+    BOOST_REQUIRE_EQUAL( blocks, 2u );
+
+    // ring buffer keeps only the most recent spans
+    tracer.configure( 8, 0, trace_dir.path() );
+    generate_block();
+    trace = tracer.get_trace( 1 );
+    BOOST_REQUIRE_EQUAL( trace.traceEvents.size(), 8u );
+    BOOST_REQUIRE_EQUAL( trace.traceEvents.back().cat, "block" );
+
+    // slow blocks are written to trace directory
+    tracer.configure( 10000, 1, trace_dir.path() );
+    auto slow_handler = db->add_post_apply_block_handler( []( const block_notification& )
+    {
+      fc::usleep( fc::milliseconds( 5 ) );
+    }, *db_plugin );
+    generate_block();
+    slow_handler.disconnect();
+    tracer.wait_for_dumps(); // trace is written in background
+    fc::path trace_file = trace_dir.path() / ( "block_" + std::to_string( db->head_block_num() ) + ".trace.json" );
+    BOOST_REQUIRE( fc::exists( trace_file ) );
+    trace = fc::json::from_file( trace_file ).as< hive::chain::util::chrome_trace >();
+    BOOST_REQUIRE( find( trace, db_plugin->get_name() + "<-block" ) != nullptr );
+    BOOST_REQUIRE( trace.traceEvents.back().dur >= 5000 );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif
@@ -172,7 +172,7 @@ struct curation_rewards_handler
 
   std::vector<comment_reward_info>          comment_rewards;
 
-  boost::signals2::connection               _comment_reward_con;
+  hive::chain::util::notification_connection               _comment_reward_con;
 
   void preparation( bool enter )
   {
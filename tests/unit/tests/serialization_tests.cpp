@@ -31,6 +31,8 @@
 
 #include <hive/plugins/condenser_api/condenser_api_legacy_asset.hpp>
 #include <hive/plugins/condenser_api/condenser_api_legacy_objects.hpp>
+#include <hive/plugins/condenser_api/condenser_api_legacy_json.hpp>
+#include <hive/plugins/condenser_api/condenser_api.hpp>
 
 #include <fc/crypto/digest.hpp>
 #include <fc/crypto/elliptic.hpp>
@@ -626,6 +628,74 @@ BOOST_AUTO_TEST_CASE( legacy_operation_test )
   FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( legacy_json_writer_test )
+{
+  try
+  {
+    using namespace hive::plugins;
+
+    ACTORS( (alice)(bob) )
+    fund( "alice", ASSET( "10.000 TESTS" ) );
+    generate_block();
+
+    signed_transaction tx;
+    transfer_operation transfer;
+    transfer.from = "alice";
+    transfer.to = "bob";
+    transfer.amount = ASSET( "1.000 TESTS" );
+    transfer.memo = "\"quoted\" memo";
+    tx.operations.push_back( transfer );
+    custom_json_operation custom;
+    custom.required_posting_auths.insert( "alice" );
+    custom.id = "test";
+    custom.json = "{\"a\":[1,2]}";
+    tx.operations.push_back( custom );
+    tx.set_expiration( db->head_block_time() + HIVE_MAX_TIME_UNTIL_EXPIRATION );
+    sign( tx, alice_private_key );
+    db->push_transaction( tx, 0 );
+    generate_block();
+
+    auto block = db->fetch_block_by_number( db->head_block_num() );
+    BOOST_REQUIRE( block.valid() && block->transactions.size() == 1 );
+    block_api::api_signed_block_object api_block( *block );
+
+    condenser_api::legacy_signed_block legacy_block( api_block );
+    for( uint32_t i = 0; i < legacy_block.transactions.size(); ++i )
+    {
+      legacy_block.transactions[i].transaction_id = api_block.transactions[i].id();
+      legacy_block.transactions[i].block_num = api_block.block_num();
+      legacy_block.transactions[i].transaction_num = i;
+    }
+
+    std::string json;
+    condenser_api::write_legacy_block( json, api_block );
+    BOOST_REQUIRE_EQUAL( json, fc::json::to_string( legacy_block ) );
+
+    std::multiset< account_history::api_operation_object > ops;
+    std::vector< condenser_api::api_operation_object > legacy_ops;
+    uint32_t op_in_trx = 0;
+    for( const auto& op : block->transactions[0].operations )
+    {
+      account_history::api_operation_object op_obj;
+      op_obj.trx_id = api_block.transaction_ids[0];
+      op_obj.block = api_block.block_num();
+      op_obj.op_in_trx = op_in_trx++;
+      op_obj.timestamp = block->timestamp;
+      op_obj.op = op;
+      ops.insert( op_obj );
+
+      condenser_api::legacy_operation l_op;
+      op.visit( condenser_api::legacy_operation_conversion_visitor( l_op ) );
+      legacy_ops.emplace_back( op_obj, l_op );
+    }
+
+    json.clear();
+    condenser_api::write_legacy_operations( json, ops );
+    BOOST_REQUIRE_EQUAL( json, fc::json::to_string( legacy_ops ) );
+  }
+  FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_CASE( asset_symbol_type_test )
 {
   try